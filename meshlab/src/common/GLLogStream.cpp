@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <QStringList>
+#include <QMutexLocker>
 
 #include "GLLogStream.h"
 
@@ -59,12 +60,14 @@ void GLLogStream::RealTimeLogf(const QString& Id, const QString &meshName, const
 
 void GLLogStream::RealTimeLog(const QString& Id, const QString &meshName, const QString& text)
 {
+  QMutexLocker lock(&mutex);
   this->RealTimeLogText.insert(Id,qMakePair(meshName,text) );
 }
 
 
 void GLLogStream::Save(int /*Level*/, const char * filename )
 {
+	QMutexLocker lock(&mutex);
 	FILE *fp=fopen(filename,"wb");
 	QList<pair <int,QString> > ::iterator li;
 	for(li=S.begin();li!=S.end();++li)
@@ -78,17 +81,20 @@ void GLLogStream::ClearBookmark()
 
 void GLLogStream::SetBookmark()
 {
+  QMutexLocker lock(&mutex);
   bookmark=S.size();
 }
 
 void GLLogStream::BackToBookmark()
 {
+  QMutexLocker lock(&mutex);
   if(bookmark<0) return;
   while(S.size() > bookmark )
     S.removeLast();
 }
 void GLLogStream::print(QStringList &out)
 {
+  QMutexLocker lock(&mutex);
   out.clear();
   QList<pair <int,QString> > ::const_iterator li;
   for(li=S.begin();li!=S.end();++li)
@@ -97,13 +103,17 @@ void GLLogStream::print(QStringList &out)
 
 void GLLogStream::Clear()
 {
+	QMutexLocker lock(&mutex);
 	S.clear();
 }
 
 void GLLogStream::Log( int Level, const char * buf )
 {
 	QString tmp(buf);
-	S.push_back(std::make_pair(Level,tmp));
+	{
+		QMutexLocker lock(&mutex);
+		S.push_back(std::make_pair(Level,tmp));
+	}
 	qDebug("LOG: %i %s",Level,buf);
 	emit logUpdated();
 }
@@ -31,9 +31,11 @@
 #include <QPair>
 #include <QString>
 #include <QObject>
+#include <QMutex>
 /**
   This is the logging class.
   One for each document. Responsible of getting an history of the logging message printed out by filters.
+  The messages can be logged from several threads at the same time (e.g. by the filters run on all the layers).
   */
 class GLLogStream : public QObject
 {
@@ -75,6 +77,7 @@ signals:
 
 private:
   int bookmark; /// this field is used to place a bookmark for restoring the log. Useful for previeweing
+  QMutex mutex;
 
 };
 
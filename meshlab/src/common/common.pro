@@ -1,4 +1,5 @@
 include (../general.pri)
+include (../openmp.pri)
 EXIF_DIR = ../external/jhead-2.95
 
 GLEWCODE = $$GLEWDIR/src/glew.c
@@ -87,6 +88,7 @@ win32-msvc2010:DEFINES += _CRT_SECURE_NO_WARNINGS
 win32-msvc2012:DEFINES += _CRT_SECURE_NO_WARNINGS
 win32-msvc2013:DEFINES += _CRT_SECURE_NO_WARNINGS
 win32-msvc2015:DEFINES += _CRT_SECURE_NO_WARNINGS
+win32-g++:LIBS += -lpsapi
 
 
 # Input
@@ -104,7 +106,17 @@ HEADERS += 	filterparameter.h \
 			scriptsyntax.h \
 			meshlabdocumentxml.h \
 			ml_shared_data_context.h \
-			meshlabdocumentxml.h
+			meshlabdocumentxml.h \
+			mltrace.h \
+			ml_topology.h \
+			ml_point_cloud.h \
+			ml_knn_graph.h \
+			ml_ascii_reader.h \
+			ml_filter_cache.h \
+			ml_layer_runner.h \
+			ml_layer_saver.h \
+			ml_vertex_weld.h \
+			ml_hole_filling.h
 			
 SOURCES += 	filterparameter.cpp \
 			interfaces.cpp \
@@ -120,4 +132,12 @@ SOURCES += 	filterparameter.cpp \
 			$$GLEWCODE \
 			meshlabdocumentxml.cpp \
 			meshlabdocumentbundler.cpp \
-			ml_shared_data_context.cpp 
+			ml_shared_data_context.cpp \
+			mltrace.cpp \
+			ml_topology.cpp \
+			ml_point_cloud.cpp \
+			ml_knn_graph.cpp \
+			ml_ascii_reader.cpp \
+			ml_filter_cache.cpp \
+			ml_layer_runner.cpp \
+			ml_layer_saver.cpp
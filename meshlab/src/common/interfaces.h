@@ -183,6 +183,12 @@ public:
 
     virtual void GetExportMaskCapability(QString &format, int &capability, int &defaultBits) const = 0;
 
+    // The formats for which save can be called on several meshes at the same time (see MLLayerSaver) return true.
+    // save must be reentrant for them and, on failure, keep the message of each file for saveError.
+    virtual bool supportsConcurrentSave(const QString &/*format*/) const {return false;}
+    // The error message of the last failed save of fileName; safe to call while other saves run.
+    virtual QString saveError(const QString &/*fileName*/) {return errorMessage;}
+
   /// callback used to actually load a mesh from a file
   virtual bool open(
       const QString &format,					/// the extension of the format e.g. "PLY"
@@ -311,6 +317,18 @@ public:
   */
   virtual int postCondition( QAction* ) const {return MeshModel::MM_UNKNOWN;}
 
+  /** Filters that never access the vertices of the layers (e.g. renaming or deleting a layer) return true,
+    // so that the framework does not expand the compact point cloud layers (see MeshModel::compact) before running them.
+    // For the other filters the layers are expanded and, after the run, compacted again when they are still point clouds.
+  */
+  virtual bool acceptsCompactMeshes( QAction* ) const {return false;}
+
+  /** Single mesh filters that can run on several layers at the same time return true (see MLLayerRunner).
+    // Each run gets a document holding only its layer: the filter must change nothing but md.mm(), must not add or remove layers,
+    // must not use the glContext, the rasters or the members of the plugin (errorMessage included) and must be reentrant.
+  */
+  virtual bool supportsConcurrentLayers( QAction* ) const {return false;}
+
   /** \brief applies the selected filter with the already stabilished parameters
   * This function is called by the framework after getting values for the parameters specified in the \ref InitParameterSet
   * NO GUI interaction should be done here. No dialog asking, no messagebox errors.
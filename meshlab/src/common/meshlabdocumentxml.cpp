@@ -6,7 +6,28 @@
 #include "meshmodel.h"
 #include "meshlabdocumentxml.h"
 #include <wrap/qt/shot_qt.h>
+#include <cstdio>
+#if defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// replaces the destination in a single step where the OS allows it
+static bool replaceFile(const QString &from, const QString &to)
+{
+#if defined(Q_OS_WIN)
+  return MoveFileExW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(from).utf16()),
+                     reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(to).utf16()),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  return std::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+}
 
+// The project is written aside and then renamed over the old one: an interrupted save
+// leaves the previous project, never a truncated one.
 bool MeshDocumentToXMLFile(MeshDocument &md, QString filename, bool onlyVisibleLayers)
 {
   md.setFileName(filename);
@@ -14,12 +35,20 @@ bool MeshDocumentToXMLFile(MeshDocument &md, QString filename, bool onlyVisibleL
     QDir tmpDir = QDir::current();
     QDir::setCurrent(fi.absoluteDir().absolutePath());
     QDomDocument doc = MeshDocumentToXML(md, onlyVisibleLayers);
-  QFile file(filename);
-  file.open(QIODevice::WriteOnly);
+  QDir::setCurrent(tmpDir.absolutePath());
+  const QString part = fi.absoluteFilePath() + ".part";
+  QFile file(part);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
   QTextStream qstream(&file);
   doc.save(qstream,1);
+  qstream.flush();
     file.close();
-  QDir::setCurrent(tmpDir.absolutePath());
+  if ((qstream.status() != QTextStream::Ok) || (file.error() != QFile::NoError) || !replaceFile(part, fi.absoluteFilePath()))
+  {
+    QFile::remove(part);
+    return false;
+  }
   return true;
 }
 
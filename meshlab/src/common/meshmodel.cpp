@@ -31,6 +31,12 @@
 #include <vcg/complex/append.h>
 #include "mlexception.h"
 #include "ml_shared_data_context.h"
+#include "mltrace.h"
+#include "ml_knn_graph.h"
+#include "ml_topology.h"
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
 
 
 using namespace vcg;
@@ -216,6 +222,26 @@ bool MeshDocument::delMesh(MeshModel *mmToDel)
     return true;
 }
 
+QList<MeshModel *> MeshDocument::expandCompactMeshes(bool onlyCurrent)
+{
+    QList<MeshModel *> expanded;
+    foreach(MeshModel *m, meshList)
+        if (m->isCompact() && (!onlyCurrent || (m == mm())))
+        {
+            m->expand();
+            expanded.push_back(m);
+        }
+    return expanded;
+}
+
+void MeshDocument::recompactMeshes(const QList<MeshModel *> &expanded)
+{
+    // the filter may have deleted some of them: only the layers still in the document are touched
+    foreach(MeshModel *m, meshList)
+        if (expanded.contains(m))
+            m->recompact();
+}
+
 RasterModel * MeshDocument::addNewRaster(/*QString fullPathFilename*/)
 {
     QFileInfo info(fullPathFilename);
@@ -344,6 +370,10 @@ void MeshModel::Clear()
     currentDataMask = MM_NONE;
     currentDataMask |= MM_VERTCOORD | MM_VERTNORMAL | MM_VERTFLAG ;
     currentDataMask |= MM_FACEVERT  | MM_FACENORMAL | MM_FACEFLAG ;
+    topologyStamp = currentTopologyStamp(MM_NONE);
+    _compactCloud.clear();
+    _expandedEncoding = -1;
+    MLKnnGraph::invalidate(cm);
 
     visible=true;
     cm.Tr.SetIdentity();
@@ -351,8 +381,111 @@ void MeshModel::Clear()
     cm.svn=0;
 }
 
+#ifdef _USE_OMP
+// below this size the serial update is faster than building the vertex-face index
+static const int parallelBoxAndNormalsMinFaces = 20000;
+
+// Contribution of the wedge j of f to the normal of its vertex, computed with the
+// same operations of UpdateNormal::PerVertexAngleWeighted (f.N() must be normalized).
+static inline Point3m angleWeightedWedgeNormal(const CFaceO &f,int j)
+{
+    Point3m ea, eb;
+    switch(j)
+    {
+    case 0: ea =  (f.cP(1)-f.cP(0)).Normalize(); eb = -(f.cP(0)-f.cP(2)).Normalize(); break;
+    case 1: ea = -(f.cP(1)-f.cP(0)).Normalize(); eb =  (f.cP(2)-f.cP(1)).Normalize(); break;
+    default:ea = -(f.cP(2)-f.cP(1)).Normalize(); eb =  (f.cP(0)-f.cP(2)).Normalize(); break;
+    }
+    return f.cN()*AngleN(ea,eb);
+}
+
+/*
+  Parallel version of UpdateBounding::Box, UpdateNormal::PerFaceNormalized and
+  UpdateNormal::PerVertexAngleWeighted.
+  The bounding box is reduced from per thread boxes. The vertex normals are gathered
+  through a vertex -> wedge index filled in face order, so that each vertex sums the
+  same terms in the same order of the serial code: the result is bitwise identical.
+*/
+static void parallelUpdateBoxAndNormals(CMeshO &m)
+{
+    const int vertNum = int(m.vert.size());
+    const int faceNum = int(m.face.size());
+
+    const int threadNum = omp_get_max_threads();
+    std::vector<Box3m> boxes(threadNum);
+    #pragma omp parallel num_threads(threadNum)
+    {
+        const int t = omp_get_thread_num();
+        #pragma omp for schedule(static)
+        for(int i = 0;i < vertNum;++i)
+            if(!m.vert[i].IsD())
+                boxes[t].Add(m.vert[i].cP());
+    }
+    m.bbox.SetNull();
+    for(int t = 0;t < threadNum;++t)
+        m.bbox.Add(boxes[t]);
+
+    #pragma omp parallel for schedule(static)
+    for(int i = 0;i < faceNum;++i)
+    {
+        CFaceO &f = m.face[i];
+        if(!f.IsD())
+        {
+            f.N() = TriangleNormal(f);
+            f.N().Normalize();
+        }
+    }
+
+    // vertex -> wedge (3*face+j) index, in increasing face order for every vertex
+    std::vector<int> first(vertNum+1,0);
+    for(int i = 0;i < faceNum;++i)
+        if(!m.face[i].IsD())
+            for(int j = 0;j < 3;++j)
+                ++first[tri::Index(m,m.face[i].cV(j))+1];
+    for(int i = 0;i < vertNum;++i)
+        first[i+1] += first[i];
+    std::vector<int> wedges(first[vertNum]);
+    std::vector<int> pos(first.begin(),first.end()-1);
+    for(int i = 0;i < faceNum;++i)
+        if(!m.face[i].IsD())
+            for(int j = 0;j < 3;++j)
+                wedges[pos[tri::Index(m,m.face[i].cV(j))]++] = 3*i+j;
+
+    #pragma omp parallel for schedule(static)
+    for(int i = 0;i < vertNum;++i)
+    {
+        CVertexO &v = m.vert[i];
+        // vertices not referenced by any face keep their normal (and are left visited, as the serial code does)
+        if(first[i] == first[i+1])
+        {
+            if(!v.IsD())
+                v.SetV();
+            continue;
+        }
+        v.ClearV();
+        Point3m n = v.cN();
+        if(!v.IsD() && v.IsRW())
+            n = Point3m(0,0,0);
+        for(int k = first[i];k < first[i+1];++k)
+        {
+            const CFaceO &f = m.face[wedges[k]/3];
+            if(f.IsR())
+                n += angleWeightedWedgeNormal(f,wedges[k]%3);
+        }
+        v.N() = n;
+    }
+}
+#endif
+
 void MeshModel::UpdateBoxAndNormals()
 {
+#ifdef _USE_OMP
+    if(cm.fn >= parallelBoxAndNormalsMinFaces && omp_get_max_threads() > 1)
+    {
+        parallelUpdateBoxAndNormals(cm);
+        return;
+    }
+#endif
     tri::UpdateBounding<CMeshO>::Box(cm);
     if(cm.fn>0) {
         tri::UpdateNormal<CMeshO>::PerFaceNormalized(cm);
@@ -671,18 +804,72 @@ void MeshModel::updateDataMask(MeshModel *m)
     updateDataMask(m->currentDataMask);
 }
 
-void MeshModel::updateDataMask(int neededDataMask)
+MeshModel::TopologyStamp MeshModel::currentTopologyStamp(int mask) const
+{
+    TopologyStamp s;
+    s.mask = mask;
+    s.vn = cm.vn;
+    s.fn = cm.fn;
+    s.vertSize = cm.vert.size();
+    s.faceSize = cm.face.size();
+    s.vertData = cm.vert.empty() ? 0 : &cm.vert[0];
+    s.faceData = cm.face.empty() ? 0 : &cm.face[0];
+    return s;
+}
+
+// The mask alone is not enough: a plugin can add or remove elements without declaring
+// it, so the sizes and the position of the containers must be the same too.
+bool MeshModel::hasValidTopology(int topoMask) const
+{
+    if ((topologyStamp.mask & topoMask) != topoMask)
+        return false;
+    const TopologyStamp s = currentTopologyStamp(topoMask);
+    return s.vn == topologyStamp.vn && s.fn == topologyStamp.fn &&
+           s.vertSize == topologyStamp.vertSize && s.faceSize == topologyStamp.faceSize &&
+           s.vertData == topologyStamp.vertData && s.faceData == topologyStamp.faceData;
+}
+
+void MeshModel::setValidTopology(int topoMask)
+{
+    // the other adjacency is kept only if it has been computed on the same mesh
+    int mask = topoMask;
+    if (hasValidTopology(topologyStamp.mask))
+        mask |= topologyStamp.mask;
+    topologyStamp = currentTopologyStamp(mask);
+}
+
+void MeshModel::invalidateTopology(int changedDataMask)
+{
+    const int connectivityMask = MM_VERTNUMBER | MM_VERTFLAG | MM_VERTFACETOPO |
+                                 MM_FACEVERT | MM_FACENUMBER | MM_FACEFLAG | MM_FACEFACETOPO | MM_UNKNOWN;
+    if ((changedDataMask & connectivityMask) != 0)
+        topologyStamp.mask = MM_NONE;
+    if ((changedDataMask & (MM_VERTCOORD | MM_VERTNUMBER | MM_UNKNOWN)) != 0)
+        MLKnnGraph::invalidate(cm);
+}
+
+void MeshModel::updateDataMask(int neededDataMask, bool reuseValidTopology)
 {
     if((neededDataMask & MM_FACEFACETOPO)!=0)
     {
-        cm.face.EnableFFAdjacency();
-        tri::UpdateTopology<CMeshO>::FaceFace(cm);
+        if (!reuseValidTopology || !cm.face.IsFFAdjacencyEnabled() || !hasValidTopology(MM_FACEFACETOPO))
+        {
+            MLTraceSpan span("FF topology","topology",cm.vn,cm.fn);
+            cm.face.EnableFFAdjacency();
+            MLTopology::FaceFace(cm);
+            setValidTopology(MM_FACEFACETOPO);
+        }
     }
     if((neededDataMask & MM_VERTFACETOPO)!=0)
     {
-        cm.vert.EnableVFAdjacency();
-        cm.face.EnableVFAdjacency();
-        tri::UpdateTopology<CMeshO>::VertexFace(cm);
+        if (!reuseValidTopology || !cm.vert.IsVFAdjacencyEnabled() || !cm.face.IsVFAdjacencyEnabled() || !hasValidTopology(MM_VERTFACETOPO))
+        {
+            MLTraceSpan span("VF topology","topology",cm.vn,cm.fn);
+            cm.vert.EnableVFAdjacency();
+            cm.face.EnableVFAdjacency();
+            MLTopology::VertexFace(cm);
+            setValidTopology(MM_VERTFACETOPO);
+        }
     }
 
     if((neededDataMask & MM_WEDGTEXCOORD)!=0)  
@@ -726,6 +913,7 @@ void MeshModel::clearDataMask(int unneededDataMask)
     if( ( (unneededDataMask & MM_VERTTEXCOORD)!=0)	&& hasDataMask(MM_VERTTEXCOORD))	cm.vert.DisableTexCoord();
 
     currentDataMask = currentDataMask & (~unneededDataMask);
+    topologyStamp.mask &= ~(unneededDataMask & (MM_FACEFACETOPO | MM_VERTFACETOPO));
 }
 
 void MeshModel::Enable(int openingFileMask)
@@ -755,6 +943,103 @@ int MeshModel::dataMask() const
     return currentDataMask;
 }
 
+bool MeshModel::compact(MLPointCloud::CoordEncoding enc)
+{
+    if (isCompact())
+    {
+        if (_compactCloud->encoding() == enc)
+            return true;
+        expand();
+    }
+    if ((cm.fn > 0) || (cm.en > 0) || !cm.vert_attr.empty() ||
+        hasDataMask(MM_VERTTEXCOORD | MM_VERTCURV | MM_VERTCURVDIR | MM_VERTRADIUS))
+        return false;
+
+    // scans often come without normals: do not store them if they are all null
+    bool normals = false;
+    for (CMeshO::VertexIterator vi = cm.vert.begin(); (vi != cm.vert.end()) && !normals; ++vi)
+        if (!(*vi).IsD() && ((*vi).cN() != Point3m(0,0,0)))
+            normals = true;
+
+    QSharedPointer<MLPointCloud> cloud(new MLPointCloud(enc));
+    cloud->fromMesh(cm,normals,hasDataMask(MM_VERTCOLOR),hasDataMask(MM_VERTQUALITY));
+    cloud->squeeze();
+
+    const Box3m bb = cm.bbox;
+    cm.Clear();
+    cm.vert.shrink_to_fit();
+    cm.bbox = bb;
+    cm.svn = 0;
+    _compactCloud = cloud;
+    _expandedEncoding = -1;
+    invalidateTopology();
+    return true;
+}
+
+bool MeshModel::loadCompactCloud(const QString &fileName, MLPointCloud::CoordEncoding enc, QString &error)
+{
+    MLTraceSpan span("Open " + QFileInfo(fileName).fileName(),"io");
+    QSharedPointer<MLPointCloud> cloud(new MLPointCloud(enc));
+    if (!cloud->loadPly(fileName,error))
+        return false;
+    span.setCounts(int(cloud->size()),0);
+
+    cm.Clear();
+    cm.vert.shrink_to_fit();
+    if (cloud->hasColor())
+        updateDataMask(MM_VERTCOLOR);
+    if (cloud->hasQuality())
+        updateDataMask(MM_VERTQUALITY);
+    const vcg::Box3d bb = cloud->bbox();
+    cm.bbox.SetNull();
+    if (!bb.IsNull())
+    {
+        cm.bbox.Add(Point3m::Construct(bb.min));
+        cm.bbox.Add(Point3m::Construct(bb.max));
+    }
+    _compactCloud = cloud;
+    _expandedEncoding = -1;
+    invalidateTopology();
+    return true;
+}
+
+void MeshModel::expand()
+{
+    if (!isCompact())
+        return;
+    MLTraceSpan span("Expand point cloud","io",int(_compactCloud->size()),0);
+    QSharedPointer<MLPointCloud> cloud = _compactCloud;
+    _compactCloud.clear();
+    _expandedEncoding = cloud->encoding();
+    cm.Clear();
+    cloud->toMesh(cm);
+    tri::UpdateBounding<CMeshO>::Box(cm);
+    invalidateTopology();
+}
+
+bool MeshModel::recompact()
+{
+    if (isCompact() || (_expandedEncoding < 0))
+        return false;
+    for (CMeshO::VertexIterator vi = cm.vert.begin(); vi != cm.vert.end(); ++vi)
+        if (!(*vi).IsD() && (*vi).IsS())
+            return false;
+    return compact(MLPointCloud::CoordEncoding(_expandedEncoding));
+}
+
+void MeshModel::expandTo(MeshModel &m) const
+{
+    if (!isCompact())
+        return;
+    MLTraceSpan span("Expand point cloud","io",int(_compactCloud->size()),0);
+    m.Clear();
+    m.cm.Clear();
+    m.updateDataMask(currentDataMask & (MM_VERTCOLOR | MM_VERTQUALITY));
+    _compactCloud->toMesh(m.cm);
+    m.cm.Tr = cm.Tr;
+    tri::UpdateBounding<CMeshO>::Box(m.cm);
+}
+
 //RenderMode RenderMode::computeARenderModeSetCompatibleWithMesh(const CMeshO& mesh,const RenderMode& rm)
 //{
 //    RenderMode result(rm);
@@ -56,9 +56,11 @@
 #include <QReadWriteLock>
 #include <QImage>
 #include <QAction>
+#include <QSharedPointer>
 #include "GLLogStream.h"
 #include "filterscript.h"
 #include "ml_shared_data_context.h"
+#include "ml_point_cloud.h"
 
 
 /*
@@ -152,6 +154,19 @@ public:
 
 private:
     int currentDataMask;
+    // Adjacency (MM_FACEFACETOPO/MM_VERTFACETOPO) known to be up to date, together
+    // with the state of the mesh when it was computed; see updateDataMask
+    struct TopologyStamp
+    {
+        int mask;
+        int vn, fn;
+        size_t vertSize, faceSize;
+        const CVertexO *vertData;
+        const CFaceO *faceData;
+    } topologyStamp;
+    TopologyStamp currentTopologyStamp(int mask) const;
+    bool hasValidTopology(int topoMask) const;
+    void setValidTopology(int topoMask);
     QString fullPathFileName;
     QString _label;
     int _id;
@@ -206,13 +221,46 @@ public:
 
     bool hasDataMask(const int maskToBeTested) const;
     void updateDataMask(MeshModel *m);
-    void updateDataMask(int neededDataMask);
+    // With reuseValidTopology the FF/VF adjacency is rebuilt only if something could
+    // have changed the connectivity since it was last computed: the framework uses it
+    // before running a filter, plugins should not.
+    void updateDataMask(int neededDataMask, bool reuseValidTopology = false);
     void clearDataMask(int unneededDataMask);
+    // To be called after a filter (or an edit) with the mask of what it changed, e.g.
+    // its postCondition(); anything touching vertices, faces or their flags
+    // invalidates the cached adjacency, moving or removing vertices also drops the
+    // cached neighbor graph (see MLKnnGraph).
+    void invalidateTopology(int changedDataMask = MM_UNKNOWN);
     int dataMask() const;
 
 
     bool& meshModified();
     static int io2mm(int single_iobit);
+
+    // Huge point clouds can be kept in a compact MLPointCloud: while compact the CMeshO is
+    // empty (only its bbox is kept), so nothing is rendered. The framework expands the
+    // layer before running a filter and compacts it again afterwards (see recompact());
+    // it is saved from a temporary copy made by expandTo().
+    // compact() fails on meshes with faces or edges or with per vertex data that the
+    // compact cloud cannot store (texcoords, curvature, radius, user attributes).
+    bool compact(MLPointCloud::CoordEncoding enc);
+    void expand();
+    // Compacts again, with the encoding it had, a layer expanded by expand(). Fails like
+    // compact(), and also when some vertices are selected, as the compact cloud has no flags.
+    bool recompact();
+    // Copies the points of a compact layer into m, leaving this layer compact
+    void expandTo(MeshModel &m) const;
+    // Replaces the content of the mesh with the points of a binary PLY file, read directly in
+    // compact form (see MLPointCloud::loadPly)
+    bool loadCompactCloud(const QString &fileName, MLPointCloud::CoordEncoding enc, QString &error);
+    bool isCompact() const {return !_compactCloud.isNull();}
+    const MLPointCloud *compactCloud() const {return _compactCloud.data();}
+
+private:
+    QSharedPointer<MLPointCloud> _compactCloud;
+    // encoding of the cloud of the last expand(), -1 if the layer was not expanded since
+    int _expandedEncoding;
+public:
 };// end class MeshModel
 
 
@@ -514,6 +562,9 @@ public:
     /// The list of the raster models of the project
     QList<RasterModel *> rasterList;
     int newMeshId() {return meshIdCounter++;}
+    /// the id that the next added mesh will get (MLFilterCache restores it with the layers)
+    int nextMeshId() const {return meshIdCounter;}
+    void setNextMeshId(int id) {meshIdCounter = id;}
     int newRasterId() {return rasterIdCounter++;}
 
     //functions to update the document entities (meshes and/or rasters) during the filters execution
@@ -543,6 +594,7 @@ public:
     QString docLabel() const {return documentLabel;}
     QString pathName() const {QFileInfo fi(fullPathFilename); return fi.absolutePath();}
     void setFileName(const QString& newFileName) {fullPathFilename = newFileName;}
+    const QString& fileName() const {return fullPathFilename;}
     GLLogStream Log;
     FilterScript* filterHistory;
     QStringList xmlhistory;
@@ -570,6 +622,11 @@ public:
     ///remove the mesh from the list and delete it from memory
     bool delMesh(MeshModel *mmToDel);
 
+    ///expand the compact point cloud layers (only the current one if onlyCurrent), returns the expanded ones
+    QList<MeshModel *> expandCompactMeshes(bool onlyCurrent=false);
+    ///compact again the layers returned by expandCompactMeshes that still exist and are still point clouds
+    void recompactMeshes(const QList<MeshModel *> &expanded);
+
     ///add a new raster model
     RasterModel *addNewRaster(/*QString rasterName*/);
 
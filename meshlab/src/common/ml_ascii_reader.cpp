@@ -0,0 +1,201 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_ascii_reader.h"
+
+#include <cmath>
+#include <cstring>
+
+MLAsciiReader::MLAsciiReader()
+    :_data(0), _size(0)
+{
+}
+
+MLAsciiReader::~MLAsciiReader()
+{
+    close();
+}
+
+bool MLAsciiReader::open(const QString &fileName)
+{
+    close();
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::ReadOnly))
+        return false;
+    _size = _file.size();
+    if (_size == 0)
+        return true;
+    _data = reinterpret_cast<const char *>(_file.map(0, _size));
+    if (_data == 0)
+    {
+        // e.g. a file larger than the address space of a 32 bit build
+        if (quint64(_size) > quint64(size_t(-1) / 2))
+        {
+            close();
+            return false;
+        }
+        _buffer.resize(size_t(_size));
+        if (_file.read(&_buffer[0], _size) != _size)
+        {
+            close();
+            return false;
+        }
+        _data = &_buffer[0];
+    }
+    return true;
+}
+
+void MLAsciiReader::close()
+{
+    if (_file.isOpen())
+        _file.close();
+    std::vector<char>().swap(_buffer);
+    _data = 0;
+    _size = 0;
+}
+
+const char *MLAsciiReader::nextLine(const char *p, const char *end)
+{
+    const char *nl = (p < end) ? static_cast<const char *>(memchr(p, '\n', size_t(end - p))) : 0;
+    return nl ? nl + 1 : end;
+}
+
+const char *MLAsciiReader::lineEnd(const char *p, const char *end)
+{
+    const char *nl = (p < end) ? static_cast<const char *>(memchr(p, '\n', size_t(end - p))) : 0;
+    return nl ? nl : end;
+}
+
+bool MLAsciiReader::isBlank(const char *p, const char *end)
+{
+    for (; p < end; ++p)
+        if (*p != ' ' && *p != '\t' && *p != '\r')
+            return false;
+    return true;
+}
+
+const char *MLAsciiReader::skip(const char *p, const char *end, const char *separators)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || (*p != 0 && strchr(separators, *p) != 0)))
+        ++p;
+    return p;
+}
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool MLAsciiReader::parseNumber(const char *&p, const char *end, double &v)
+{
+    // exactly representable powers of ten
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+'))
+    {
+        negative = (*s == '-');
+        ++s;
+    }
+
+    // up to 19 significant digits fit in the mantissa, the others only scale it
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    bool any = false;
+    for (; s < end && isDigit(*s); ++s)
+    {
+        any = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (mantissa != 0)
+                ++digits;
+        }
+        else
+            ++exp10;
+    }
+    if (s < end && *s == '.')
+    {
+        ++s;
+        for (; s < end && isDigit(*s); ++s)
+        {
+            any = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa != 0)
+                    ++digits;
+                --exp10;
+            }
+        }
+    }
+    if (!any)
+        return false;
+
+    if (s < end && (*s == 'e' || *s == 'E'))
+    {
+        const char *e = s + 1;
+        bool negativeExp = false;
+        if (e < end && (*e == '-' || *e == '+'))
+        {
+            negativeExp = (*e == '-');
+            ++e;
+        }
+        if (e < end && isDigit(*e))
+        {
+            int exponent = 0;
+            for (; e < end && isDigit(*e); ++e)
+                if (exponent < 10000)
+                    exponent = exponent * 10 + (*e - '0');
+            exp10 += negativeExp ? -exponent : exponent;
+            s = e;
+        }
+    }
+
+    if (mantissa == 0)
+        v = 0;
+    else if (digits <= 15 && exp10 >= -22 && exp10 <= 22)
+        v = (exp10 >= 0) ? double(mantissa) * pow10[exp10] : double(mantissa) / pow10[-exp10];
+    else
+        v = double((long double)mantissa * std::pow(10.0L, (long double)exp10));
+    if (negative)
+        v = -v;
+    p = s;
+    return true;
+}
+
+int MLAsciiReader::parseNumbers(const char *&p, const char *end, const char *separators, double *v, int maxNum)
+{
+    int n = 0;
+    while (n < maxNum)
+    {
+        const char *s = skip(p, end, separators);
+        if (!parseNumber(s, end, v[n]))
+            break;
+        p = s;
+        ++n;
+    }
+    return n;
+}
@@ -0,0 +1,176 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_ASCII_READER_H
+#define ML_ASCII_READER_H
+
+#include <QFile>
+#include <QString>
+#include <algorithm>
+#include <vector>
+#include <wrap/callback.h>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+/*
+  Parallel parsing of line based ASCII files (XYZ, APTS, ASC point clouds...).
+
+  The file is memory mapped and read in windows of a few tens of megabytes. Every
+  window is cut at line boundaries in one chunk per core (a few more, to balance the
+  load), the chunks are parsed concurrently and the results are appended in file
+  order, so the output does not depend on the number of threads. Only the parsed
+  records of one window are kept besides the result.
+
+  Numbers are read with parseNumber, which does not depend on the locale and does not
+  allocate; the result is the correctly rounded value for the usual inputs (up to 15
+  significant digits and exponents up to 22), and within one ulp otherwise.
+
+  Usage:
+    struct PointParser {
+      bool operator()(const char *line, const char *lineEnd, Point3m &p) const {...}
+    };
+    MLAsciiReader reader;
+    if (reader.open(fileName)) {
+      std::vector<Point3m> points;
+      reader.parseLines(reader.begin(), PointParser(), points, cb);
+    }
+*/
+class MLAsciiReader
+{
+public:
+    MLAsciiReader();
+    ~MLAsciiReader();
+
+    bool open(const QString &fileName);
+    void close();
+
+    const char *begin() const {return _data;}
+    const char *end() const {return _data + _size;}
+    qint64 size() const {return _size;}
+
+    // first character of the line following the one of p (end if none)
+    static const char *nextLine(const char *p, const char *end);
+    // the '\n' (or end) closing the line of p; a trailing '\r' is left in the line
+    static const char *lineEnd(const char *p, const char *end);
+    static bool isBlank(const char *p, const char *end);
+    // skips blanks (spaces, tabs, '\r') and any character of separators
+    static const char *skip(const char *p, const char *end, const char *separators);
+    // Reads a number at p, without leading blanks, and moves p after it.
+    // Returns false, leaving p untouched, if p does not start with a number.
+    static bool parseNumber(const char *&p, const char *end, double &v);
+    // Reads up to maxNum numbers separated by blanks or separators, returns how many
+    // were read; reading stops at the first token that is not a number.
+    static int parseNumbers(const char *&p, const char *end, const char *separators, double *v, int maxNum);
+
+    /*
+      Calls parser(line, lineEnd, record) for every line from from, which must be at the
+      beginning of a line, to the end of the file; the records for which it returns true are
+      appended, in file order, to result. Returns the number of the non blank lines
+      rejected by the parser.
+      The parser is called concurrently and must be thread safe; T must be default
+      constructible and copyable.
+    */
+    template <class T, class LineParser>
+    int parseLines(const char *from, const LineParser &parser, std::vector<T> &result,
+                   vcg::CallBackPos *cb = 0, const char *cbMessage = "Loading") const
+    {
+        int threadNum = 1;
+#ifdef _USE_OMP
+        threadNum = omp_get_max_threads();
+#endif
+        const int chunkNum = 4 * threadNum;
+        const char *last = end();
+        const char *first = begin();
+        const size_t startSize = result.size();
+        int rejected = 0;
+        bool reserved = false;
+
+        std::vector<const char *> bounds(chunkNum + 1);
+        std::vector<std::vector<T> > parts(chunkNum);
+        while (from < last)
+        {
+            bounds[0] = from;
+            for (int c = 1; c <= chunkNum; ++c)
+            {
+                const char *p = bounds[c - 1];
+                if (last - p > chunkSize)
+                    p = nextLine(p + chunkSize, last);
+                else
+                    p = last;
+                bounds[c] = p;
+            }
+
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic, 1) reduction(+:rejected)
+#endif
+            for (int c = 0; c < chunkNum; ++c)
+            {
+                std::vector<T> &out = parts[c];
+                out.clear();
+                T rec;
+                for (const char *line = bounds[c]; line < bounds[c + 1]; )
+                {
+                    const char *le = lineEnd(line, bounds[c + 1]);
+                    if (parser(line, le, rec))
+                        out.push_back(rec);
+                    else if (!isBlank(line, le))
+                        ++rejected;
+                    line = (le < bounds[c + 1]) ? le + 1 : le;
+                }
+            }
+
+            std::vector<size_t> offset(chunkNum + 1, result.size());
+            for (int c = 0; c < chunkNum; ++c)
+                offset[c + 1] = offset[c] + parts[c].size();
+            // guess the final size from the first window, to avoid the reallocations
+            if (!reserved && bounds[chunkNum] < last && offset[chunkNum] > startSize)
+            {
+                const double ratio = double(last - bounds[0]) / double(bounds[chunkNum] - bounds[0]);
+                result.reserve(offset[chunkNum] + size_t(double(offset[chunkNum] - startSize) * (ratio - 1.0) * 1.02));
+                reserved = true;
+            }
+            result.resize(offset[chunkNum]);
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic, 1)
+#endif
+            for (int c = 0; c < chunkNum; ++c)
+                std::copy(parts[c].begin(), parts[c].end(), result.begin() + offset[c]);
+
+            from = bounds[chunkNum];
+            if (cb != 0)
+                cb(int(double(from - first) * 100.0 / double(last - first)), cbMessage);
+        }
+        return rejected;
+    }
+
+private:
+    static const qint64 chunkSize = 4 << 20;
+
+    QFile _file;
+    const char *_data;
+    qint64 _size;
+    std::vector<char> _buffer;   // used when the file cannot be mapped
+};
+
+#endif // ML_ASCII_READER_H
@@ -0,0 +1,805 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_filter_cache.h"
+#include "meshmodel.h"
+#include "filterscript.h"
+#include "mlapplication.h"
+#include "mltrace.h"
+#include "ml_knn_graph.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCoreApplication>
+
+#include <vcg/complex/algorithms/update/bounding.h>
+
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+#if defined(Q_OS_WIN)
+#include <sys/types.h>
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+namespace
+{
+// 64 bit offset, entries can be larger than 2GB
+qint64 filePos(FILE *fp)
+{
+#if defined(Q_OS_WIN)
+    return qint64(_ftelli64(fp));
+#else
+    return qint64(ftello(fp));
+#endif
+}
+
+// the attributes that are only a cache of derived data (rebuilt when needed) are not stored
+bool hasStoredAttributes(CMeshO &m)
+{
+    if (!m.vert_attr.empty() || !m.face_attr.empty() || !m.edge_attr.empty())
+        return true;
+    std::set<vcg::PointerToAttribute>::const_iterator ai;
+    for(ai = m.mesh_attr.begin();ai != m.mesh_attr.end();++ai)
+        if (ai->_name != MLKnnGraph::attributeName())
+            return true;
+    return false;
+}
+
+const char stateMagic[4] = {'M','L','F','C'};
+const char stateEnd[4] = {'M','L','F','E'};
+const int stateVersion = 1;
+// elements packed (or unpacked) in parallel and written with a single call
+const int windowSize = 1 << 18;
+
+const int topologyMask = MeshModel::MM_FACEFACETOPO | MeshModel::MM_VERTFACETOPO;
+// everything else in the data mask of a mesh makes the document not cacheable
+const int supportedMask = MeshModel::MM_VERTCOORD | MeshModel::MM_VERTNORMAL | MeshModel::MM_VERTFLAG |
+    MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTQUALITY | MeshModel::MM_VERTMARK | MeshModel::MM_VERTTEXCOORD |
+    MeshModel::MM_VERTNUMBER | MeshModel::MM_FACEVERT | MeshModel::MM_FACENORMAL | MeshModel::MM_FACEFLAG |
+    MeshModel::MM_FACECOLOR | MeshModel::MM_FACEQUALITY | MeshModel::MM_FACEMARK | MeshModel::MM_FACENUMBER |
+    MeshModel::MM_WEDGTEXCOORD | MeshModel::MM_VERTFLAGSELECT | MeshModel::MM_FACEFLAGSELECT |
+    MeshModel::MM_TRANSFMATRIX | MeshModel::MM_COLOR | MeshModel::MM_POLYGONAL | topologyMask;
+
+typedef CVertexO::QualityType VertQuality;
+typedef CVertexO::TexCoordType VertTexCoord;
+typedef CFaceO::QualityType FaceQuality;
+typedef CFaceO::TexCoordType WedgeTexCoord;
+
+// Size and content of the records of the elements of a mesh, given its data mask
+struct Layout
+{
+    bool vc,vq,vt,fc,fq,wt;
+    size_t vStride,fStride,eStride;
+
+    Layout(int mask)
+    {
+        vc = (mask & MeshModel::MM_VERTCOLOR) != 0;
+        vq = (mask & MeshModel::MM_VERTQUALITY) != 0;
+        vt = (mask & MeshModel::MM_VERTTEXCOORD) != 0;
+        fc = (mask & MeshModel::MM_FACECOLOR) != 0;
+        fq = (mask & MeshModel::MM_FACEQUALITY) != 0;
+        wt = (mask & MeshModel::MM_WEDGTEXCOORD) != 0;
+        vStride = 2 * sizeof(Point3m) + sizeof(int) + (vc ? sizeof(vcg::Color4b) : 0) +
+                  (vq ? sizeof(VertQuality) : 0) + (vt ? sizeof(VertTexCoord) : 0);
+        fStride = 4 * sizeof(int) + sizeof(Point3m) + (fc ? sizeof(vcg::Color4b) : 0) +
+                  (fq ? sizeof(FaceQuality) : 0) + (wt ? 3 * sizeof(WedgeTexCoord) : 0);
+        eStride = 3 * sizeof(int);
+    }
+};
+
+template <class T>
+inline void pack(char *&p,const T &v)
+{
+    memcpy(p,&v,sizeof(T));
+    p += sizeof(T);
+}
+
+template <class T>
+inline void unpack(const char *&p,T &v)
+{
+    memcpy(&v,p,sizeof(T));
+    p += sizeof(T);
+}
+
+// Destination of a serialized document: the hash of its key, a cache entry or both
+class StateWriter
+{
+public:
+    StateWriter(QCryptographicHash *hash,FILE *fp) :_hash(hash),_fp(fp),_ok(true) {}
+
+    void write(const void *data,size_t size)
+    {
+        if (_hash != NULL)
+            _hash->addData(static_cast<const char*>(data),int(size));
+        if ((_fp != NULL) && _ok)
+            _ok = (fwrite(data,1,size,_fp) == size);
+    }
+    template <class T>
+    void put(const T &v) {write(&v,sizeof(T));}
+    void putString(const QString &s)
+    {
+        QByteArray u = s.toUtf8();
+        put(int(u.size()));
+        write(u.constData(),size_t(u.size()));
+    }
+    bool ok() const {return _ok;}
+
+private:
+    QCryptographicHash *_hash;
+    FILE *_fp;
+    bool _ok;
+};
+
+class StateReader
+{
+public:
+    StateReader(FILE *fp) :_fp(fp),_ok(true) {}
+
+    bool read(void *data,size_t size)
+    {
+        _ok = _ok && (fread(data,1,size,_fp) == size);
+        return _ok;
+    }
+    template <class T>
+    bool get(T &v) {return read(&v,sizeof(T));}
+    bool getString(QString &s)
+    {
+        int len = 0;
+        if (!get(len) || (len < 0) || (len > (1 << 20)))
+            return (_ok = false);
+        QByteArray u(len,'\0');
+        if (!read(u.data(),size_t(len)))
+            return false;
+        s = QString::fromUtf8(u);
+        return true;
+    }
+    bool ok() const {return _ok;}
+
+private:
+    FILE *_fp;
+    bool _ok;
+};
+
+// Live elements of a mesh and the new index of each vertex
+struct MeshIndex
+{
+    std::vector<int> verts,faces,edges;
+    std::vector<int> vertRemap;
+
+    MeshIndex(const CMeshO &m)
+    {
+        vertRemap.assign(m.vert.size(),-1);
+        verts.reserve(m.vn);
+        for(int i = 0;i < int(m.vert.size());++i)
+            if (!m.vert[i].IsD())
+            {
+                vertRemap[i] = int(verts.size());
+                verts.push_back(i);
+            }
+        faces.reserve(m.fn);
+        for(int i = 0;i < int(m.face.size());++i)
+            if (!m.face[i].IsD())
+                faces.push_back(i);
+        edges.reserve(m.en);
+        for(int i = 0;i < int(m.edge.size());++i)
+            if (!m.edge[i].IsD())
+                edges.push_back(i);
+    }
+};
+
+void writeVertices(CMeshO &m,const MeshIndex &ind,const Layout &lay,std::vector<char> &buf,StateWriter &w)
+{
+    const int n = int(ind.verts.size());
+    for(int first = 0;first < n;first += windowSize)
+    {
+        const int count = std::min(windowSize,n - first);
+        buf.resize(size_t(count) * lay.vStride);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for(int i = 0;i < count;++i)
+        {
+            const CVertexO &v = m.vert[ind.verts[first + i]];
+            char *p = &buf[size_t(i) * lay.vStride];
+            pack(p,v.cP());
+            pack(p,v.cN());
+            pack(p,v.cFlags());
+            if (lay.vc) pack(p,v.cC());
+            if (lay.vq) pack(p,v.cQ());
+            if (lay.vt) pack(p,v.cT());
+        }
+        w.write(&buf[0],buf.size());
+    }
+}
+
+void writeFaces(CMeshO &m,const MeshIndex &ind,const Layout &lay,std::vector<char> &buf,StateWriter &w)
+{
+    const int n = int(ind.faces.size());
+    for(int first = 0;first < n;first += windowSize)
+    {
+        const int count = std::min(windowSize,n - first);
+        buf.resize(size_t(count) * lay.fStride);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for(int i = 0;i < count;++i)
+        {
+            const CFaceO &f = m.face[ind.faces[first + i]];
+            char *p = &buf[size_t(i) * lay.fStride];
+            for(int j = 0;j < 3;++j)
+                pack(p,ind.vertRemap[vcg::tri::Index(m,f.cV(j))]);
+            pack(p,f.cFlags());
+            pack(p,f.cN());
+            if (lay.fc) pack(p,f.cC());
+            if (lay.fq) pack(p,f.cQ());
+            if (lay.wt)
+                for(int j = 0;j < 3;++j)
+                    pack(p,f.cWT(j));
+        }
+        w.write(&buf[0],buf.size());
+    }
+}
+
+void writeEdges(CMeshO &m,const MeshIndex &ind,const Layout &lay,std::vector<char> &buf,StateWriter &w)
+{
+    const int n = int(ind.edges.size());
+    if (n == 0)
+        return;
+    buf.resize(size_t(n) * lay.eStride);
+    for(int i = 0;i < n;++i)
+    {
+        const CEdgeO &e = m.edge[ind.edges[i]];
+        char *p = &buf[size_t(i) * lay.eStride];
+        pack(p,ind.vertRemap[vcg::tri::Index(m,e.cV(0))]);
+        pack(p,ind.vertRemap[vcg::tri::Index(m,e.cV(1))]);
+        pack(p,e.cFlags());
+    }
+    w.write(&buf[0],buf.size());
+}
+
+// The whole document: a table of the layers followed by their elements.
+// Attributes are not written: isCacheable only lets through the transient ones (e.g. the k-NN graph)
+bool writeDocument(MeshDocument &md,StateWriter &w)
+{
+    std::vector<MeshIndex*> indexes;
+    foreach(MeshModel *m,md.meshList)
+        indexes.push_back(new MeshIndex(m->cm));
+
+    w.write(stateMagic,4);
+    w.put(stateVersion);
+    w.put(int(sizeof(Scalarm)));
+    w.put(int(sizeof(VertQuality)));
+    w.put(int(sizeof(VertTexCoord)));
+    w.put(int(md.meshList.size()));
+    w.put(md.nextMeshId());
+    w.put((md.mm() != NULL) ? md.mm()->id() : -1);
+    for(int mi = 0;mi < md.meshList.size();++mi)
+    {
+        MeshModel *m = md.meshList[mi];
+        w.put(m->id());
+        w.put(m->dataMask());
+        w.put(int(m->visible));
+        w.put(int(indexes[mi]->verts.size()));
+        w.put(int(indexes[mi]->faces.size()));
+        w.put(int(indexes[mi]->edges.size()));
+        for(int i = 0;i < 4;++i)
+            for(int j = 0;j < 4;++j)
+                w.put(m->cm.Tr.ElementAt(i,j));
+        w.put(m->cm.C());
+        w.putString(m->label());
+        w.putString(m->fullName());
+        w.put(int(m->cm.textures.size()));
+        for(size_t i = 0;i < m->cm.textures.size();++i)
+            w.putString(QString::fromStdString(m->cm.textures[i]));
+        w.put(int(m->cm.normalmaps.size()));
+        for(size_t i = 0;i < m->cm.normalmaps.size();++i)
+            w.putString(QString::fromStdString(m->cm.normalmaps[i]));
+    }
+
+    std::vector<char> buf;
+    for(int mi = 0;mi < md.meshList.size();++mi)
+    {
+        MeshModel *m = md.meshList[mi];
+        const Layout lay(m->dataMask());
+        writeVertices(m->cm,*indexes[mi],lay,buf,w);
+        writeFaces(m->cm,*indexes[mi],lay,buf,w);
+        writeEdges(m->cm,*indexes[mi],lay,buf,w);
+        delete indexes[mi];
+    }
+    w.write(stateEnd,4);
+    return w.ok();
+}
+
+// A layer as found in the table of a cache entry
+struct MeshEntry
+{
+    int id,mask,visible,vn,fn,en;
+    Matrix44m Tr;
+    vcg::Color4b color;
+    QString label,fullName;
+    std::vector<std::string> textures,normalmaps;
+
+    bool read(StateReader &r)
+    {
+        r.get(id); r.get(mask); r.get(visible);
+        r.get(vn); r.get(fn); r.get(en);
+        for(int i = 0;i < 4;++i)
+            for(int j = 0;j < 4;++j)
+                r.get(Tr.ElementAt(i,j));
+        r.get(color);
+        r.getString(label);
+        r.getString(fullName);
+        return readNames(r,textures) && readNames(r,normalmaps) &&
+               (vn >= 0) && (fn >= 0) && (en >= 0) && ((mask & ~supportedMask) == 0);
+    }
+
+    qint64 dataSize() const
+    {
+        const Layout lay(mask);
+        return qint64(vn) * qint64(lay.vStride) + qint64(fn) * qint64(lay.fStride) + qint64(en) * qint64(lay.eStride);
+    }
+
+private:
+    static bool readNames(StateReader &r,std::vector<std::string> &names)
+    {
+        int count = 0;
+        if (!r.get(count) || (count < 0) || (count > 4096))
+            return false;
+        for(int i = 0;i < count;++i)
+        {
+            QString s;
+            if (!r.getString(s))
+                return false;
+            names.push_back(s.toStdString());
+        }
+        return true;
+    }
+};
+
+// Reads the elements of a layer whose mesh is already allocated
+bool readMesh(CMeshO &m,const MeshEntry &e,std::vector<char> &buf,StateReader &r)
+{
+    const Layout lay(e.mask);
+    const int vn = e.vn;
+    int svn = 0,sfn = 0,invalid = 0;
+    for(int first = 0;first < e.vn;first += windowSize)
+    {
+        const int count = std::min(windowSize,e.vn - first);
+        buf.resize(size_t(count) * lay.vStride);
+        if (!r.read(&buf[0],buf.size()))
+            return false;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static) reduction(+: svn)
+#endif
+        for(int i = 0;i < count;++i)
+        {
+            CVertexO &v = m.vert[first + i];
+            const char *p = &buf[size_t(i) * lay.vStride];
+            unpack(p,v.P());
+            unpack(p,v.N());
+            unpack(p,v.Flags());
+            if (lay.vc) unpack(p,v.C());
+            if (lay.vq) unpack(p,v.Q());
+            if (lay.vt) unpack(p,v.T());
+            if (v.IsS())
+                ++svn;
+        }
+    }
+    for(int first = 0;first < e.fn;first += windowSize)
+    {
+        const int count = std::min(windowSize,e.fn - first);
+        buf.resize(size_t(count) * lay.fStride);
+        if (!r.read(&buf[0],buf.size()))
+            return false;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static) reduction(+: sfn,invalid)
+#endif
+        for(int i = 0;i < count;++i)
+        {
+            CFaceO &f = m.face[first + i];
+            const char *p = &buf[size_t(i) * lay.fStride];
+            for(int j = 0;j < 3;++j)
+            {
+                int vi;
+                unpack(p,vi);
+                if ((vi < 0) || (vi >= vn))
+                {
+                    ++invalid;
+                    vi = 0;
+                }
+                f.V(j) = (vn > 0) ? &m.vert[vi] : 0;
+            }
+            unpack(p,f.Flags());
+            unpack(p,f.N());
+            if (lay.fc) unpack(p,f.C());
+            if (lay.fq) unpack(p,f.Q());
+            if (lay.wt)
+                for(int j = 0;j < 3;++j)
+                    unpack(p,f.WT(j));
+            if (f.IsS())
+                ++sfn;
+        }
+    }
+    if (e.en > 0)
+    {
+        buf.resize(size_t(e.en) * lay.eStride);
+        if (!r.read(&buf[0],buf.size()))
+            return false;
+        for(int i = 0;i < e.en;++i)
+        {
+            CEdgeO &ed = m.edge[i];
+            const char *p = &buf[size_t(i) * lay.eStride];
+            for(int j = 0;j < 2;++j)
+            {
+                int vi;
+                unpack(p,vi);
+                if ((vi < 0) || (vi >= vn))
+                    return false;
+                ed.V(j) = &m.vert[vi];
+            }
+            unpack(p,ed.Flags());
+        }
+    }
+    m.svn = svn;
+    m.sfn = sfn;
+    return invalid == 0;
+}
+
+// Hashes the exact values of the parameters of a step (the XML of the scripts rounds the floats)
+class ParameterKeyVisitor : public Visitor
+{
+public:
+    ParameterKeyVisitor(QCryptographicHash &hash) :valid(true),_hash(hash) {}
+
+    void visit(RichBool &pd) {begin(pd,'b'); add(pd.val->getBool());}
+    void visit(RichInt &pd) {begin(pd,'i'); add(pd.val->getInt());}
+    void visit(RichFloat &pd) {begin(pd,'f'); add(pd.val->getFloat());}
+    void visit(RichString &pd) {begin(pd,'s'); add(pd.val->getString());}
+    void visit(RichMatrix44f &pd)
+    {
+        begin(pd,'m');
+        const vcg::Matrix44f mat = pd.val->getMatrix44f();
+        for(int i = 0;i < 4;++i)
+            for(int j = 0;j < 4;++j)
+                add(mat.ElementAt(i,j));
+    }
+    void visit(RichPoint3f &pd)
+    {
+        begin(pd,'p');
+        const vcg::Point3f p = pd.val->getPoint3f();
+        add(p[0]); add(p[1]); add(p[2]);
+    }
+    // cameras are not hashed: the step and the following ones are not cached
+    void visit(RichShotf &pd) {begin(pd,'h'); valid = false;}
+    void visit(RichColor &pd) {begin(pd,'c'); add(unsigned(pd.val->getColor().rgba()));}
+    void visit(RichAbsPerc &pd) {begin(pd,'a'); add(pd.val->getAbsPerc());}
+    void visit(RichEnum &pd) {begin(pd,'e'); add(pd.val->getEnum());}
+    void visit(RichFloatList &pd)
+    {
+        begin(pd,'l');
+        const QList<float> list = pd.val->getFloatList();
+        add(list.size());
+        foreach(float f,list)
+            add(f);
+    }
+    void visit(RichDynamicFloat &pd) {begin(pd,'d'); add(pd.val->getDynamicFloat());}
+    // the filters reading a file give a different result if the file changes
+    void visit(RichOpenFile &pd)
+    {
+        begin(pd,'o');
+        const QFileInfo fi(pd.val->getFileName());
+        add(fi.absoluteFilePath());
+        add(fi.exists() ? fi.size() : qint64(-1));
+        add(fi.exists() ? fi.lastModified().toString(Qt::ISODate) : QString());
+    }
+    void visit(RichSaveFile &pd) {begin(pd,'w'); add(pd.val->getFileName());}
+    void visit(RichMesh &pd) {begin(pd,'x'); add(pd.meshindex);}
+
+    void add(const QByteArray &b)
+    {
+        add(b.size());
+        _hash.addData(b);
+    }
+    void add(const QString &s) {add(s.toUtf8());}
+    template <class T>
+    void add(const T &v) {_hash.addData(reinterpret_cast<const char*>(&v),int(sizeof(T)));}
+
+    bool valid;
+
+private:
+    void begin(RichParameter &pd,char type)
+    {
+        add(pd.name);
+        add(type);
+    }
+
+    QCryptographicHash &_hash;
+};
+
+inline void touch(const QString &path)
+{
+#if defined(Q_OS_WIN)
+    _utime(QFile::encodeName(path).constData(),NULL);
+#else
+    utime(QFile::encodeName(path).constData(),NULL);
+#endif
+}
+} // namespace
+
+MLFilterCache::MLFilterCache()
+    :_dir(environmentDirectory()),_budget(environmentBudget())
+{
+}
+
+QString MLFilterCache::environmentDirectory()
+{
+    return QString::fromLocal8Bit(qgetenv("MESHLAB_FILTER_CACHE"));
+}
+
+qint64 MLFilterCache::environmentBudget()
+{
+    bool ok = false;
+    const qint64 mb = QString::fromLocal8Bit(qgetenv("MESHLAB_FILTER_CACHE_MB")).toLongLong(&ok);
+    return ((ok && (mb > 0)) ? mb : 4096) * 1024 * 1024;
+}
+
+bool MLFilterCache::isCacheable(MeshDocument &md)
+{
+    if (!md.rasterList.isEmpty())
+        return false;
+    foreach(MeshModel *m,md.meshList)
+    {
+        if (m->isCompact() || ((m->dataMask() & ~supportedMask) != 0))
+            return false;
+        if (hasStoredAttributes(m->cm))
+            return false;
+    }
+    return true;
+}
+
+QString MLFilterCache::entryPath(const QByteArray &key) const
+{
+    return QDir(_dir).filePath(QString::fromLatin1(key) + ".mlc");
+}
+
+QList<QByteArray> MLFilterCache::scriptKeys(MeshDocument &md,FilterScript &script)
+{
+    QList<QByteArray> keys;
+    if (!isEnabled() || !isCacheable(md))
+        return keys;
+
+    QByteArray key;
+    {
+        MLTraceSpan span("Filter cache key","cache",md.vn(),md.fn());
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(MeshLabApplication::appVer().toUtf8());
+        StateWriter w(&hash,NULL);
+        writeDocument(md,w);
+        key = hash.result().toHex();
+    }
+
+    for(FilterScript::iterator ii = script.filtparlist.begin();ii != script.filtparlist.end();++ii)
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        ParameterKeyVisitor v(hash);
+        v.add(key);
+        v.add((*ii)->filterName());
+        if (!(*ii)->isXMLFilter())
+        {
+            RichParameterSet &par = reinterpret_cast<OldFilterNameParameterValuesPair*>(*ii)->pair.second;
+            for(int i = 0;i < par.paramList.size();++i)
+                par.paramList[i]->accept(v);
+        }
+        else
+        {
+            const QMap<QString,QString> &par = reinterpret_cast<XMLFilterNameParameterValuesPair*>(*ii)->pair.second;
+            for(QMap<QString,QString>::const_iterator it = par.constBegin();it != par.constEnd();++it)
+            {
+                v.add(it.key());
+                v.add(it.value());
+            }
+        }
+        if (!v.valid)
+            break;
+        key = hash.result().toHex();
+        keys << key;
+    }
+    return keys;
+}
+
+int MLFilterCache::resume(MeshDocument &md,const QList<QByteArray> &keys)
+{
+    for(int ii = keys.size();ii > 0;--ii)
+    {
+        const QString path = entryPath(keys[ii - 1]);
+        if (!QFile::exists(path))
+            continue;
+        bool damaged = false;
+        if (restore(path,md,damaged))
+        {
+            touch(path);
+            return ii;
+        }
+        QFile::remove(path);
+        if (damaged)
+            return -1;
+    }
+    return 0;
+}
+
+bool MLFilterCache::restore(const QString &path,MeshDocument &md,bool &damaged)
+{
+    damaged = false;
+    FILE *fp = fopen(QFile::encodeName(path).constData(),"rb");
+    if (fp == NULL)
+        return false;
+    MLTraceSpan span("Filter cache restore","cache");
+    StateReader r(fp);
+
+    char magic[4];
+    int version = 0,scalarSize = 0,qualitySize = 0,texSize = 0,meshCount = 0,nextId = 0,currentId = -1;
+    r.read(magic,4);
+    r.get(version); r.get(scalarSize); r.get(qualitySize); r.get(texSize);
+    r.get(meshCount); r.get(nextId); r.get(currentId);
+    if (!r.ok() || (memcmp(magic,stateMagic,4) != 0) || (version != stateVersion) || (scalarSize != int(sizeof(Scalarm))) ||
+        (qualitySize != int(sizeof(VertQuality))) || (texSize != int(sizeof(VertTexCoord))) || (meshCount < 0) || (meshCount > 65536))
+    {
+        fclose(fp);
+        return false;
+    }
+    std::vector<MeshEntry> entries(meshCount);
+    qint64 expected = 0;
+    for(int mi = 0;mi < meshCount;++mi)
+    {
+        if (!entries[mi].read(r) || (entries[mi].id >= nextId))
+        {
+            fclose(fp);
+            return false;
+        }
+        expected += entries[mi].dataSize();
+    }
+    // a truncated entry is detected before touching the document
+    expected += filePos(fp) + 4;
+    if (expected != QFileInfo(path).size())
+    {
+        fclose(fp);
+        return false;
+    }
+
+    damaged = true;
+    md.setBusy(true);
+    QList<int> ids;
+    for(int mi = 0;mi < meshCount;++mi)
+        ids << entries[mi].id;
+    foreach(MeshModel *m,QList<MeshModel*>(md.meshList))
+        if (!ids.contains(m->id()))
+            md.delMesh(m);
+
+    QList<MeshModel*> layers;
+    std::vector<char> buf;
+    bool ok = true;
+    for(int mi = 0;(mi < meshCount) && ok;++mi)
+    {
+        const MeshEntry &e = entries[mi];
+        MeshModel *m = md.getMesh(e.id);
+        if (m == NULL)
+        {
+            // the new layer gets the id it had when the state was saved
+            md.setNextMeshId(e.id);
+            m = md.addNewMesh(e.fullName,e.label,false);
+        }
+        layers << m;
+        m->clearDataMask(m->dataMask() & ~e.mask);
+        m->cm.Clear();
+        m->Clear();
+        m->updateDataMask(e.mask & ~topologyMask);
+        m->setLabel(e.label);
+        if (!e.fullName.isEmpty())
+            m->setFileName(e.fullName);
+        m->visible = (e.visible != 0);
+        m->cm.Tr = e.Tr;
+        m->cm.C() = e.color;
+        m->cm.textures = e.textures;
+        m->cm.normalmaps = e.normalmaps;
+        vcg::tri::Allocator<CMeshO>::AddVertices(m->cm,e.vn);
+        vcg::tri::Allocator<CMeshO>::AddFaces(m->cm,e.fn);
+        vcg::tri::Allocator<CMeshO>::AddEdges(m->cm,e.en);
+        ok = readMesh(m->cm,e,buf,r);
+        vcg::tri::UpdateBounding<CMeshO>::Box(m->cm);
+        m->updateDataMask(e.mask & topologyMask);
+        // the restored state is the result of some filters, not the content of the file of the layer
+        m->meshModified() = true;
+    }
+    char end[4];
+    ok = ok && r.read(end,4) && (memcmp(end,stateEnd,4) == 0);
+    fclose(fp);
+
+    md.meshList = layers;
+    md.setNextMeshId(nextId);
+    md.setCurrentMesh(currentId);
+    md.setBusy(false);
+    span.setCounts(md.vn(),md.fn());
+    return ok;
+}
+
+bool MLFilterCache::store(const QByteArray &key,MeshDocument &md)
+{
+    if (!isEnabled() || !isCacheable(md))
+        return false;
+    const QString path = entryPath(key);
+    if (QFile::exists(path))
+    {
+        touch(path);
+        return true;
+    }
+    qint64 size = 0;
+    foreach(MeshModel *m,md.meshList)
+    {
+        const Layout lay(m->dataMask());
+        size += qint64(m->cm.vn) * qint64(lay.vStride) + qint64(m->cm.fn) * qint64(lay.fStride);
+    }
+    if (size > _budget)
+        return false;
+    if (!QDir().mkpath(_dir))
+        return false;
+
+    MLTraceSpan span("Filter cache store","cache",md.vn(),md.fn());
+    // written aside and renamed, other processes sharing the cache never see a partial entry
+    const QString part = path + QString(".%1.part").arg(QCoreApplication::applicationPid());
+    FILE *fp = fopen(QFile::encodeName(part).constData(),"wb");
+    if (fp == NULL)
+        return false;
+    StateWriter w(NULL,fp);
+    bool ok = writeDocument(md,w);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || !QFile::rename(part,path))
+    {
+        QFile::remove(part);
+        return false;
+    }
+    evict();
+    return true;
+}
+
+void MLFilterCache::evict()
+{
+    // least recently used first: the entries are touched when they are restored
+    const QFileInfoList entries = QDir(_dir).entryInfoList(QStringList("*.mlc"),QDir::Files,QDir::Time | QDir::Reversed);
+    qint64 total = 0;
+    foreach(const QFileInfo &fi,entries)
+        total += fi.size();
+    for(int ii = 0;(ii < entries.size()) && (total > _budget);++ii)
+        if (QFile::remove(entries[ii].absoluteFilePath()))
+            total -= entries[ii].size();
+}
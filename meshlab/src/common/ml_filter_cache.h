@@ -0,0 +1,97 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_FILTER_CACHE_H
+#define ML_FILTER_CACHE_H
+
+#include <QString>
+#include <QList>
+#include <QByteArray>
+
+class MeshDocument;
+class FilterScript;
+
+/*
+  On disk cache of the results of the steps of a filter script.
+
+  The state of the document after each step is identified by a key chained from the
+  content of the document the script starts from: the key of the initial state is the
+  SHA-1 of the serialized document (meshes, attributes, transforms, layer ids and
+  names), the key of step i hashes the key of step i-1 with the filter name and the
+  exact values of its parameters. Re-running a script whose first steps did not
+  change restores the state of the longest cached prefix and runs only the rest.
+
+  The states are stored in a raw binary format (one file per key) with the live
+  elements only, packed and unpacked in parallel. When the size of the directory
+  goes over the budget the least recently used entries are removed.
+
+  The cache is off unless a directory is set, by default from the
+  MESHLAB_FILTER_CACHE environment variable (budget in MB from
+  MESHLAB_FILTER_CACHE_MB, 4096 if not set).
+  Documents with raster layers, compact point clouds, user defined attributes or
+  per element data that the format does not store (curvature, radius, cameras,
+  wedge colors and normals) are not cached: the script just runs as usual.
+
+  Usage:
+    MLFilterCache cache;
+    QList<QByteArray> keys = cache.scriptKeys(md,script);
+    int first = cache.resume(md,keys);   // steps already done
+    ... after step i succeeded
+    cache.store(keys[i],md);              // if i < keys.size()
+*/
+class MLFilterCache
+{
+public:
+    MLFilterCache();
+
+    static QString environmentDirectory();
+    static qint64 environmentBudget();
+
+    void setDirectory(const QString &dir) {_dir = dir;}
+    const QString &directory() const {return _dir;}
+    void setBudget(qint64 bytes) {_budget = bytes;}
+    bool isEnabled() const {return !_dir.isEmpty();}
+
+    // Keys of the states after each step of the script applied to md (hex SHA-1).
+    // The list stops before the first step whose parameters cannot be hashed and it is
+    // empty if the cache is disabled or md cannot be cached.
+    QList<QByteArray> scriptKeys(MeshDocument &md,FilterScript &script);
+    // Replaces the content of md with the longest cached prefix of keys and returns its
+    // length (0 if nothing was found). Returns -1 if an entry could not be read after
+    // md had already been changed.
+    int resume(MeshDocument &md,const QList<QByteArray> &keys);
+    // Saves the state of md under key and evicts the old entries over the budget
+    bool store(const QByteArray &key,MeshDocument &md);
+
+    static bool isCacheable(MeshDocument &md);
+
+private:
+    QString entryPath(const QByteArray &key) const;
+    bool restore(const QString &path,MeshDocument &md,bool &damaged);
+    void evict();
+
+    QString _dir;
+    qint64 _budget;
+};
+
+#endif // ML_FILTER_CACHE_H
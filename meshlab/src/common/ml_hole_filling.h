@@ -0,0 +1,387 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_HOLE_FILLING_H
+#define ML_HOLE_FILLING_H
+
+#include <vector>
+#include <algorithm>
+#include <vcg/complex/complex.h>
+#include <vcg/complex/algorithms/clean.h>
+#include <vcg/complex/algorithms/hole.h>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+/*
+Parallel versions of tri::Hole::GetInfo, EarCuttingFill and EarCuttingIntersectionFill,
+giving the same holes and the same fills of the serial ones.
+
+GetInfo: the border edges are collected in parallel, a block of faces per thread, and
+then the loops are walked serially starting from them in face order, so only the
+border is visited serially and the holes come out in the same order.
+
+FillHoles: the faces of all the holes are allocated at once, in the order the serial
+code adds them, each hole getting a block of size-2 faces. The ear cutting of a hole
+only reads and changes the faces around its border vertices, so the holes that do not
+share a vertex with other holes are filled in parallel, each one in its own block; the
+holes sharing some vertex are then filled serially, in their order. The faces left
+unused in the blocks are deleted at the end, as FillHoleEar does after every hole.
+
+The self intersection test of tri::SelfIntersectionEar checks the new faces against a
+static ring of faces, shared by all the ears; RingSelfIntersectionEar does the same
+test on the ring of the hole it belongs to, so that several holes can be filled at the
+same time.
+*/
+template <class MeshType>
+class RingSelfIntersectionEar : public vcg::tri::MinimumWeightEar<MeshType>
+{
+public:
+    typedef typename MeshType::FaceType FaceType;
+    typedef typename MeshType::FacePointer FacePointer;
+    typedef typename vcg::face::Pos<FaceType> PosType;
+
+    RingSelfIntersectionEar() : ring(0) {}
+    RingSelfIntersectionEar(const PosType &ep) : vcg::tri::MinimumWeightEar<MeshType>(ep), ring(0) {}
+
+    // the faces around the hole and the ones already added to fill it
+    std::vector<FacePointer> *ring;
+
+    virtual bool Close(PosType &np0, PosType &np1, FacePointer f)
+    {
+        // the new face is temporarily attached to test it
+        (*f).V(0) = this->e0.VFlip();
+        (*f).V(1) = this->e0.v;
+        (*f).V(2) = this->e1.v;
+
+        (*f).FFp(0) = this->e0.f;
+        (*f).FFi(0) = this->e0.z;
+        (*f).FFp(1) = this->e1.f;
+        (*f).FFi(1) = this->e1.z;
+        (*f).FFp(2) = f;
+        (*f).FFi(2) = 2;
+
+        const int a1 = this->e0.z;
+        const int a2 = this->e1.z;
+
+        this->e0.f->FFp(this->e0.z) = f;
+        this->e0.f->FFi(this->e0.z) = 0;
+        this->e1.f->FFp(this->e1.z) = f;
+        this->e1.f->FFi(this->e1.z) = 1;
+
+        bool intersect = false;
+        for (size_t i = 0; i < ring->size() && !intersect; ++i)
+            if (!(*ring)[i]->IsD() && vcg::tri::Clean<MeshType>::TestFaceFaceIntersection(&*f, (*ring)[i]))
+                intersect = true;
+
+        this->e0.f->FFp(this->e0.z) = this->e0.f;
+        this->e0.f->FFi(this->e0.z) = a1;
+        this->e1.f->FFp(this->e1.z) = this->e1.f;
+        this->e1.f->FFi(this->e1.z) = a2;
+        if (intersect)
+            return false;
+
+        const bool ret = vcg::tri::TrivialEar<MeshType>::Close(np0, np1, f);
+        if (ret)
+            ring->push_back(f);
+        return ret;
+    }
+};
+
+template <class MeshType>
+class HoleFilling
+{
+public:
+    typedef typename MeshType::ScalarType ScalarType;
+    typedef typename MeshType::VertexType VertexType;
+    typedef typename MeshType::FaceType FaceType;
+    typedef typename MeshType::FacePointer FacePointer;
+    typedef typename vcg::face::Pos<FaceType> PosType;
+    typedef typename vcg::tri::Hole<MeshType>::Info Info;
+
+    // Same holes, in the same order, of tri::Hole::GetInfo; as it does, leaves the V flag
+    // on the faces of the holes (and, with selected, on the unselected faces).
+    static void GetInfo(MeshType &m, bool selected, std::vector<Info> &holes)
+    {
+        const int faceNum = int(m.face.size());
+        int threadNum = 1;
+#ifdef _USE_OMP
+        threadNum = omp_get_max_threads();
+#endif
+        // border edges (3 * face index + edge) found by each thread, in face order
+        std::vector< std::vector<int> > borders(threadNum);
+
+#ifdef _USE_OMP
+        #pragma omp parallel num_threads(threadNum)
+#endif
+        {
+            int t = 0, teamSize = 1;
+#ifdef _USE_OMP
+            t = omp_get_thread_num();
+            teamSize = omp_get_num_threads();
+#endif
+            const int f0 = int((long long)faceNum * t / teamSize);
+            const int f1 = int((long long)faceNum * (t + 1) / teamSize);
+            std::vector<int> &b = borders[t];
+            for (int i = f0; i < f1; ++i)
+            {
+                FaceType &f = m.face[i];
+                if (f.IsD()) continue;
+                f.ClearV();
+                // the unselected faces cannot start a hole
+                if (selected && !f.IsS())
+                    f.SetV();
+                else
+                    for (int j = 0; j < 3; ++j)
+                        if (vcg::face::IsBorder(f, j))
+                            b.push_back(3 * i + j);
+            }
+        }
+
+        holes.clear();
+        for (int t = 0; t < threadNum; ++t)
+            for (size_t k = 0; k < borders[t].size(); ++k)
+            {
+                FaceType &f = m.face[borders[t][k] / 3];
+                if (f.IsV()) continue;
+                const int j = borders[t][k] % 3;
+                f.SetV();
+                PosType sp(&f, j, f.V(j));
+                const PosType fp = sp;
+                int holeSize = 0;
+                vcg::Box3<ScalarType> hbox;
+                hbox.Add(sp.v->cP());
+                do
+                {
+                    sp.f->SetV();
+                    hbox.Add(sp.v->cP());
+                    ++holeSize;
+                    sp.NextB();
+                    sp.f->SetV();
+                } while (sp != fp);
+                holes.push_back(Info(sp, holeSize, hbox));
+            }
+    }
+
+    // Fills the holes as calling tri::Hole::FillHoleEar<EAR> on each of them, in order:
+    // same faces, in the same order, and same deleted faces. The face pointers of the
+    // holes and the ones in facePointersToBeUpdated are updated.
+    // With RingSelfIntersectionEar the ring of every hole is the one of
+    // tri::Hole::EarCuttingIntersectionFill.
+    template <class EAR>
+    static void FillHoles(MeshType &m, std::vector<Info> &holes, std::vector<FacePointer *> &facePointersToBeUpdated, vcg::CallBackPos *cb = 0)
+    {
+        const int holeNum = int(holes.size());
+        if (holeNum == 0) return;
+
+        // hole k gets the faces [first[k], first[k+1])
+        std::vector<size_t> first(holeNum + 1);
+        first[0] = m.face.size();
+        for (int k = 0; k < holeNum; ++k)
+            first[k + 1] = first[k] + size_t(std::max(holes[k].size - 2, 0));
+        std::vector<FacePointer *> toUpdate(facePointersToBeUpdated);
+        for (int k = 0; k < holeNum; ++k)
+            toUpdate.push_back(&holes[k].p.f);
+        vcg::tri::Allocator<MeshType>::AddFaces(m, first[holeNum] - first[0], toUpdate);
+
+        // a vertex shared by two holes makes both of them dependent on the fill order
+        std::vector<int> owner(m.vert.size(), -1);
+        std::vector<char> shared(holeNum, 0);
+        for (int k = 0; k < holeNum; ++k)
+        {
+            PosType ip = holes[k].p;
+            do
+            {
+                int &o = owner[vcg::tri::Index(m, ip.v)];
+                if (o == -1)
+                    o = k;
+                else if (o != k)
+                    shared[k] = shared[o] = 1;
+                ip.NextB();
+            } while (ip != holes[k].p);
+        }
+        std::vector<int> independent, dependent;
+        for (int k = 0; k < holeNum; ++k)
+            (shared[k] ? dependent : independent).push_back(k);
+
+        // FillHoleEar takes (and releases) the same bit for every hole
+        const int nmBit = VertexType::NewBitFlag();
+        std::vector<int> used(holeNum, 0);
+        int done = 0;
+        const int independentNum = int(independent.size());
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic, 16)
+#endif
+        for (int ii = 0; ii < independentNum; ++ii)
+        {
+            const int k = independent[ii];
+            used[k] = FillHole<EAR>(holes[k], &*m.face.begin() + first[k], nmBit);
+            // the count is read in the same critical section that increments it
+            int filled;
+#ifdef _USE_OMP
+            #pragma omp critical (holeFillingProgress)
+#endif
+            filled = ++done;
+            bool master = true;
+#ifdef _USE_OMP
+            master = (omp_get_thread_num() == 0);
+#endif
+            if (master && cb)
+                cb(100 * filled / holeNum, "Closing Holes");
+        }
+        for (size_t ii = 0; ii < dependent.size(); ++ii)
+        {
+            const int k = dependent[ii];
+            used[k] = FillHole<EAR>(holes[k], &*m.face.begin() + first[k], nmBit);
+            if (cb)
+                cb(100 * (independentNum + int(ii) + 1) / holeNum, "Closing Holes");
+        }
+        VertexType::DeleteBitFlag(nmBit);
+
+        for (int k = 0; k < holeNum; ++k)
+            for (size_t i = first[k] + used[k]; i < first[k + 1]; ++i)
+                vcg::tri::Allocator<MeshType>::DeleteFace(m, m.face[i]);
+    }
+
+    // Parallel tri::Hole::EarCuttingFill
+    template <class EAR>
+    static int EarCuttingFill(MeshType &m, int sizeHole, bool selected = false, vcg::CallBackPos *cb = 0)
+    {
+        std::vector<Info> holes;
+        SmallHoles(m, sizeHole, selected, holes);
+        std::vector<FacePointer *> none;
+        FillHoles<EAR>(m, holes, none, cb);
+        return int(holes.size());
+    }
+
+    // Parallel tri::Hole::EarCuttingIntersectionFill<tri::SelfIntersectionEar>
+    static int EarCuttingIntersectionFill(MeshType &m, int maxSizeHole, bool selected, vcg::CallBackPos *cb = 0)
+    {
+        return EarCuttingFill< RingSelfIntersectionEar<MeshType> >(m, maxSizeHole, selected, cb);
+    }
+
+private:
+    static void SmallHoles(MeshType &m, int sizeHole, bool selected, std::vector<Info> &holes)
+    {
+        std::vector<Info> all;
+        GetInfo(m, selected, all);
+        holes.clear();
+        for (size_t k = 0; k < all.size(); ++k)
+            if (all[k].size < sizeHole)
+                holes.push_back(all[k]);
+    }
+
+    // only RingSelfIntersectionEar uses the ring
+    static bool NeedsRing(const vcg::tri::TrivialEar<MeshType> *) {return false;}
+    static bool NeedsRing(const RingSelfIntersectionEar<MeshType> *) {return true;}
+    static void BindRing(vcg::tri::TrivialEar<MeshType> &, std::vector<FacePointer> *) {}
+    static void BindRing(RingSelfIntersectionEar<MeshType> &ear, std::vector<FacePointer> *ring) {ear.ring = ring;}
+
+    // The ear cutting of FillHoleEar on the faces starting at f, returns the faces used.
+    template <class EAR>
+    static int FillHole(const Info &h, FacePointer f, int nmBit)
+    {
+        // faces around the hole, for the self intersection test
+        std::vector<FacePointer> ring;
+        PosType ip = h.p;
+        if (NeedsRing((EAR *)0))
+            do
+            {
+                PosType inp = ip;
+                do
+                {
+                    inp.FlipE();
+                    inp.FlipF();
+                    ring.push_back(inp.f);
+                } while (!inp.IsBorder());
+                ip.NextB();
+            } while (ip != h.p);
+
+        // the vertices visited more than once are non manifold
+        ip = h.p;
+        do
+        {
+            ip.V()->ClearUserBit(nmBit);
+            ip.V()->ClearV();
+            ip.NextB();
+        } while (ip != h.p);
+        ip = h.p;
+        do
+        {
+            if (!ip.V()->IsV())
+                ip.V()->SetV();
+            else
+                ip.V()->SetUserBit(nmBit);
+            ip.NextB();
+        } while (ip != h.p);
+
+        std::vector<EAR> earHeap;
+        earHeap.reserve(h.size);
+        PosType fp = h.p;
+        do
+        {
+            EAR ear(fp);
+            BindRing(ear, &ring);
+            earHeap.push_back(ear);
+            fp.NextB();
+        } while (fp != h.p);
+
+        int cnt = h.size;
+        int used = 0;
+        std::make_heap(earHeap.begin(), earHeap.end());
+        while (cnt > 2 && !earHeap.empty())
+        {
+            std::pop_heap(earHeap.begin(), earHeap.end());
+            EAR bestEar = earHeap.back();
+            earHeap.pop_back();
+            if (bestEar.IsUpToDate() && !bestEar.IsDegen(nmBit))
+            {
+                if ((*f).HasPolyInfo()) (*f).Alloc(3);
+                PosType ep0, ep1;
+                if (bestEar.Close(ep0, ep1, f))
+                {
+                    if (!ep0.IsNull())
+                    {
+                        EAR ear(ep0);
+                        BindRing(ear, &ring);
+                        earHeap.push_back(ear);
+                        std::push_heap(earHeap.begin(), earHeap.end());
+                    }
+                    if (!ep1.IsNull())
+                    {
+                        EAR ear(ep1);
+                        BindRing(ear, &ring);
+                        earHeap.push_back(ear);
+                        std::push_heap(earHeap.begin(), earHeap.end());
+                    }
+                    --cnt;
+                    ++f;
+                    ++used;
+                }
+            }
+        }
+        return used;
+    }
+};
+
+#endif // ML_HOLE_FILLING_H
@@ -0,0 +1,425 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_knn_graph.h"
+#include "mltrace.h"
+
+#include <algorithm>
+#include <limits>
+#include <QSharedPointer>
+#include <vcg/space/fitting3.h>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+namespace
+{
+struct AxisLess
+{
+    const std::vector<Point3m> &p;
+    int axis;
+    AxisLess(const std::vector<Point3m> &points, int a) : p(points), axis(a) {}
+    bool operator()(int a, int b) const {return p[a][axis] < p[b][axis];}
+};
+
+const char *knnAttributeName = "MLKnnGraph";
+}
+
+// Max heap of the k best candidates found so far, kept in the caller's arrays
+struct MLKdTree::Heap
+{
+    int k;
+    int n;
+    int *idx;
+    Scalarm *d2;
+
+    Scalarm worst() const {return (n < k) ? std::numeric_limits<Scalarm>::max() : d2[0];}
+
+    void push(Scalarm d, int id)
+    {
+        int c;
+        if (n < k)
+        {
+            // sift up from the new leaf
+            c = n++;
+            while (c > 0 && d2[(c - 1) / 2] < d)
+            {
+                d2[c] = d2[(c - 1) / 2];
+                idx[c] = idx[(c - 1) / 2];
+                c = (c - 1) / 2;
+            }
+        }
+        else
+            c = siftDown(0, d, n);
+        d2[c] = d;
+        idx[c] = id;
+    }
+
+    // moves down the hole at c until d fits, returns its final position
+    int siftDown(int c, Scalarm d, int size)
+    {
+        for (;;)
+        {
+            int ch = 2 * c + 1;
+            if (ch >= size)
+                break;
+            if (ch + 1 < size && d2[ch + 1] > d2[ch])
+                ++ch;
+            if (d2[ch] <= d)
+                break;
+            d2[c] = d2[ch];
+            idx[c] = idx[ch];
+            c = ch;
+        }
+        return c;
+    }
+
+    // heap sort, leaves the candidates in increasing distance order
+    void sort()
+    {
+        for (int size = n - 1; size > 0; --size)
+        {
+            const Scalarm d = d2[size];
+            const int id = idx[size];
+            d2[size] = d2[0];
+            idx[size] = idx[0];
+            const int c = siftDown(0, d, size);
+            d2[c] = d;
+            idx[c] = id;
+        }
+    }
+};
+
+MLKdTree::MLKdTree(const std::vector<Point3m> &points, int bucketSize)
+{
+    const int pointNum = int(points.size());
+    _index.resize(pointNum);
+    for (int i = 0; i < pointNum; ++i)
+        _index[i] = i;
+    _depth = 0;
+    while ((pointNum >> _depth) > bucketSize)
+        ++_depth;
+    _split.resize((1 << _depth) - 1);
+    _axis.resize((1 << _depth) - 1);
+
+    // the nodes of a level cover disjoint ranges of _index
+    for (int level = 0; level < _depth; ++level)
+    {
+        const int nodeNum = 1 << level;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic)
+#endif
+        for (int j = 0; j < nodeNum; ++j)
+        {
+            const int b = rangeBegin(level, j);
+            const int e = rangeBegin(level, j + 1);
+            const int mid = rangeBegin(level + 1, 2 * j + 1);
+            Box3m box;
+            for (int t = b; t < e; ++t)
+                box.Add(points[_index[t]]);
+            const int axis = box.MaxDim();
+            std::nth_element(_index.begin() + b, _index.begin() + mid, _index.begin() + e, AxisLess(points, axis));
+            _axis[nodeNum - 1 + j] = (unsigned char)axis;
+            _split[nodeNum - 1 + j] = points[_index[mid]][axis];
+        }
+    }
+
+    _points.resize(pointNum);
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int t = 0; t < pointNum; ++t)
+        _points[t] = points[_index[t]];
+}
+
+int MLKdTree::query(const Point3m &p, int k, int *idx, Scalarm *dist2, int skip) const
+{
+    Heap heap;
+    heap.k = k;
+    heap.n = 0;
+    heap.idx = idx;
+    heap.d2 = dist2;
+    if (k > 0 && size() > 0)
+        search(0, 0, p, skip, heap);
+    heap.sort();
+    return heap.n;
+}
+
+void MLKdTree::search(int level, int node, const Point3m &p, int skip, Heap &heap) const
+{
+    if (level == _depth)
+    {
+        const int e = rangeBegin(level, node + 1);
+        for (int t = rangeBegin(level, node); t < e; ++t)
+        {
+            if (_index[t] == skip)
+                continue;
+            const Scalarm d = vcg::SquaredDistance(p, _points[t]);
+            if (d < heap.worst())
+                heap.push(d, _index[t]);
+        }
+        return;
+    }
+    const int id = (1 << level) - 1 + node;
+    const Scalarm diff = p[_axis[id]] - _split[id];
+    const int nearChild = (diff < 0) ? 2 * node : 2 * node + 1;
+    search(level + 1, nearChild, p, skip, heap);
+    if (diff * diff < heap.worst())
+        search(level + 1, nearChild ^ 1, p, skip, heap);
+}
+
+MLKnnGraph::MLKnnGraph()
+    :_k(0), _requestedK(0), _vn(0), _vertSize(0), _vertData(0)
+{
+}
+
+void MLKnnGraph::build(const CMeshO &m, int k)
+{
+    MLTraceSpan span("kNN graph", "knn", m.vn, 0);
+    const int vertNum = int(m.vert.size());
+    std::vector<int> ids;
+    std::vector<Point3m> points;
+    ids.reserve(m.vn);
+    points.reserve(m.vn);
+    for (int i = 0; i < vertNum; ++i)
+        if (!m.vert[i].IsD())
+        {
+            ids.push_back(i);
+            points.push_back(m.vert[i].cP());
+        }
+    const int pointNum = int(points.size());
+
+    _requestedK = k;
+    _k = std::max(0, std::min(k, pointNum - 1));
+    _vn = m.vn;
+    _vertSize = m.vert.size();
+    _vertData = m.vert.empty() ? 0 : &m.vert[0];
+    _nbr.assign(_vertSize * _k, -1);
+    if (_k == 0)
+        return;
+
+    MLKdTree tree(points);
+    std::vector<Point3m>().swap(points);
+#ifdef _USE_OMP
+    #pragma omp parallel
+#endif
+    {
+        std::vector<int> idx(_k);
+        std::vector<Scalarm> dist2(_k);
+        // following the tree order, consecutive queries visit the same leaves
+#ifdef _USE_OMP
+        #pragma omp for schedule(dynamic, 1024)
+#endif
+        for (int t = 0; t < pointNum; ++t)
+        {
+            const int pi = tree.index(t);
+            tree.query(tree.point(t), _k, &idx[0], &dist2[0], pi);
+            int *out = &_nbr[size_t(ids[pi]) * _k];
+            for (int j = 0; j < _k; ++j)
+                out[j] = ids[idx[j]];
+        }
+    }
+}
+
+bool MLKnnGraph::isValidFor(const CMeshO &m, int k) const
+{
+    return k <= _requestedK && _vn == m.vn && _vertSize == m.vert.size() &&
+           _vertData == (m.vert.empty() ? 0 : &m.vert[0]);
+}
+
+const MLKnnGraph &MLKnnGraph::get(CMeshO &m, int k)
+{
+    CMeshO::PerMeshAttributeHandle<QSharedPointer<MLKnnGraph> > h =
+        vcg::tri::Allocator<CMeshO>::GetPerMeshAttribute<QSharedPointer<MLKnnGraph> >(m, knnAttributeName);
+    QSharedPointer<MLKnnGraph> &graph = h();
+    if (graph.isNull() || !graph->isValidFor(m, k))
+    {
+        graph.clear();
+        graph = QSharedPointer<MLKnnGraph>(new MLKnnGraph());
+        graph->build(m, k);
+    }
+    return *graph;
+}
+
+const char *MLKnnGraph::attributeName()
+{
+    return knnAttributeName;
+}
+
+void MLKnnGraph::invalidate(CMeshO &m)
+{
+    if (vcg::tri::HasPerMeshAttribute(m, knnAttributeName))
+        vcg::tri::Allocator<CMeshO>::DeletePerMeshAttribute(m, knnAttributeName);
+}
+
+namespace
+{
+// Arc of the orientation spanning tree, the most parallel normals are visited first
+struct OrientArc
+{
+    int src;
+    int dst;
+    Scalarm w;
+    bool operator<(const OrientArc &a) const {return w < a.w;}
+};
+}
+
+void MLPointCloudNormal::Compute(CMeshO &m, int fittingAdjNum, int smoothingIterNum, bool useViewPoint, const Point3m &viewPoint, vcg::CallBackPos *cb)
+{
+    // same default of tri::PointCloudNormal::Param
+    const int coherentAdjNum = 8;
+    const int vertNum = int(m.vert.size());
+
+    // the vertex is part of its own neighborhood
+    if (cb) cb(1, "Building the neighbor graph");
+    const MLKnnGraph &graph = MLKnnGraph::get(m, std::max(fittingAdjNum, coherentAdjNum) - 1);
+    const int fitNum = std::min(fittingAdjNum - 1, graph.k());
+
+    if (cb) cb(40, "Fitting planes");
+#ifdef _USE_OMP
+    #pragma omp parallel
+#endif
+    {
+        std::vector<Point3m> ptVec;
+        ptVec.reserve(fitNum + 1);
+#ifdef _USE_OMP
+        #pragma omp for schedule(dynamic, 1024)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            CVertexO &v = m.vert[i];
+            if (v.IsD())
+                continue;
+            const int *nb = graph.neighbors(i);
+            ptVec.clear();
+            ptVec.push_back(v.cP());
+            for (int j = 0; j < fitNum; ++j)
+                ptVec.push_back(m.vert[nb[j]].cP());
+            vcg::Plane3<Scalarm> plane;
+            vcg::FitPlaneToPointSet(ptVec, plane);
+            v.N() = plane.Direction();
+        }
+    }
+
+    if (cb) cb(70, "Smoothing normals");
+    Smooth(m, fittingAdjNum, smoothingIterNum);
+
+    if (cb) cb(90, "Orienting normals");
+    if (useViewPoint)
+    {
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            CVertexO &v = m.vert[i];
+            if (!v.IsD() && v.N().dot(viewPoint - v.cP()) < 0)
+                v.N() = -v.N();
+        }
+        return;
+    }
+
+    // propagate the orientation along a maximum spanning tree of the normal agreement
+    const int cohNum = std::min(coherentAdjNum - 1, graph.k());
+    std::vector<char> visited(vertNum, 0);
+    std::vector<OrientArc> heap;
+    for (int s = 0; s < vertNum; ++s)
+    {
+        if (m.vert[s].IsD() || visited[s])
+            continue;
+        visited[s] = 1;
+        int cur = s;
+        for (;;)
+        {
+            const int *nb = graph.neighbors(cur);
+            for (int j = 0; j < cohNum; ++j)
+                if (!visited[nb[j]])
+                {
+                    OrientArc a;
+                    a.src = cur;
+                    a.dst = nb[j];
+                    a.w = vcg::math::Abs(m.vert[cur].cN().dot(m.vert[nb[j]].cN()));
+                    heap.push_back(a);
+                    std::push_heap(heap.begin(), heap.end());
+                }
+            cur = -1;
+            while (cur < 0 && !heap.empty())
+            {
+                std::pop_heap(heap.begin(), heap.end());
+                const OrientArc a = heap.back();
+                heap.pop_back();
+                if (!visited[a.dst])
+                {
+                    visited[a.dst] = 1;
+                    if (m.vert[a.src].cN().dot(m.vert[a.dst].cN()) < 0)
+                        m.vert[a.dst].N() = -m.vert[a.dst].N();
+                    cur = a.dst;
+                }
+            }
+            if (cur < 0)
+                break;
+        }
+    }
+}
+
+void MLPointCloudNormal::Smooth(CMeshO &m, int neighborNum, int iterNum)
+{
+    if (iterNum <= 0)
+        return;
+    const int vertNum = int(m.vert.size());
+    const MLKnnGraph &graph = MLKnnGraph::get(m, std::max(neighborNum - 1, 1));
+    const int nbNum = std::min(neighborNum - 1, graph.k());
+    std::vector<Point3m> sum(vertNum);
+    for (int it = 0; it < iterNum; ++it)
+    {
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            const CVertexO &v = m.vert[i];
+            if (v.IsD())
+                continue;
+            const int *nb = graph.neighbors(i);
+            Point3m n = v.cN();
+            for (int j = 0; j < nbNum; ++j)
+            {
+                const Point3m &nn = m.vert[nb[j]].cN();
+                if (nn.dot(v.cN()) > 0)
+                    n += nn;
+                else
+                    n -= nn;
+            }
+            sum[i] = n;
+        }
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+            if (!m.vert[i].IsD())
+            {
+                m.vert[i].N() = sum[i];
+                m.vert[i].N().Normalize();
+            }
+    }
+}
@@ -0,0 +1,120 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_KNN_GRAPH_H
+#define ML_KNN_GRAPH_H
+
+#include "ml_mesh_type.h"
+#include <vector>
+
+/*
+  k nearest neighbors of point clouds, shared by the normal estimation, the MLS radius
+  estimation and the point editing tools.
+
+  MLKdTree is a balanced kd-tree over a static set of points: every split is at the
+  median of the widest side of the node, so the shape of the tree only depends on the
+  number of points and the nodes can be stored implicitly. The levels are built one at
+  a time, all the nodes of a level in parallel. The points are copied in leaf order, so
+  that both the leaf scans and a query loop that follows the tree order touch
+  contiguous memory. Queries are const and can be issued concurrently.
+
+  MLKnnGraph stores the k nearest neighbors of every vertex of a mesh (the vertex itself
+  excluded), sorted by increasing distance; all the queries are run in parallel.
+  MLKnnGraph::get caches the graph in a per mesh attribute: the graph is reused while
+  the vertex vector is unchanged and the requested k is not larger than the cached
+  one. Code that moves the vertices without reallocating them must call
+  MLKnnGraph::invalidate (MeshModel::invalidateTopology does it after the filters that
+  change the vertex coordinates, MeshModel::Clear when the mesh is reset). The graph
+  takes k ints per vertex, so the users free it with invalidate once they are done:
+  it is shared by the steps of one operation (e.g. the fitting, smoothing and orienting
+  of the normals, or the selections of edit_point), not kept for the life of the mesh.
+*/
+class MLKdTree
+{
+public:
+    explicit MLKdTree(const std::vector<Point3m> &points, int bucketSize = 16);
+
+    int size() const {return int(_index.size());}
+    // index in the input vector of the t-th point in tree order
+    int index(int t) const {return _index[t];}
+    const Point3m &point(int t) const {return _points[t];}
+
+    // Fills idx and dist2 (which must have room for k values) with the k points closest
+    // to p, in increasing distance order, skipping the input point with index skip.
+    // Returns the number of points found (less than k only for small sets).
+    int query(const Point3m &p, int k, int *idx, Scalarm *dist2, int skip = -1) const;
+
+private:
+    struct Heap;
+    void search(int level, int node, const Point3m &p, int skip, Heap &heap) const;
+    int rangeBegin(int level, int node) const {return int((long long)size() * node >> level);}
+
+    int _depth;                     // the leaves are all at this level
+    std::vector<Point3m> _points;   // in leaf order
+    std::vector<int> _index;
+    std::vector<Scalarm> _split;    // implicit layout, children of n are 2n+1 and 2n+2
+    std::vector<unsigned char> _axis;
+};
+
+class MLKnnGraph
+{
+public:
+    MLKnnGraph();
+
+    void build(const CMeshO &m, int k);
+    bool isValidFor(const CMeshO &m, int k) const;
+
+    // neighbors stored for each vertex; less than the requested k only on tiny meshes
+    int k() const {return _k;}
+    // the k() neighbor indexes of vertex vi, -1 for the deleted vertices
+    const int *neighbors(int vi) const {return &_nbr[size_t(vi) * _k];}
+
+    static const MLKnnGraph &get(CMeshO &m, int k);
+    static void invalidate(CMeshO &m);
+    // name of the per mesh attribute where get caches the graph
+    static const char *attributeName();
+
+private:
+    int _k;
+    int _requestedK;
+    int _vn;
+    size_t _vertSize;
+    const CVertexO *_vertData;
+    std::vector<int> _nbr;
+};
+
+/*
+  Normal estimation for point clouds, same results of tri::PointCloudNormal:
+  a plane is fitted to each vertex and its neighbors, the normals are then smoothed
+  and oriented, either towards a view point or propagating the orientation along a
+  minimum spanning tree of the neighbor graph. Fitting and smoothing run in parallel.
+*/
+class MLPointCloudNormal
+{
+public:
+    static void Compute(CMeshO &m, int fittingAdjNum, int smoothingIterNum, bool useViewPoint, const Point3m &viewPoint, vcg::CallBackPos *cb = 0);
+    // Averages each normal with the ones of its neighbors (flipped if needed)
+    static void Smooth(CMeshO &m, int neighborNum, int iterNum);
+};
+
+#endif // ML_KNN_GRAPH_H
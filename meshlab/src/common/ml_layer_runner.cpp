@@ -0,0 +1,352 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_layer_runner.h"
+#include "interfaces.h"
+#include "meshmodel.h"
+#include "filterparameter.h"
+#include "mltrace.h"
+#include "ml_thread_safe_memory_info.h"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <exception>
+#include <QAction>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QThread>
+#include <QFile>
+
+#if defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+namespace
+{
+// working memory of a run: the layer and as much again for the temporary data of the filter
+std::ptrdiff_t runFootprint(const MeshModel *m)
+{
+    const size_t bytes = m->cm.vert.capacity() * sizeof(CVertexO) +
+                         m->cm.face.capacity() * sizeof(CFaceO) +
+                         m->cm.edge.capacity() * sizeof(CEdgeO);
+    return std::ptrdiff_t(2 * bytes);
+}
+
+bool largerFirst(const MeshModel *a,const MeshModel *b)
+{
+    return runFootprint(a) > runFootprint(b);
+}
+
+// Admission of the runs: a run waits until its memory fits in the budget, unless nothing else is running
+class MemoryGate
+{
+public:
+    MemoryGate(std::ptrdiff_t budget) :_info(budget),_running(0) {}
+
+    std::ptrdiff_t enter(std::ptrdiff_t mem)
+    {
+        QMutexLocker lock(&_mutex);
+        while (_running > 0 && !_info.isAdditionalMemoryAvailable(mem))
+            _freed.wait(&_mutex);
+        mem = std::min(mem,_info.currentFreeMemory());
+        _info.acquiredMemory(mem);
+        ++_running;
+        return mem;
+    }
+
+    void leave(std::ptrdiff_t mem)
+    {
+        QMutexLocker lock(&_mutex);
+        _info.releasedMemory(mem);
+        --_running;
+        _freed.wakeAll();
+    }
+
+private:
+    MLThreadSafeMemoryInfo _info;
+    QMutex _mutex;
+    QWaitCondition _freed;
+    int _running;
+};
+
+// Progress of the runs, one slot for each thread; only the thread that called apply talks to the callback
+struct Progress
+{
+    Progress(vcg::CallBackPos *_cb,int _total,int threadNum)
+        :cb(_cb),owner(QThread::currentThreadId()),total(_total),done(0),runPos(threadNum) {}
+
+    static int thread()
+    {
+#ifdef _USE_OMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+    void set(int pos)
+    {
+        const int t = thread();
+        if (t < int(runPos.size()))
+            runPos[t].fetchAndStoreRelaxed(pos);
+    }
+
+    void finish()
+    {
+        done.fetchAndAddOrdered(1);
+        set(0);
+    }
+
+    void report(const char *str)
+    {
+        if ((cb == 0) || (QThread::currentThreadId() != owner))
+            return;
+        int sum = 100 * done.fetchAndAddRelaxed(0);
+        for(size_t ii = 0;ii < runPos.size();++ii)
+            sum += runPos[ii].fetchAndAddRelaxed(0);
+        cb(std::min(sum / total,100),str);
+    }
+
+    vcg::CallBackPos *cb;
+    Qt::HANDLE owner;
+    int total;
+    QAtomicInt done;
+    std::vector<QAtomicInt> runPos;
+};
+
+Progress *currentProgress = 0;
+
+// The defaults of some parameters depend on the layer: the AbsPerc ones (a fraction of
+// the bbox diagonal) or e.g. a target number of faces. The values of par, chosen for the
+// current layer (whose defaults are curDef), are moved to the layer with the defaults
+// layerDef keeping the same relation with the defaults: the same percentage for the
+// AbsPerc ones, the same ratio for the other numbers; the other values that depend on the
+// layer are replaced by the default of the layer if they were left to the default.
+void adaptToLayer(RichParameterSet &par,const RichParameterSet &curDef,const RichParameterSet &layerDef)
+{
+    foreach(RichParameter *p, par.paramList)
+    {
+        const RichParameter *cd = curDef.findParameter(p->name);
+        const RichParameter *ld = layerDef.findParameter(p->name);
+        if ((cd == 0) || (ld == 0) || (cd->val->typeName() != p->val->typeName()) || (ld->val->typeName() != p->val->typeName()))
+            continue;
+        const Value &cv = *cd->val;
+        const Value &lv = *ld->val;
+        if (p->val->isAbsPerc())
+        {
+            const AbsPercDecoration *cdec = static_cast<const AbsPercDecoration*>(cd->pd);
+            const AbsPercDecoration *ldec = static_cast<const AbsPercDecoration*>(ld->pd);
+            if (cdec->max > cdec->min)
+            {
+                const float perc = (p->val->getAbsPerc() - cdec->min) / (cdec->max - cdec->min);
+                p->val->set(AbsPercValue(ldec->min + perc * (ldec->max - ldec->min)));
+            }
+        }
+        else if (p->val->isEnum() || p->val->isDynamicFloat())
+            continue;
+        else if (p->val->isInt())
+        {
+            if ((cv.getInt() != lv.getInt()) && (cv.getInt() != 0))
+                p->val->set(IntValue(int(double(p->val->getInt()) * lv.getInt() / cv.getInt() + 0.5)));
+        }
+        else if (p->val->isFloat())
+        {
+            if ((cv.getFloat() != lv.getFloat()) && (cv.getFloat() != 0))
+                p->val->set(FloatValue(p->val->getFloat() * lv.getFloat() / cv.getFloat()));
+        }
+        else if (p->val->isPoint3f())
+        {
+            if ((cv.getPoint3f() != lv.getPoint3f()) && (p->val->getPoint3f() == cv.getPoint3f()))
+                p->val->set(lv);
+        }
+    }
+}
+
+bool progressCallBack(const int pos,const char *str)
+{
+    Progress *p = currentProgress;
+    if (p != 0)
+    {
+        p->set(pos);
+        p->report(str);
+    }
+    return true;
+}
+}
+
+bool MLLayerRunner::canRun( MeshFilterInterface *filter,QAction *action )
+{
+    return (filter->filterArity(action) == MeshFilterInterface::SINGLE_MESH) && filter->supportsConcurrentLayers(action);
+}
+
+QList<MeshModel*> MLLayerRunner::visibleLayers( MeshDocument &md )
+{
+    QList<MeshModel*> layers;
+    foreach(MeshModel *m, md.meshList)
+        if (m->isVisible())
+            layers.push_back(m);
+    return layers;
+}
+
+qint64 MLLayerRunner::memoryBudget()
+{
+    bool ok = false;
+    const qint64 mb = qgetenv("MESHLAB_LAYER_MEMORY_MB").toLongLong(&ok);
+    if (ok && (mb > 0))
+        return mb * 1024 * 1024;
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status))
+        return qint64(status.ullAvailPhys);
+#else
+#if defined(Q_OS_LINUX)
+    // the free pages do not count the page cache, that the kernel gives back on demand
+    QFile meminfo("/proc/meminfo");
+    if (meminfo.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QByteArray line;
+        while (!(line = meminfo.readLine()).isEmpty())
+            if (line.startsWith("MemAvailable:"))
+            {
+                const qint64 kb = line.mid(13).trimmed().split(' ').first().toLongLong(&ok);
+                if (ok)
+                    return kb * 1024;
+            }
+    }
+#endif
+#if defined(_SC_AVPHYS_PAGES)
+    const long pages = sysconf(_SC_AVPHYS_PAGES);
+#elif defined(_SC_PHYS_PAGES)
+    // the available memory is not reported (e.g. on macOS): half of the physical one
+    const long pages = sysconf(_SC_PHYS_PAGES) / 2;
+#else
+    const long pages = -1;
+#endif
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    if ((pages > 0) && (pageSize > 0))
+        return qint64(pages) * pageSize;
+#endif
+    // unknown: the runs are limited by the number of threads only
+    return std::numeric_limits<qint64>::max();
+}
+
+bool MLLayerRunner::apply( MeshFilterInterface *filter,QAction *action,MeshDocument &md,const QList<MeshModel*> &layers,
+                           const RichParameterSet &par,vcg::CallBackPos *cb,QStringList *failed )
+{
+    if (layers.isEmpty())
+        return true;
+    std::vector<MeshModel*> order(layers.begin(),layers.end());
+    std::stable_sort(order.begin(),order.end(),largerFirst);
+    const int layerNum = int(order.size());
+
+    // the documents and the parameters of the runs are set up serially
+    RichParameterSet curDef;
+    if (md.mm() != 0)
+        filter->initParameterSet(action,md,curDef);
+    const int req = filter->getRequirements(action);
+    std::vector<MeshDocument*> docs(layerNum);
+    std::vector<RichParameterSet*> pars(layerNum);
+    for(int ii = 0;ii < layerNum;++ii)
+    {
+        order[ii]->updateDataMask(req,true);
+        docs[ii] = new MeshDocument();
+        docs[ii]->setFileName(md.fileName());
+        docs[ii]->meshList.push_back(order[ii]);
+        docs[ii]->setCurrentMesh(order[ii]->id());
+        pars[ii] = new RichParameterSet(par);
+        if ((order[ii] != md.mm()) && !curDef.isEmpty())
+        {
+            RichParameterSet layerDef;
+            filter->initParameterSet(action,*docs[ii],layerDef);
+            adaptToLayer(*pars[ii],curDef,layerDef);
+        }
+    }
+
+    int threadNum = 1;
+#ifdef _USE_OMP
+    threadNum = omp_get_max_threads();
+#endif
+    const qint64 budget = std::min<qint64>(memoryBudget(),std::numeric_limits<std::ptrdiff_t>::max());
+    MemoryGate gate(std::ptrdiff_t(budget));
+    Progress progress(cb,layerNum,threadNum);
+    currentProgress = &progress;
+
+    const QString filterName = filter->filterName(action);
+    std::vector<int> ok(layerNum,0);
+    std::vector<QString> reason(layerNum);
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(dynamic,1) num_threads(threadNum)
+#endif
+    for(int ii = 0;ii < layerNum;++ii)
+    {
+        MeshModel *m = order[ii];
+        const std::ptrdiff_t mem = gate.enter(runFootprint(m));
+        try
+        {
+            MLTraceSpan span(filterName + " (" + m->label() + ")","filter",m->cm.vn,m->cm.fn);
+            ok[ii] = filter->applyFilter(action,*docs[ii],*pars[ii],progressCallBack) ? 1 : 0;
+            span.setCounts(m->cm.vn,m->cm.fn);
+        }
+        catch (std::exception &e)
+        {
+            reason[ii] = QString(e.what());
+        }
+        catch (...)
+        {
+            reason[ii] = QString("unknown exception");
+        }
+        progress.finish();
+        gate.leave(mem);
+    }
+    currentProgress = 0;
+
+    bool res = true;
+    for(int ii = 0;ii < layerNum;++ii)
+    {
+        // what the filter logged on the document of the run goes to the real one
+        for(int jj = 0;jj < docs[ii]->Log.S.size();++jj)
+            md.Log.Log(docs[ii]->Log.S[jj].first,qPrintable(docs[ii]->Log.S[jj].second));
+        docs[ii]->meshList.removeAll(order[ii]);
+        delete docs[ii];
+        delete pars[ii];
+        if (!ok[ii])
+        {
+            res = false;
+            if (failed != 0)
+                failed->push_back(reason[ii].isEmpty() ? order[ii]->label() : order[ii]->label() + ": " + reason[ii]);
+        }
+    }
+    return res;
+}
@@ -0,0 +1,76 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_LAYER_RUNNER_H
+#define ML_LAYER_RUNNER_H
+
+#include <QList>
+#include <QStringList>
+#include <wrap/callback.h>
+
+class QAction;
+class MeshModel;
+class MeshDocument;
+class MeshFilterInterface;
+class RichParameterSet;
+
+/*
+  Applies a single mesh filter to many layers at the same time, e.g. to clean and
+  compute the normals of the hundreds of range maps of a scan project in one go.
+
+  The layers are processed in parallel, one layer per OpenMP thread, the largest ones
+  first; the parallel loops inside the filter run serially in this case. Each run gets
+  its own copy of the parameters and a private MeshDocument that holds just its layer
+  as the current mesh, so the filter code does not change. The parameters are those
+  chosen for the current layer: the ones whose default depends on the layer (AbsPerc
+  values, target face numbers...) are rescaled to each layer, see adaptToLayer. Only the filters that
+  declare it with MeshFilterInterface::supportsConcurrentLayers can run this way.
+
+  Before starting, a run reserves from a MLThreadSafeMemoryInfo an estimate of its
+  working memory (twice the size of the layer); when the budget is exhausted the
+  run waits for the end of the others. The budget is the physical memory available
+  when apply is called or, if set, the MESHLAB_LAYER_MEMORY_MB environment variable.
+  A run is always started when no other one is in flight.
+
+  The progress of the runs is merged and reported through the given callback, only
+  from the calling thread.
+
+  Usage:
+    if (MLLayerRunner::canRun(filter,action))
+      ok = MLLayerRunner::apply(filter,action,md,MLLayerRunner::visibleLayers(md),par,cb,&failed);
+*/
+class MLLayerRunner
+{
+public:
+    static bool canRun(MeshFilterInterface *filter,QAction *action);
+    static QList<MeshModel*> visibleLayers(MeshDocument &md);
+    // bytes available to the runs, see above
+    static qint64 memoryBudget();
+
+    // Returns false if the filter failed on some of the layers; their labels are
+    // appended to failed (with the reason, if an exception was thrown).
+    static bool apply(MeshFilterInterface *filter,QAction *action,MeshDocument &md,const QList<MeshModel*> &layers,
+                      const RichParameterSet &par,vcg::CallBackPos *cb = 0,QStringList *failed = 0);
+};
+
+#endif // ML_LAYER_RUNNER_H
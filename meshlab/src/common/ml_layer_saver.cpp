@@ -0,0 +1,149 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_layer_saver.h"
+#include "interfaces.h"
+#include "meshmodel.h"
+#include "mltrace.h"
+
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <QFileInfo>
+#include <QAtomicInt>
+
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+// the disks are saturated well before the cores
+static const int maxSaveThreads = 8;
+
+MLLayerSaver::~MLLayerSaver()
+{
+    foreach(Job *job, _jobs)
+        delete job;
+}
+
+bool MLLayerSaver::needsSave( MeshModel &m,const QString &fileName )
+{
+    if (m.meshModified())
+        return true;
+    QFileInfo fi(fileName);
+    return !fi.exists() || (fi.absoluteFilePath() != QFileInfo(m.fullName()).absoluteFilePath());
+}
+
+int MLLayerSaver::threadNum()
+{
+#ifdef _USE_OMP
+    return std::max(1,std::min(omp_get_max_threads(),maxSaveThreads));
+#else
+    return 1;
+#endif
+}
+
+void MLLayerSaver::add( MeshModel *m,MeshIOInterface *plugin,const QString &format,const QString &fileName,int mask,const RichParameterSet &par )
+{
+    Job *job = new Job();
+    job->m = m;
+    job->plugin = plugin;
+    job->format = format;
+    job->fileName = fileName;
+    job->mask = mask;
+    job->par = par;
+    job->ok = false;
+    _jobs.push_back(job);
+}
+
+void MLLayerSaver::save( Job &job )
+{
+    MLTraceSpan span("Save " + QFileInfo(job.fileName).fileName(),"io",job.m->cm.vn,job.m->cm.fn);
+    try
+    {
+        if (job.m->isCompact())
+        {
+            // compact point clouds are saved from a temporary copy, the layer stays compact
+            MeshModel expanded(job.m->parent,job.m->fullName(),job.m->label());
+            job.m->expandTo(expanded);
+            span.setCounts(expanded.cm.vn,0);
+            job.ok = job.plugin->save(job.format,job.fileName,expanded,job.mask,job.par);
+        }
+        else
+            job.ok = job.plugin->save(job.format,job.fileName,*job.m,job.mask,job.par);
+        // the message of this file, the other layers can be failing at the same time
+        if (!job.ok)
+            job.error = job.plugin->saveError(job.fileName);
+    }
+    catch (std::exception &e)
+    {
+        job.ok = false;
+        job.error = QString(e.what());
+    }
+}
+
+bool MLLayerSaver::run( vcg::CallBackPos *cb )
+{
+    _errors.clear();
+    std::vector<Job*> concurrent;
+    std::vector<Job*> serial;
+    foreach(Job *job, _jobs)
+    {
+        if (job->plugin->supportsConcurrentSave(job->format) && !job->m->isCompact())
+            concurrent.push_back(job);
+        else
+            serial.push_back(job);
+    }
+
+    const int total = _jobs.size();
+    const int concurrentNum = int(concurrent.size());
+    QAtomicInt done(0);
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(dynamic,1) num_threads(threadNum())
+#endif
+    for(int ii = 0;ii < concurrentNum;++ii)
+    {
+        save(*concurrent[ii]);
+        const int saved = done.fetchAndAddOrdered(1) + 1;
+        bool master = true;
+#ifdef _USE_OMP
+        master = (omp_get_thread_num() == 0);
+#endif
+        if (master && (cb != 0))
+            cb(100 * saved / total,"Saving layers");
+    }
+    for(size_t ii = 0;ii < serial.size();++ii)
+    {
+        save(*serial[ii]);
+        if (cb != 0)
+            cb(100 * (concurrentNum + int(ii) + 1) / total,"Saving layers");
+    }
+
+    foreach(Job *job, _jobs)
+    {
+        if (job->ok)
+            job->m->meshModified() = false;
+        else
+            _errors.push_back(job->m->label() + ": " + job->error);
+    }
+    return _errors.isEmpty();
+}
@@ -0,0 +1,100 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_LAYER_SAVER_H
+#define ML_LAYER_SAVER_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <wrap/callback.h>
+#include "filterparameter.h"
+
+class MeshModel;
+class MeshIOInterface;
+
+/*
+  Export of the layers of a project, up to threadNum() at the same time.
+
+  The layers to save are added one at a time from the calling thread (the mask and
+  the saving parameters may come from a dialog), then run() writes them. The formats
+  for which MeshIOInterface::supportsConcurrentSave is true are written in parallel;
+  the other ones, and the compact point clouds (saved from a temporary expanded copy),
+  are written afterwards one at a time. Progress is reported through the callback
+  only from the calling thread.
+
+  needsSave tells the layers whose file is already up to date, so that saving a
+  project only writes what changed. The project file itself should be written after
+  run() succeeded (see MeshDocumentToXMLFile), so that it never points to layers
+  that have not been completely written.
+
+  Usage:
+    MLLayerSaver saver;
+    foreach(MeshModel *m, md.meshList)
+      if (MLLayerSaver::needsSave(*m,m->fullName()))
+        saver.add(m,plugin,format,m->fullName(),mask,savePar);
+    if (saver.run(cb))
+      MeshDocumentToXMLFile(md,projectName,false);
+*/
+class MLLayerSaver
+{
+public:
+    MLLayerSaver() {}
+    ~MLLayerSaver();
+
+    // false if the layer was loaded from (or saved in) fileName and has not been modified since
+    static bool needsSave(MeshModel &m,const QString &fileName);
+    // layers written at the same time
+    static int threadNum();
+
+    void add(MeshModel *m,MeshIOInterface *plugin,const QString &format,const QString &fileName,int mask,const RichParameterSet &par);
+    int size() const {return _jobs.size();}
+
+    // Writes the layers added; the ones written are no more marked as modified.
+    // Returns false if some of them failed, see errors().
+    bool run(vcg::CallBackPos *cb = 0);
+    const QStringList &errors() const {return _errors;}
+
+private:
+    struct Job
+    {
+        MeshModel *m;
+        MeshIOInterface *plugin;
+        QString format;
+        QString fileName;
+        int mask;
+        RichParameterSet par;
+        bool ok;
+        QString error;
+    };
+
+    static void save(Job &job);
+
+    MLLayerSaver(const MLLayerSaver&);
+    MLLayerSaver& operator=(const MLLayerSaver&);
+
+    QList<Job*> _jobs;
+    QStringList _errors;
+};
+
+#endif // ML_LAYER_SAVER_H
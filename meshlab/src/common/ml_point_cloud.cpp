@@ -0,0 +1,535 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_point_cloud.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <QList>
+#include <QByteArray>
+
+const float MLPointCloud::halfMax = 65504.0f;
+
+MLPointCloud::MLPointCloud( CoordEncoding enc )
+    :_enc(enc),_origin(0,0,0),_step(1,1,1),_size(0),_hasNormal(false),_hasColor(false),_hasQuality(false)
+{
+}
+
+void MLPointCloud::setQuantization( const vcg::Box3d& box )
+{
+    _origin = box.min;
+    for(int k = 0;k < 3;++k)
+    {
+        const double side = box.max[k] - box.min[k];
+        _step[k] = (side > 0) ? side / 65535.0 : 1.0;
+    }
+}
+
+void MLPointCloud::reserve( size_t n )
+{
+    if (_enc == FLOAT32)
+        _posF.reserve(n);
+    else
+        _pos16.reserve(3 * n);
+    if (_hasNormal) _normal.reserve(3 * n);
+    if (_hasColor) _color.reserve(3 * n);
+    if (_hasQuality) _quality.reserve(n);
+}
+
+void MLPointCloud::resize( size_t n )
+{
+    if (_enc == FLOAT32)
+        _posF.resize(n,vcg::Point3f(0,0,0));
+    else
+        _pos16.resize(3 * n,0);
+    if (_hasNormal) _normal.resize(3 * n,0);
+    if (_hasColor) _color.resize(3 * n,255);
+    if (_hasQuality) _quality.resize(n,0);
+    _size = n;
+}
+
+void MLPointCloud::clear()
+{
+    std::vector<vcg::Point3f>().swap(_posF);
+    std::vector<unsigned short>().swap(_pos16);
+    std::vector<short>().swap(_normal);
+    std::vector<unsigned char>().swap(_color);
+    std::vector<float>().swap(_quality);
+    _size = 0;
+}
+
+void MLPointCloud::squeeze()
+{
+    std::vector<vcg::Point3f>(_posF).swap(_posF);
+    std::vector<unsigned short>(_pos16).swap(_pos16);
+    std::vector<short>(_normal).swap(_normal);
+    std::vector<unsigned char>(_color).swap(_color);
+    std::vector<float>(_quality).swap(_quality);
+}
+
+size_t MLPointCloud::append( const vcg::Point3d& p )
+{
+    const size_t i = _size;
+    resize(_size + 1);
+    setPosition(i,p);
+    return i;
+}
+
+vcg::Point3d MLPointCloud::position( size_t i ) const
+{
+    switch(_enc)
+    {
+    case FLOAT32:
+        return _origin + vcg::Point3d::Construct(_posF[i]);
+    case HALF16:
+        return _origin + vcg::Point3d(halfToFloat(_pos16[3*i]),halfToFloat(_pos16[3*i+1]),halfToFloat(_pos16[3*i+2]));
+    default:
+        return _origin + vcg::Point3d(_pos16[3*i] * _step[0],_pos16[3*i+1] * _step[1],_pos16[3*i+2] * _step[2]);
+    }
+}
+
+void MLPointCloud::setPosition( size_t i,const vcg::Point3d& p )
+{
+    const vcg::Point3d l = p - _origin;
+    switch(_enc)
+    {
+    case FLOAT32:
+        _posF[i] = vcg::Point3f::Construct(l);
+        break;
+    case HALF16:
+        if ((fabs(l[0]) > halfMax) || (fabs(l[1]) > halfMax) || (fabs(l[2]) > halfMax))
+        {
+            // out of the half precision range: it would become an infinity
+            toFloat32();
+            _posF[i] = vcg::Point3f::Construct(l);
+            break;
+        }
+        for(int k = 0;k < 3;++k)
+            _pos16[3*i+k] = floatToHalf(float(l[k]));
+        break;
+    default:
+        for(int k = 0;k < 3;++k)
+            _pos16[3*i+k] = (unsigned short) std::max(0.0,std::min(65535.0,floor(l[k] / _step[k] + 0.5)));
+    }
+}
+
+void MLPointCloud::toFloat32()
+{
+    if (_enc != HALF16)
+        return;
+    std::vector<vcg::Point3f> pos(_pos16.size() / 3);
+    for(size_t i = 0;i < pos.size();++i)
+        pos[i] = vcg::Point3f(halfToFloat(_pos16[3*i]),halfToFloat(_pos16[3*i+1]),halfToFloat(_pos16[3*i+2]));
+    pos.reserve(_pos16.capacity() / 3);
+    pos.swap(_posF);
+    std::vector<unsigned short>().swap(_pos16);
+    _enc = FLOAT32;
+}
+
+const vcg::Point3f* MLPointCloud::localPositions() const
+{
+    if ((_enc != FLOAT32) || _posF.empty())
+        return NULL;
+    return &_posF[0];
+}
+
+void MLPointCloud::enableNormal()
+{
+    if (_hasNormal) return;
+    _hasNormal = true;
+    _normal.assign(3 * _size,0);
+}
+
+void MLPointCloud::disableNormal()
+{
+    _hasNormal = false;
+    std::vector<short>().swap(_normal);
+}
+
+vcg::Point3f MLPointCloud::normal( size_t i ) const
+{
+    const float s = 1.0f / 32767.0f;
+    return vcg::Point3f(_normal[3*i] * s,_normal[3*i+1] * s,_normal[3*i+2] * s);
+}
+
+void MLPointCloud::setNormal( size_t i,const vcg::Point3f& n )
+{
+    for(int k = 0;k < 3;++k)
+        _normal[3*i+k] = (short) std::max(-32767.0f,std::min(32767.0f,floorf(n[k] * 32767.0f + 0.5f)));
+}
+
+void MLPointCloud::enableColor()
+{
+    if (_hasColor) return;
+    _hasColor = true;
+    _color.assign(3 * _size,255);
+}
+
+void MLPointCloud::disableColor()
+{
+    _hasColor = false;
+    std::vector<unsigned char>().swap(_color);
+}
+
+vcg::Color4b MLPointCloud::color( size_t i ) const
+{
+    return vcg::Color4b(_color[3*i],_color[3*i+1],_color[3*i+2],255);
+}
+
+void MLPointCloud::setColor( size_t i,const vcg::Color4b& c )
+{
+    for(int k = 0;k < 3;++k)
+        _color[3*i+k] = c[k];
+}
+
+void MLPointCloud::enableQuality()
+{
+    if (_hasQuality) return;
+    _hasQuality = true;
+    _quality.assign(_size,0);
+}
+
+void MLPointCloud::disableQuality()
+{
+    _hasQuality = false;
+    std::vector<float>().swap(_quality);
+}
+
+vcg::Box3d MLPointCloud::bbox() const
+{
+    vcg::Box3d b;
+    for(size_t i = 0;i < _size;++i)
+        b.Add(position(i));
+    return b;
+}
+
+size_t MLPointCloud::bytesPerPoint() const
+{
+    size_t b = (_enc == FLOAT32) ? sizeof(vcg::Point3f) : 3 * sizeof(unsigned short);
+    if (_hasNormal) b += 3 * sizeof(short);
+    if (_hasColor) b += 3;
+    if (_hasQuality) b += sizeof(float);
+    return b;
+}
+
+size_t MLPointCloud::memoryUsed() const
+{
+    return _posF.capacity() * sizeof(vcg::Point3f) + _pos16.capacity() * sizeof(unsigned short) +
+           _normal.capacity() * sizeof(short) + _color.capacity() + _quality.capacity() * sizeof(float);
+}
+
+void MLPointCloud::fromMesh( const CMeshO& m,bool normal,bool color,bool quality )
+{
+    clear();
+    vcg::Box3d box;
+    for(CMeshO::ConstVertexIterator vi = m.vert.begin();vi != m.vert.end();++vi)
+        if (!(*vi).IsD())
+            box.Add(vcg::Point3d::Construct((*vi).cP()));
+    if (_enc == QUANTIZED16)
+        setQuantization(box);
+    else
+        _origin = box.IsNull() ? vcg::Point3d(0,0,0) : box.Center();
+
+    if (normal) enableNormal(); else disableNormal();
+    if (color) enableColor(); else disableColor();
+    if (quality) enableQuality(); else disableQuality();
+    resize(size_t(m.vn));
+    size_t i = 0;
+    for(CMeshO::ConstVertexIterator vi = m.vert.begin();vi != m.vert.end();++vi)
+    {
+        if ((*vi).IsD())
+            continue;
+        setPosition(i,vcg::Point3d::Construct((*vi).cP()));
+        if (normal) setNormal(i,vcg::Point3f::Construct((*vi).cN()));
+        if (color) setColor(i,(*vi).cC());
+        if (quality) setQuality(i,float((*vi).cQ()));
+        ++i;
+    }
+    resize(i);
+}
+
+void MLPointCloud::toMesh( CMeshO& m,size_t first,size_t count ) const
+{
+    count = std::min(count,(first < _size) ? _size - first : size_t(0));
+    CMeshO::VertexIterator vi = vcg::tri::Allocator<CMeshO>::AddVertices(m,count);
+    for(size_t i = first;i < first + count;++i,++vi)
+    {
+        (*vi).P() = Point3m::Construct(position(i));
+        if (_hasNormal) (*vi).N() = Point3m::Construct(normal(i));
+        if (_hasColor) (*vi).C() = color(i);
+        if (_hasQuality) (*vi).Q() = quality(i);
+    }
+}
+
+namespace
+{
+enum PlyField { PF_X,PF_Y,PF_Z,PF_NX,PF_NY,PF_NZ,PF_R,PF_G,PF_B,PF_Q,PF_NUM };
+
+int plyTypeSize( const QByteArray& t )
+{
+    if (t == "char" || t == "uchar" || t == "int8" || t == "uint8") return 1;
+    if (t == "short" || t == "ushort" || t == "int16" || t == "uint16") return 2;
+    if (t == "int" || t == "uint" || t == "float" || t == "int32" || t == "uint32" || t == "float32") return 4;
+    if (t == "double" || t == "float64") return 8;
+    return 0;
+}
+
+struct PlyProperty
+{
+    int offset;
+    int size;
+    char kind; // 'i' signed, 'u' unsigned, 'f' float
+};
+
+double plyValue( const char* p,const PlyProperty& prop,bool swap )
+{
+    char tmp[8];
+    memcpy(tmp,p,prop.size);
+    if (swap) std::reverse(tmp,tmp + prop.size);
+    switch(prop.size)
+    {
+    case 1: return (prop.kind == 'u') ? double(*(unsigned char*)tmp) : double(*(signed char*)tmp);
+    case 2: {unsigned short u; short s; memcpy(&u,tmp,2); memcpy(&s,tmp,2); return (prop.kind == 'u') ? double(u) : double(s);}
+    case 4:
+        {
+            if (prop.kind == 'f') {float f; memcpy(&f,tmp,4); return f;}
+            unsigned int u; int s; memcpy(&u,tmp,4); memcpy(&s,tmp,4);
+            return (prop.kind == 'u') ? double(u) : double(s);
+        }
+    default: {double d; memcpy(&d,tmp,8); return d;}
+    }
+}
+}
+
+bool MLPointCloud::loadPly( const QString& fileName,QString& error )
+{
+    FILE* fp = fopen(qPrintable(fileName),"rb");
+    if (fp == NULL)
+    {
+        error = QString("Unable to open '%1'").arg(fileName);
+        return false;
+    }
+
+    static const char* names[PF_NUM][3] = {
+        {"x",0,0},{"y",0,0},{"z",0,0},{"nx",0,0},{"ny",0,0},{"nz",0,0},
+        {"red","diffuse_red","r"},{"green","diffuse_green","g"},{"blue","diffuse_blue","b"},
+        {"quality","intensity","scalar_intensity"}};
+    PlyProperty prop[PF_NUM];
+    for(int f = 0;f < PF_NUM;++f)
+        prop[f].offset = -1;
+    size_t vertNum = 0,stride = 0;
+    bool inVertex = false,littleEndian = true,headerDone = false;
+    char line[1024];
+    error.clear();
+    if (!fgets(line,sizeof(line),fp) || QByteArray(line).trimmed() != "ply")
+        error = "Not a PLY file";
+    while(error.isEmpty() && !headerDone && fgets(line,sizeof(line),fp))
+    {
+        QList<QByteArray> tok = QByteArray(line).simplified().split(' ');
+        if (tok[0] == "end_header")
+            headerDone = true;
+        else if (tok[0] == "format")
+        {
+            if (tok.size() < 2 || tok[1] == "ascii")
+                error = "Only binary PLY files can be loaded as compact point clouds";
+            littleEndian = (tok.size() >= 2) && (tok[1] == "binary_little_endian");
+        }
+        else if (tok[0] == "element" && tok.size() >= 3)
+        {
+            if (tok[1] == "vertex" && stride == 0)
+            {
+                vertNum = tok[2].toULongLong();
+                inVertex = true;
+            }
+            else if (!inVertex && stride == 0)
+                error = "The vertex element is not the first one";
+            else
+                inVertex = false;
+        }
+        else if (tok[0] == "property" && inVertex)
+        {
+            int sz = (tok.size() >= 3) ? plyTypeSize(tok[1]) : 0;
+            if (sz == 0)
+            {
+                error = "List or unknown properties are not supported in the vertex element";
+                break;
+            }
+            for(int f = 0;f < PF_NUM;++f)
+                for(int n = 0;n < 3;++n)
+                    if (names[f][n] != 0 && tok[2] == names[f][n] && prop[f].offset < 0)
+                    {
+                        prop[f].offset = int(stride);
+                        prop[f].size = sz;
+                        prop[f].kind = (tok[1].startsWith("float") || tok[1] == "double") ? 'f' : (tok[1].startsWith("u") ? 'u' : 'i');
+                    }
+            stride += sz;
+        }
+    }
+    if (error.isEmpty() && !headerDone)
+        error = "Unexpected end of the PLY header";
+    if (error.isEmpty() && (prop[PF_X].offset < 0 || prop[PF_Y].offset < 0 || prop[PF_Z].offset < 0))
+        error = "The vertices have no x,y,z coordinates";
+    if (!error.isEmpty())
+    {
+        fclose(fp);
+        return false;
+    }
+
+    unsigned short one = 1;
+    const bool swap = ((*((unsigned char*)&one) == 1) != littleEndian);
+    const long dataStart = ftell(fp);
+    const bool hasN = prop[PF_NX].offset >= 0 && prop[PF_NY].offset >= 0 && prop[PF_NZ].offset >= 0;
+    const bool hasC = prop[PF_R].offset >= 0 && prop[PF_G].offset >= 0 && prop[PF_B].offset >= 0;
+    const bool hasQ = prop[PF_Q].offset >= 0;
+    // colors stored as floats are in [0,1]
+    const double colorScale = (hasC && prop[PF_R].kind == 'f') ? 255.0 : 1.0;
+    std::vector<char> buf(stride * (1 << 16));
+
+    // the quantization grid needs the bounding box: one more pass on the file
+    if (_enc == QUANTIZED16)
+    {
+        vcg::Box3d box;
+        size_t read = 0;
+        while(read < vertNum)
+        {
+            size_t n = fread(&buf[0],stride,std::min(vertNum - read,buf.size() / stride),fp);
+            if (n == 0) break;
+            for(size_t i = 0;i < n;++i)
+            {
+                const char* v = &buf[i * stride];
+                box.Add(vcg::Point3d(plyValue(v + prop[PF_X].offset,prop[PF_X],swap),plyValue(v + prop[PF_Y].offset,prop[PF_Y],swap),plyValue(v + prop[PF_Z].offset,prop[PF_Z],swap)));
+            }
+            read += n;
+        }
+        setQuantization(box);
+        fseek(fp,dataStart,SEEK_SET);
+    }
+
+    clear();
+    if (hasN) enableNormal(); else disableNormal();
+    if (hasC) enableColor(); else disableColor();
+    if (hasQ) enableQuality(); else disableQuality();
+    reserve(vertNum);
+    size_t read = 0;
+    while(read < vertNum)
+    {
+        size_t n = fread(&buf[0],stride,std::min(vertNum - read,buf.size() / stride),fp);
+        if (n == 0) break;
+        resize(read + n);
+        for(size_t i = 0;i < n;++i)
+        {
+            const char* v = &buf[i * stride];
+            vcg::Point3d p(plyValue(v + prop[PF_X].offset,prop[PF_X],swap),plyValue(v + prop[PF_Y].offset,prop[PF_Y],swap),plyValue(v + prop[PF_Z].offset,prop[PF_Z],swap));
+            // FLOAT32 and HALF16 clouds are stored around their first point
+            if (read + i == 0 && _enc != QUANTIZED16)
+                _origin = vcg::Point3d(floor(p[0]),floor(p[1]),floor(p[2]));
+            setPosition(read + i,p);
+            if (hasN)
+                setNormal(read + i,vcg::Point3f(plyValue(v + prop[PF_NX].offset,prop[PF_NX],swap),plyValue(v + prop[PF_NY].offset,prop[PF_NY],swap),plyValue(v + prop[PF_NZ].offset,prop[PF_NZ],swap)));
+            if (hasC)
+            {
+                vcg::Color4b c;
+                for(int k = 0;k < 3;++k)
+                    c[k] = (unsigned char) std::max(0.0,std::min(255.0,plyValue(v + prop[PF_R + k].offset,prop[PF_R + k],swap) * colorScale + ((colorScale > 1.0) ? 0.5 : 0.0)));
+                c[3] = 255;
+                setColor(read + i,c);
+            }
+            if (hasQ)
+                setQuality(read + i,float(plyValue(v + prop[PF_Q].offset,prop[PF_Q],swap)));
+        }
+        read += n;
+    }
+    fclose(fp);
+    if (read < vertNum)
+    {
+        error = QString("Truncated file: %1 of %2 vertices read").arg(read).arg(vertNum);
+        return false;
+    }
+    return true;
+}
+
+unsigned short MLPointCloud::floatToHalf( float f )
+{
+    unsigned int x;
+    memcpy(&x,&f,4);
+    const unsigned int sign = (x >> 16) & 0x8000;
+    const unsigned int fexp = (x >> 23) & 0xff;
+    unsigned int mant = x & 0x7fffff;
+    if (fexp == 0xff)
+        return (unsigned short)(sign | 0x7c00 | (mant ? 0x200 : 0));
+    const int exp = int(fexp) - 127 + 15;
+    if (exp >= 31)
+        return (unsigned short)(sign | 0x7c00);
+    if (exp <= 0)
+    {
+        // subnormal half (or zero)
+        if (exp < -10)
+            return (unsigned short) sign;
+        mant |= 0x800000;
+        const int shift = 14 - exp;
+        unsigned int h = mant >> shift;
+        const unsigned int rem = mant & ((1u << shift) - 1),half = 1u << (shift - 1);
+        if (rem > half || (rem == half && (h & 1)))
+            ++h;
+        return (unsigned short)(sign | h);
+    }
+    unsigned int h = (unsigned int)(exp << 10) | (mant >> 13);
+    const unsigned int rem = mant & 0x1fff;
+    // round to nearest even, a carry correctly moves to the next exponent
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+        ++h;
+    return (unsigned short)(sign | h);
+}
+
+float MLPointCloud::halfToFloat( unsigned short h )
+{
+    const unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+    int exp = (h >> 10) & 0x1f;
+    unsigned int mant = h & 0x3ff;
+    unsigned int x;
+    if (exp == 0)
+    {
+        if (mant == 0)
+            x = sign;
+        else
+        {
+            exp = 1;
+            while(!(mant & 0x400))
+            {
+                mant <<= 1;
+                --exp;
+            }
+            mant &= 0x3ff;
+            x = sign | ((unsigned int)(exp + 127 - 15) << 23) | (mant << 13);
+        }
+    }
+    else if (exp == 31)
+        x = sign | 0x7f800000 | (mant << 13);
+    else
+        x = sign | ((unsigned int)(exp + 127 - 15) << 23) | (mant << 13);
+    float f;
+    memcpy(&f,&x,4);
+    return f;
+}
@@ -0,0 +1,135 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_POINT_CLOUD_H
+#define ML_POINT_CLOUD_H
+
+#include <vector>
+#include <QString>
+#include "ml_mesh_type.h"
+
+/*
+  Compact storage for very large point clouds (e.g. terrestrial scans).
+
+  Each attribute is kept in its own array (struct of arrays) and the optional ones
+  (normal, color, quality/intensity) are allocated only when enabled, so a cloud with
+  just positions and intensity costs 10 to 16 bytes per point instead of the ~44 bytes
+  of a CVertexO. The positions are stored relative to a local origin, in one of the
+  following encodings:
+  - FLOAT32:     3 floats, same precision of a CMeshO near the origin (12 bytes)
+  - HALF16:      3 half precision floats (6 bytes), ~11 significant bits; the offsets from
+                 the origin must be within +-65504, at the first point out of this range
+                 the whole cloud switches to FLOAT32
+  - QUANTIZED16: 3 unsigned shorts on a regular grid covering the bounding box set with
+                 setQuantization() (6 bytes), uniform error of half a step
+  Normals are quantized on 3 shorts, colors are RGB bytes and quality is a float.
+
+  The points are processed sequentially, or converted in chunks to a CMeshO with toMesh()
+  for the algorithms that need a real mesh.
+*/
+class MLPointCloud
+{
+public:
+    enum CoordEncoding { FLOAT32 = 0, HALF16 = 1, QUANTIZED16 = 2 };
+
+    MLPointCloud(CoordEncoding enc = FLOAT32);
+
+    // can differ from the requested one, see HALF16
+    CoordEncoding encoding() const {return _enc;}
+    // The origin (and for QUANTIZED16 the grid step) must be set before adding points.
+    void setOrigin(const vcg::Point3d &o) {_origin = o;}
+    const vcg::Point3d &origin() const {return _origin;}
+    // QUANTIZED16: 65536 steps along each side of the box, whose min becomes the origin
+    void setQuantization(const vcg::Box3d &box);
+    const vcg::Point3d &step() const {return _step;}
+
+    size_t size() const {return _size;}
+    void reserve(size_t n);
+    void resize(size_t n);
+    void clear();
+    // frees the memory not used by the points
+    void squeeze();
+
+    size_t append(const vcg::Point3d &p);
+    vcg::Point3d position(size_t i) const;
+    void setPosition(size_t i, const vcg::Point3d &p);
+    // FLOAT32 only: the contiguous positions relative to the origin, NULL otherwise
+    const vcg::Point3f *localPositions() const;
+
+    bool hasNormal() const {return _hasNormal;}
+    void enableNormal();
+    void disableNormal();
+    vcg::Point3f normal(size_t i) const;
+    void setNormal(size_t i, const vcg::Point3f &n);
+
+    bool hasColor() const {return _hasColor;}
+    void enableColor();
+    void disableColor();
+    vcg::Color4b color(size_t i) const;
+    void setColor(size_t i, const vcg::Color4b &c);
+
+    bool hasQuality() const {return _hasQuality;}
+    void enableQuality();
+    void disableQuality();
+    float quality(size_t i) const {return _quality[i];}
+    void setQuality(size_t i, float q) {_quality[i] = q;}
+
+    vcg::Box3d bbox() const;
+    size_t bytesPerPoint() const;
+    size_t memoryUsed() const;
+
+    // Copies the non deleted vertices of m (faces are ignored); the origin is the center
+    // of the bounding box of m.
+    void fromMesh(const CMeshO &m, bool normal, bool color, bool quality);
+    // Appends the points [first,first+count) as vertices of m
+    void toMesh(CMeshO &m, size_t first, size_t count) const;
+    void toMesh(CMeshO &m) const {toMesh(m,0,_size);}
+
+    // Streams the vertices of a binary PLY file. The vertex element must be the first
+    // one; x,y,z are required, nx,ny,nz, red,green,blue and quality (or intensity) are
+    // loaded if present and the other fixed size properties are skipped.
+    bool loadPly(const QString &fileName, QString &error);
+
+    static unsigned short floatToHalf(float f);
+    static float halfToFloat(unsigned short h);
+    // the largest finite half precision value
+    static const float halfMax;
+
+private:
+    // converts the HALF16 positions to FLOAT32
+    void toFloat32();
+
+    CoordEncoding _enc;
+    vcg::Point3d _origin;
+    vcg::Point3d _step;
+    size_t _size;
+    bool _hasNormal, _hasColor, _hasQuality;
+
+    std::vector<vcg::Point3f> _posF;          // FLOAT32
+    std::vector<unsigned short> _pos16;       // HALF16 and QUANTIZED16, xyz interleaved
+    std::vector<short> _normal;               // xyz interleaved, unit length * 32767
+    std::vector<unsigned char> _color;        // rgb interleaved
+    std::vector<float> _quality;
+};
+
+#endif // ML_POINT_CLOUD_H
@@ -1,5 +1,6 @@
 #include "ml_shared_data_context.h"
 #include "mlexception.h"
+#include "mltrace.h"
 #include <vector>
 
 #include "meshmodel.h"
@@ -309,6 +310,7 @@ void MLSceneGLSharedDataContext::manageBuffers( int mmid )
     PerMeshMultiViewManager* man = meshAttributesMultiViewerManager(mmid);
     if (man != NULL)
     {
+        MLTraceSpan span("Update buffers ",mm->label(),"gpu",mm->cm.vn,mm->cm.fn);
         QGLContext* ctx = makeCurrentGLContext();
         man->manageBuffers();
         doneCurrentGLContext(ctx);
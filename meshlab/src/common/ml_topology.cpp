@@ -0,0 +1,183 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_topology.h"
+
+#include <algorithm>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+namespace
+{
+// A face edge seen from its lowest vertex: the other vertex and the wedge (3*face+edge)
+struct EdgeRef
+{
+    int v;
+    int w;
+};
+
+inline bool edgeLess(const EdgeRef &a, const EdgeRef &b)
+{
+    return a.v < b.v;
+}
+
+// Stable sort by the other vertex; the buckets are usually tiny (a vertex of valence
+// six owns three edges on average)
+void sortBucket(EdgeRef *b, int n)
+{
+    if (n > 32)
+    {
+        std::stable_sort(b, b + n, edgeLess);
+        return;
+    }
+    for (int k = 1; k < n; ++k)
+    {
+        const EdgeRef x = b[k];
+        int p = k;
+        while (p > 0 && b[p - 1].v > x.v)
+        {
+            b[p] = b[p - 1];
+            --p;
+        }
+        b[p] = x;
+    }
+}
+
+// CSR offsets of the wedges of the non deleted faces, bucketed by key
+template <class KeyFunc>
+void bucketWedges(CMeshO &m, int bucketNum, KeyFunc key, std::vector<int> &first, std::vector<EdgeRef> &refs)
+{
+    const int faceNum = int(m.face.size());
+    first.assign(bucketNum + 1, 0);
+    for (int i = 0; i < faceNum; ++i)
+        if (!m.face[i].IsD())
+            for (int j = 0; j < 3; ++j)
+                ++first[key(i, j).first + 1];
+    for (int i = 0; i < bucketNum; ++i)
+        first[i + 1] += first[i];
+
+    refs.resize(first[bucketNum]);
+    std::vector<int> pos(first.begin(), first.end() - 1);
+    for (int i = 0; i < faceNum; ++i)
+        if (!m.face[i].IsD())
+            for (int j = 0; j < 3; ++j)
+            {
+                const std::pair<int, int> k = key(i, j);
+                EdgeRef &r = refs[pos[k.first]++];
+                r.v = k.second;
+                r.w = 3 * i + j;
+            }
+}
+
+struct EdgeKey
+{
+    CMeshO &m;
+    EdgeKey(CMeshO &mesh) : m(mesh) {}
+    std::pair<int, int> operator()(int i, int j) const
+    {
+        const int v0 = int(vcg::tri::Index(m, m.face[i].cV(j)));
+        const int v1 = int(vcg::tri::Index(m, m.face[i].cV((j + 1) % 3)));
+        return std::make_pair(std::min(v0, v1), std::max(v0, v1));
+    }
+};
+
+struct WedgeKey
+{
+    CMeshO &m;
+    WedgeKey(CMeshO &mesh) : m(mesh) {}
+    std::pair<int, int> operator()(int i, int j) const
+    {
+        return std::make_pair(int(vcg::tri::Index(m, m.face[i].cV(j))), 0);
+    }
+};
+}
+
+void MLTopology::FaceFace(CMeshO &m)
+{
+    assert(vcg::tri::HasFFAdjacency(m));
+    if (m.fn == 0) return;
+
+    const int vertNum = int(m.vert.size());
+    std::vector<int> first;
+    std::vector<EdgeRef> edges;
+    bucketWedges(m, vertNum, EdgeKey(m), first, edges);
+
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(dynamic, 4096)
+#endif
+    for (int i = 0; i < vertNum; ++i)
+    {
+        const int n = first[i + 1] - first[i];
+        if (n == 0) continue;
+        EdgeRef *b = &edges[first[i]];
+        sortBucket(b, n);
+
+        // link every run of equal edges in a ring; border edges point to themselves
+        int rs = 0;
+        while (rs < n)
+        {
+            int re = rs + 1;
+            while (re < n && b[re].v == b[rs].v) ++re;
+            for (int q = rs; q < re; ++q)
+            {
+                const int next = (q + 1 < re) ? q + 1 : rs;
+                CFaceO &f = m.face[b[q].w / 3];
+                f.FFp(b[q].w % 3) = &m.face[b[next].w / 3];
+                f.FFi(b[q].w % 3) = char(b[next].w % 3);
+            }
+            rs = re;
+        }
+    }
+}
+
+void MLTopology::VertexFace(CMeshO &m)
+{
+    assert(vcg::tri::HasPerVertexVFAdjacency(m) && vcg::tri::HasPerFaceVFAdjacency(m));
+
+    const int vertNum = int(m.vert.size());
+    std::vector<int> first;
+    std::vector<EdgeRef> wedges;
+    bucketWedges(m, vertNum, WedgeKey(m), first, wedges);
+
+    // UpdateTopology::VertexFace pushes the faces in front of the lists scanning them
+    // in index order, so each list ends with the lowest face
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < vertNum; ++i)
+    {
+        CVertexO &v = m.vert[i];
+        v.VFp() = 0;
+        v.VFi() = 0;
+        for (int k = first[i]; k < first[i + 1]; ++k)
+        {
+            const int w = wedges[k].w;
+            CFaceO &f = m.face[w / 3];
+            f.VFp(w % 3) = v.VFp();
+            f.VFi(w % 3) = v.VFi();
+            v.VFp() = &f;
+            v.VFi() = w % 3;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_TOPOLOGY_H
+#define ML_TOPOLOGY_H
+
+#include "ml_mesh_type.h"
+
+/*
+  Builders of the face-face and vertex-face adjacency of a CMeshO, used by
+  MeshModel::updateDataMask in place of tri::UpdateTopology.
+
+  Instead of sorting the whole edge (or wedge) vector, the wedges are distributed
+  with a counting sort in one bucket per vertex; the buckets are then processed in
+  parallel. Both builders are deterministic, whatever the number of threads:
+  - FaceFace: the edges are bucketed by their lowest vertex index and each bucket is
+    sorted by the other vertex, so that the faces sharing an edge are adjacent and in
+    increasing index order. The resulting rings are the same of UpdateTopology (on a
+    non manifold edge the faces are linked in index order).
+  - VertexFace: the result is identical to the one of UpdateTopology::VertexFace.
+
+  Both require the adjacency to be already enabled on the mesh.
+*/
+class MLTopology
+{
+public:
+    static void FaceFace(CMeshO &m);
+    static void VertexFace(CMeshO &m);
+};
+
+#endif // ML_TOPOLOGY_H
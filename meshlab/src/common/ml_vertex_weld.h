@@ -0,0 +1,339 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_VERTEX_WELD_H
+#define ML_VERTEX_WELD_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <vcg/complex/complex.h>
+#include <vcg/complex/algorithms/clean.h>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+/*
+Parallel versions of tri::Clean::RemoveDuplicateVertex and tri::Clean::MergeCloseVertex,
+giving the same result of the serial ones.
+
+RemoveDuplicateVertex: the vertices are distributed with a counting sort in buckets
+indexed by a hash of their position; each bucket is then sorted (position, index) on its
+own, so the equal vertices are merged on the one with the lowest index, as the serial
+version does.
+
+MergeCloseVertex: the vertices are hashed in a uniform grid with cells as large as the
+merging distance and the neighbours of each vertex are searched in parallel, a block of
+vertices at a time. The greedy clustering of tri::Clean::ClusterVertex (every vertex not
+yet clustered, in index order, snaps to itself all the free vertices nearer than the
+distance) is then replayed serially on the neighbour lists, and the snapped vertices are
+welded with RemoveDuplicateVertex.
+
+In both cases the faces (and edges) are remapped in place: besides the mesh only a few
+integers per vertex are allocated. Deleted vertices are left in the vector, as the serial
+versions do.
+*/
+template <class MeshType>
+class VertexWeld
+{
+public:
+    typedef typename MeshType::ScalarType ScalarType;
+    typedef typename MeshType::CoordType CoordType;
+    typedef typename MeshType::VertexType VertexType;
+    typedef typename MeshType::FaceType FaceType;
+
+    // Returns the number of removed vertices; with removeDegenerate the faces (and edges)
+    // that collapsed are deleted too.
+    static int RemoveDuplicateVertex(MeshType &m, bool removeDegenerate = true)
+    {
+        if (m.vert.empty() || m.vn == 0) return 0;
+        const int vertNum = int(m.vert.size());
+        const int bucketNum = BucketNum(m.vn);
+
+        std::vector<int> key(vertNum);
+        std::vector<int> rep(vertNum);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            rep[i] = i;
+            const VertexType &v = m.vert[i];
+            // vertices with NaN coords are never equal to anything
+            key[i] = (v.IsD() || !IsFinite(v.cP())) ? bucketNum : int(PositionHash(v.cP()) & size_t(bucketNum - 1));
+        }
+        std::vector<int> first, items;
+        Bucket(key, bucketNum, first, items);
+        std::vector<int>().swap(key);
+
+        int deleted = 0;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic, 1024) reduction(+:deleted)
+#endif
+        for (int b = 0; b < bucketNum; ++b)
+        {
+            const int n = first[b + 1] - first[b];
+            if (n < 2) continue;
+            int *it = &items[first[b]];
+            std::sort(it, it + n, PositionLess(m));
+            int rs = 0;
+            for (int q = 1; q < n; ++q)
+            {
+                if (m.vert[it[q]].cP() == m.vert[it[rs]].cP())
+                {
+                    rep[it[q]] = it[rs];
+                    ++deleted;
+                }
+                else
+                    rs = q;
+            }
+        }
+
+        if (deleted > 0)
+            Remap(m, rep, deleted);
+        if (removeDegenerate)
+        {
+            RemoveDegenerateFace(m);
+            if (m.en > 0)
+            {
+                vcg::tri::Clean<MeshType>::RemoveDegenerateEdge(m);
+                vcg::tri::Clean<MeshType>::RemoveDuplicateEdge(m);
+            }
+        }
+        return deleted;
+    }
+
+    // Returns the number of vertices snapped on a nearer one, as tri::Clean::MergeCloseVertex.
+    static int MergeCloseVertex(MeshType &m, const ScalarType radius)
+    {
+        if (m.vn == 0) return 0;
+        int merged = 0;
+        if (radius > 0)
+            merged = ClusterVertex(m, radius);
+        RemoveDuplicateVertex(m, true);
+        return merged;
+    }
+
+    // Deletes the faces with two coincident vertex references, returns their number
+    static int RemoveDegenerateFace(MeshType &m)
+    {
+        const int faceNum = int(m.face.size());
+        int removed = 0;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static) reduction(+:removed)
+#endif
+        for (int i = 0; i < faceNum; ++i)
+        {
+            FaceType &f = m.face[i];
+            if (!f.IsD() && (f.V(0) == f.V(1) || f.V(0) == f.V(2) || f.V(1) == f.V(2)))
+            {
+                f.SetD();
+                ++removed;
+            }
+        }
+        m.fn -= removed;
+        return removed;
+    }
+
+private:
+    // Snaps each free vertex on the nearest (in index order) cluster center; the positions
+    // are changed but nothing is deleted yet
+    static int ClusterVertex(MeshType &m, const ScalarType radius)
+    {
+        const int vertNum = int(m.vert.size());
+        const int bucketNum = BucketNum(m.vn);
+
+        vcg::Box3<ScalarType> bb;
+        for (int i = 0; i < vertNum; ++i)
+            if (!m.vert[i].IsD() && IsFinite(m.vert[i].cP()))
+                bb.Add(m.vert[i].cP());
+        if (bb.IsNull()) return 0;
+
+        std::vector<vcg::Point3i> cell(vertNum);
+        std::vector<int> key(vertNum);
+        int overflow = 0;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static) reduction(+:overflow)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            const VertexType &v = m.vert[i];
+            if (v.IsD() || !IsFinite(v.cP()))
+            {
+                key[i] = bucketNum;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k)
+            {
+                const double c = std::floor(double(v.cP()[k] - bb.min[k]) / double(radius));
+                if (c > double(1 << 30)) ++overflow;
+                cell[i][k] = int(std::min(c, double(1 << 30)));
+            }
+            key[i] = int(CellHash(cell[i]) & size_t(bucketNum - 1));
+        }
+        // a distance so small with respect to the mesh that cells cannot be indexed:
+        // only the exact duplicates can be merged
+        if (overflow > 0) return 0;
+
+        std::vector<int> first, items;
+        Bucket(key, bucketNum, first, items);
+        std::vector<int>().swap(key);
+
+        std::vector<char> visited(vertNum, 0);
+        const int blockSize = 1 << 16;
+        std::vector< std::vector<int> > near(blockSize);
+        int merged = 0;
+        for (int b0 = 0; b0 < vertNum; b0 += blockSize)
+        {
+            const int b1 = std::min(vertNum, b0 + blockSize);
+            // neighbours with a higher index, the lower ones are already clustered when
+            // the sweep reaches a vertex
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic, 256)
+#endif
+            for (int i = b0; i < b1; ++i)
+            {
+                std::vector<int> &nl = near[i - b0];
+                nl.clear();
+                if (visited[i] || m.vert[i].IsD() || !IsFinite(m.vert[i].cP())) continue;
+                const CoordType &p = m.vert[i].cP();
+                for (int dz = -1; dz <= 1; ++dz)
+                    for (int dy = -1; dy <= 1; ++dy)
+                        for (int dx = -1; dx <= 1; ++dx)
+                        {
+                            const vcg::Point3i c(cell[i][0] + dx, cell[i][1] + dy, cell[i][2] + dz);
+                            const int h = int(CellHash(c) & size_t(bucketNum - 1));
+                            for (int q = first[h]; q < first[h + 1]; ++q)
+                            {
+                                const int j = items[q];
+                                if (j > i && cell[j] == c && vcg::Distance(p, m.vert[j].cP()) < radius)
+                                    nl.push_back(j);
+                            }
+                        }
+            }
+
+            for (int i = b0; i < b1; ++i)
+            {
+                if (visited[i] || m.vert[i].IsD() || !IsFinite(m.vert[i].cP())) continue;
+                visited[i] = 1;
+                const std::vector<int> &nl = near[i - b0];
+                for (size_t q = 0; q < nl.size(); ++q)
+                    if (!visited[nl[q]])
+                    {
+                        visited[nl[q]] = 1;
+                        m.vert[nl[q]].P() = m.vert[i].cP();
+                        ++merged;
+                    }
+            }
+        }
+        return merged;
+    }
+
+    // Moves the face and edge references on the representative vertices and deletes the others
+    static void Remap(MeshType &m, const std::vector<int> &rep, int deleted)
+    {
+        const int vertNum = int(m.vert.size());
+        const int faceNum = int(m.face.size());
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < faceNum; ++i)
+        {
+            FaceType &f = m.face[i];
+            if (f.IsD()) continue;
+            for (int k = 0; k < 3; ++k)
+                f.V(k) = &m.vert[rep[vcg::tri::Index(m, f.V(k))]];
+        }
+        for (typename MeshType::EdgeIterator ei = m.edge.begin(); ei != m.edge.end(); ++ei)
+            if (!(*ei).IsD())
+                for (int k = 0; k < 2; ++k)
+                    (*ei).V(k) = &m.vert[rep[vcg::tri::Index(m, (*ei).V(k))]];
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+            if (rep[i] != i)
+                m.vert[i].SetD();
+        m.vn -= deleted;
+    }
+
+    // Counting sort of the indexes in [0,key.size()) by key; key == bucketNum means skip
+    static void Bucket(const std::vector<int> &key, int bucketNum, std::vector<int> &first, std::vector<int> &items)
+    {
+        const int n = int(key.size());
+        first.assign(bucketNum + 2, 0);
+        for (int i = 0; i < n; ++i)
+            ++first[key[i] + 1];
+        for (int b = 0; b <= bucketNum; ++b)
+            first[b + 1] += first[b];
+        items.resize(first[bucketNum]);
+        std::vector<int> pos(first.begin(), first.begin() + bucketNum);
+        for (int i = 0; i < n; ++i)
+            if (key[i] < bucketNum)
+                items[pos[key[i]]++] = i;
+        first.resize(bucketNum + 1);
+    }
+
+    static int BucketNum(int n)
+    {
+        int b = 1;
+        while (b < n && b < (1 << 30)) b <<= 1;
+        return b;
+    }
+
+    static bool IsFinite(const CoordType &p)
+    {
+        return p[0] == p[0] && p[1] == p[1] && p[2] == p[2];
+    }
+
+    static size_t PositionHash(const CoordType &p)
+    {
+        std::hash<ScalarType> h;
+        size_t res = 0;
+        for (int k = 0; k < 3; ++k)
+            res = res * size_t(1000003) ^ h(p[k] + ScalarType(0)); // -0 and +0 are the same point
+        return res ^ (res >> 16);
+    }
+
+    static size_t CellHash(const vcg::Point3i &c)
+    {
+        // same primes of vcg::SpatialHashTable
+        return size_t(c[0]) * size_t(73856093) ^ size_t(c[1]) * size_t(19349663) ^ size_t(c[2]) * size_t(83492791);
+    }
+
+    struct PositionLess
+    {
+        const MeshType &m;
+        PositionLess(const MeshType &mesh) : m(mesh) {}
+        bool operator()(int a, int b) const
+        {
+            const CoordType &pa = m.vert[a].cP();
+            const CoordType &pb = m.vert[b].cP();
+            if (pa == pb) return a < b;
+            return pa < pb;
+        }
+    };
+};
+
+#endif // ML_VERTEX_WELD_H
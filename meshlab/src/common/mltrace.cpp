@@ -0,0 +1,223 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "mltrace.h"
+
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+#include <QThread>
+#include <QMutexLocker>
+#include <cstdio>
+#include <limits>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#if defined(Q_OS_MAC)
+#include <mach/mach.h>
+#endif
+#endif
+
+QAtomicInt MLTracer::_enabled(0);
+
+MLTracer::MLTracer()
+{
+    _timer.start();
+}
+
+MLTracer& MLTracer::instance()
+{
+    static MLTracer tracer;
+    return tracer;
+}
+
+void MLTracer::setEnabled( bool on )
+{
+    if (on)
+        instance();
+    _enabled.fetchAndStoreOrdered(on ? 1 : 0);
+}
+
+QString MLTracer::environmentFileName()
+{
+    return QString::fromLocal8Bit(qgetenv("MESHLAB_TRACE"));
+}
+
+qint64 MLTracer::peakRSS()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(),&pmc,sizeof(pmc)))
+        return qint64(pmc.PeakWorkingSetSize);
+    return -1;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF,&ru) != 0)
+        return -1;
+#if defined(Q_OS_MAC)
+    return qint64(ru.ru_maxrss);
+#else
+    return qint64(ru.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+qint64 MLTracer::currentRSS()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(),&pmc,sizeof(pmc)))
+        return qint64(pmc.WorkingSetSize);
+    return -1;
+#elif defined(Q_OS_MAC)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(),MACH_TASK_BASIC_INFO,(task_info_t)&info,&count) != KERN_SUCCESS)
+        return -1;
+    return qint64(info.resident_size);
+#else
+    // the second field of statm is the number of resident pages
+    FILE *fp = fopen("/proc/self/statm","r");
+    if (fp == NULL)
+        return -1;
+    long size = 0,resident = 0;
+    const int read = fscanf(fp,"%ld %ld",&size,&resident);
+    fclose(fp);
+    if (read != 2)
+        return -1;
+    return qint64(resident) * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+qint64 MLTracer::now() const
+{
+    return _timer.nsecsElapsed() / 1000;
+}
+
+void MLTracer::record( const Event& ev )
+{
+    QMutexLocker lock(&_mutex);
+    _events.push_back(ev);
+}
+
+void MLTracer::clear()
+{
+    QMutexLocker lock(&_mutex);
+    _events.clear();
+}
+
+int MLTracer::eventCount()
+{
+    QMutexLocker lock(&_mutex);
+    return _events.size();
+}
+
+// rssDelta when the resident memory is not available
+static const qint64 noRSS = std::numeric_limits<qint64>::min();
+
+static QString jsonEscape(const QString& s)
+{
+    QString res;
+    res.reserve(s.size());
+    for(int ii = 0;ii < s.size();++ii)
+    {
+        const QChar c = s[ii];
+        if (c == QChar('"') || c == QChar('\\'))
+            res += QChar('\\') + QString(c);
+        else if (c.unicode() < 0x20)
+            res += QString("\\u%1").arg(int(c.unicode()),4,16,QChar('0'));
+        else
+            res += c;
+    }
+    return res;
+}
+
+bool MLTracer::saveChromeTrace( const QString& fileName )
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    QMutexLocker lock(&_mutex);
+    // Chrome wants small integer thread ids
+    QMap<quintptr,int> tids;
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[\n";
+    for(int ii = 0;ii < _events.size();++ii)
+    {
+        const Event& ev = _events[ii];
+        if (!tids.contains(ev.thread))
+            tids.insert(ev.thread,tids.size() + 1);
+        out << "{\"name\":\"" << jsonEscape(ev.name) << "\",\"cat\":\"" << ev.category << "\",\"ph\":\"X\"";
+        out << ",\"ts\":" << ev.start << ",\"dur\":" << ev.duration << ",\"pid\":1,\"tid\":" << tids[ev.thread];
+        out << ",\"args\":{";
+        bool first = true;
+        if (ev.processPeakRSS >= 0)
+        {
+            out << "\"processPeakRSS_MB\":" << QString::number(double(ev.processPeakRSS) / (1024.0 * 1024.0),'f',1);
+            first = false;
+        }
+        if (ev.rssDelta != noRSS)
+        {
+            out << (first ? "" : ",") << "\"rssDelta_MB\":" << QString::number(double(ev.rssDelta) / (1024.0 * 1024.0),'f',1);
+            first = false;
+        }
+        if (ev.vn >= 0)
+        {
+            out << (first ? "" : ",") << "\"vn\":" << ev.vn << ",\"fn\":" << ev.fn;
+            first = false;
+        }
+        out << "}}" << ((ii + 1 < _events.size()) ? ",\n" : "\n");
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+    return file.error() == QFile::NoError;
+}
+
+void MLTraceSpan::begin( const QString& name,const char* category,int vn,int fn )
+{
+    _ev.name = name;
+    _ev.category = category;
+    _ev.vn = vn;
+    _ev.fn = fn;
+    _ev.thread = quintptr(QThread::currentThreadId());
+    // the resident memory at the start, replaced by the difference in end()
+    _ev.rssDelta = MLTracer::currentRSS();
+    _ev.start = MLTracer::instance().now();
+}
+
+void MLTraceSpan::end()
+{
+    MLTracer& tracer = MLTracer::instance();
+    _ev.duration = tracer.now() - _ev.start;
+    _ev.processPeakRSS = MLTracer::peakRSS();
+    const qint64 rss = MLTracer::currentRSS();
+    _ev.rssDelta = ((rss >= 0) && (_ev.rssDelta >= 0)) ? rss - _ev.rssDelta : noRSS;
+    tracer.record(_ev);
+}
@@ -0,0 +1,152 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_TRACE_H
+#define ML_TRACE_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+
+/*
+  Tracing of the time spent in filters, IO and rendering updates.
+
+  A MLTraceSpan measures the scope it lives in; spans opened inside other spans of the
+  same thread show up nested. Each span records its duration, the thread, how much the
+  resident memory of the process changed from its start to its end, the peak resident
+  memory of the process so far (not of the span: it is the same for all the spans after
+  the largest one) and, optionally, the number of vertices and faces involved. When the tracer is disabled (the default) a span costs a single
+  flag test.
+
+  The recorded spans can be saved in the Chrome trace event format, readable by
+  chrome://tracing or Perfetto. Tracing is enabled by setting the MESHLAB_TRACE
+  environment variable to the name of the file where the trace will be saved on exit,
+  with the -t option of meshlabserver or from the Tools menu of MeshLab.
+
+  Usage in a plugin:
+    MLTraceSpan span("Build octree");
+    ...
+    span.setCounts(m.cm.vn,m.cm.fn);
+  In the frequently called code the name is better given as a prefix and a detail, joined
+  only when tracing is enabled:
+    MLTraceSpan span("Update buffers ",mm->label(),"gpu");
+*/
+class MLTracer
+{
+public:
+    struct Event
+    {
+        QString name;
+        const char* category;
+        qint64 start;     // microseconds since the creation of the tracer
+        qint64 duration;  // microseconds
+        quintptr thread;
+        qint64 processPeakRSS; // peak of the whole process so far, bytes, -1 if not available
+        qint64 rssDelta;  // change of the resident memory during the span, bytes
+        int vn;           // -1 if not set
+        int fn;
+    };
+
+    static MLTracer& instance();
+    static inline bool enabled()
+    {
+#if (QT_VERSION >= 0x050000)
+        return _enabled.loadAcquire() != 0;
+#else
+        return int(_enabled) != 0;
+#endif
+    }
+    static void setEnabled(bool on);
+    // file name given by the MESHLAB_TRACE environment variable (empty if not set)
+    static QString environmentFileName();
+    // peak resident set size of the process in bytes, -1 if not available
+    static qint64 peakRSS();
+    // current resident set size of the process in bytes, -1 if not available
+    static qint64 currentRSS();
+
+    qint64 now() const;
+    void record(const Event& ev);
+    void clear();
+    int eventCount();
+    bool saveChromeTrace(const QString& fileName);
+
+private:
+    MLTracer();
+
+    // read by every span, in any thread
+    static QAtomicInt _enabled;
+    QElapsedTimer _timer;
+    QMutex _mutex;
+    QVector<Event> _events;
+};
+
+class MLTraceSpan
+{
+public:
+    MLTraceSpan(const char* name,const char* category = "phase",int vn = -1,int fn = -1)
+        :_active(MLTracer::enabled())
+    {
+        if (_active)
+            begin(QString(name),category,vn,fn);
+    }
+
+    MLTraceSpan(const QString& name,const char* category = "phase",int vn = -1,int fn = -1)
+        :_active(MLTracer::enabled())
+    {
+        if (_active)
+            begin(name,category,vn,fn);
+    }
+
+    MLTraceSpan(const char* prefix,const QString& detail,const char* category,int vn = -1,int fn = -1)
+        :_active(MLTracer::enabled())
+    {
+        if (_active)
+            begin(QString(prefix) + detail,category,vn,fn);
+    }
+
+    ~MLTraceSpan()
+    {
+        if (_active)
+            end();
+    }
+
+    inline void setCounts(int vn,int fn)
+    {
+        if (_active)
+        {
+            _ev.vn = vn;
+            _ev.fn = fn;
+        }
+    }
+
+private:
+    void begin(const QString& name,const char* category,int vn,int fn);
+    void end();
+
+    bool _active;
+    MLTracer::Event _ev;
+};
+
+#endif // ML_TRACE_H
@@ -373,6 +373,11 @@ MeshModelSI::MeshModelSI(MeshModel& meshModel,MeshDocumentSI* parent)
 
 }
 
+MeshModelSI::~MeshModelSI()
+{
+    qDeleteAll(views);
+}
+
 Q_INVOKABLE Scalarm MeshModelSI::bboxDiag() const
 {
     return mm.cm.bbox.Diag();
@@ -433,6 +438,7 @@ Q_INVOKABLE QVector<VCGVertexSI*> MeshModelSI::vert()
 Q_INVOKABLE Point3Vector MeshModelSI::getVertPosArray()
 {
     Point3Vector pv;
+    pv.reserve(mm.cm.vn);
     for(int ii = 0; ii < mm.cm.vn;++ii)
     {
         QVector<Scalarm> p;
@@ -457,6 +463,7 @@ Q_INVOKABLE void MeshModelSI::setVertNormArray( const Point3Vector& na )
 Q_INVOKABLE Point3Vector MeshModelSI::getVertNormArray()
 {
     Point3Vector pv;
+    pv.reserve(mm.cm.vn);
     for(int ii = 0; ii < mm.cm.vn;++ii)
     {
         QVector<Scalarm> p;
@@ -466,6 +473,187 @@ Q_INVOKABLE Point3Vector MeshModelSI::getVertNormArray()
     return pv;
 }
 
+QScriptValue MeshModelSI::view( MeshAttributeViewSI::Attribute attr,int requiredMask )
+{
+    if (engine() == NULL)
+        return QScriptValue();
+    if ((requiredMask != MeshModel::MM_NONE) && !mm.hasDataMask(requiredMask))
+        return context()->throwError(QString("The mesh %1 has not the requested attribute").arg(mm.label()));
+    MeshAttributeViewSI* v = views.value(attr,NULL);
+    if (v == NULL)
+    {
+        v = new MeshAttributeViewSI(engine(),mm,attr);
+        views.insert(attr,v);
+    }
+    return engine()->newObject(v);
+}
+
+Q_INVOKABLE QScriptValue MeshModelSI::vertPos()
+{
+    return view(MeshAttributeViewSI::VertPos,MeshModel::MM_NONE);
+}
+
+Q_INVOKABLE QScriptValue MeshModelSI::vertNorm()
+{
+    return view(MeshAttributeViewSI::VertNorm,MeshModel::MM_NONE);
+}
+
+Q_INVOKABLE QScriptValue MeshModelSI::vertColor()
+{
+    return view(MeshAttributeViewSI::VertColor,MeshModel::MM_NONE);
+}
+
+Q_INVOKABLE QScriptValue MeshModelSI::vertQuality()
+{
+    return view(MeshAttributeViewSI::VertQuality,MeshModel::MM_NONE);
+}
+
+Q_INVOKABLE QScriptValue MeshModelSI::faceVert()
+{
+    return view(MeshAttributeViewSI::FaceVert,MeshModel::MM_NONE);
+}
+
+Q_INVOKABLE QScriptValue MeshModelSI::faceNorm()
+{
+    return view(MeshAttributeViewSI::FaceNorm,MeshModel::MM_NONE);
+}
+
+Q_INVOKABLE QScriptValue MeshModelSI::faceColor()
+{
+    return view(MeshAttributeViewSI::FaceColor,MeshModel::MM_FACECOLOR);
+}
+
+Q_INVOKABLE QScriptValue MeshModelSI::faceQuality()
+{
+    return view(MeshAttributeViewSI::FaceQuality,MeshModel::MM_FACEQUALITY);
+}
+
+Q_INVOKABLE void MeshModelSI::transformVert( const QVector<Scalarm>& m16 )
+{
+    vcg::tri::UpdatePosition<CMeshO>::Matrix(mm.cm,ScriptInterfaceUtilities::vector16ToVcgMatrix44(m16),true);
+}
+
+Q_INVOKABLE void MeshModelSI::fillVertQuality( const Scalarm q )
+{
+    for(size_t ii = 0; ii < mm.cm.vert.size();++ii)
+        mm.cm.vert[ii].Q() = q;
+}
+
+Q_INVOKABLE void MeshModelSI::fillVertColor( const int r,const int g,const int b,const int a )
+{
+    vcg::Color4b c(r,g,b,a);
+    for(size_t ii = 0; ii < mm.cm.vert.size();++ii)
+        mm.cm.vert[ii].C() = c;
+}
+
+Q_INVOKABLE void MeshModelSI::normalizeVertNorm()
+{
+    vcg::tri::UpdateNormal<CMeshO>::NormalizePerVertex(mm.cm);
+}
+
+Q_INVOKABLE void MeshModelSI::updateBoxAndNormals()
+{
+    mm.UpdateBoxAndNormals();
+}
+
+MeshAttributeViewSI::MeshAttributeViewSI( QScriptEngine* eng,MeshModel& meshModel,Attribute attribute )
+:QScriptClass(eng),mm(meshModel),attr(attribute)
+{
+    lengthName = eng->toStringHandle("length");
+    componentsName = eng->toStringHandle("components");
+}
+
+int MeshAttributeViewSI::components() const
+{
+    switch(attr)
+    {
+    case VertColor:
+    case FaceColor:
+        return 4;
+    case VertQuality:
+    case FaceQuality:
+        return 1;
+    default:
+        return 3;
+    }
+}
+
+uint MeshAttributeViewSI::length() const
+{
+    if (attr < FaceVert)
+        return uint(mm.cm.vert.size()) * components();
+    return uint(mm.cm.face.size()) * components();
+}
+
+QString MeshAttributeViewSI::name() const
+{
+    return QString("MeshAttributeView");
+}
+
+QScriptClass::QueryFlags MeshAttributeViewSI::queryProperty( const QScriptValue& /*object*/,const QScriptString& name,QueryFlags flags,uint* id )
+{
+    if ((name == lengthName) || (name == componentsName))
+        return flags & HandlesReadAccess;
+    bool isIndex = false;
+    quint32 ind = name.toArrayIndex(&isIndex);
+    if (!isIndex || (ind >= length()))
+        return 0;
+    *id = ind;
+    if (attr == FaceVert)
+        return flags & HandlesReadAccess;
+    return flags;
+}
+
+QScriptValue MeshAttributeViewSI::property( const QScriptValue& /*object*/,const QScriptString& name,uint id )
+{
+    if (name == lengthName)
+        return QScriptValue(length());
+    if (name == componentsName)
+        return QScriptValue(components());
+    const uint ii = id / components();
+    const int k = id % components();
+    CMeshO& m = mm.cm;
+    switch(attr)
+    {
+    case VertPos:     return QScriptValue(double(m.vert[ii].cP()[k]));
+    case VertNorm:    return QScriptValue(double(m.vert[ii].cN()[k]));
+    case VertColor:   return QScriptValue(int(m.vert[ii].cC()[k]));
+    case VertQuality: return QScriptValue(double(m.vert[ii].cQ()));
+    case FaceVert:    return QScriptValue(int(vcg::tri::Index(m,m.face[ii].cV(k))));
+    case FaceNorm:    return QScriptValue(double(m.face[ii].cN()[k]));
+    case FaceColor:   return QScriptValue(int(m.face[ii].cC()[k]));
+    case FaceQuality: return QScriptValue(double(m.face[ii].cQ()));
+    }
+    return QScriptValue();
+}
+
+void MeshAttributeViewSI::setProperty( QScriptValue& /*object*/,const QScriptString& /*name*/,uint id,const QScriptValue& value )
+{
+    const uint ii = id / components();
+    const int k = id % components();
+    const double val = value.toNumber();
+    const unsigned char col = (unsigned char) std::max(0.0,std::min(255.0,val));
+    CMeshO& m = mm.cm;
+    switch(attr)
+    {
+    case VertPos:     m.vert[ii].P()[k] = Scalarm(val); break;
+    case VertNorm:    m.vert[ii].N()[k] = Scalarm(val); break;
+    case VertColor:   m.vert[ii].C()[k] = col; break;
+    case VertQuality: m.vert[ii].Q() = Scalarm(val); break;
+    case FaceNorm:    m.face[ii].N()[k] = Scalarm(val); break;
+    case FaceColor:   m.face[ii].C()[k] = col; break;
+    case FaceQuality: m.face[ii].Q() = Scalarm(val); break;
+    default: break;
+    }
+}
+
+QScriptValue::PropertyFlags MeshAttributeViewSI::propertyFlags( const QScriptValue& /*object*/,const QScriptString& name,uint /*id*/ )
+{
+    if ((name == lengthName) || (name == componentsName) || (attr == FaceVert))
+        return QScriptValue::ReadOnly | QScriptValue::Undeletable;
+    return QScriptValue::Undeletable;
+}
+
 //Q_INVOKABLE void MeshModelSI::setV( const QVector<VCGVertexSI*>& v )
 //{
 //	for(unsigned int ii = 0; ii < mm.cm.vn;++ii)
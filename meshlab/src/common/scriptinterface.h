@@ -117,6 +117,37 @@ public:
     CMeshO::VertexType& vv;
 };
 
+/*
+  Array-like view on a per element attribute of a mesh, bound directly to the CMeshO
+  storage: view[i*view.components + k] is the k-th component of the i-th vertex (face)
+  and view.length is vert.size()*view.components (face.size()*view.components).
+  Nothing is copied and no object is allocated per element, so scripts can walk
+  meshes with millions of elements. Deleted elements are not skipped.
+  FaceVert (the vertex indexes of each face) is read-only.
+*/
+class MeshAttributeViewSI : public QScriptClass
+{
+public:
+    enum Attribute {VertPos, VertNorm, VertColor, VertQuality, FaceVert, FaceNorm, FaceColor, FaceQuality};
+
+    MeshAttributeViewSI(QScriptEngine* eng,MeshModel& meshModel,Attribute attribute);
+
+    QueryFlags queryProperty(const QScriptValue& object,const QScriptString& name,QueryFlags flags,uint* id);
+    QScriptValue property(const QScriptValue& object,const QScriptString& name,uint id);
+    void setProperty(QScriptValue& object,const QScriptString& name,uint id,const QScriptValue& value);
+    QScriptValue::PropertyFlags propertyFlags(const QScriptValue& object,const QScriptString& name,uint id);
+    QString name() const;
+
+    int components() const;
+    uint length() const;
+
+    MeshModel& mm;
+    Attribute attr;
+private:
+    QScriptString lengthName;
+    QScriptString componentsName;
+};
+
 class MeshModelSI;
 
 class MeshDocumentSI : public QObject
@@ -138,12 +169,13 @@ public:
 
 class ShotSI;
 
-class MeshModelSI : public QObject
+class MeshModelSI : public QObject, protected QScriptable
 {
     Q_OBJECT
 
 public:
     MeshModelSI(MeshModel& meshModel,MeshDocumentSI* mdsi);
+    ~MeshModelSI();
 
     Q_INVOKABLE int id() const;
     Q_INVOKABLE Scalarm bboxDiag() const;
@@ -161,12 +193,32 @@ Q_INVOKABLE inline Scalarm computeMaxFQ() const {  return vcg::tri::Stat<CMeshO>
     Q_INVOKABLE void setVertNormArray(const Point3Vector& na);
     //Q_INVOKABLE void setV(const QVector<VCGVertexSI*>& v);
 
+    // zero-copy views on the mesh storage (see MeshAttributeViewSI)
+    Q_INVOKABLE QScriptValue vertPos();
+    Q_INVOKABLE QScriptValue vertNorm();
+    Q_INVOKABLE QScriptValue vertColor();
+    Q_INVOKABLE QScriptValue vertQuality();
+    Q_INVOKABLE QScriptValue faceVert();
+    Q_INVOKABLE QScriptValue faceNorm();
+    Q_INVOKABLE QScriptValue faceColor();
+    Q_INVOKABLE QScriptValue faceQuality();
+
+    // bulk operations, performed natively on all the vertices
+    Q_INVOKABLE void transformVert(const QVector<Scalarm>& m16);
+    Q_INVOKABLE void fillVertQuality(const Scalarm q);
+    Q_INVOKABLE void fillVertColor(const int r,const int g,const int b,const int a);
+    Q_INVOKABLE void normalizeVertNorm();
+    Q_INVOKABLE void updateBoxAndNormals();
+
     Q_INVOKABLE int vn() const;
     Q_INVOKABLE int fn() const;
     Q_INVOKABLE VCGVertexSI* v(const int ind);
     Q_INVOKABLE ShotSI* shot();
 
     MeshModel& mm;
+private:
+    QScriptValue view(MeshAttributeViewSI::Attribute attr,int requiredMask);
+    QMap<int,MeshAttributeViewSI*> views;
 };
 
 
@@ -5,6 +5,7 @@
 #include "../common/meshlabdocumentxml.h"
 #include "../common/meshlabdocumentbundler.h"
 #include "filterthread.h"
+#include "../common/mltrace.h"
 
 FilterThread* FilterThread::_cur = NULL;
 
@@ -84,7 +85,12 @@ void FilterThread::run()
                 env.insertExpressionBinding(itp.key(),itp.value());
             EnvWrap envwrap(env);
             _cur = this;
-            _success = it->filterInterface->applyFilter(_fname, _md, envwrap, &localCallBack);
+            {
+                MLTraceSpan span(_fname,"filter");
+                _success = it->filterInterface->applyFilter(_fname, _md, envwrap, &localCallBack);
+                if (_md.mm() != NULL)
+                    span.setCounts(_md.mm()->cm.vn,_md.mm()->cm.fn);
+            }
             _cur = NULL;
             it->filterInterface->glContext->removePerViewRenderindData();
             delete it->filterInterface->glContext;
@@ -181,6 +181,7 @@ public slots:
             if (mm() != NULL)
                 iEdit->EndEdit(*mm(),this,parentmultiview->sharedDataContext());
         }
+        invalidateTopology();
         iEdit= 0;
         currentEditor=0;
         setCursorTrack(0);
@@ -188,6 +189,15 @@ public slots:
         emit updateMainWindowMenus();
     }
 
+    // edit tools do not declare what they change: the adjacency cached for
+    // the filters is dropped when they end or are suspended
+    void invalidateTopology()
+    {
+        if (md() == NULL) return;
+        for(MeshModel* m = md()->nextMesh();m != NULL;m = md()->nextMesh(m))
+            m->invalidateTopology();
+    }
+
     void suspendEditToggle()
     {
         if(currentEditor==0) return;
@@ -197,6 +207,7 @@ public slots:
             setCursor(qc);
         }	else {
             suspendedEditor=true;
+            invalidateTopology();
             qc=cursor();
             setCursorTrack(0);
         }
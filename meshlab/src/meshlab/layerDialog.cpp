@@ -504,10 +504,19 @@ void LayerDialog::addDefaultNotes(QTreeWidgetItem * parent, MeshModel *meshModel
 
     QTreeWidgetItem *vertItem = new QTreeWidgetItem();
     vertItem->setText(2, QString("Vertices"));
-    vertItem->setText(3, QString::number(meshModel->cm.vn));
+    vertItem->setText(3, QString::number(meshModel->isCompact() ? int(meshModel->compactCloud()->size()) : meshModel->cm.vn));
     parent->addChild(vertItem);
     updateColumnNumber(vertItem);
 
+    if(meshModel->isCompact()){
+        static const char *encodings[] = {"Float","Half Float","Quantized"};
+        QTreeWidgetItem *compactItem = new QTreeWidgetItem();
+        compactItem->setText(2, QString("Compact"));
+        compactItem->setText(3, QString("%1, not rendered").arg(encodings[meshModel->compactCloud()->encoding()]));
+        parent->addChild(compactItem);
+        updateColumnNumber(compactItem);
+    }
+
     if(meshModel->cm.en>0){
         QTreeWidgetItem *edgeItem = new QTreeWidgetItem();
         edgeItem->setText(2, QString("Edges"));
@@ -839,6 +848,12 @@ MeshTreeWidgetItem::MeshTreeWidgetItem(MeshModel* meshmodel,QTreeWidget* tree,ML
         QString meshName = inf.completeBaseName();
         if (meshmodel->meshModified())
             meshName += " *";
+        // compact point clouds are not drawn until they are expanded
+        if (meshmodel->isCompact())
+        {
+            meshName += " [compact]";
+            setToolTip(2, "Compact point cloud: it is not rendered, use Expand Compact Point Cloud Layer to draw it");
+        }
         if (_rendertoolbar != NULL)
             tree->setItemWidget(this,3,_rendertoolbar);
 
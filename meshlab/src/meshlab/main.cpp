@@ -21,6 +21,7 @@
 *                                                                           *
 ****************************************************************************/
 #include <common/mlapplication.h>
+#include <common/mltrace.h>
 #include <QMessageBox>
 #include "mainwindow.h"
 #include <QString>
@@ -57,6 +58,11 @@ int main(int argc, char *argv[])
         }
     }
 
+    // MESHLAB_TRACE=file.json records the whole session and saves it on exit
+    QString traceFile = MLTracer::environmentFileName();
+    if (!traceFile.isEmpty())
+        MLTracer::setEnabled(true);
+
     MainWindow window;
     window.showMaximized();
 
@@ -83,5 +89,8 @@ int main(int argc, char *argv[])
             window.importMeshWithLayerManagement(argv[1]);
     }
     //else 	if(filterObj->noEvent) window.open();
-    return app.exec();
+    int res = app.exec();
+    if (!traceFile.isEmpty())
+        MLTracer::instance().saveChromeTrace(traceFile);
+    return res;
 }
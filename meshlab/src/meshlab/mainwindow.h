@@ -136,6 +136,8 @@ private slots:
 public:
 
     bool exportMesh(QString fileName,MeshModel* mod,const bool saveAllPossibleAttributes);
+    // writes the layers of the current document that are not up to date on disk (see MLLayerSaver)
+    bool saveLayers(const bool onlyVisible,QStringList& errors);
     bool loadMesh(const QString& fileName,MeshIOInterface *pCurrentIOPlugin,MeshModel* mm,int& mask,RichParameterSet* prePar, const Matrix44m &mtr=Matrix44m::Identity());
     bool loadMeshWithStandardParams(QString& fullPath,MeshModel* mm, const Matrix44m &mtr=Matrix44m::Identity());
     
@@ -205,6 +207,8 @@ private slots:
 
     ///////////Slot Menu Preferences /////////////////
     void setCustomize();
+    void recordTrace(bool on);
+    void saveTrace();
     ///////////Slot Menu Help ////////////////////////
     void about();
     void aboutPlugins();
@@ -418,6 +422,7 @@ private:
     QAction *exitAct;
     //////
     QAction *lastFilterAct;
+    QAction *applyToAllLayersAct;
     QAction *runFilterScriptAct;
     QAction *showFilterScriptAct;
     QAction* showFilterEditAct;
@@ -484,6 +489,8 @@ private:
 
     ///////////Actions Menu Preferences /////////////////
     QAction *setCustomizeAct;
+    QAction *recordTraceAct;
+    QAction *saveTraceAct;
     ///////////Actions Menu Help ////////////////////////
     QAction *aboutAct;
     QAction *aboutPluginsAct;
@@ -504,6 +511,8 @@ private:
         {}
     };
     QMap<int,MeshModelTmpData> existingmeshesbeforefilterexecution;
+    // the compact layers expanded for the running xml filter, compacted again by postFilterExecution
+    QList<MeshModel*> expandedmeshesbeforefilterexecution;
     static QString getDecoratedFileName(const QString& name);
 };
 
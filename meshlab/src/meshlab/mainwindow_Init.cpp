@@ -26,6 +26,7 @@
 #include "../common/xmlfilterinfo.h"
 #include "../common/searcher.h"
 #include "../common/mlapplication.h"
+#include "../common/mltrace.h"
 
 #include <QToolBar>
 #include <QProgressBar>
@@ -395,6 +396,11 @@ connectRenderModeActionList(rendlist);*/
     lastFilterAct->setEnabled(false);
     connect(lastFilterAct, SIGNAL(triggered()), this, SLOT(applyLastFilter()));
 
+    applyToAllLayersAct = new QAction(tr("Apply to all visible layers"),this);
+    applyToAllLayersAct->setCheckable(true);
+    applyToAllLayersAct->setChecked(false);
+    applyToAllLayersAct->setToolTip(tr("The filters that support it run on every visible layer at the same time"));
+
     showFilterScriptAct = new QAction(tr("Show current filter script"),this);
     showFilterScriptAct->setEnabled(false);
     connect(showFilterScriptAct, SIGNAL(triggered()), this, SLOT(showFilterScript()));
@@ -403,6 +409,14 @@ connectRenderModeActionList(rendlist);*/
     setCustomizeAct	  = new QAction(tr("&Options..."),this);
     connect(setCustomizeAct, SIGNAL(triggered()), this, SLOT(setCustomize()));
 
+    recordTraceAct = new QAction(tr("&Record Trace"),this);
+    recordTraceAct->setCheckable(true);
+    recordTraceAct->setChecked(MLTracer::enabled());
+    connect(recordTraceAct, SIGNAL(toggled(bool)), this, SLOT(recordTrace(bool)));
+
+    saveTraceAct = new QAction(tr("Save &Trace..."),this);
+    connect(saveTraceAct, SIGNAL(triggered()), this, SLOT(saveTrace()));
+
     //////////////Action Menu About ///////////////////////////////////////////////////////////////////////////
     aboutAct = new QAction(tr("&About"), this);
     connect(aboutAct, SIGNAL(triggered()), this, SLOT(about()));
@@ -598,6 +612,10 @@ void MainWindow::createMenus()
    /* preferencesMenu->addAction(showFilterEditAct);
     preferencesMenu->addSeparator();*/
     preferencesMenu->addAction(setCustomizeAct);
+    preferencesMenu->addSeparator();
+    // the tracing actions live in the Tools menu (preferencesMenu)
+    preferencesMenu->addAction(recordTraceAct);
+    preferencesMenu->addAction(saveTraceAct);
 
     //////////////////// Menu Help ////////////////////////////////////////////////////////////////
     helpMenu = menuBar()->addMenu(tr("&Help"));
@@ -670,6 +688,7 @@ void MainWindow::fillFilterMenu()
 {
     filterMenu->clear();
     filterMenu->addAction(lastFilterAct);
+    filterMenu->addAction(applyToAllLayersAct);
     filterMenu->addAction(showFilterScriptAct);
     filterMenu->addSeparator();
     //filterMenu->addMenu(new SearcherMenu(this,filterMenu));
@@ -50,6 +50,10 @@
 #include "../common/meshlabdocumentbundler.h"
 #include "../common/mlapplication.h"
 #include "../common/filterscript.h"
+#include "../common/mltrace.h"
+#include "../common/ml_filter_cache.h"
+#include "../common/ml_layer_runner.h"
+#include "../common/ml_layer_saver.h"
 
 
 using namespace std;
@@ -791,10 +795,25 @@ void MainWindow::runFilterScript()
 {
     if ((meshDoc() == NULL) || (meshDoc()->filterHistory == NULL))
         return;
-    for(FilterScript::iterator ii= meshDoc()->filterHistory->filtparlist.begin();ii!= meshDoc()->filterHistory->filtparlist.end();++ii)
+    // with MESHLAB_FILTER_CACHE set, the steps whose result is already cached are skipped
+    MLFilterCache cache;
+    QList<QByteArray> cacheKeys = cache.scriptKeys(*meshDoc(),*meshDoc()->filterHistory);
+    int firstStep = cache.resume(*meshDoc(),cacheKeys);
+    if (firstStep < 0)
+    {
+        meshDoc()->Log.Logf(GLLogStream::WARNING,"Failed to read the filter cache in %s",qPrintable(cache.directory()));
+        return;
+    }
+    if (firstStep > 0)
+    {
+        GLA()->completeUpdateRequested();
+        GLA()->Logf(GLLogStream::SYSTEM,"Restored the cached result of the first %i filters",firstStep);
+    }
+    for(FilterScript::iterator ii= meshDoc()->filterHistory->filtparlist.begin() + firstStep;ii!= meshDoc()->filterHistory->filtparlist.end();++ii)
     {
         QString filtnm = (*ii)->filterName();
         int classes = 0;
+        bool ret = false;
         if (!(*ii)->isXMLFilter())
         {
             QAction *action = PM.actionFilterMap[ filtnm];
@@ -878,7 +897,7 @@ void MainWindow::runFilterScript()
             meshDoc()->setBusy(true);
             //WARNING!!!!!!!!!!!!
             /* to be changed */
-            iFilter->applyFilter( action, *meshDoc(), old->pair.second, QCallBack );
+            ret = iFilter->applyFilter( action, *meshDoc(), old->pair.second, QCallBack );
             meshDoc()->setBusy(false);
             if (shar != NULL)
                 shar->removeView(iFilter->glContext); 
@@ -971,7 +990,7 @@ void MainWindow::runFilterScript()
                     //WARNING!!!!!!!!!!!!
                     /* IT SHOULD INVOKE executeFilter function. Unfortunately this function create a different thread for each invoked filter, and the MeshLab synchronization mechanisms are quite naive. Better to invoke the filters list in the same thread*/
                     meshDoc()->setBusy(true);
-                    cppfilt->applyFilter( filtnm, *meshDoc(), envwrap, QCallBack );
+                    ret = cppfilt->applyFilter( filtnm, *meshDoc(), envwrap, QCallBack );
                     meshDoc()->setBusy(false);
                     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
                     if ((currentViewContainer() != NULL) && (currentViewContainer()->sharedDataContext() != NULL))
@@ -1018,6 +1037,9 @@ void MainWindow::runFilterScript()
         qb->reset();
         GLA()->update();
         GLA()->Logf(GLLogStream::SYSTEM,"Re-Applied filter %s",qPrintable((*ii)->filterName()));
+        const int step = int(ii - meshDoc()->filterHistory->filtparlist.begin());
+        if (ret && (step < cacheKeys.size()))
+            cache.store(cacheKeys[step],*meshDoc());
     }
 }
 
@@ -1330,9 +1352,18 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
     // and statisfy them
     qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
     MainWindow::globalStatusBar()->showMessage("Starting Filter...",5000);
+    // the filters that support it can run on all the visible layers at the same time
+    QList<MeshModel*> layers;
+    if (!isPreview && applyToAllLayersAct->isChecked() && MLLayerRunner::canRun(iFilter,action))
+        layers = MLLayerRunner::visibleLayers(*meshDoc());
+    const bool allLayers = (layers.size() > 1);
+    // compact point clouds are expanded for the filters that need their vertices
+    QList<MeshModel*> expandedMeshes;
+    if (!iFilter->acceptsCompactMeshes(action))
+        expandedMeshes = meshDoc()->expandCompactMeshes(!allLayers && (iFilter->filterArity(action) == MeshFilterInterface::SINGLE_MESH));
     int req=iFilter->getRequirements(action);
     if (!meshDoc()->meshList.isEmpty())
-        meshDoc()->mm()->updateDataMask(req);
+        meshDoc()->mm()->updateDataMask(req,true);
     qApp->restoreOverrideCursor();
 
     // (3) save the current filter and its parameters in the history
@@ -1372,7 +1403,7 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
         atts[MLRenderingData::ATT_NAMES::ATT_VERTPOSITION] = true;
         atts[MLRenderingData::ATT_NAMES::ATT_VERTNORMAL] = true;
 
-        if (iFilter->filterArity(action) == MeshFilterInterface::SINGLE_MESH)
+        if (!allLayers && (iFilter->filterArity(action) == MeshFilterInterface::SINGLE_MESH))
         {
             MLRenderingData::PRIMITIVE_MODALITY pm = MLPoliciesStandAloneFunctions::bestPrimitiveModalityAccordingToMesh(meshDoc()->mm());
             if ((pm != MLRenderingData::PR_ARITY) && (meshDoc()->mm() != NULL))
@@ -1396,6 +1427,7 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
         }
     }
     bool newmeshcreated = false;
+    QStringList failedLayers;
     try
     {
         existingmeshesbeforefilterexecution.clear();
@@ -1404,7 +1436,24 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
             int dt = mm->dataMask();
             existingmeshesbeforefilterexecution.insert(mm->id(),MeshModelTmpData(mm->dataMask(),(size_t) mm->cm.VN(),(size_t) mm->cm.FN(),(size_t) mm->cm.EN()));
         }
-        ret=iFilter->applyFilter(action, *(meshDoc()), mergedenvironment, QCallBack);
+        // the expanded layers have no rendering buffers yet
+        foreach(MeshModel* mm, expandedMeshes)
+            existingmeshesbeforefilterexecution.find(mm->id())->_nvert = 0;
+        {
+            MLTraceSpan span(action->text(),"filter");
+            if (allLayers)
+                ret=MLLayerRunner::apply(iFilter,action,*(meshDoc()),layers,mergedenvironment,QCallBack,&failedLayers);
+            else
+                ret=iFilter->applyFilter(action, *(meshDoc()), mergedenvironment, QCallBack);
+            if (!allLayers && (meshDoc()->mm() != NULL))
+                span.setCounts(meshDoc()->mm()->cm.vn,meshDoc()->mm()->cm.fn);
+        }
+        // the adjacency cached by updateDataMask survives only the filters that do not touch the connectivity
+        int changedMask = ret ? iFilter->postCondition(action) : int(MeshModel::MM_UNKNOWN);
+        for(MeshModel* mm = meshDoc()->nextMesh();mm != NULL;mm=meshDoc()->nextMesh(mm))
+            mm->invalidateTopology(changedMask);
+        // the layers expanded for the filter go back to their compact form
+        meshDoc()->recompactMeshes(expandedMeshes);
         if (shar != NULL)
         {
             shar->removeView(iFilter->glContext);
@@ -1421,6 +1470,8 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
             meshDoc()->Log.Logf(GLLogStream::SYSTEM,"Applied filter %s in %i msec",qPrintable(action->text()),tt.elapsed());
             if (meshDoc()->mm() != NULL)
                 meshDoc()->mm()->meshModified() = true;
+            foreach(MeshModel* mm, layers)
+                mm->meshModified() = true;
             MainWindow::globalStatusBar()->showMessage("Filter successfully completed...",2000);
             if(GLA())
             {
@@ -1430,6 +1481,14 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
             lastFilterAct->setText(QString("Apply filter ") + action->text());
             lastFilterAct->setEnabled(true);
         }
+        else if (allLayers)
+        {
+            foreach(MeshModel* mm, layers)
+                mm->meshModified() = true;
+            QMessageBox::warning(this, tr("Filter Failure"), QString("Failure of filter <font color=red>: '%1'</font> on the layers:<br><br>").arg(action->text())+failedLayers.join("<br>")); // text
+            meshDoc()->Log.Log(GLLogStream::SYSTEM,qPrintable("Filter failed on the layers: " + failedLayers.join(", ")));
+            MainWindow::globalStatusBar()->showMessage("Filter failed...",2000);
+        }
         else // filter has failed. show the message error.
         {
             QMessageBox::warning(this, tr("Filter Failure"), QString("Failure of filter <font color=red>: '%1'</font><br><br>").arg(action->text())+iFilter->errorMsg()); // text
@@ -1444,7 +1503,10 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
         {
         case (MeshFilterInterface::SINGLE_MESH):
             {
-                tmp.push_back(meshDoc()->mm());
+                if (allLayers)
+                    tmp = layers;
+                else
+                    tmp.push_back(meshDoc()->mm());
                 break;
             }
         case (MeshFilterInterface::FIXED):
@@ -1481,6 +1543,10 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
             MeshModel* mm = tmp[jj];
             if (mm != NULL)
             {
+                // the layers touched by the filter have to be written again when the project is saved
+                if (ret)
+                    mm->meshModified() = true;
+
                 // at the end for filters that change the color, or selection set the appropriate rendering mode
                 if(iFilter->getClass(action) & MeshFilterInterface::FaceColoring ) 
                     mm->updateDataMask(MeshModel::MM_FACECOLOR);
@@ -1507,6 +1573,8 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
     }
     catch (std::bad_alloc& bdall)
     {
+        for(MeshModel* mm = meshDoc()->nextMesh();mm != NULL;mm=meshDoc()->nextMesh(mm))
+            mm->invalidateTopology();
         meshDoc()->setBusy(false);
         qApp->restoreOverrideCursor();
         QMessageBox::warning(this, tr("Filter Failure"), QString("Operating system was not able to allocate the requested memory.<br><b>Failure of filter <font color=red>: '%1'</font><br>We warmly suggest you to try a 64-bit version of MeshLab.<br>").arg(action->text())+bdall.what()); // text
@@ -1661,6 +1729,7 @@ void MainWindow::executeFilter(MeshLabXMLFilterContainer* mfc,const QMap<QString
     qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
     MainWindow::globalStatusBar()->showMessage("Starting Filter...",5000);
     //int req=iFilter->getRequirements(action);
+    expandedmeshesbeforefilterexecution = meshDoc()->expandCompactMeshes();
     meshDoc()->mm()->updateDataMask(postCondMask);
     qApp->restoreOverrideCursor();
 
@@ -1717,6 +1786,9 @@ void MainWindow::executeFilter(MeshLabXMLFilterContainer* mfc,const QMap<QString
         existingmeshesbeforefilterexecution.clear();
         for(MeshModel* mm = meshDoc()->nextMesh();mm != NULL;mm=meshDoc()->nextMesh(mm))
             existingmeshesbeforefilterexecution.insert(mm->id(),MeshModelTmpData(mm->dataMask(),(size_t) mm->cm.VN(),(size_t) mm->cm.FN(),(size_t) mm->cm.EN()));
+        // the expanded layers have no rendering buffers yet
+        foreach(MeshModel* mm, expandedmeshesbeforefilterexecution)
+            existingmeshesbeforefilterexecution.find(mm->id())->_nvert = 0;
         if (filtercpp)
         {
             enableDocumentSensibleActionsContainer(false);
@@ -1763,6 +1835,9 @@ void MainWindow::postFilterExecution()
     //foreach(QAction* act,filterMenu->actions())
     //    act->setEnabled(true);
     enableDocumentSensibleActionsContainer(true);
+    // the layers expanded for the filter go back to their compact form
+    meshDoc()->recompactMeshes(expandedmeshesbeforefilterexecution);
+    expandedmeshesbeforefilterexecution.clear();
 
     FilterThread* obj = qobject_cast<FilterThread*>(QObject::sender());
     if (obj == NULL)
@@ -1776,12 +1851,16 @@ void MainWindow::postFilterExecution()
     QStringList filterClassesList = filterClasses.split(QRegExp("\\W+"), QString::SkipEmptyParts);
     int fclasses =	MeshLabFilterInterface::convertStringListToCategoryEnum(filterClassesList);
     bool newmeshcreated = false;
+    QString postCond = mfc->xmlInfo->filterAttribute(fname,MLXMLElNames::filterPostCond);
+    QStringList postCondList = postCond.split(QRegExp("\\W+"), QString::SkipEmptyParts);
+    int postCondMask = MeshLabFilterInterface::convertStringListToMeshElementEnum(postCondList);
+    // xml filters without a declared post condition can have changed anything
+    int changedMask = (obj->succeed() && (postCondMask != MeshModel::MM_NONE)) ? postCondMask : int(MeshModel::MM_UNKNOWN);
+    for(MeshModel* mm = meshDoc()->nextMesh();mm != NULL;mm=meshDoc()->nextMesh(mm))
+        mm->invalidateTopology(changedMask);
     if (mfc->filterInterface != NULL)
     {
         mfc->filterInterface->setInterrupt(false);
-        QString postCond = mfc->xmlInfo->filterAttribute(fname,MLXMLElNames::filterPostCond);
-        QStringList postCondList = postCond.split(QRegExp("\\W+"), QString::SkipEmptyParts);
-        int postCondMask = MeshLabFilterInterface::convertStringListToMeshElementEnum(postCondList);
         updateSharedContextDataAfterFilterExecution(postCondMask,fclasses,newmeshcreated);
         MultiViewer_Container* mvc = currentViewContainer();
         if(mvc)
@@ -1796,6 +1875,9 @@ void MainWindow::postFilterExecution()
 
     if(obj->succeed())
     {
+        // a script filter can touch any layer
+        for(MeshModel* mm = meshDoc()->nextMesh();mm != NULL;mm=meshDoc()->nextMesh(mm))
+            mm->meshModified() = true;
         meshDoc()->Log.Logf(GLLogStream::SYSTEM,"Applied filter %s in %i msec\n",qPrintable(fname),xmlfiltertimer.elapsed());
         MainWindow::globalStatusBar()->showMessage("Filter successfully completed...",2000);
         if(GLA())
@@ -2078,6 +2160,16 @@ void MainWindow::saveProject()
         path.truncate(path.lastIndexOf("/"));
         lastUsedDirectory.setPath(path);
     }
+    // the layers are written before the project file, so that it never refers to partially written meshes
+    if (saveAllFile->isChecked())
+    {
+        QStringList errors;
+        if (!saveLayers(onlyVisibleLayers->isChecked(),errors))
+        {
+            QMessageBox::critical(this, tr("Meshlab Saving Error"), QString("Unable to save the layers of project %1, the project file has not been written.\n\n%2").arg(fileName).arg(errors.join("\n")));
+            return;
+        }
+    }
     if (QString(fi.suffix()).toLower() == "aln")
     {
         vector<string> meshNameVector;
@@ -2096,19 +2188,61 @@ void MainWindow::saveProject()
     else
         ret = MeshDocumentToXMLFile(*meshDoc(),fileName,onlyVisibleLayers->isChecked());
 
-    if (saveAllFile->isChecked())
+    if(!ret)
+        QMessageBox::critical(this, tr("Meshlab Saving Error"), QString("Unable to save project file %1\n").arg(fileName));
+}
+
+bool MainWindow::saveLayers(const bool onlyVisible,QStringList& errors)
+{
+    MLLayerSaver saver;
+    foreach(MeshModel * mp, meshDoc()->meshList)
     {
-        for(int ii = 0; ii < meshDoc()->meshList.size();++ii)
+        if ((onlyVisible && !mp->visible) || !MLLayerSaver::needsSave(*mp,mp->fullName()))
+            continue;
+        QString extension = QFileInfo(mp->fullName()).suffix().toLower();
+        MeshIOInterface *pCurrentIOPlugin = PM.allKnowOutputFormats[extension];
+        if (pCurrentIOPlugin == 0)
         {
-            MeshModel* mp = meshDoc()->meshList[ii];
-            if((!onlyVisibleLayers->isChecked()) || (mp->visible))
-            {
-                ret |= exportMesh(mp->fullName(),mp,true);
-            }
+            errors.push_back(mp->label() + ": file extension not supported");
+            continue;
         }
+        pCurrentIOPlugin->setLog(&meshDoc()->Log);
+
+        int capability=0,defaultBits=0;
+        pCurrentIOPlugin->GetExportMaskCapability(extension,capability,defaultBits);
+        RichParameterSet savePar;
+        pCurrentIOPlugin->initSaveParameter(extension,*mp,savePar);
+
+        // as in exportMesh with saveAllPossibleAttributes
+        SaveMaskExporterDialog maskDialog(new QWidget(),mp,capability,defaultBits,&savePar,this->GLA());
+        maskDialog.SlotSelectionAllButton();
+        maskDialog.updateMask();
+        int mask = maskDialog.GetNewMask();
+        if (mask == -1)
+        {
+            errors.push_back(mp->label() + ": no attribute to save");
+            continue;
+        }
+        saver.add(mp,pCurrentIOPlugin,extension,mp->fullName(),mask,savePar);
     }
-    if(!ret)
-        QMessageBox::critical(this, tr("Meshlab Saving Error"), QString("Unable to save project file %1\n").arg(fileName));
+    if (!errors.isEmpty())
+        return false;
+    if (saver.size() == 0)
+        return true;
+
+    qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
+    qb->show();
+    QTime tt; tt.start();
+    bool ret = saver.run(QCallBack);
+    qb->reset();
+    qApp->restoreOverrideCursor();
+    GLA()->Logf(GLLogStream::SYSTEM,"Saved %i layers in %i msec",saver.size(),tt.elapsed());
+
+    QSettings settings;
+    int savedMeshCounter=settings.value("savedMeshCounter",0).toInt();
+    settings.setValue("savedMeshCounter",savedMeshCounter+saver.size()-saver.errors().size());
+    errors += saver.errors();
+    return ret;
 }
 
 bool MainWindow::openProject(QString fileName)
@@ -2494,7 +2628,13 @@ bool MainWindow::loadMesh(const QString& fileName, MeshIOInterface *pCurrentIOPl
     }
     meshDoc()->setBusy(true);
     pCurrentIOPlugin->setLog(&meshDoc()->Log);
-    if (!pCurrentIOPlugin->open(extension, fileName, *mm ,mask,*prePar,QCallBack,this /*gla*/))
+    bool opened = false;
+    {
+        MLTraceSpan span("Open " + fi.fileName(),"io");
+        opened = pCurrentIOPlugin->open(extension, fileName, *mm ,mask,*prePar,QCallBack,this /*gla*/);
+        span.setCounts(mm->cm.vn,mm->cm.fn);
+    }
+    if (!opened)
     {
         QMessageBox::warning(this, tr("Opening Failure"), QString("While opening: '%1'\n\n").arg(fileName)+pCurrentIOPlugin->errorMsg()); // text+
         pCurrentIOPlugin->clearErrorString();
@@ -2532,15 +2672,18 @@ bool MainWindow::loadMesh(const QString& fileName, MeshIOInterface *pCurrentIOPl
         mm->updateDataMask(MeshModel::MM_FACEFACETOPO);
         vcg::tri::UpdateNormal<CMeshO>::PerBitQuadFaceNormalized(mm->cm);
         vcg::tri::UpdateNormal<CMeshO>::PerVertexFromCurrentFaceNormal(mm->cm);
+        vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);					// updates bounding box
     } // standard case
     else
     {
-        vcg::tri::UpdateNormal<CMeshO>::PerFaceNormalized(mm->cm);
         if(!( mask & vcg::tri::io::Mask::IOM_VERTNORMAL) )
-            vcg::tri::UpdateNormal<CMeshO>::PerVertexAngleWeighted(mm->cm);
+            mm->UpdateBoxAndNormals();
+        else
+        {
+            vcg::tri::UpdateNormal<CMeshO>::PerFaceNormalized(mm->cm);
+            vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);
+        }
     }
-
-    vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);					// updates bounding box
     if(mm->cm.fn==0 && mm->cm.en==0)
     {
         if(mask & vcg::tri::io::Mask::IOM_VERTNORMAL)
@@ -2880,7 +3023,19 @@ bool MainWindow::exportMesh(QString fileName,MeshModel* mod,const bool saveAllPo
         qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
         qb->show();
         QTime tt; tt.start();
-        ret = pCurrentIOPlugin->save(extension, fileName, *mod ,mask,savePar,QCallBack,this);
+        {
+            MLTraceSpan span("Save " + QFileInfo(fileName).fileName(),"io",mod->cm.vn,mod->cm.fn);
+            if (mod->isCompact())
+            {
+                // compact point clouds are saved from a temporary copy, the layer stays compact
+                MeshModel expanded(meshDoc(),mod->fullName(),mod->label());
+                mod->expandTo(expanded);
+                span.setCounts(expanded.cm.vn,0);
+                ret = pCurrentIOPlugin->save(extension, fileName, expanded ,mask,savePar,QCallBack,this);
+            }
+            else
+                ret = pCurrentIOPlugin->save(extension, fileName, *mod ,mask,savePar,QCallBack,this);
+        }
         qb->reset();
         GLA()->Logf(GLLogStream::SYSTEM,"Saved Mesh %s in %i msec",qPrintable(fileName),tt.elapsed());
 
@@ -3008,6 +3163,22 @@ void MainWindow::setCustomize()
     dialog.exec();
 }
 
+void MainWindow::recordTrace(bool on)
+{
+    MLTracer::setEnabled(on);
+}
+
+void MainWindow::saveTrace()
+{
+    QString fileName = QFileDialog::getSaveFileName(this,tr("Save Trace"),lastUsedDirectory.path(),tr("Chrome Trace (*.json)"));
+    if (fileName.isEmpty())
+        return;
+    if (!fileName.endsWith(".json",Qt::CaseInsensitive))
+        fileName += ".json";
+    if (!MLTracer::instance().saveChromeTrace(fileName))
+        QMessageBox::warning(this,tr("Saving Trace"),tr("Unable to save the trace in '%1'").arg(fileName));
+}
+
 void MainWindow::fullScreen(){
     if(!isFullScreen())
     {
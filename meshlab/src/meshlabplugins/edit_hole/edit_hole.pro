@@ -1,4 +1,5 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       = edit_hole_factory.h \
 		    edit_hole.h \
@@ -6,7 +7,7 @@ HEADERS       = edit_hole_factory.h \
 		    holeListModel.h \
 		    fgtHole.h \
         fgtBridge.h \
-		    holeSetManager.h 
+		    holeSetManager.h
 
 SOURCES       = edit_hole_factory.cpp \
         edit_hole.cpp \
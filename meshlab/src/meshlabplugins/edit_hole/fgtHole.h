@@ -36,6 +36,7 @@
 #include <vcg/complex/algorithms/closest.h>
 #include <vcg/space/index/grid_static_ptr.h>
 #include "vcg/space/color4.h"
+#include <common/ml_hole_filling.h>
 #include "holeSetManager.h"
 
 /** An hole type, extends vcg::tri::Hole<MESH>::Info adding more information
@@ -97,7 +98,7 @@ public:
 	typedef typename HoleVector::iterator									HoleIterator;
 	typedef typename vcg::tri::TrivialEar<MESH>						TrivialEar;
 	typedef typename vcg::tri::MinimumWeightEar<MESH>			MinimumWeightEar;
-	typedef typename vcg::tri::SelfIntersectionEar<MESH>	SelfIntersectionEar;
+	typedef RingSelfIntersectionEar<MESH>									SelfIntersectionEar;
 
 	FgtHole(HoleInfo &hi, QString holeName, HoleSetManager<MESH> *parent) :
 		HoleInfo(hi.p, hi.size, hi.bb)
@@ -264,51 +265,41 @@ public:
 
 	void Fill(FillerMode mode, MESH &mesh, std::vector<FacePointer * > &local_facePointer)
 	{
-		assert(!IsFilled());
-		assert(this->p.IsBorder());
+		std::vector<FgtHole<MESH>*> single(1, this);
+		FillHoles(mode, mesh, single, local_facePointer);
+	}
+
+	/*  Fill several holes at once: the ones which don't share vertexes with others
+	 *  are filled in parallel (see HoleFilling), the result is the same of filling
+	 *  them one at a time in order.
+	 */
+	static void FillHoles(FillerMode mode, MESH &mesh, std::vector<FgtHole<MESH>*> &toFill,
+			std::vector<FacePointer * > &local_facePointer)
+	{
+		std::vector<HoleInfo> vinfo;
+		typename std::vector<FgtHole<MESH>*>::iterator hit;
+		for(hit = toFill.begin(); hit != toFill.end(); ++hit)
+		{
+			assert(!(*hit)->IsFilled());
+			assert((*hit)->p.IsBorder());
+			vinfo.push_back( HoleInfo((*hit)->p, (*hit)->size, (*hit)->bb) );
+		}
+
 		switch(mode)
 		{
 		case FgtHole<MESH>::Trivial:
-				vcgHole::template FillHoleEar< TrivialEar >(mesh, *this, local_facePointer);
+				HoleFilling<MESH>::template FillHoles< TrivialEar >(mesh, vinfo, local_facePointer);
 			break;
 		case FgtHole<MESH>::MinimumWeight:
-				vcgHole::template FillHoleEar< MinimumWeightEar >(mesh, *this, local_facePointer);
+				HoleFilling<MESH>::template FillHoles< MinimumWeightEar >(mesh, vinfo, local_facePointer);
 			break;
 		case FgtHole<MESH>::SelfIntersection:
-				std::vector<FacePointer * > vfp = local_facePointer;
-				SelfIntersectionEar::AdjacencyRing().clear();
-				PosType ip = this->p;
-				do
-				{
-					PosType inp = ip;
-					do
-					{
-						inp.FlipE();
-						inp.FlipF();
-						SelfIntersectionEar::AdjacencyRing().push_back(inp.f);
-					} while(!inp.IsBorder());
-					ip.NextB();
-				}while(ip != this->p);
-
-				typename std::vector<FacePointer>::iterator fpi = SelfIntersectionEar::AdjacencyRing().begin();
-        for( ; fpi != SelfIntersectionEar::AdjacencyRing().end(); ++fpi)
-					vfp.push_back( &*fpi );
-
-				vcgHole::template FillHoleEar< SelfIntersectionEar >(mesh, *this, vfp);
-				SelfIntersectionEar::AdjacencyRing().clear();
+				HoleFilling<MESH>::template FillHoles< SelfIntersectionEar >(mesh, vinfo, local_facePointer);
 			break;
 		}
 
-		// hole filling leaves V flag to border vertex... resetting!
-		typename PosVector::const_iterator it = borderPos.begin();
-		for( ;it!=borderPos.end(); it++)
-				it->v->ClearV();
-
-		parentManager->faceAttr->UpdateSize();
-
-		_state |= FILLED;
-		_state |= ACCEPTED;
-		_state &= (~COMPENET);
+		for(hit = toFill.begin(); hit != toFill.end(); ++hit)
+			(*hit)->setFilled();
 	}
 
 	/* Check if face is a border face of this hole */
@@ -374,6 +365,20 @@ public:
 
 private:
 
+	void setFilled()
+	{
+		// hole filling leaves V flag to border vertex... resetting!
+		typename PosVector::const_iterator it = borderPos.begin();
+		for( ;it!=borderPos.end(); it++)
+				it->v->ClearV();
+
+		parentManager->faceAttr->UpdateSize();
+
+		_state |= FILLED;
+		_state |= ACCEPTED;
+		_state &= (~COMPENET);
+	}
+
 	/*  Walking the hole computing vcgHole::Info data and other info */
 	void updateInfo()
 	{
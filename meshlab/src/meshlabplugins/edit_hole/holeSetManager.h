@@ -122,17 +122,12 @@ public:
 		std::vector<FacePointer *> local_facePointer;
 		AddFaceReference(local_facePointer);
 
+		std::vector<HoleType*> selected;
 		HoleIterator hit = holes.begin();
 		for( ; hit != holes.end(); hit++ )
 			if( hit->IsSelected() )
-			{
-				hit->Fill(mode, *mesh, local_facePointer);
-
-				// there are new face reference to update in next filling
-				typename std::vector<FacePointer>::iterator fit;
-				for(fit=hit->patches.begin(); fit!=hit->patches.end(); fit++)
-					local_facePointer.push_back(&*fit);	
-			}
+				selected.push_back(&*hit);
+		HoleType::FillHoles(mode, *mesh, selected, local_facePointer);
 
 		nAccepted=nSelected;
 		return true;
@@ -361,7 +356,7 @@ private:
 		std::vector<HoleInfo> vhi;
 
 		//prendo la lista di info(sugli hole) tutte le facce anche le non selezionate
-		vcgHole::GetInfo(*mesh, false, vhi);
+		HoleFilling<MESH>::GetInfo(*mesh, false, vhi);
 		HoleType::ResetHoleId();
 		typename std::vector<HoleInfo>::iterator itH = vhi.begin();
 		for( ; itH != vhi.end(); itH++)
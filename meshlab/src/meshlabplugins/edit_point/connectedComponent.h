@@ -3,7 +3,7 @@
 
 #include <QTime>
 
-#include "knnGraph.h"
+#include <common/ml_knn_graph.h>
 
 #include <vector>
 #include <stack>
@@ -101,27 +101,19 @@ public:
 /** This function is used to calculate the minimum distances between one point (v) and all the others
   * in the mesh. We use the Dijkstra algorithm with one change: only arcs with a cost less or equal
   * of maxHopDist will be taken into account.
-  * In the first call of this method, when neither DistParam or KNNGraph are present, we create these
-  * attributes and we construct the KNNGraph.
+  * The arcs are the ones of the k-nearest neighbours graph, built in the first call and then
+  * shared with the other users of MLKnnGraph until the points change.
   * The notReachableVect is returned in order to calculate the border in other methods.
   **/
 
 static void Dijkstra(_MyMeshType& m, VertexType& v, int numOfNeighbours, float maxHopDist, std::vector<VertexType*> &notReachableVect)
 {
-    bool hasKNNGraph = tri::HasPerVertexAttribute(m, "KNNGraph");
-    bool hasDistParam = tri::HasPerVertexAttribute(m, "DistParam");
-
     notReachableVect.clear();
 
     typename _MyMeshType::template PerVertexAttributeHandle<float> distFromCenter = vcg::tri::Allocator<_MyMeshType>::template GetPerVertexAttribute<float>(m, std::string("DistParam"));
 
-    if (!hasKNNGraph) {
-        KNNGraph<_MyMeshType>::MakeKNNTree(m, numOfNeighbours);
-    }
-
-    typename _MyMeshType::template PerVertexAttributeHandle<std::vector<VertexType*>* > neighboursVect = tri::Allocator<_MyMeshType>::template GetPerVertexAttribute<std::vector<VertexType*>* >(m,"KNNGraph");
-
-    typename std::vector<VertexType*>::iterator it;
+    const MLKnnGraph &knnGraph = MLKnnGraph::get(m, numOfNeighbours);
+    const int neighbourNum = std::min(numOfNeighbours, knnGraph.k());
 
     // For Dijkstra algorithm we use a Priority Queue
     typedef std::priority_queue<VertexType*, std::vector<VertexType*>, Compare > VertPriorityQueue;
@@ -142,21 +134,23 @@ static void Dijkstra(_MyMeshType& m, VertexType& v, int numOfNeighbours, float m
          VertexType* element = prQueue.top();
         prQueue.pop();
 
-        for (it = neighboursVect[element]->begin(); it != neighboursVect[element]->end(); it++) 
+        const int *neighbours = knnGraph.neighbors(int(tri::Index(m, element)));
+        for (int j = 0; j < neighbourNum; ++j)
 		{
+			VertexType *nv = &m.vert[neighbours[j]];
 			//I have not to compute the arches connecting vertices already visited.
-			if (!(*it)->IsV())
+			if (!nv->IsV())
 			{
-				float distance = vcg::Distance((*it)->P(), element->P());
+				float distance = vcg::Distance(nv->P(), element->P());
 
 				// we take into account only the arcs with a distance less or equal to maxHopDist
 				if (distance <= maxHopDist) 
 				{
-					if ((distFromCenter[*element] + distance) < distFromCenter[*it])
+					if ((distFromCenter[*element] + distance) < distFromCenter[*nv])
 					{
-						distFromCenter[*it] = distFromCenter[*element] + distance;
-						prQueue.push(*it);
-						(*it)->SetV();
+						distFromCenter[*nv] = distFromCenter[*element] + distance;
+						prQueue.push(nv);
+						nv->SetV();
 					}
 				}
 				// all the other are the notReachable arcs
@@ -173,7 +167,7 @@ static void Dijkstra(_MyMeshType& m, VertexType& v, int numOfNeighbours, float m
 
 static void DeletePerVertexAttribute(_MyMeshType& m)
 {
-    KNNGraph<_MyMeshType>::DeleteKNNTree(m);
+    MLKnnGraph::invalidate(m);
 
     bool hasDistParam = tri::HasPerVertexAttribute(m, "DistParam");
     if (hasDistParam) {
@@ -4,8 +4,7 @@ include (../../shared.pri)
 HEADERS       = \
                 edit_point.h \
                 edit_point_factory.h \
-                connectedComponent.h \
-                knnGraph.h
+                connectedComponent.h
 				 
 SOURCES       = \
                 edit_point.cpp \
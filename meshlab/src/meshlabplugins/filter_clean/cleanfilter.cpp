@@ -28,6 +28,7 @@
 
 #include "cleanfilter.h"
 #include "align_tools.h"
+#include <common/ml_vertex_weld.h>
 
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/create/platonic.h>
@@ -299,8 +300,9 @@ bool CleanFilter::applyFilter(QAction *filter, MeshDocument &md, RichParameterSe
    case FP_MERGE_CLOSE_VERTEX :
     {
         float threshold = par.getAbsPerc("Threshold");
-        int total = tri::Clean<CMeshO>::MergeCloseVertex(m.cm, threshold);
-        Log("Successfully merged %d vertices", total);
+        int vn0 = m.cm.vn, fn0 = m.cm.fn;
+        int total = VertexWeld<CMeshO>::MergeCloseVertex(m.cm, threshold);
+        Log("Successfully merged %d vertices (%d vertices and %d degenerate faces removed)", total, vn0 - m.cm.vn, fn0 - m.cm.fn);
     }
     break;
   case FP_REMOVE_DUPLICATE_FACE :
@@ -0,0 +1,172 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef DISCRETE_CURVATURE_H
+#define DISCRETE_CURVATURE_H
+
+#include <vcg/complex/complex.h>
+#include <vcg/simplex/face/pos.h>
+#include <vcg/simplex/face/topology.h>
+
+/*
+Parallel version of tri::UpdateCurvature::MeanAndGaussian (Meyer, Desbrun et al.
+"Discrete Differential-Geometry Operators for Triangulated 2-Manifolds").
+
+A first pass over the faces computes the three angles of every face once. A second
+pass over the vertices gathers, through the VF adjacency, the mixed voronoi area,
+the laplacian contribution, the angle sum and the normal of each vertex, and sets
+normals, Kh, Kg and, optionally, the quality with one of the derived curvatures.
+Every vertex is written by one thread only, so the passes need no per thread buffers
+and stay parallel whatever the order of the faces.
+
+The formulas are those of MeanAndGaussian, border vertices included: as there, the
+angle between the two border edges of the vertex (found with Pos::NextB) is removed
+from 2*pi together with the face angles. The output is the same up to rounding, as
+the sums run in ScalarType in the order of the VF lists, with one exception: faces
+with a zero angle are skipped for the laplacian and the angle sum, while
+MeanAndGaussian tests the second angle twice and misses the faces whose third one is
+zero.
+
+Requires VF adjacency, FF adjacency (for the border angles) and per vertex curvature.
+*/
+template <class MeshType>
+class DiscreteCurvature
+{
+public:
+    typedef typename MeshType::ScalarType ScalarType;
+    typedef typename MeshType::CoordType CoordType;
+    typedef typename MeshType::VertexType VertexType;
+    typedef typename MeshType::FaceType FaceType;
+
+    enum CurvatureType { NoCurv=-1, MeanCurv=0, GaussianCurv=1, RMSCurv=2, AbsCurv=3 };
+
+    // Computes per vertex normalized normals, Kh and Kg and, if required,
+    // copies the chosen curvature into the per vertex quality.
+    static void Compute(MeshType &m, CurvatureType qualityType=NoCurv)
+    {
+        const int vertNum = int(m.vert.size());
+        const int faceNum = int(m.face.size());
+
+        // angles[i][j] is the angle of the face i at its vertex j
+        std::vector<CoordType> angles(faceNum);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < faceNum; ++i)
+        {
+            const FaceType &f = m.face[i];
+            if (f.IsD()) continue;
+            angles[i][0] = vcg::math::Abs(vcg::Angle(f.cP(1) - f.cP(0), f.cP(2) - f.cP(0)));
+            angles[i][1] = vcg::math::Abs(vcg::Angle(f.cP(0) - f.cP(1), f.cP(2) - f.cP(1)));
+            angles[i][2] = ScalarType(M_PI) - (angles[i][0] + angles[i][1]);
+        }
+
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic, 1024)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            VertexType &v = m.vert[i];
+            if (v.IsD()) continue;
+
+            Accum a;
+            for (vcg::face::VFIterator<FaceType> vfi(&v); !vfi.End(); ++vfi)
+                AccumulateWedge(*vfi.F(), vfi.I(), angles[vcg::tri::Index(m, vfi.F())], a);
+
+            v.N() = a.norm;
+            v.N().Normalize();
+            if (a.area <= std::numeric_limits<ScalarType>::epsilon())
+            {
+                v.Kh() = 0;
+                v.Kg() = 0;
+            }
+            else
+            {
+                v.Kh() = ((a.contr.dot(v.cN()) > 0) ? 1.0 : -1.0) * (a.contr / a.area).Norm();
+                v.Kg() = (ScalarType(2.0 * M_PI) - a.angle) / a.area;
+            }
+
+            switch (qualityType)
+            {
+            case MeanCurv:     v.Q() = v.Kh(); break;
+            case GaussianCurv: v.Q() = v.Kg(); break;
+            case RMSCurv:      v.Q() = vcg::math::Sqrt(vcg::math::Abs(4 * v.Kh() * v.Kh() - 2 * v.Kg())); break;
+            case AbsCurv:
+                if (v.Kg() >= 0) v.Q() = vcg::math::Abs(2 * v.Kh());
+                else             v.Q() = 2 * vcg::math::Sqrt(vcg::math::Abs(v.Kh() * v.Kh() - v.Kg()));
+                break;
+            default: break;
+            }
+        }
+    }
+
+private:
+    // Per vertex sums
+    struct Accum
+    {
+        ScalarType area;   // mixed voronoi area
+        ScalarType angle;  // sum of the incident angles (border angles included)
+        CoordType contr;   // mean curvature normal times area
+        CoordType norm;    // area weighted normal
+
+        Accum() : area(0), angle(0), contr(0, 0, 0), norm(0, 0, 0) {}
+    };
+
+    // Adds to a the contribution of the face f to its vertex z, given the angles of f
+    static void AccumulateWedge(FaceType &f, int z, const CoordType &angle, Accum &a)
+    {
+        const int z1 = (z + 1) % 3;
+        const int z2 = (z + 2) % 3;
+        const CoordType &p = f.cP(z);
+
+        a.norm += vcg::TriangleNormal(f);
+
+        // mixed voronoi area
+        if ((angle[0] < M_PI / 2) && (angle[1] < M_PI / 2) && (angle[2] < M_PI / 2))
+            a.area += (vcg::SquaredDistance(f.cP(z2), p) / tan(angle[z1]) +
+                       vcg::SquaredDistance(f.cP(z1), p) / tan(angle[z2])) / 8.0;
+        else // obtuse triangle: half of the area goes to the obtuse vertex
+            a.area += vcg::DoubleArea(f) / ((angle[z] >= M_PI / 2) ? 4.0 : 8.0);
+
+        // skip degenerate triangles
+        if (angle[0] == 0 || angle[1] == 0 || angle[2] == 0) return;
+
+        a.contr += ((p - f.cP(z2)) / tan(angle[z1]) - (f.cP(z1) - p) / tan(angle[z2])) / 4.0;
+        a.angle += angle[z];
+
+        // on the border the angle between the two border edges is also removed
+        if (vcg::face::IsBorder(f, z))
+        {
+            vcg::face::Pos<FaceType> hp(&f, z, f.V(z));
+            vcg::face::Pos<FaceType> hp1 = hp;
+            hp1.FlipV();
+            const CoordType e1 = hp1.v->cP() - hp.v->cP();
+            hp1.FlipV();
+            hp1.NextB();
+            const CoordType e2 = hp1.v->cP() - hp.v->cP();
+            a.angle += vcg::math::Abs(vcg::Angle(e1, e2));
+        }
+    }
+};
+
+#endif // DISCRETE_CURVATURE_H
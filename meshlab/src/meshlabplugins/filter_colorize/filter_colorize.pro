@@ -1,6 +1,8 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
-HEADERS       += meshcolorize.h 
+HEADERS       += meshcolorize.h \
+                 discrete_curvature.h
 SOURCES       += meshcolorize.cpp 
 
 TARGET        = filter_colorize
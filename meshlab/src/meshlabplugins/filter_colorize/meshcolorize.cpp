@@ -21,7 +21,9 @@
 *                                                                           *
 ****************************************************************************/
 
+#include <QTime>
 #include "meshcolorize.h"
+#include "discrete_curvature.h"
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/stat.h>
 #include <vcg/complex/algorithms/smooth.h>
@@ -259,16 +261,22 @@ bool ExtraMeshColorizePlugin::applyFilter(QAction *filter, MeshDocument &md, Ric
             int delvert=tri::Clean<CMeshO>::RemoveUnreferencedVertex(m.cm);
             if(delvert) Log("Pre-Curvature Cleaning: Removed %d unreferenced vertices",delvert);
             tri::Allocator<CMeshO>::CompactVertexVector(m.cm);
-            tri::UpdateCurvature<CMeshO>::MeanAndGaussian(m.cm);
+            m.updateDataMask(MeshModel::MM_VERTFACETOPO);
             int curvType = par.getEnum("CurvatureType");
+            assert(curvType>=0 && curvType<=3);
+
+            // Kh, Kg and the chosen curvature as quality in a single parallel pass
+            QTime tt; tt.start();
+            DiscreteCurvature<CMeshO>::Compute(m.cm, DiscreteCurvature<CMeshO>::CurvatureType(curvType));
 
             switch(curvType){
-            case 0: tri::UpdateQuality<CMeshO>::VertexFromMeanCurvatureHG(m.cm);        Log( "Computed Mean Curvature");      break;
-            case 1: tri::UpdateQuality<CMeshO>::VertexFromGaussianCurvatureHG(m.cm);    Log( "Computed Gaussian Curvature"); break;
-            case 2: tri::UpdateQuality<CMeshO>::VertexFromRMSCurvature(m.cm);         Log( "Computed RMS Curvature"); break;
-            case 3: tri::UpdateQuality<CMeshO>::VertexFromAbsoluteCurvature(m.cm);    Log( "Computed ABS Curvature"); break;
+            case 0: Log( "Computed Mean Curvature");      break;
+            case 1: Log( "Computed Gaussian Curvature"); break;
+            case 2: Log( "Computed RMS Curvature"); break;
+            case 3: Log( "Computed ABS Curvature"); break;
             default : assert(0);
             }
+            Log( "Curvature of %i vertices computed in %i msec",m.cm.vn,tt.elapsed());
 
             Histogramf H;
             tri::Stat<CMeshO>::ComputePerVertexQualityHistogram(m.cm,H);
@@ -401,8 +401,13 @@ public:
     {
 
 
-        //Ord_HVert[index]
-        for (unsigned int i=0;i<HRES_meshes.size();i++)
+        ///each sub mesh is a copy of a disjoint part of the high resolution mesh
+        ///(half stars, half diamonds or faces), so they are optimized concurrently
+        const int n=HRES_meshes.size();
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic)
+#endif
+        for (int i=0;i<n;i++)
         {
 
             MeshType *currMesh=HRES_meshes[i];
@@ -618,6 +623,14 @@ public:
         (*cb)(percent,ret);
     }
 
+    void PrintStage(const char *stage)
+    {
+        int percent=std::min(100,(step*100)/6);
+        char ret[200];
+        sprintf(ret," PERFORM GLOBAL OPTIMIZATION  step %d: optimized %s ",step,stage);
+        (*cb)(percent,ret);
+    }
+
     void Optimize(ScalarType gap=0.5,int max_step=10)
     {
         int k=0;
@@ -639,12 +652,15 @@ public:
 
             InitStarSubdivision();
             MinimizeStep(0);
+            PrintStage("stars");
 
             InitDiamondSubdivision();
             MinimizeStep(1);
+            PrintStage("diamonds");
 
             InitFaceSubdivision();
             MinimizeStep(2);
+            PrintStage("faces");
             step++;
             PrintAttributes();
 
@@ -1,4 +1,5 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += ./diamond_sampler.h \
         ./diam_parametrization.h \
@@ -26,24 +27,6 @@ TARGET        = filter_isoparametrization
 INCLUDEPATH  += ./  \
                 ../../external/levmar-2.3/
 
-win32-msvc2005:QMAKE_CXXFLAGS   +=  /openmp -D_USE_OMP
-win32-msvc2008:QMAKE_CXXFLAGS   +=  /openmp -D_USE_OMP
-win32-msvc2010:QMAKE_CXXFLAGS   +=  /openmp -D_USE_OMP
-win32-msvc2012:QMAKE_CXXFLAGS   +=  /openmp -D_USE_OMP
-#win32-g++:QMAKE_CXXFLAGS   +=  -fopenmp -D_USE_OMP
-win32-g++:QMAKE_LFLAGS += -fopenmp
-#linux-g++:QMAKE_CXXFLAGS   +=  -fopenmp -D_USE_OMP
-#linux-g++-32:QMAKE_CXXFLAGS   +=  -fopenmp -D_USE_OMP
-linux-g++-64:QMAKE_CXXFLAGS   +=  -fopenmp -D_USE_OMP
-
-
-#macx:QMAKE_CXX = g++
-macx: {
-  contains(QMAKE_CXX,g++-mp-4.8) {
-macx:QMAKE_CXXFLAGS += -fopenmp -D_USE_OMP
-macx:QMAKE_LFLAGS += -fopenmp
-  }
-}
 win32-msvc.net:LIBS	+= ../../external/lib/win32-msvc.net/levmar.lib
 win32-msvc2005:LIBS	+= ../../external/lib/win32-msvc2005/levmar.lib
 win32-msvc2008:LIBS	+= ../../external/lib/win32-msvc2008/levmar.lib
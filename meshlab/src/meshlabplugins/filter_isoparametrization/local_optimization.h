@@ -345,4 +345,43 @@ bool SmartOptimizeStar(typename MeshType::VertexType *center,MeshType &base_doma
 		OptimizeStar<MeshType>(center,base_domain,accuracy,En);
 	return true;
 }
+///split a list of star centers into groups of independent stars (no two centers
+///of a group share a face) so that the stars of a group touch disjoint patches
+///and can be optimized concurrently; the original order is kept inside each group
+///and the groups are filled greedily in that order. Requires VF topology.
+template <class MeshType>
+void IndependentStarSets(MeshType &domain,
+                         const std::vector<typename MeshType::VertexType*> &centers,
+                         std::vector<std::vector<typename MeshType::VertexType*> > &sets)
+{
+	typedef typename MeshType::VertexType VertexType;
+	typedef typename MeshType::FaceType FaceType;
+
+	sets.clear();
+	///last set that each vertex has been reserved by
+	std::vector<int> reserved(domain.vert.size(),-1);
+	std::vector<VertexType*> remaining=centers;
+	while (!remaining.empty())
+	{
+		const int curr=(int)sets.size();
+		sets.resize(curr+1);
+		std::vector<VertexType*> postponed;
+		for (unsigned int i=0;i<remaining.size();i++)
+		{
+			VertexType *v=remaining[i];
+			if (reserved[vcg::tri::Index(domain,v)]==curr)
+			{
+				postponed.push_back(v);
+				continue;
+			}
+			///take it and reserve its one ring
+			sets[curr].push_back(v);
+			vcg::face::VFIterator<FaceType> vfi(v);
+			for (;!vfi.End();++vfi)
+				for (int j=0;j<3;j++)
+					reserved[vcg::tri::Index(domain,vfi.F()->V(j))]=curr;
+		}
+		remaining.swap(postponed);
+	}
+}
 #endif
@@ -349,23 +349,49 @@ private:
         sprintf(ret," PERFORM GLOBAL OPTIMIZATION initializing... ");
         (*cb)(0,ret);
 
-        std::vector<vert_para> ord_vertex;
-        ord_vertex.resize(base_mesh.vn);
+        ///stars that do not share faces touch disjoint patches,
+        ///so each independent set is processed concurrently
+        std::vector<BaseVertex*> centers;
         for (unsigned int i=0;i<base_mesh.vert.size();i++)
             if (!base_mesh.vert[i].IsD())
-            {
-                BaseVertex *v=&base_mesh.vert[i];
-                ScalarType val=StarDistorsion<BaseMesh>(&base_mesh.vert[i]);
-                //printf("i: %d\n",i);
-                ord_vertex[i].dist=val;
-                ord_vertex[i].v=v;
-            }
+                centers.push_back(&base_mesh.vert[i]);
+
+        std::vector<std::vector<BaseVertex*> > sets;
+        IndependentStarSets<BaseMesh>(base_mesh,centers,sets);
+        std::vector<ScalarType> distorsion(base_mesh.vert.size(),0);
+        for (unsigned int s=0;s<sets.size();s++)
+        {
+            const int n=sets[s].size();
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic)
+#endif
+            for (int i=0;i<n;i++)
+                distorsion[vcg::tri::Index(base_mesh,sets[s][i])]=StarDistorsion<BaseMesh>(sets[s][i]);
+        }
 
+        std::vector<vert_para> ord_vertex(centers.size());
+        for (unsigned int i=0;i<centers.size();i++)
+        {
+            ord_vertex[i].dist=distorsion[vcg::tri::Index(base_mesh,centers[i])];
+            ord_vertex[i].v=centers[i];
+        }
         std::sort(ord_vertex.begin(),ord_vertex.end());
+
+        ///then optimize the stars, most distorted first
         for (unsigned int i=0;i<ord_vertex.size();i++)
+            centers[i]=ord_vertex[i].v;
+        IndependentStarSets<BaseMesh>(base_mesh,centers,sets);
+        for (unsigned int s=0;s<sets.size();s++)
         {
-                printf("%3.3f\n",ord_vertex[i].dist);
-        SmartOptimizeStar<BaseMesh>(ord_vertex[i].v,base_mesh,pecp->Accuracy(),EType);
+            const int n=sets[s].size();
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic)
+#endif
+            for (int i=0;i<n;i++)
+                SmartOptimizeStar<BaseMesh>(sets[s][i],base_mesh,pecp->Accuracy(),EType);
+
+            sprintf(ret," PERFORM GLOBAL OPTIMIZATION star set %d of %d (%d stars)",s+1,(int)sets.size(),n);
+            (*cb)(((s+1)*100)/sets.size(),ret);
         }
     }
 
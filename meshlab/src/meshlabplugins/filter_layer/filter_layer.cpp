@@ -49,7 +49,10 @@ FilterLayerPlugin::FilterLayerPlugin()
         FP_RENAME_MESH <<
         FP_RENAME_RASTER <<
         FP_DUPLICATE <<
-        FP_SELECTCURRENT;
+        FP_SELECTCURRENT <<
+        FP_COMPACT_POINT_CLOUD <<
+        FP_EXPAND_POINT_CLOUD <<
+        FP_IMPORT_COMPACT_POINT_CLOUD;
 
     foreach(FilterIDType tt , types())
         actionList << new QAction(filterName(tt), this);
@@ -71,6 +74,9 @@ QString FilterLayerPlugin::filterName(FilterIDType filterId) const
     case FP_RENAME_MESH :  return QString("Rename Current Mesh");
     case FP_RENAME_RASTER :  return QString("Rename Current Raster");
     case FP_SELECTCURRENT :  return QString("Change the current layer");
+    case FP_COMPACT_POINT_CLOUD :  return QString("Compact Point Cloud Layer");
+    case FP_EXPAND_POINT_CLOUD :  return QString("Expand Compact Point Cloud Layer");
+    case FP_IMPORT_COMPACT_POINT_CLOUD :  return QString("Import Compact Point Cloud");
     default : assert(0);
     }
 }
@@ -91,6 +97,13 @@ QString FilterLayerPlugin::filterInfo(FilterIDType filterId) const
     case FP_RENAME_MESH :  return QString("Explicitly change the label shown for a given mesh");
     case FP_RENAME_RASTER :  return QString("Explicitly change the label shown for a given raster");
     case FP_SELECTCURRENT :  return QString("Change the current layer from its name");
+    case FP_COMPACT_POINT_CLOUD :  return QString("Store the current point cloud in a compact form, keeping only positions, normals, colors and quality. <br>"
+                                                  "Useful for huge scans: the layer uses less than half of the memory, but it is not rendered until it is expanded. "
+                                                  "The layer is automatically expanded when a filter needs its vertices or when it is saved. <br>"
+                                                  "Meshes with faces or with other per vertex data cannot be compacted.");
+    case FP_EXPAND_POINT_CLOUD :  return QString("Move a compact point cloud layer back to the standard representation");
+    case FP_IMPORT_COMPACT_POINT_CLOUD :  return QString("Load the vertices of a binary PLY file in a new compact point cloud layer, without building a standard layer first. <br>"
+                                                         "x,y,z and, if present, normals, colors and quality (or intensity) are read; the vertex element must be the first one of the file.");
     default : assert(0);
     }
 }
@@ -141,6 +154,21 @@ void FilterLayerPlugin::initParameterSet(QAction *action, MeshDocument &md, Rich
         parlst.addParam(new RichMesh ("mesh",md.mm(),&md, "Mesh",
             "The name of the current mesh"));
         break;
+    case FP_COMPACT_POINT_CLOUD :
+        parlst.addParam(new RichEnum("Encoding", MLPointCloud::FLOAT32,
+            QStringList() << "Float (12 bytes)" << "Half Float (6 bytes)" << "Quantized (6 bytes)",
+            "Coordinates Encoding",
+            "How the coordinates are stored, relative to the center of the point cloud. <br>"
+            "Float has the same precision of a standard layer; Half Float keeps about 3 significant digits; "
+            "Quantized uses a regular grid of 65536 steps along each side of the bounding box."));
+        break;
+    case FP_IMPORT_COMPACT_POINT_CLOUD :
+        parlst.addParam(new RichOpenFile("FileName", "", QStringList() << "*.ply", "PLY File", "The binary PLY file to be loaded"));
+        parlst.addParam(new RichEnum("Encoding", MLPointCloud::FLOAT32,
+            QStringList() << "Float (12 bytes)" << "Half Float (6 bytes)" << "Quantized (6 bytes)",
+            "Coordinates Encoding",
+            "How the coordinates are stored, see the Compact Point Cloud Layer filter"));
+        break;
     default: break; // do not add any parameter for the other filters
     }
 }
@@ -156,6 +184,46 @@ bool FilterLayerPlugin::applyFilter(QAction *filter, MeshDocument &md, RichParam
     case  FP_RENAME_MESH:          md.mm()->setLabel(par.getString("newName"));  break;
     case  FP_RENAME_RASTER:          md.rm()->setLabel(par.getString("newName"));  break;
     case  FP_SELECTCURRENT:   md.setCurrent(par.getMesh("mesh"));           break;
+    case FP_COMPACT_POINT_CLOUD :
+        {
+            MeshModel *mm = md.mm();
+            const int vn = mm->isCompact() ? int(mm->compactCloud()->size()) : mm->cm.vn;
+            if (!mm->compact(MLPointCloud::CoordEncoding(par.getEnum("Encoding"))))
+            {
+                errorMessage = "Only point clouds (no faces or edges) without per vertex texture coords, curvature, radius or user defined attributes can be compacted";
+                return false;
+            }
+            const MLPointCloud *cloud = mm->compactCloud();
+            if (cloud->encoding() != MLPointCloud::CoordEncoding(par.getEnum("Encoding")))
+                Log("The coordinates exceed the Half Float range: stored as Float");
+            Log("Compacted %i points: %i bytes per point, %.1f MB instead of %.1f MB", vn, int(cloud->bytesPerPoint()),
+                cloud->memoryUsed() / (1024.0 * 1024.0), double(vn) * sizeof(CVertexO) / (1024.0 * 1024.0));
+        } break;
+    case FP_IMPORT_COMPACT_POINT_CLOUD :
+        {
+            QString fileName = par.getOpenFileName("FileName");
+            MeshModel *mm = md.addNewMesh(fileName, QFileInfo(fileName).fileName());
+            QString error;
+            if (!mm->loadCompactCloud(fileName, MLPointCloud::CoordEncoding(par.getEnum("Encoding")), error))
+            {
+                md.delMesh(mm);
+                errorMessage = error;
+                return false;
+            }
+            const MLPointCloud *cloud = mm->compactCloud();
+            if (cloud->encoding() != MLPointCloud::CoordEncoding(par.getEnum("Encoding")))
+                Log("The coordinates exceed the Half Float range: stored as Float");
+            Log("Loaded %i points: %i bytes per point, %.1f MB", int(cloud->size()), int(cloud->bytesPerPoint()), cloud->memoryUsed() / (1024.0 * 1024.0));
+        } break;
+    case FP_EXPAND_POINT_CLOUD :
+        if (md.mm()->isCompact())
+        {
+            md.mm()->expand();
+            Log("Expanded %i points", md.mm()->cm.vn);
+        }
+        else
+            Log("The current layer is not compact");
+        break;
     case  FP_DELETE_MESH :
         if(md.mm())
             md.delMesh(md.mm());
@@ -393,6 +461,9 @@ FilterLayerPlugin::FilterClass FilterLayerPlugin::getClass(QAction *a)
     case FP_SPLITCONNECTED :
     case FP_DELETE_MESH :
     case FP_DELETE_NON_VISIBLE_MESH :
+    case FP_COMPACT_POINT_CLOUD :
+    case FP_EXPAND_POINT_CLOUD :
+    case FP_IMPORT_COMPACT_POINT_CLOUD :
         return MeshFilterInterface::Layer;
     case FP_RENAME_RASTER :
     case FP_DELETE_RASTER :
@@ -415,10 +486,13 @@ MeshFilterInterface::FILTER_ARITY FilterLayerPlugin::filterArity( QAction* filte
     case FP_SELECTCURRENT :
     case FP_SPLITCONNECTED :
     case FP_DELETE_MESH :
+    case FP_COMPACT_POINT_CLOUD :
+    case FP_EXPAND_POINT_CLOUD :
         return MeshFilterInterface::SINGLE_MESH;
     case FP_RENAME_RASTER :
     case FP_DELETE_RASTER :
     case FP_DELETE_NON_SELECTED_RASTER :
+    case FP_IMPORT_COMPACT_POINT_CLOUD :
         return MeshFilterInterface::NONE;
     case FP_FLATTEN :
     case FP_DELETE_NON_VISIBLE_MESH :
@@ -427,4 +501,24 @@ MeshFilterInterface::FILTER_ARITY FilterLayerPlugin::filterArity( QAction* filte
     return MeshFilterInterface::NONE;
 }
 
+// The filters that only rename, select or delete layers do not need the vertices of the compact point clouds
+bool FilterLayerPlugin::acceptsCompactMeshes(QAction *filter) const
+{
+    switch(ID(filter))
+    {
+    case FP_RENAME_MESH :
+    case FP_RENAME_RASTER :
+    case FP_SELECTCURRENT :
+    case FP_DELETE_MESH :
+    case FP_DELETE_NON_VISIBLE_MESH :
+    case FP_DELETE_RASTER :
+    case FP_DELETE_NON_SELECTED_RASTER :
+    case FP_COMPACT_POINT_CLOUD :
+    case FP_EXPAND_POINT_CLOUD :
+    case FP_IMPORT_COMPACT_POINT_CLOUD :
+        return true;
+    }
+    return false;
+}
+
 MESHLAB_PLUGIN_NAME_EXPORTER(FilterLayerPlugin)
@@ -35,7 +35,7 @@ class FilterLayerPlugin : public QObject, public MeshFilterInterface
         Q_INTERFACES(MeshFilterInterface)
 
 public:
-    enum { FP_FLATTEN, FP_SPLITSELECTEDFACES, FP_SPLITSELECTEDVERTICES, FP_SPLITCONNECTED, FP_DUPLICATE, FP_RENAME_MESH, FP_RENAME_RASTER, FP_DELETE_MESH, FP_DELETE_NON_VISIBLE_MESH,FP_DELETE_RASTER, FP_DELETE_NON_SELECTED_RASTER,FP_SELECTCURRENT };
+    enum { FP_FLATTEN, FP_SPLITSELECTEDFACES, FP_SPLITSELECTEDVERTICES, FP_SPLITCONNECTED, FP_DUPLICATE, FP_RENAME_MESH, FP_RENAME_RASTER, FP_DELETE_MESH, FP_DELETE_NON_VISIBLE_MESH,FP_DELETE_RASTER, FP_DELETE_NON_SELECTED_RASTER,FP_SELECTCURRENT, FP_COMPACT_POINT_CLOUD, FP_EXPAND_POINT_CLOUD, FP_IMPORT_COMPACT_POINT_CLOUD };
 
     FilterLayerPlugin();
 
@@ -45,6 +45,7 @@ public:
     virtual void initParameterSet(QAction *,MeshDocument &/*m*/, RichParameterSet & /*parent*/);
     virtual bool applyFilter(QAction *filter, MeshDocument &md, RichParameterSet & /*parent*/, vcg::CallBackPos * cb) ;
     FILTER_ARITY filterArity(QAction*) const;
+    bool acceptsCompactMeshes(QAction*) const;
 };
 
 #endif
@@ -34,6 +34,7 @@
 #include<vcg/complex/algorithms/mesh_to_matrix.h>
 #include<vcg/complex/algorithms/bitquad_optimization.h>
 #include "filter_measure.h"
+#include "mesh_measure.h"
 
 using namespace std;
 using namespace vcg;
@@ -45,45 +46,29 @@ bool FilterMeasurePlugin::applyFilter( const QString& filterName,MeshDocument& m
 	if (filterName == "Compute Topological Measures")
 	{
 		CMeshO &m = md.mm()->cm;
-		tri::Allocator<CMeshO>::CompactFaceVector(m);
-		tri::Allocator<CMeshO>::CompactVertexVector(m);
-		md.mm()->updateDataMask(MeshModel::MM_FACEFACETOPO);
-		md.mm()->updateDataMask(MeshModel::MM_VERTFACETOPO);
-
-		int edgeNonManifFFNum = tri::Clean<CMeshO>::CountNonManifoldEdgeFF(m, true);
-		int faceEdgeManif = tri::UpdateSelection<CMeshO>::FaceCount(m);
-		tri::UpdateSelection<CMeshO>::VertexClear(m);
-		tri::UpdateSelection<CMeshO>::FaceClear(m);
-
-		int vertManifNum = tri::Clean<CMeshO>::CountNonManifoldVertexFF(m, true);
-		tri::UpdateSelection<CMeshO>::FaceFromVertexLoose(m);
-		int faceVertManif = tri::UpdateSelection<CMeshO>::FaceCount(m);
-		int edgeNum = 0, edgeBorderNum = 0, edgeNonManifNum = 0;
-		tri::Clean<CMeshO>::CountEdgeNum(m, edgeNum, edgeBorderNum, edgeNonManifNum);
-		assert(edgeNonManifFFNum == edgeNonManifNum);
-		int holeNum;
-		Log("V: %6i E: %6i F:%6i", m.vn, edgeNum, m.fn);
-		int unrefVertNum = tri::Clean<CMeshO>::CountUnreferencedVertex(m);
-		Log("Unreferenced Vertices %i", unrefVertNum);
-		Log("Boundary Edges %i", edgeBorderNum);
-
-		int connectedComponentsNum = tri::Clean<CMeshO>::CountConnectedComponents(m);
-		Log("Mesh is composed by %i connected component(s)\n", connectedComponentsNum);
+		MeshMeasure<CMeshO>::Topology topo;
+		MeshMeasure<CMeshO>::ComputeTopology(m, topo);
+		const int edgeNonManifFFNum = topo.edges.nonManifNum;
+		const int vertManifNum = topo.nonManifVertNum;
+
+		Log("V: %6i E: %6i F:%6i", m.vn, topo.edges.edgeNum, m.fn);
+		Log("Unreferenced Vertices %i", topo.unrefVertNum);
+		Log("Boundary Edges %i", topo.edges.borderNum);
+		Log("Mesh is composed by %i connected component(s)\n", topo.componentNum);
 
 		if (edgeNonManifFFNum == 0 && vertManifNum == 0){
 			Log("Mesh is two-manifold ");
 		}
 
-		if (edgeNonManifFFNum != 0) Log("Mesh has %i non two manifold edges and %i faces are incident on these edges\n", edgeNonManifFFNum, faceEdgeManif);
-		if (vertManifNum != 0) Log("Mesh has %i non two manifold vertexes and %i faces are incident on these vertices\n", vertManifNum, faceVertManif);
+		if (edgeNonManifFFNum != 0) Log("Mesh has %i non two manifold edges and %i faces are incident on these edges\n", edgeNonManifFFNum, topo.nonManifEdgeFaceNum);
+		if (vertManifNum != 0) Log("Mesh has %i non two manifold vertexes and %i faces are incident on these vertices\n", vertManifNum, topo.nonManifVertFaceNum);
 
 		// For Manifold meshes compute some other stuff
 		if (vertManifNum == 0 && edgeNonManifFFNum == 0)
 		{
-			holeNum = tri::Clean<CMeshO>::CountHoles(m);
-			Log("Mesh has %i holes", holeNum);
+			Log("Mesh has %i holes", topo.holeNum);
 
-			int genus = tri::Clean<CMeshO>::MeshGenus(m.vn - unrefVertNum, edgeNum, m.fn, holeNum, connectedComponentsNum);
+			int genus = tri::Clean<CMeshO>::MeshGenus(m.vn - topo.unrefVertNum, topo.edges.edgeNum, m.fn, topo.holeNum, topo.componentNum);
 			Log("Genus is %i", genus);
 		}
 		else
@@ -192,23 +177,26 @@ bool FilterMeasurePlugin::applyFilter( const QString& filterName,MeshDocument& m
 		if ((m.fn == 0) && (m.vn != 0))
 			pointcloud = true;
 
+		MeshMeasure<CMeshO>::Cloud cloud;
+		MeshMeasure<CMeshO>::ComputeCloud(m, cloud);
+
 		if (pointcloud)
 		{
 			// cloud barycenter
-			Point3m bc = tri::Stat<CMeshO>::ComputeCloudBarycenter(m, false);
+			Point3d bc = cloud.barycenter;
 			Log("Pointcloud (vertex) barycenter  %9.6f  %9.6f  %9.6f", bc[0], bc[1], bc[2]);
 
 			// if there is vertex quality, also provide weighted barycenter
-			if (tri::HasPerVertexQuality(m))
+			if (cloud.hasQualityBarycenter)
 			{
-				bc = tri::Stat<CMeshO>::ComputeCloudBarycenter(m, true);
+				bc = cloud.qualityBarycenter;
 				Log("Pointcloud (vertex) barycenter, weighted by verytex quality:");
 				Log("  %9.6f  %9.6f  %9.6f", bc[0], bc[1], bc[2]);
 			}
 
 			// principal axis
 			Matrix33m PCA;
-			PCA = computePrincipalAxisCloud(m);
+			PCA = principalAxes(cloud.covariance);
 			Log("Principal Axes are :");
 			Log("    | %9.6f  %9.6f  %9.6f |", PCA[0][0], PCA[0][1], PCA[0][2]);
 			Log("    | %9.6f  %9.6f  %9.6f |", PCA[1][0], PCA[1][1], PCA[1][2]);
@@ -216,52 +204,50 @@ bool FilterMeasurePlugin::applyFilter( const QString& filterName,MeshDocument& m
 		}
 		else
 		{
+			MeshMeasure<CMeshO>::Geometry geom;
+			MeshMeasure<CMeshO>::ComputeGeometry(m, geom);
+			MeshMeasure<CMeshO>::Edges edges;
+			MeshMeasure<CMeshO>::ComputeEdges(m, edges);
+
 			// area
-			float Area = tri::Stat<CMeshO>::ComputeMeshArea(m);
-			Log("Mesh Surface Area is %f", Area);
+			Log("Mesh Surface Area is %f", geom.area);
 
 			// edges
-			Distribution<float> eDist;
-			tri::Stat<CMeshO>::ComputeFaceEdgeLengthDistribution(m, eDist, false);
-			Log("Mesh Total Len of %i Edges is %f Avg Len %f", int(eDist.Cnt()), eDist.Sum(), eDist.Avg());
-			tri::Stat<CMeshO>::ComputeFaceEdgeLengthDistribution(m, eDist, true);
-			Log("Mesh Total Len of %i Edges is %f Avg Len %f (including faux edges))", int(eDist.Cnt()), eDist.Sum(), eDist.Avg());
+			Log("Mesh Total Len of %i Edges is %f Avg Len %f", edges.nonFauxNum, edges.nonFauxLength, edges.nonFauxNum > 0 ? edges.nonFauxLength / edges.nonFauxNum : 0.0);
+			Log("Mesh Total Len of %i Edges is %f Avg Len %f (including faux edges))", edges.edgeNum, edges.length, edges.edgeNum > 0 ? edges.length / edges.edgeNum : 0.0);
 
 			// Thin shell barycenter
-			Point3m bc = tri::Stat<CMeshO>::ComputeShellBarycenter(m);
+			Point3d bc = geom.shellBarycenter;
 			Log("Thin shell (faces) barycenter:  %9.6f  %9.6f  %9.6f", bc[0], bc[1], bc[2]);
 
 			// cloud barycenter
-			bc = tri::Stat<CMeshO>::ComputeCloudBarycenter(m, false);
+			bc = cloud.barycenter;
 			Log("Vertices barycenter  %9.6f  %9.6f  %9.6f", bc[0], bc[1], bc[2]);
 
 			// is watertight?
-			int edgeNum = 0, edgeBorderNum = 0, edgeNonManifNum = 0;
-			tri::Clean<CMeshO>::CountEdgeNum(m, edgeNum, edgeBorderNum, edgeNonManifNum);
-			watertight = (edgeBorderNum == 0) && (edgeNonManifNum == 0);
+			watertight = (edges.borderNum == 0) && (edges.nonManifNum == 0);
 			if (watertight)
 			{
-				tri::Inertia<CMeshO> I(m);
-
 				// volume
-				float Volume = I.Mass();
-				Log("Mesh Volume  is %f", Volume);
+				Log("Mesh Volume  is %f", geom.volume);
 
 				// center of mass
-				Log("Center of Mass  is %f %f %f", I.CenterOfMass()[0], I.CenterOfMass()[1], I.CenterOfMass()[2]);
+				Log("Center of Mass  is %f %f %f", geom.centerOfMass[0], geom.centerOfMass[1], geom.centerOfMass[2]);
 
 				// inertia tensor
-				Matrix33m IT;
-				I.InertiaTensor(IT);
+				const Matrix33d &IT = geom.inertiaTensor;
 				Log("Inertia Tensor is :");
 				Log("    | %9.6f  %9.6f  %9.6f |", IT[0][0], IT[0][1], IT[0][2]);
 				Log("    | %9.6f  %9.6f  %9.6f |", IT[1][0], IT[1][1], IT[1][2]);
 				Log("    | %9.6f  %9.6f  %9.6f |", IT[2][0], IT[2][1], IT[2][2]);
 
-				// principal axis
+				// principal axis, as tri::Inertia::InertiaTensorEigen
+				Eigen::Matrix3d em;
+				IT.ToEigenMatrix(em);
+				Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(em);
 				Matrix33m PCA;
-				Point3m pcav;
-				I.InertiaTensorEigen(PCA, pcav);
+				PCA.FromEigenMatrix(eig.eigenvectors());
+				Eigen::Vector3d pcav = eig.eigenvalues();
 				Log("Principal axes are :");
 				Log("    | %9.6f  %9.6f  %9.6f |", PCA[0][0], PCA[0][1], PCA[0][2]);
 				Log("    | %9.6f  %9.6f  %9.6f |", PCA[1][0], PCA[1][1], PCA[1][2]);
@@ -277,7 +263,7 @@ bool FilterMeasurePlugin::applyFilter( const QString& filterName,MeshDocument& m
 
 				// principal axis
 				Matrix33m PCA;
-				PCA = computePrincipalAxisCloud(m);
+				PCA = principalAxes(cloud.covariance);
 				Log("Principal axes are :");
 				Log("    | %9.6f  %9.6f  %9.6f |", PCA[0][0], PCA[0][1], PCA[0][2]);
 				Log("    | %9.6f  %9.6f  %9.6f |", PCA[1][0], PCA[1][1], PCA[1][2]);
@@ -401,23 +387,10 @@ bool FilterMeasurePlugin::applyFilter( const QString& filterName,MeshDocument& m
 	return false;
 }
 
-// function to calculate prioncipal axis for pointclouds or non-watertight meshes
-Matrix33m FilterMeasurePlugin::computePrincipalAxisCloud(CMeshO & m)
+// function to calculate prioncipal axis for pointclouds or non-watertight meshes,
+// from the covariance of the vertices
+Matrix33m FilterMeasurePlugin::principalAxes(const Matrix33d & cov)
 {
-	Matrix33m cov;
-	Point3m bp(0, 0, 0);
-	vector<Point3m> PtVec;
-	for (CMeshO::VertexIterator vi = m.vert.begin(); vi != m.vert.end(); ++vi)
-	if (!(*vi).IsD()) 
-	{
-		PtVec.push_back((*vi).cP());
-		bp += (*vi).cP();
-	}
-
-	bp /= m.vn;
-
-	cov.Covariance(PtVec, bp);
-
 	Matrix33m eigenvecMatrix;
 	Eigen::Matrix3d em;
 	cov.ToEigenMatrix(em);
@@ -36,7 +36,7 @@ public:
     bool applyFilter( const QString& filterName,MeshDocument& md,EnvWrap& env, vcg::CallBackPos * cb );
 
 private:
-	Matrix33m computePrincipalAxisCloud(CMeshO & m);
+	Matrix33m principalAxes(const Matrix33d & cov);
 };
 
 #endif
@@ -1,6 +1,8 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
-HEADERS       += filter_measure.h
+HEADERS       += filter_measure.h \
+                 mesh_measure.h
 SOURCES       += filter_measure.cpp 
 TARGET         = filter_measure
 PRE_TARGETDEPS += filter_measure.xml
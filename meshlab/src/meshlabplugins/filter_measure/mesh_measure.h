@@ -0,0 +1,597 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef MESH_MEASURE_H
+#define MESH_MEASURE_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <vcg/complex/complex.h>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+/*
+Geometric and topological measures of a mesh computed in a few parallel passes, without
+touching the mesh (no FF/VF adjacency, no flags, no selection, no compaction).
+
+Geometric: a pass over the faces integrates area, thin shell barycenter and, summing
+the signed tetrahedra of each face with a reference point, volume, first and second
+moments; a pass over the vertices gives the (quality weighted) barycenters and a second
+one the covariance around the barycenter. Everything is taken relative to the center of
+the bounding box, accumulated in double with compensated sums, one per thread on a
+contiguous block of elements, and the thread sums are added in a fixed order.
+
+Topological: the face edges are bucketed by their lowest vertex (a counting sort, as in
+MLTopology) and each bucket is sorted on its own, giving the number of faces on every
+edge. From these come edge, border and non manifold edge counts, the vertices whose
+faces are not a single fan (the ones tri::Clean::CountNonManifoldVertexFF reports), the
+connected components of the faces across their edges and, for two manifold meshes, the
+boundary loops.
+*/
+template <class MeshType>
+class MeshMeasure
+{
+public:
+    typedef typename MeshType::ScalarType ScalarType;
+    typedef typename MeshType::VertexType VertexType;
+    typedef typename MeshType::FaceType FaceType;
+    typedef vcg::Point3d Point3d;
+
+    // Integrals over the surface and over the enclosed volume; the volume ones are
+    // meaningful only for watertight meshes. The moments are around the center of mass.
+    struct Geometry
+    {
+        double area;
+        Point3d shellBarycenter;
+        double volume;
+        Point3d centerOfMass;
+        vcg::Matrix33d inertiaTensor;
+    };
+
+    // Barycenter of the vertices (optionally weighted with the quality) and the
+    // covariance of their positions around it.
+    struct Cloud
+    {
+        Point3d barycenter;
+        bool hasQualityBarycenter;
+        Point3d qualityBarycenter;
+        vcg::Matrix33d covariance;
+    };
+
+    // Unique (unordered) face edges, as tri::Clean::CountEdgeNum and
+    // tri::Stat::ComputeFaceEdgeLengthDistribution count them.
+    struct Edges
+    {
+        int edgeNum;
+        int borderNum;      // edges with one face
+        int nonManifNum;    // edges with more than two faces
+        double length;
+        int nonFauxNum;     // edges with at least a non faux side, and their length
+        double nonFauxLength;
+    };
+
+    struct Topology
+    {
+        Edges edges;
+        int unrefVertNum;
+        int nonManifEdgeFaceNum;   // faces with a non manifold edge
+        int nonManifVertNum;       // vertices (not on non manifold edges) with more than one fan
+        int nonManifVertFaceNum;   // faces with one of those vertices
+        int componentNum;
+        int holeNum;               // boundary loops, -1 if the mesh is not two manifold
+    };
+
+    static void ComputeGeometry(MeshType &m, Geometry &g)
+    {
+        const Point3d o = vcg::Point3d::Construct(m.bbox.Center());
+        const int faceNum = int(m.face.size());
+        std::vector<FacePartial> partials(ThreadNum());
+#ifdef _USE_OMP
+        #pragma omp parallel num_threads(int(partials.size()))
+#endif
+        {
+            int b, e;
+            FacePartial &p = partials[Block(faceNum, b, e)];
+            for (int i = b; i < e; ++i)
+            {
+                const FaceType &f = m.face[i];
+                if (f.IsD()) continue;
+                const Point3d a = vcg::Point3d::Construct(f.cP(0)) - o;
+                const Point3d c1 = vcg::Point3d::Construct(f.cP(1)) - o;
+                const Point3d c2 = vcg::Point3d::Construct(f.cP(2)) - o;
+                const double dblArea = ((c1 - a) ^ (c2 - a)).Norm();
+                const Point3d s = a + c1 + c2;
+                p.area.add(dblArea / 2.0);
+                for (int k = 0; k < 3; ++k)
+                    p.shell[k].add(s[k] / 3.0 * dblArea);
+
+                // tetrahedron (o,a,c1,c2): integral of x_i x_j is V/20 (sum_k p_ki p_kj + s_i s_j)
+                const double v = (a * (c1 ^ c2)) / 6.0;
+                p.volume.add(v);
+                for (int k = 0; k < 3; ++k)
+                {
+                    const int k1 = (k + 1) % 3;
+                    p.first[k].add(v / 4.0 * s[k]);
+                    p.square[k].add(v / 20.0 * (a[k] * a[k] + c1[k] * c1[k] + c2[k] * c2[k] + s[k] * s[k]));
+                    p.product[k].add(v / 20.0 * (a[k] * a[k1] + c1[k] * c1[k1] + c2[k] * c2[k1] + s[k] * s[k1]));
+                }
+            }
+        }
+        FacePartial t;
+        for (size_t i = 0; i < partials.size(); ++i)
+            t.merge(partials[i]);
+
+        // the face barycenters are weighted with the double area, as in tri::Stat::ComputeShellBarycenter
+        g.area = t.area.value();
+        g.shellBarycenter = o;
+        if (g.area > 0)
+            g.shellBarycenter += Point3d(t.shell[0].value(), t.shell[1].value(), t.shell[2].value()) / (2.0 * g.area);
+
+        // inertia tensor around the center of mass, as tri::Inertia::InertiaTensor
+        g.volume = t.volume.value();
+        const double mass = g.volume;
+        Point3d r(0, 0, 0);
+        if (mass != 0)
+            r = Point3d(t.first[0].value(), t.first[1].value(), t.first[2].value()) / mass;
+        g.centerOfMass = o + r;
+        const double T2[3] = {t.square[0].value(), t.square[1].value(), t.square[2].value()};
+        const double TP[3] = {t.product[0].value(), t.product[1].value(), t.product[2].value()};
+        vcg::Matrix33d &J = g.inertiaTensor;
+        J[0][0] = T2[1] + T2[2] - mass * (r[1] * r[1] + r[2] * r[2]);
+        J[1][1] = T2[2] + T2[0] - mass * (r[2] * r[2] + r[0] * r[0]);
+        J[2][2] = T2[0] + T2[1] - mass * (r[0] * r[0] + r[1] * r[1]);
+        J[0][1] = J[1][0] = -TP[0] + mass * r[0] * r[1];
+        J[1][2] = J[2][1] = -TP[1] + mass * r[1] * r[2];
+        J[2][0] = J[0][2] = -TP[2] + mass * r[2] * r[0];
+    }
+
+    static void ComputeCloud(MeshType &m, Cloud &c)
+    {
+        const Point3d o = vcg::Point3d::Construct(m.bbox.Center());
+        const int vertNum = int(m.vert.size());
+        const int threadNum = ThreadNum();
+        const bool quality = vcg::tri::HasPerVertexQuality(m);
+
+        std::vector<VertPartial> partials(threadNum);
+#ifdef _USE_OMP
+        #pragma omp parallel num_threads(threadNum)
+#endif
+        {
+            int b, e;
+            VertPartial &p = partials[Block(vertNum, b, e)];
+            for (int i = b; i < e; ++i)
+            {
+                const VertexType &v = m.vert[i];
+                if (v.IsD()) continue;
+                const Point3d q = vcg::Point3d::Construct(v.cP()) - o;
+                p.count.add(1.0);
+                for (int k = 0; k < 3; ++k)
+                    p.pos[k].add(q[k]);
+                if (quality)
+                {
+                    const double w = v.cQ();
+                    p.weight.add(w);
+                    for (int k = 0; k < 3; ++k)
+                        p.weighted[k].add(q[k] * w);
+                }
+            }
+        }
+        VertPartial t;
+        for (int i = 0; i < threadNum; ++i)
+            t.merge(partials[i]);
+        const double n = t.count.value();
+        const Point3d bc = (n > 0) ? Point3d(t.pos[0].value(), t.pos[1].value(), t.pos[2].value()) / n : Point3d(0, 0, 0);
+        c.barycenter = o + bc;
+        c.hasQualityBarycenter = quality;
+        if (quality)
+            c.qualityBarycenter = o + Point3d(t.weighted[0].value(), t.weighted[1].value(), t.weighted[2].value()) / t.weight.value();
+
+        // second pass for the covariance, around the barycenter
+        std::vector<CovPartial> cov(threadNum);
+#ifdef _USE_OMP
+        #pragma omp parallel num_threads(threadNum)
+#endif
+        {
+            int b, e;
+            CovPartial &p = cov[Block(vertNum, b, e)];
+            for (int i = b; i < e; ++i)
+            {
+                const VertexType &v = m.vert[i];
+                if (v.IsD()) continue;
+                const Point3d q = vcg::Point3d::Construct(v.cP()) - o - bc;
+                for (int r = 0; r < 3; ++r)
+                    for (int s = r; s < 3; ++s)
+                        p.c[r][s].add(q[r] * q[s]);
+            }
+        }
+        for (int r = 0; r < 3; ++r)
+            for (int s = r; s < 3; ++s)
+            {
+                Sum sum;
+                for (int i = 0; i < threadNum; ++i)
+                    sum.add(cov[i].c[r][s].value());
+                c.covariance[r][s] = c.covariance[s][r] = sum.value();
+            }
+    }
+
+    static void ComputeEdges(MeshType &m, Edges &ed)
+    {
+        std::vector<int> first, faceNumOnEdge;
+        std::vector<EdgeRef> refs;
+        SortEdges(m, first, refs, ed, faceNumOnEdge);
+    }
+
+    static void ComputeTopology(MeshType &m, Topology &t)
+    {
+        const int vertNum = int(m.vert.size());
+        const int faceNum = int(m.face.size());
+        std::vector<int> first, faceNumOnEdge;
+        std::vector<EdgeRef> refs;
+        SortEdges(m, first, refs, t.edges, faceNumOnEdge);
+
+        // connected components: the faces of an edge are joined
+        std::vector<int> parent(faceNum);
+        for (int i = 0; i < faceNum; ++i)
+            parent[i] = i;
+        for (int i = 0; i < vertNum; ++i)
+            for (int k = first[i] + 1; k < first[i + 1]; ++k)
+                if (refs[k].v == refs[k - 1].v)
+                    Join(parent, refs[k].w / 3, refs[k - 1].w / 3);
+        t.componentNum = 0;
+        for (int i = 0; i < faceNum; ++i)
+            if (!m.face[i].IsD() && Find(parent, i) == i)
+                ++t.componentNum;
+        std::vector<EdgeRef>().swap(refs);
+
+        // the corners of every vertex
+        std::vector<int> corner;
+        first.assign(vertNum + 1, 0);
+        for (int i = 0; i < faceNum; ++i)
+            if (!m.face[i].IsD())
+                for (int j = 0; j < 3; ++j)
+                    ++first[Index(m, m.face[i].cV(j)) + 1];
+        for (int i = 0; i < vertNum; ++i)
+            first[i + 1] += first[i];
+        corner.resize(first[vertNum]);
+        {
+            std::vector<int> pos(first.begin(), first.end() - 1);
+            for (int i = 0; i < faceNum; ++i)
+                if (!m.face[i].IsD())
+                    for (int j = 0; j < 3; ++j)
+                        corner[pos[Index(m, m.face[i].cV(j))]++] = 3 * i + j;
+        }
+
+        // vertices referenced by edges are not unreferenced
+        std::vector<char> edgeRef(vertNum, 0);
+        for (size_t i = 0; i < m.edge.size(); ++i)
+            if (!m.edge[i].IsD())
+                for (int j = 0; j < 2; ++j)
+                    edgeRef[Index(m, m.edge[i].cV(j))] = 1;
+
+        std::vector<char> nonManifVert(vertNum, 0);
+        int unref = 0, nonManif = 0;
+#ifdef _USE_OMP
+        #pragma omp parallel
+#endif
+        {
+            std::vector<int> scratch;
+#ifdef _USE_OMP
+            #pragma omp for schedule(dynamic, 4096) reduction(+: unref, nonManif)
+#endif
+            for (int i = 0; i < vertNum; ++i)
+            {
+                if (m.vert[i].IsD()) continue;
+                if (first[i] == first[i + 1])
+                {
+                    if (!edgeRef[i]) ++unref;
+                    continue;
+                }
+                if (!IsSingleFan(m, &corner[first[i]], first[i + 1] - first[i], faceNumOnEdge, scratch))
+                {
+                    nonManifVert[i] = 1;
+                    ++nonManif;
+                }
+            }
+        }
+        t.unrefVertNum = unref;
+        t.nonManifVertNum = nonManif;
+
+        int edgeFaces = 0, vertFaces = 0;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static) reduction(+: edgeFaces, vertFaces)
+#endif
+        for (int i = 0; i < faceNum; ++i)
+        {
+            const FaceType &f = m.face[i];
+            if (f.IsD()) continue;
+            bool onEdge = false, onVert = false;
+            for (int j = 0; j < 3; ++j)
+            {
+                onEdge = onEdge || faceNumOnEdge[3 * i + j] > 2;
+                onVert = onVert || nonManifVert[Index(m, f.cV(j))];
+            }
+            if (onEdge) ++edgeFaces;
+            if (onVert) ++vertFaces;
+        }
+        t.nonManifEdgeFaceNum = edgeFaces;
+        t.nonManifVertFaceNum = vertFaces;
+
+        // boundary loops: on a two manifold mesh the border edges form disjoint cycles
+        t.holeNum = -1;
+        if (t.edges.nonManifNum == 0 && t.nonManifVertNum == 0)
+        {
+            std::vector<int> vparent(vertNum);
+            std::vector<char> onBorder(vertNum, 0);
+            for (int i = 0; i < vertNum; ++i)
+                vparent[i] = i;
+            for (int i = 0; i < faceNum; ++i)
+                if (!m.face[i].IsD())
+                    for (int j = 0; j < 3; ++j)
+                        if (faceNumOnEdge[3 * i + j] == 1)
+                        {
+                            const int v0 = Index(m, m.face[i].cV(j));
+                            const int v1 = Index(m, m.face[i].cV((j + 1) % 3));
+                            onBorder[v0] = onBorder[v1] = 1;
+                            Join(vparent, v0, v1);
+                        }
+            t.holeNum = 0;
+            for (int i = 0; i < vertNum; ++i)
+                if (onBorder[i] && Find(vparent, i) == i)
+                    ++t.holeNum;
+        }
+    }
+
+private:
+    // Compensated (Neumaier) sum
+    struct Sum
+    {
+        double s, c;
+        Sum() : s(0), c(0) {}
+        void add(double x)
+        {
+            const double t = s + x;
+            if (std::fabs(s) >= std::fabs(x)) c += (s - t) + x;
+            else                              c += (x - t) + s;
+            s = t;
+        }
+        double value() const { return s + c; }
+    };
+
+    struct FacePartial
+    {
+        Sum area, shell[3], volume, first[3], square[3], product[3];
+        void merge(const FacePartial &p)
+        {
+            area.add(p.area.value());
+            volume.add(p.volume.value());
+            for (int k = 0; k < 3; ++k)
+            {
+                shell[k].add(p.shell[k].value());
+                first[k].add(p.first[k].value());
+                square[k].add(p.square[k].value());
+                product[k].add(p.product[k].value());
+            }
+        }
+    };
+
+    struct VertPartial
+    {
+        Sum count, pos[3], weight, weighted[3];
+        void merge(const VertPartial &p)
+        {
+            count.add(p.count.value());
+            weight.add(p.weight.value());
+            for (int k = 0; k < 3; ++k)
+            {
+                pos[k].add(p.pos[k].value());
+                weighted[k].add(p.weighted[k].value());
+            }
+        }
+    };
+
+    struct CovPartial
+    {
+        Sum c[3][3];
+    };
+
+    struct EdgePartial
+    {
+        int edgeNum, borderNum, nonManifNum, nonFauxNum;
+        Sum length, nonFauxLength;
+        EdgePartial() : edgeNum(0), borderNum(0), nonManifNum(0), nonFauxNum(0) {}
+    };
+
+    // A face edge seen from its lowest vertex: the other vertex and the wedge (3*face+edge)
+    struct EdgeRef
+    {
+        int v;
+        int w;
+        bool operator<(const EdgeRef &r) const { return v < r.v || (v == r.v && w < r.w); }
+    };
+
+    static int ThreadNum()
+    {
+#ifdef _USE_OMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    // The contiguous block [b,e) of n elements of the calling thread; returns its index
+    static int Block(int n, int &b, int &e)
+    {
+        int t = 0, teamSize = 1;
+#ifdef _USE_OMP
+        t = omp_get_thread_num();
+        teamSize = omp_get_num_threads();
+#endif
+        b = int((long long)n * t / teamSize);
+        e = int((long long)n * (t + 1) / teamSize);
+        return t;
+    }
+
+    static int Index(const MeshType &m, const VertexType *v) { return int(v - &m.vert[0]); }
+
+    static int Find(std::vector<int> &parent, int i)
+    {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    static void Join(std::vector<int> &parent, int a, int b)
+    {
+        a = Find(parent, a);
+        b = Find(parent, b);
+        if (a < b) parent[b] = a;
+        else if (b < a) parent[a] = b;
+    }
+
+    // Buckets and sorts the face edges, counts the unique ones and, for every wedge, the
+    // faces on its edge
+    static void SortEdges(MeshType &m, std::vector<int> &first, std::vector<EdgeRef> &refs, Edges &ed, std::vector<int> &faceNumOnEdge)
+    {
+        const int vertNum = int(m.vert.size());
+        const int faceNum = int(m.face.size());
+        first.assign(vertNum + 1, 0);
+        for (int i = 0; i < faceNum; ++i)
+            if (!m.face[i].IsD())
+                for (int j = 0; j < 3; ++j)
+                    ++first[std::min(Index(m, m.face[i].cV(j)), Index(m, m.face[i].cV((j + 1) % 3))) + 1];
+        for (int i = 0; i < vertNum; ++i)
+            first[i + 1] += first[i];
+        refs.resize(first[vertNum]);
+        {
+            std::vector<int> pos(first.begin(), first.end() - 1);
+            for (int i = 0; i < faceNum; ++i)
+                if (!m.face[i].IsD())
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        const int v0 = Index(m, m.face[i].cV(j));
+                        const int v1 = Index(m, m.face[i].cV((j + 1) % 3));
+                        EdgeRef &r = refs[pos[std::min(v0, v1)]++];
+                        r.v = std::max(v0, v1);
+                        r.w = 3 * i + j;
+                    }
+        }
+
+        faceNumOnEdge.assign(3 * faceNum, 0);
+        std::vector<EdgePartial> partials(ThreadNum());
+#ifdef _USE_OMP
+        #pragma omp parallel num_threads(int(partials.size()))
+#endif
+        {
+            int b, e;
+            EdgePartial &p = partials[Block(vertNum, b, e)];
+            for (int i = b; i < e; ++i)
+            {
+                std::sort(refs.begin() + first[i], refs.begin() + first[i + 1]);
+                int rs = first[i];
+                while (rs < first[i + 1])
+                {
+                    int re = rs + 1;
+                    while (re < first[i + 1] && refs[re].v == refs[rs].v) ++re;
+                    const int n = re - rs;
+                    bool faux = true;
+                    for (int q = rs; q < re; ++q)
+                    {
+                        faceNumOnEdge[refs[q].w] = n;
+                        faux = faux && m.face[refs[q].w / 3].IsF(refs[q].w % 3);
+                    }
+                    const double len = vcg::Distance(vcg::Point3d::Construct(m.vert[i].cP()), vcg::Point3d::Construct(m.vert[refs[rs].v].cP()));
+                    ++p.edgeNum;
+                    if (n == 1) ++p.borderNum;
+                    if (n > 2) ++p.nonManifNum;
+                    p.length.add(len);
+                    if (!faux)
+                    {
+                        ++p.nonFauxNum;
+                        p.nonFauxLength.add(len);
+                    }
+                    rs = re;
+                }
+            }
+        }
+        ed.edgeNum = ed.borderNum = ed.nonManifNum = ed.nonFauxNum = 0;
+        Sum length, nonFauxLength;
+        for (size_t i = 0; i < partials.size(); ++i)
+        {
+            ed.edgeNum += partials[i].edgeNum;
+            ed.borderNum += partials[i].borderNum;
+            ed.nonManifNum += partials[i].nonManifNum;
+            ed.nonFauxNum += partials[i].nonFauxNum;
+            length.add(partials[i].length.value());
+            nonFauxLength.add(partials[i].nonFauxLength.value());
+        }
+        ed.length = length.value();
+        ed.nonFauxLength = nonFauxLength.value();
+    }
+
+    // True if the faces around a vertex (given by its corners) are a single fan, or if the
+    // vertex is on a non manifold edge (CountNonManifoldVertexFF skips those vertices).
+    // The fans are the connected components of the link: one edge per face, between the
+    // two other vertices of the face. scratch is reused among the calls of a thread.
+    static bool IsSingleFan(MeshType &m, const int *corner, int n, const std::vector<int> &faceNumOnEdge, std::vector<int> &scratch)
+    {
+        // link vertices, then their sorted unique ids, then the union find parents
+        scratch.resize(8 * n);
+        int *link = &scratch[0], *ids = link + 2 * n, *parent = ids + 2 * n;
+        for (int k = 0; k < n; ++k)
+        {
+            const int f = corner[k] / 3, j = corner[k] % 3;
+            if (faceNumOnEdge[3 * f + j] > 2 || faceNumOnEdge[3 * f + (j + 2) % 3] > 2)
+                return true;
+            link[2 * k] = Index(m, m.face[f].cV((j + 1) % 3));
+            link[2 * k + 1] = Index(m, m.face[f].cV((j + 2) % 3));
+        }
+        if (n == 1)
+            return true;
+        std::copy(link, link + 2 * n, ids);
+        std::sort(ids, ids + 2 * n);
+        const int idNum = int(std::unique(ids, ids + 2 * n) - ids);
+        for (int i = 0; i < idNum; ++i)
+            parent[i] = i;
+        int fans = idNum;
+        for (int k = 0; k < n; ++k)
+        {
+            int a = int(std::lower_bound(ids, ids + idNum, link[2 * k]) - ids);
+            int b = int(std::lower_bound(ids, ids + idNum, link[2 * k + 1]) - ids);
+            while (parent[a] != a) { parent[a] = parent[parent[a]]; a = parent[a]; }
+            while (parent[b] != b) { parent[b] = parent[parent[b]]; b = parent[b]; }
+            if (a != b)
+            {
+                parent[std::max(a, b)] = std::min(a, b);
+                --fans;
+            }
+        }
+        return fans == 1;
+    }
+};
+
+#endif // MESH_MEASURE_H
@@ -1,9 +1,11 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += $$VCGDIR/vcg/complex/algorithms/clean.h\
 		quadric_simp.h \ 
 		quadric_tex_simp.h \ 
-		meshfilter.h 
+		meshfilter.h \
+		subdivision.h
 
 SOURCES       += meshfilter.cpp \
 		quadric_simp.cpp \ 
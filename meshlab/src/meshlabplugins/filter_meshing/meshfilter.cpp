@@ -32,11 +32,14 @@
 #include <vcg/complex/algorithms/attribute_seam.h>
 #include <vcg/complex/algorithms/update/curvature.h>
 #include <vcg/complex/algorithms/update/curvature_fitting.h>
-#include <vcg/complex/algorithms/pointcloud_normal.h>
 #include <vcg/space/fitting3.h>
 #include <wrap/gl/glu_tessellator_cap.h>
 #include "quadric_tex_simp.h"
 #include "quadric_simp.h"
+#include "subdivision.h"
+#include <common/ml_knn_graph.h>
+#include <common/ml_vertex_weld.h>
+#include <common/ml_hole_filling.h>
 
 using namespace std;
 using namespace vcg;
@@ -646,63 +649,49 @@ bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, Ric
     float threshold = par.getAbsPerc("Threshold");
     int iterations = par.getInt("Iterations");
 
+    typedef ParallelRefine<CMeshO> Refiner;
     for(int i=0; i<iterations; ++i) {
-      m.updateDataMask(MeshModel::MM_VERTFACETOPO);
       switch(ID(filter)) {
       case FP_LOOP_SS :
         switch(par.getEnum("LoopWeight")) {
         case 0:
-          tri::RefineOddEven<CMeshO/*, tri::OddPointLoop<CMeshO>, tri::EvenPointLoop<CMeshO>*/ >
-              (m.cm, tri::OddPointLoop<CMeshO>(m.cm), tri::EvenPointLoop<CMeshO>(), threshold, selected, cb);
+          Refiner::RefineOddEven(m.cm, tri::OddPointLoop<CMeshO>(m.cm), tri::EvenPointLoop<CMeshO>(), threshold, selected, cb);
           break;
         case 1:
-          tri::RefineOddEven<CMeshO/*,
-                                     tri::OddPointLoopGeneric<CMeshO, Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >,
-                                     tri::EvenPointLoopGeneric<CMeshO, Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >*/ >
-              (m.cm, tri::OddPointLoopGeneric<CMeshO, Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >(m.cm),
+          Refiner::RefineOddEven(m.cm, tri::OddPointLoopGeneric<CMeshO, Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >(m.cm),
                tri::EvenPointLoopGeneric<CMeshO, Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >(), threshold, selected, cb);
           break;
         case 2:
-          tri::RefineOddEven<CMeshO/*,
-                                     tri::OddPointLoopGeneric<CMeshO, Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >,
-                                     tri::EvenPointLoopGeneric<CMeshO, Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >*/ >
-              (m.cm, tri::OddPointLoopGeneric<CMeshO, Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >(m.cm),
+          Refiner::RefineOddEven(m.cm, tri::OddPointLoopGeneric<CMeshO, Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >(m.cm),
                tri::EvenPointLoopGeneric<CMeshO, Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >(), threshold, selected, cb);
           break;
         }
         break;
       case FP_BUTTERFLY_SS :
-        Refine<CMeshO,MidPointButterfly<CMeshO> >
-            (m.cm, MidPointButterfly<CMeshO>(m.cm), threshold, selected, cb);
+        Refiner::Refine(m.cm, MidPointButterfly<CMeshO>(m.cm), threshold, selected, cb);
         break;
       case FP_MIDPOINT :
-        Refine<CMeshO,MidPoint<CMeshO> >
-            (m.cm, MidPoint<CMeshO>(&m.cm), threshold, selected, cb);
+        Refiner::Refine(m.cm, MidPoint<CMeshO>(&m.cm), threshold, selected, cb);
         break;
       case FP_REFINE_LS3_LOOP :
         switch(par.getEnum("LoopWeight")) {
         case 0:
-          tri::RefineOddEven<CMeshO/*, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >, tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >*/ >
-              (m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >(m.cm), tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >(), threshold, selected, cb);
+          Refiner::RefineOddEven(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >(m.cm),
+               tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >(), threshold, selected, cb);
           break;
         case 1:
-          tri::RefineOddEven<CMeshO/*,
-                                     tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >,
-                                     tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >*/ >
-              (m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >(m.cm),
+          Refiner::RefineOddEven(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >(m.cm),
                tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >(), threshold, selected, cb);
           break;
         case 2:
-          tri::RefineOddEven<CMeshO/*,
-                                     tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >,
-                                     tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >*/ >
-              (m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >(m.cm),
+          Refiner::RefineOddEven(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >(m.cm),
                tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >(), threshold, selected, cb);
           break;
         }
         break;
       }
-      m.clearDataMask(MeshModel::MM_VERTFACETOPO);
+      // the refiner keeps the border flags but not the FF adjacency
+      m.updateDataMask(MeshModel::MM_FACEFACETOPO);
     }
     m.UpdateBoxAndNormals();
   } break;
@@ -729,8 +718,9 @@ bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, Ric
 
     case FP_REMOVE_DUPLICATED_VERTEX:
         {
-            int delvert=tri::Clean<CMeshO>::RemoveDuplicateVertex(m.cm);
-            Log( "Removed %d duplicated vertices", delvert);
+            int fn0 = m.cm.fn;
+            int delvert=VertexWeld<CMeshO>::RemoveDuplicateVertex(m.cm);
+            Log( "Removed %d duplicated vertices (%d degenerate faces)", delvert, fn0 - m.cm.fn);
             if (delvert != 0)
             m.UpdateBoxAndNormals();
 
@@ -947,23 +937,37 @@ bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, Ric
             if(par.getFloat("TargetPerc")!=0) TargetFaceNum = m.cm.fn*par.getFloat("TargetPerc");
 
             tri::TriEdgeCollapseQuadricParameter pp;
-            pp.QualityThr=lastq_QualityThr =par.getFloat("QualityThr");
-            pp.PreserveBoundary=lastq_PreserveBoundary = par.getBool("PreserveBoundary");
+            pp.QualityThr = par.getFloat("QualityThr");
+            pp.PreserveBoundary = par.getBool("PreserveBoundary");
             pp.BoundaryWeight = pp.BoundaryWeight * par.getFloat("BoundaryWeight");
-            pp.PreserveTopology=lastq_PreserveTopology = par.getBool("PreserveTopology");
-            pp.QualityWeight=lastq_QualityWeight = par.getBool("QualityWeight");
-            pp.NormalCheck=lastq_PreserveNormal = par.getBool("PreserveNormal");
-            pp.OptimalPlacement=lastq_OptimalPlacement = par.getBool("OptimalPlacement");
-            pp.QualityQuadric=lastq_PlanarQuadric = par.getBool("PlanarQuadric");
-            lastq_Selected = par.getBool("Selected");
+            pp.PreserveTopology = par.getBool("PreserveTopology");
+            pp.QualityWeight = par.getBool("QualityWeight");
+            pp.NormalCheck = par.getBool("PreserveNormal");
+            pp.OptimalPlacement = par.getBool("OptimalPlacement");
+            pp.QualityQuadric = par.getBool("PlanarQuadric");
+            const bool selected = par.getBool("Selected");
+            // the defaults of the next run; the layers can be simplified at the same time
+#ifdef _USE_OMP
+            #pragma omp critical (lastq)
+#endif
+            {
+                lastq_QualityThr = pp.QualityThr;
+                lastq_PreserveBoundary = pp.PreserveBoundary;
+                lastq_PreserveTopology = pp.PreserveTopology;
+                lastq_QualityWeight = pp.QualityWeight;
+                lastq_PreserveNormal = pp.NormalCheck;
+                lastq_OptimalPlacement = pp.OptimalPlacement;
+                lastq_PlanarQuadric = pp.QualityQuadric;
+                lastq_Selected = selected;
+            }
 
-            QuadricSimplification(m.cm,TargetFaceNum,lastq_Selected,pp,  cb);
+            QuadricSimplification(m.cm,TargetFaceNum,selected,pp,  cb);
 
             if(par.getBool("AutoClean"))
             {
                 int nullFaces=tri::Clean<CMeshO>::RemoveFaceOutOfRangeArea(m.cm,0);
                 if(nullFaces) Log( "PostSimplification Cleaning: Removed %d null faces", nullFaces);
-                int deldupvert=tri::Clean<CMeshO>::RemoveDuplicateVertex(m.cm);
+                int deldupvert=VertexWeld<CMeshO>::RemoveDuplicateVertex(m.cm);
                 if(deldupvert) Log( "PostSimplification Cleaning: Removed %d duplicated vertices", deldupvert);
                 int delvert=tri::Clean<CMeshO>::RemoveUnreferencedVertex(m.cm);
                 if(delvert) Log( "PostSimplification Cleaning: Removed %d unreferenced vertices",delvert);
@@ -1432,18 +1436,15 @@ bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, Ric
 
     case FP_NORMAL_EXTRAPOLATION :
         {
-      tri::PointCloudNormal<CMeshO>::Param p;
-      p.fittingAdjNum = par.getInt("K");
-      p.smoothingIterNum = par.getInt("smoothIter");
-      p.viewPoint = par.getPoint3m("viewPos");
-      p.useViewPoint = par.getBool("flipFlag");
-      tri::PointCloudNormal<CMeshO>::Compute(m.cm, p,cb);
+      MLPointCloudNormal::Compute(m.cm, par.getInt("K"), par.getInt("smoothIter"),
+                                  par.getBool("flipFlag"), par.getPoint3m("viewPos"), cb);
+      MLKnnGraph::invalidate(m.cm);
         } break;
 
     case FP_NORMAL_SMOOTH_POINTCLOUD :
         {
-            tri::Allocator<CMeshO>::CompactVertexVector(m.cm);
-            tri::Smooth<CMeshO>::VertexNormalPointCloud(m.cm,par.getInt("K"),1);
+            MLPointCloudNormal::Smooth(m.cm,par.getInt("K"),1);
+            MLKnnGraph::invalidate(m.cm);
         } break;
 
 
@@ -1500,9 +1501,9 @@ bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, Ric
             bool NewFaceSelectedFlag = par.getBool("NewFaceSelected");
             int holeCnt;
             if( SelfIntersectionFlag )
-                holeCnt = tri::Hole<CMeshO>::EarCuttingIntersectionFill<tri::SelfIntersectionEar< CMeshO> >(m.cm,MaxHoleSize,SelectedFlag,cb);
+                holeCnt = HoleFilling<CMeshO>::EarCuttingIntersectionFill(m.cm,MaxHoleSize,SelectedFlag,cb);
             else
-                holeCnt = tri::Hole<CMeshO>::EarCuttingFill<vcg::tri::MinimumWeightEar< CMeshO> >(m.cm,MaxHoleSize,SelectedFlag,cb);
+                holeCnt = HoleFilling<CMeshO>::EarCuttingFill<vcg::tri::MinimumWeightEar< CMeshO> >(m.cm,MaxHoleSize,SelectedFlag,cb);
             Log("Closed %i holes and added %i new faces",holeCnt,m.cm.fn-OriginalSize);
             assert(tri::Clean<CMeshO>::IsFFAdjacencyConsistent(m.cm));
             m.UpdateBoxAndNormals();
@@ -1813,6 +1814,25 @@ bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, Ric
     return true;
 }
 
+// the cleaning, normal and clustering filters that only touch the current mesh can run on many layers at once.
+// Not the quadric simplification: the edge collapses of vcg share a process wide GlobalMark.
+bool ExtraMeshFilterPlugin::supportsConcurrentLayers(QAction * filter) const
+{
+    switch (ID(filter))
+    {
+    case FP_SELECT_FACES_BY_AREA:
+    case FP_REMOVE_UNREFERENCED_VERTEX:
+    case FP_REMOVE_DUPLICATED_VERTEX:
+    case FP_CLUSTERING:
+    case FP_INVERT_FACES:
+    case FP_NORMAL_EXTRAPOLATION:
+    case FP_NORMAL_SMOOTH_POINTCLOUD:
+        return true;
+    default:
+        return false;
+    }
+}
+
 int ExtraMeshFilterPlugin::postCondition(QAction * filter) const
 {
     switch (ID(filter))
@@ -94,6 +94,7 @@ public:
     int postCondition(QAction *filter) const;
     int getPreCondition(QAction *filter) const;
     FILTER_ARITY filterArity(QAction *) const {return SINGLE_MESH;}
+    bool supportsConcurrentLayers(QAction *filter) const;
 
 protected:
 
@@ -0,0 +1,384 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef SUBDIVISION_H
+#define SUBDIVISION_H
+
+#include <vector>
+#include <vcg/complex/complex.h>
+#include <vcg/simplex/face/pos.h>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+/*
+Parallel versions of tri::Refine (RefineE with an EdgeLen predicate) and
+tri::RefineOddEven, using the same edge point and even point functors (MidPoint,
+MidPointButterfly, OddPointLoopGeneric, EvenPointLoopGeneric...).
+
+Instead of walking the faces and growing the vectors one split at a time, the refinement
+is done in passes over preallocated data:
+- the edges to split are found with the FF adjacency; each one is owned by the face with
+  the lowest index and numbered with a prefix sum of the owned edges of every face;
+- the vertices and the faces to be added are counted, and both vectors are grown once;
+- the new edge points (and, for RefineOddEven, the updated even vertices) are computed in
+  parallel, every thread with its own copy of the functor;
+- every face writes its sub triangles (2, 3 or 4, as in RefineE) in parallel, in the
+  slots given by a prefix sum of the number of split edges per face.
+
+As in RefineE an edge is split if it is longer than the threshold and, when refining
+only the selection, if at least one of its faces is selected; the new faces copy the
+attributes of the face they come from, the wedge texture coordinates are interpolated
+with the WedgeInterp of the functor and the face border flags are kept up to date.
+Unlike RefineE the FF adjacency is not rebuilt: it is left to the caller.
+
+Requires FF adjacency and compact vertex and face vectors.
+*/
+template <class MeshType>
+class ParallelRefine
+{
+public:
+    typedef typename MeshType::ScalarType ScalarType;
+    typedef typename MeshType::CoordType CoordType;
+    typedef typename MeshType::VertexType VertexType;
+    typedef typename MeshType::FaceType FaceType;
+    typedef vcg::face::Pos<FaceType> PosType;
+    typedef typename MeshType::template PerVertexAttributeHandle<int> ValenceAttrib;
+
+    // tri::Refine: splits the edges longer than threshold, placing the new vertices with mid.
+    // Returns false if no edge has been split.
+    template <class EdgePoint>
+    static bool Refine(MeshType &m, EdgePoint mid, ScalarType threshold, bool selected = false, vcg::CallBackPos *cb = 0)
+    {
+        Split split;
+        if (cb) cb(0, "Refining");
+        FindEdges(m, threshold, selected, split);
+        if (split.edgeNum == 0)
+            return false;
+        AddEdgePoints(m, mid, split, cb);
+        SplitFaces(m, mid, split, cb);
+        return true;
+    }
+
+    // tri::RefineOddEven: splits the edges longer than threshold, placing the new vertices
+    // with odd, and moves the vertices of the (selected) faces with even; both the odd and
+    // the even points are computed from the original positions.
+    template <class OddPoint, class EvenPoint>
+    static bool RefineOddEven(MeshType &m, OddPoint odd, EvenPoint even, ScalarType threshold, bool selected = false, vcg::CallBackPos *cb = 0)
+    {
+        const int vertNum = int(m.vert.size());
+        const int faceNum = int(m.face.size());
+        ValenceAttrib valence = vcg::tri::Allocator<MeshType>::template AddPerVertexAttribute<int>(m);
+        odd.valence = &valence;
+        even.valence = &valence;
+
+        // valence (number of incident faces) of every vertex and the first corner of a
+        // refined face referring to it, the one from which RefineOddEven moves it
+        std::vector<int> corner(vertNum, -1);
+        for (int i = 0; i < vertNum; ++i)
+            valence[i] = 0;
+        for (int f = 0; f < faceNum; ++f)
+        {
+            const FaceType &face = m.face[f];
+            if (face.IsD()) continue;
+            const bool refined = !selected || face.IsS();
+            for (int j = 0; j < 3; ++j)
+            {
+                const int vi = Index(m, face.cV(j));
+                ++valence[vi];
+                if (refined && corner[vi] < 0)
+                    corner[vi] = 3 * f + j;
+            }
+        }
+
+        if (cb) cb(0, "Refining");
+        std::vector<CoordType> evenP(vertNum), evenN(vertNum);
+#ifdef _USE_OMP
+        #pragma omp parallel
+#endif
+        {
+            EvenPoint localEven = even;
+            VertexType nv;
+#ifdef _USE_OMP
+            #pragma omp for schedule(dynamic, 1024)
+#endif
+            for (int i = 0; i < vertNum; ++i)
+            {
+                if (corner[i] < 0 || m.vert[i].IsD()) continue;
+                // what the functor does not set is left as it is
+                nv.P() = m.vert[i].cP();
+                nv.N() = m.vert[i].cN();
+                localEven(nv, PosType(&m.face[corner[i] / 3], corner[i] % 3));
+                evenP[i] = nv.cP();
+                evenN[i] = nv.cN();
+            }
+        }
+
+        // as in RefineOddEven the edges are measured, and the odd points computed, on the
+        // original positions: the even ones are written back only after the split
+        Split split;
+        FindEdges(m, threshold, selected, split);
+        if (split.edgeNum > 0)
+        {
+            AddEdgePoints(m, odd, split, cb);
+            SplitFaces(m, odd, split, cb);
+        }
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+            if (corner[i] >= 0 && !m.vert[i].IsD())
+            {
+                m.vert[i].P() = evenP[i];
+                m.vert[i].N() = evenN[i];
+            }
+        vcg::tri::Allocator<MeshType>::DeletePerVertexAttribute(m, valence);
+        return true;
+    }
+
+private:
+    struct Split
+    {
+        int edgeNum;                // number of split edges (new vertices)
+        int newFaceNum;
+        int vertBase;               // index of the first new vertex
+        std::vector<int> faceEdge;  // 3 per face: index of the new vertex on the edge, or -1
+        std::vector<int> owner;     // per split edge: 3*face+edge of the owning face
+        std::vector<int> faceBase;  // per face: offset of its first added face
+        Split() : edgeNum(0), newFaceNum(0), vertBase(0) {}
+    };
+
+    static int Index(const MeshType &m, const VertexType *v) { return int(v - &m.vert[0]); }
+    static int Index(const MeshType &m, const FaceType *f) { return int(f - &m.face[0]); }
+
+    static void FindEdges(MeshType &m, ScalarType threshold, bool selected, Split &s)
+    {
+        const int faceNum = int(m.face.size());
+        const ScalarType squaredThr = threshold * threshold;
+        s.vertBase = int(m.vert.size());
+        s.faceEdge.assign(3 * faceNum, -1);
+        std::vector<int> ownBase(faceNum + 1, 0);
+
+        // the owned edges to split, marked with 0 and counted per face
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int f = 0; f < faceNum; ++f)
+        {
+            FaceType &face = m.face[f];
+            if (face.IsD()) continue;
+            int n = 0;
+            for (int j = 0; j < 3; ++j)
+            {
+                const FaceType *g = face.cFFp(j);
+                if (g != &face && Index(m, g) < f) continue;
+                if (selected && !face.IsS() && !g->IsS()) continue;
+                if (vcg::SquaredDistance(face.cP0(j), face.cP1(j)) <= squaredThr) continue;
+                s.faceEdge[3 * f + j] = 0;
+                ++n;
+            }
+            ownBase[f + 1] = n;
+        }
+        for (int f = 0; f < faceNum; ++f)
+            ownBase[f + 1] += ownBase[f];
+        s.edgeNum = ownBase[faceNum];
+        if (s.edgeNum == 0)
+            return;
+
+        s.owner.resize(s.edgeNum);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int f = 0; f < faceNum; ++f)
+        {
+            int e = ownBase[f];
+            for (int j = 0; j < 3; ++j)
+                if (s.faceEdge[3 * f + j] == 0)
+                {
+                    s.owner[e] = 3 * f + j;
+                    s.faceEdge[3 * f + j] = s.vertBase + e;
+                    ++e;
+                }
+        }
+
+        // the other side of every split edge, and the faces added by every face
+        s.faceBase.assign(faceNum + 1, 0);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int f = 0; f < faceNum; ++f)
+        {
+            const FaceType &face = m.face[f];
+            if (face.IsD()) continue;
+            int n = 0;
+            for (int j = 0; j < 3; ++j)
+            {
+                const FaceType *g = face.cFFp(j);
+                if (g != &face && Index(m, g) < f)
+                    s.faceEdge[3 * f + j] = s.faceEdge[3 * Index(m, g) + face.cFFi(j)];
+                if (s.faceEdge[3 * f + j] >= 0)
+                    ++n;
+            }
+            s.faceBase[f + 1] = n;
+        }
+        for (int f = 0; f < faceNum; ++f)
+            s.faceBase[f + 1] += s.faceBase[f];
+        s.newFaceNum = s.faceBase[faceNum];
+    }
+
+    template <class EdgePoint>
+    static void AddEdgePoints(MeshType &m, EdgePoint &mid, const Split &s, vcg::CallBackPos *cb)
+    {
+        if (cb) cb(30, "Refining");
+        vcg::tri::Allocator<MeshType>::AddVertices(m, s.edgeNum);
+#ifdef _USE_OMP
+        #pragma omp parallel
+#endif
+        {
+            EdgePoint localMid = mid;
+#ifdef _USE_OMP
+            #pragma omp for schedule(dynamic, 1024)
+#endif
+            for (int e = 0; e < s.edgeNum; ++e)
+                localMid(m.vert[s.vertBase + e], PosType(&m.face[s.owner[e] / 3], s.owner[e] % 3));
+        }
+    }
+
+    template <class EdgePoint>
+    static void SplitFaces(MeshType &m, EdgePoint &mid, const Split &s, vcg::CallBackPos *cb)
+    {
+        if (cb) cb(60, "Refining");
+        const int faceNum = int(s.faceBase.size()) - 1;
+        vcg::tri::Allocator<MeshType>::AddFaces(m, s.newFaceNum);
+        const bool wedgeTex = vcg::tri::HasPerWedgeTexCoord(m);
+#ifdef _USE_OMP
+        #pragma omp parallel
+#endif
+        {
+            EdgePoint localMid = mid;
+#ifdef _USE_OMP
+            #pragma omp for schedule(dynamic, 1024)
+#endif
+            for (int f = 0; f < faceNum; ++f)
+            {
+                if (s.faceBase[f + 1] == s.faceBase[f]) continue;
+                FaceType &face = m.face[f];
+
+                // the corners and the edge points, 3+j being the one on the edge j
+                VertexType *vv[6];
+                typename FaceType::TexCoordType wt[6];
+                for (int j = 0; j < 3; ++j)
+                {
+                    vv[j] = face.V(j);
+                    const int e = s.faceEdge[3 * f + j];
+                    vv[3 + j] = (e >= 0) ? &m.vert[e] : 0;
+                }
+                if (wedgeTex)
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        wt[j] = face.WT(j);
+                        if (vv[3 + j])
+                            wt[3 + j] = localMid.WedgeInterp(face.WT(j), face.WT((j + 1) % 3));
+                    }
+
+                int tri[4][3], orig[4][3];
+                const int triNum = Triangulate(vv, tri, orig);
+                const int orgFlags = face.Flags();
+                FaceType *nf[4];
+                nf[0] = &face;
+                for (int i = 1; i < triNum; ++i)
+                {
+                    nf[i] = &m.face[faceNum + s.faceBase[f] + i - 1];
+                    nf[i]->ImportData(face);
+                }
+                for (int i = 0; i < triNum; ++i)
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        nf[i]->V(j) = vv[tri[i][j]];
+                        if (wedgeTex)
+                            nf[i]->WT(j) = wt[tri[i][j]];
+                        if (orig[i][j] >= 0 && (orgFlags & (FaceType::BORDER0 << orig[i][j])))
+                            nf[i]->SetB(j);
+                        else
+                            nf[i]->ClearB(j);
+                    }
+            }
+        }
+    }
+
+    // Splits a face in the triangles of RefineE. tri gets the indexes in vv of their
+    // corners and orig, for every edge of them, the edge of the face it lies on (-1 if
+    // none). Returns the number of triangles.
+    static int Triangulate(VertexType *vv[6], int tri[4][3], int orig[4][3])
+    {
+        const int mask = (vv[3] ? 1 : 0) | (vv[4] ? 2 : 0) | (vv[5] ? 4 : 0);
+        switch (mask)
+        {
+        case 1: case 2: case 4:
+        {
+            const int j = (mask == 1) ? 0 : (mask == 2) ? 1 : 2;
+            const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            SetTri(tri[0], orig[0], j, 3 + j, j2, j, -1, j2);
+            SetTri(tri[1], orig[1], 3 + j, j1, j2, j, j1, -1);
+            return 2;
+        }
+        case 3: case 5: case 6:
+        {
+            // j and j1 are split: the triangle on their common corner, plus the remaining
+            // quad cut along its shorter diagonal
+            const int j = (mask == 3) ? 0 : (mask == 6) ? 1 : 2;
+            const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            const int a = 3 + j, b = 3 + j1;
+            SetTri(tri[0], orig[0], a, j1, b, j, j1, -1);
+            if (vcg::SquaredDistance(vv[j]->cP(), vv[b]->cP()) <= vcg::SquaredDistance(vv[a]->cP(), vv[j2]->cP()))
+            {
+                SetTri(tri[1], orig[1], j, a, b, j, -1, -1);
+                SetTri(tri[2], orig[2], j, b, j2, -1, j1, j2);
+            }
+            else
+            {
+                SetTri(tri[1], orig[1], j, a, j2, j, -1, j2);
+                SetTri(tri[2], orig[2], a, b, j2, -1, j1, -1);
+            }
+            return 3;
+        }
+        case 7:
+            SetTri(tri[0], orig[0], 0, 3, 5, 0, -1, 2);
+            SetTri(tri[1], orig[1], 3, 1, 4, 0, 1, -1);
+            SetTri(tri[2], orig[2], 5, 4, 2, -1, 1, 2);
+            SetTri(tri[3], orig[3], 3, 4, 5, -1, -1, -1);
+            return 4;
+        default:
+            SetTri(tri[0], orig[0], 0, 1, 2, 0, 1, 2);
+            return 1;
+        }
+    }
+
+    static void SetTri(int t[3], int o[3], int v0, int v1, int v2, int e0, int e1, int e2)
+    {
+        t[0] = v0; t[1] = v1; t[2] = v2;
+        o[0] = e0; o[1] = e1; o[2] = e2;
+    }
+};
+
+#endif // SUBDIVISION_H
@@ -1,4 +1,5 @@
 include(../../shared.pri)
+include(../../openmp.pri)
 
 # CONFIG += debug
 
@@ -22,7 +22,7 @@
 ****************************************************************************/
 
 #include "mlssurface.h"
-#include <vcg/space/index/kdtree/kdtree.h>
+#include <common/ml_knn_graph.h>
 #include <iostream>
 #include <limits>
 #include <vcg/space/index/octree.h>
@@ -123,17 +123,28 @@ void MlsSurface<_MeshType>::computeVertexRaddi(const int nbNeighbors)
 //	int nbNeighbors = 16;
 
     assert(mPoints.size()>=2);
-    vcg::KdTree<Scalar> knn(positions());
-    typename vcg::KdTree<Scalar>::PriorityQueue pq;
-//    knn.setMaxNofNeighbors(nbNeighbors);
-    mAveragePointSpacing = 0;
-    for (size_t i = 0; i< mPoints.size(); i++)
+    // the neighbor graph does not include the point itself, that was the closest of the
+    // nbNeighbors returned by the kd-tree query
+    const MLKnnGraph& knn = MLKnnGraph::get(const_cast<MeshType&>(mMesh), nbNeighbors - 1);
+    const int nbFound = std::min(nbNeighbors - 1, knn.k());
+    const int pointNum = int(mPoints.size());
+    double spacing = 0;
+    int count = 0;
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static) reduction(+:spacing,count)
+#endif
+    for (int i = 0; i < pointNum; i++)
     {
-        knn.doQueryK(mPoints[i].cP(),nbNeighbors,pq);
-        const_cast<PointsType&>(mPoints)[i].R() = 2. * sqrt(pq.getTopWeight()/Scalar(pq.getNofElements()));
-        mAveragePointSpacing += mPoints[i].cR();
+        if (mPoints[i].IsD() || nbFound <= 0)
+            continue;
+        const Scalar maxDist2 = vcg::SquaredDistance(mPoints[i].cP(), mPoints[knn.neighbors(i)[nbFound - 1]].cP());
+        const_cast<PointsType&>(mPoints)[i].R() = 2. * sqrt(maxDist2/Scalar(nbFound + 1));
+        spacing += mPoints[i].cR();
+        ++count;
     }
-    mAveragePointSpacing /= Scalar(mPoints.size());
+    mAveragePointSpacing = (count > 0) ? Scalar(spacing / count) : Scalar(0);
+    // the radii were the last use of the graph
+    MLKnnGraph::invalidate(const_cast<MeshType&>(mMesh));
 
     #endif
 }
@@ -31,6 +31,7 @@ $Log: samplefilter.cpp,v $
 #include <limits>
 
 #include "filter_sampling.h"
+#include "poisson_disk_pruning.h"
 
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/point_sampling.h>
@@ -540,6 +541,7 @@ void FilterDocSampling::initParameterSet(QAction *action, MeshDocument & md, Ric
     parlst.addParam(new RichInt("BestSamplePool", 10, "Best Sample Pool Size", "Used only if the Best Sample Flag is true. It control the number of attempt that it makes to get the best sample. It is reasonable that it is smaller than the Montecarlo oversampling factor."));
     parlst.addParam(new RichBool("ExactNumFlag", false, "Exact number of samples", "If requested it will try to do a dicotomic search for the best poisson disk radius that will generate the requested number of samples with a tolerance of the 0.5%. Obviously it takes much longer."));
     parlst.addParam(new RichFloat("RadiusVariance", 1, "Radius Variance", "The radius of the disk is allowed to vary between r and r*var. If this parameter is 1 the sampling is the same of the Poisson Disk Sampling"));
+    parlst.addParam(new RichBool("ParallelPruning", true, "Parallel Pruning", "If true the Montecarlo samples are pruned in parallel, processing at the same time grid cells that are far enough to not interfere. The properties of the sampling are the same of the serial pruning, that can still be used to compare the speed of the two methods."));
     break;
 
   case FP_TEXEL_SAMPLING :
@@ -928,10 +930,21 @@ bool FilterDocSampling::applyFilter(QAction *action, MeshDocument &md, RichParam
     pp.geodesicDistanceFlag=par.getBool("ApproximateGeodesicDistance");
     pp.bestSampleChoiceFlag=par.getBool("BestSampleFlag");
     pp.bestSamplePoolSize =par.getInt("BestSamplePool");
+    bool parallelFlag = par.getBool("ParallelPruning");
+    QTime tp;tp.start();
     if(par.getBool("ExactNumFlag"))
-      tri::SurfaceSampling<CMeshO,BaseSampler>::PoissonDiskPruningByNumber(mps, *presampledMesh, sampleNum, radius,pp,0.005);
+    {
+      if(parallelFlag) ParallelPoissonPruning<CMeshO,BaseSampler>::PruneByNumber(mps, *presampledMesh, sampleNum, radius,pp,0.005);
+      else tri::SurfaceSampling<CMeshO,BaseSampler>::PoissonDiskPruningByNumber(mps, *presampledMesh, sampleNum, radius,pp,0.005);
+    }
     else
-      tri::SurfaceSampling<CMeshO,BaseSampler>::PoissonDiskPruning(mps, *presampledMesh, radius,pp);
+    {
+      if(parallelFlag) ParallelPoissonPruning<CMeshO,BaseSampler>::Prune(mps, *presampledMesh, radius,pp);
+      else tri::SurfaceSampling<CMeshO,BaseSampler>::PoissonDiskPruning(mps, *presampledMesh, radius,pp);
+    }
+    int pruneTime = tp.elapsed();
+    Log("%s pruning of %i samples took %i msec (%.0f samples/sec)", parallelFlag?"Parallel":"Serial",
+        presampledMesh->vn, pruneTime, double(presampledMesh->vn)*1000.0/std::max(1,pruneTime));
 
     //tri::SurfaceSampling<CMeshO,BaseSampler>::PoissonDisk(curMM->cm, mps, *presampledMesh, radius,pp);
     vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);
@@ -1,6 +1,8 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += filter_sampling.h \
+    poisson_disk_pruning.h \
     $$VCGDIR/vcg/complex/algorithms/point_sampling.h
 SOURCES       += filter_sampling.cpp
 TARGET        = filter_sampling
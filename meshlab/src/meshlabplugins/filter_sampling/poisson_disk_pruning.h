@@ -0,0 +1,363 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef POISSON_DISK_PRUNING_H
+#define POISSON_DISK_PRUNING_H
+
+#include <vcg/complex/algorithms/point_sampling.h>
+#include <vcg/complex/algorithms/stat.h>
+#include <vcg/simplex/vertex/distance.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+/*
+Parallel version of SurfaceSampling::PoissonDiskPruning.
+
+As in the serial version the Montecarlo samples are bucketed in a grid of cells
+of side 2r/sqrt(3) and, pass after pass, every non empty cell picks one of its
+samples and removes all the samples closer than r, until no sample is left.
+
+Cells are colored in 27 phase groups according to their coords modulo 3: two
+cells of the same group are at least two cells apart along some axis, so their
+picked samples are farther than r and the neighbourhoods they prune (the 3x3x3
+block around each cell) are disjoint. The cells of a group are processed
+concurrently, the groups one after the other, so the result is still a maximal
+Poisson disk set where no two samples are closer than their radius.
+Samples are emitted in a deterministic order that does not depend on the
+number of threads.
+*/
+template <class MeshType, class VertexSampler>
+class ParallelPoissonPruning
+{
+public:
+    typedef typename MeshType::ScalarType ScalarType;
+    typedef typename MeshType::CoordType CoordType;
+    typedef typename MeshType::VertexType VertexType;
+    typedef typename vcg::tri::SurfaceSampling<MeshType,VertexSampler> SurfaceSampling;
+    typedef typename SurfaceSampling::PoissonDiskParam PoissonDiskParam;
+
+    // Same interface and parameters of SurfaceSampling::PoissonDiskPruning
+    static void Prune(VertexSampler &ps, MeshType &montecarloMesh, ScalarType diskRadius, PoissonDiskParam &pp)
+    {
+        if(diskRadius<=0) return;
+        ParallelPoissonPruning pruner(montecarloMesh, diskRadius, pp);
+        pruner.Run(ps, pp);
+    }
+
+    // Same interface and parameters of SurfaceSampling::PoissonDiskPruningByNumber:
+    // dicotomic search of the radius that gives sampleNum samples within the tolerance.
+    static void PruneByNumber(VertexSampler &ps, MeshType &m, size_t sampleNum, ScalarType &diskRadius,
+                              PoissonDiskParam &pp, float tolerance=0.04f, int maxIter=20)
+    {
+        size_t sampleNumMin = size_t(float(sampleNum)*(1.0f-tolerance));
+        size_t sampleNumMax = size_t(float(sampleNum)*(1.0f+tolerance));
+        ScalarType rangeMinRad = m.bbox.Diag()/10.0f;
+        ScalarType rangeMaxRad = m.bbox.Diag()/10.0f;
+        do {
+            ps.reset();
+            rangeMinRad/=2.0f;
+            Prune(ps, m, rangeMinRad, pp);
+        } while(size_t(pp.pds.sampleNum) < sampleNum);
+        do {
+            ps.reset();
+            rangeMaxRad*=2.0f;
+            Prune(ps, m, rangeMaxRad, pp);
+        } while(size_t(pp.pds.sampleNum) > sampleNum);
+
+        ScalarType curRadius=rangeMaxRad;
+        int iterCnt=0;
+        while(iterCnt<maxIter && (size_t(pp.pds.sampleNum) < sampleNumMin || size_t(pp.pds.sampleNum) > sampleNumMax))
+        {
+            iterCnt++;
+            ps.reset();
+            curRadius=(rangeMaxRad+rangeMinRad)/2.0f;
+            Prune(ps, m, curRadius, pp);
+            if(size_t(pp.pds.sampleNum) > sampleNum) rangeMinRad = curRadius;
+            if(size_t(pp.pds.sampleNum) < sampleNum) rangeMaxRad = curRadius;
+        }
+        diskRadius = curRadius;
+    }
+
+private:
+    MeshType &mc;
+    ScalarType cellSize;
+    CoordType origin;
+    long long dim[3];
+
+    std::vector<long long> cellKey;   // sorted keys of the non empty cells
+    std::vector<int> cellStart;       // samples of cell i are sampleIdx[cellStart[i]..cellStart[i+1])
+    std::vector<int> sampleIdx;       // Montecarlo vertex indexes, sorted by cell
+    std::vector<int> cellAlive;       // number of samples still available in each cell
+    std::vector<char> alive;          // per Montecarlo vertex
+    std::vector<ScalarType> radius;   // per Montecarlo vertex, only for adaptive radius
+    std::vector<int> phase[27];       // cells of each phase group
+
+    ScalarType diskRadius;
+    bool geodesicFlag;
+    bool bestSampleFlag;
+    int bestSamplePoolSize;
+
+    ParallelPoissonPruning(MeshType &montecarloMesh, ScalarType _diskRadius, const PoissonDiskParam &pp)
+        : mc(montecarloMesh), diskRadius(_diskRadius)
+    {
+        geodesicFlag = pp.geodesicDistanceFlag;
+        bestSampleFlag = pp.bestSampleChoiceFlag;
+        bestSamplePoolSize = std::max(1, pp.bestSamplePoolSize);
+
+        const int vn = int(mc.vert.size());
+        ScalarType maxRadius = diskRadius;
+        if(pp.adaptiveRadiusFlag)
+        {
+            ComputeRadii(pp.radiusVariance, pp.invertQuality);
+            maxRadius = diskRadius * std::max(ScalarType(1), ScalarType(pp.radiusVariance));
+        }
+
+        cellSize = 2.0f * maxRadius / sqrt(3.0f);
+        vcg::Box3<ScalarType> bb;
+        for(int i=0;i<vn;++i)
+            if(!mc.vert[i].IsD()) bb.Add(mc.vert[i].cP());
+        if(pp.preGenFlag)
+            for(size_t i=0;i<pp.preGenMesh->vert.size();++i)
+                if(!pp.preGenMesh->vert[i].IsD()) bb.Add(pp.preGenMesh->vert[i].cP());
+        origin = bb.min;
+        for(int k=0;k<3;++k)
+            dim[k] = bb.IsNull() ? 1 : (long long)(bb.Dim()[k]/cellSize) + 1;
+
+        // bucket the samples: sort (cell key, vertex index) pairs
+        std::vector<std::pair<long long,int> > keyed(vn);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for(int i=0;i<vn;++i)
+            keyed[i] = std::make_pair(mc.vert[i].IsD() ? -1LL : Cell(mc.vert[i].cP()), i);
+        std::sort(keyed.begin(), keyed.end());
+
+        sampleIdx.reserve(vn);
+        alive.assign(vn, 0);
+        for(int i=0;i<vn;++i)
+        {
+            if(keyed[i].first < 0) continue;
+            if(cellKey.empty() || cellKey.back() != keyed[i].first)
+            {
+                cellKey.push_back(keyed[i].first);
+                cellStart.push_back(int(sampleIdx.size()));
+            }
+            sampleIdx.push_back(keyed[i].second);
+            alive[keyed[i].second] = 1;
+        }
+        cellStart.push_back(int(sampleIdx.size()));
+
+        const int cn = int(cellKey.size());
+        cellAlive.resize(cn);
+        for(int c=0;c<cn;++c)
+        {
+            cellAlive[c] = cellStart[c+1]-cellStart[c];
+            long long i[3];
+            Coords(cellKey[c], i);
+            phase[(i[0]%3)*9 + (i[1]%3)*3 + (i[2]%3)].push_back(c);
+        }
+    }
+
+    void Run(VertexSampler &ps, PoissonDiskParam &pp)
+    {
+        pp.pds.sampleNum = 0;
+        pp.pds.gridSize = vcg::Point3i(int(dim[0]), int(dim[1]), int(dim[2]));
+        pp.pds.gridCellNum = int(cellKey.size());
+
+        // samples to be refined are added first and prune their neighbourhood
+        if(pp.preGenFlag)
+        {
+            for(size_t i=0;i<pp.preGenMesh->vert.size();++i)
+            {
+                const VertexType &v = pp.preGenMesh->vert[i];
+                if(v.IsD()) continue;
+                ps.AddVert(v);
+                pp.pds.sampleNum++;
+                RemoveInSphere(v.cP(), v.cN(), diskRadius);
+            }
+        }
+
+        std::vector<int> picked;
+        std::vector<int> order(27);
+        for(int g=0;g<27;++g) order[g]=g;
+        bool nonEmpty=true;
+        while(nonEmpty)
+        {
+            nonEmpty=false;
+            std::random_shuffle(order.begin(), order.end(), SurfaceSampling::RandomInt);
+            for(int g=0;g<27;++g)
+            {
+                const std::vector<int> &group = phase[order[g]];
+                const int gn = int(group.size());
+                picked.assign(gn, -1);
+#ifdef _USE_OMP
+                #pragma omp parallel for schedule(dynamic, 64)
+#endif
+                for(int k=0;k<gn;++k)
+                {
+                    const int c = group[k];
+                    if(cellAlive[c]==0) continue;
+                    const int si = PickSample(c);
+                    const VertexType &v = mc.vert[si];
+                    RemoveInSphere(v.cP(), v.cN(), radius.empty() ? diskRadius : radius[si]);
+                    // the sphere test is strict: the picked sample must go in any case, or
+                    // the cell would never be emptied
+                    if(alive[si])
+                    {
+                        alive[si]=0;
+                        cellAlive[c]--;
+                    }
+                    picked[k] = si;
+                }
+                // samples are added in the same order whatever the number of threads
+                for(int k=0;k<gn;++k)
+                    if(picked[k]>=0)
+                    {
+                        ps.AddVert(mc.vert[picked[k]]);
+                        pp.pds.sampleNum++;
+                        nonEmpty=true;
+                    }
+            }
+        }
+    }
+
+    // Per sample radius from the quality, as in SurfaceSampling::ComputePoissonSampleRadii,
+    // but never below a thousandth of the disk radius (a variance of 0 gives a null radius)
+    void ComputeRadii(float radiusVariance, bool invertQuality)
+    {
+        const int vn = int(mc.vert.size());
+        radius.assign(vn, diskRadius);
+        std::pair<ScalarType,ScalarType> minmax = vcg::tri::Stat<MeshType>::ComputePerVertexQualityMinMax(mc);
+        const ScalarType deltaQ = minmax.second-minmax.first;
+        const ScalarType deltaRad = diskRadius*radiusVariance - diskRadius;
+        const ScalarType minRadius = diskRadius * ScalarType(1e-3);
+        if(deltaQ<=0) return;
+        for(int i=0;i<vn;++i)
+        {
+            ScalarType q = mc.vert[i].cQ();
+            if(invertQuality) q = minmax.second - (q - minmax.first);
+            radius[i] = std::max(minRadius, diskRadius + deltaRad*((q-minmax.first)/deltaQ));
+        }
+    }
+
+    // First available sample of the cell or, with the best sample heuristic, the one
+    // (among the first bestSamplePoolSize) that removes the smallest number of samples
+    int PickSample(int c) const
+    {
+        int best=-1, bestCnt=std::numeric_limits<int>::max(), pool=0;
+        for(int i=cellStart[c];i<cellStart[c+1] && pool<bestSamplePoolSize;++i)
+        {
+            const int si = sampleIdx[i];
+            if(!alive[si]) continue;
+            if(!bestSampleFlag) return si;
+            pool++;
+            const VertexType &v = mc.vert[si];
+            const int cnt = CountInSphere(v.cP(), v.cN(), radius.empty() ? diskRadius : radius[si]);
+            if(cnt<bestCnt) { best=si; bestCnt=cnt; }
+        }
+        return best;
+    }
+
+    bool InSphere(const CoordType &p, const CoordType &n, ScalarType r, const VertexType &v) const
+    {
+        if(geodesicFlag)
+        {
+            vcg::vertex::ApproximateGeodesicDistanceFunctor<VertexType> GDF;
+            return GDF(p, n, v.cP(), v.cN()) < r;
+        }
+        return vcg::SquaredDistance(p, v.cP()) < r*r;
+    }
+
+    int CountInSphere(const CoordType &p, const CoordType &n, ScalarType r) const
+    {
+        int cnt=0;
+        long long i[3];
+        Cell(p, i);
+        for(long long z=i[2]-1;z<=i[2]+1;++z)
+            for(long long y=i[1]-1;y<=i[1]+1;++y)
+                for(long long x=i[0]-1;x<=i[0]+1;++x)
+                {
+                    const int c = FindCell(x,y,z);
+                    if(c<0 || cellAlive[c]==0) continue;
+                    for(int j=cellStart[c];j<cellStart[c+1];++j)
+                        if(alive[sampleIdx[j]] && InSphere(p, n, r, mc.vert[sampleIdx[j]])) cnt++;
+                }
+        return cnt;
+    }
+
+    // r is never larger than the cell size, so only the 3x3x3 block around p is touched
+    void RemoveInSphere(const CoordType &p, const CoordType &n, ScalarType r)
+    {
+        long long i[3];
+        Cell(p, i);
+        for(long long z=i[2]-1;z<=i[2]+1;++z)
+            for(long long y=i[1]-1;y<=i[1]+1;++y)
+                for(long long x=i[0]-1;x<=i[0]+1;++x)
+                {
+                    const int c = FindCell(x,y,z);
+                    if(c<0 || cellAlive[c]==0) continue;
+                    for(int j=cellStart[c];j<cellStart[c+1];++j)
+                    {
+                        const int si = sampleIdx[j];
+                        if(alive[si] && InSphere(p, n, r, mc.vert[si]))
+                        {
+                            alive[si]=0;
+                            cellAlive[c]--;
+                        }
+                    }
+                }
+    }
+
+    void Cell(const CoordType &p, long long i[3]) const
+    {
+        for(int k=0;k<3;++k)
+            i[k] = std::max(0LL, std::min(dim[k]-1, (long long)floor((p[k]-origin[k])/cellSize)));
+    }
+    long long Cell(const CoordType &p) const
+    {
+        long long i[3];
+        Cell(p, i);
+        return Key(i[0], i[1], i[2]);
+    }
+    long long Key(long long x, long long y, long long z) const { return x + dim[0]*(y + dim[1]*z); }
+    void Coords(long long key, long long i[3]) const
+    {
+        i[0] = key % dim[0]; key /= dim[0];
+        i[1] = key % dim[1];
+        i[2] = key / dim[1];
+    }
+    int FindCell(long long x, long long y, long long z) const
+    {
+        if(x<0 || y<0 || z<0 || x>=dim[0] || y>=dim[1] || z>=dim[2]) return -1;
+        const long long key = Key(x,y,z);
+        typename std::vector<long long>::const_iterator it = std::lower_bound(cellKey.begin(), cellKey.end(), key);
+        if(it==cellKey.end() || *it!=key) return -1;
+        return int(it-cellKey.begin());
+    }
+};
+
+#endif // POISSON_DISK_PRUNING_H
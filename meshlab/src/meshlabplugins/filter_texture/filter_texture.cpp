@@ -174,6 +174,30 @@ static QString extractFilenameWOExt(MeshModel* mm)
     return fi.baseName();
 }
 
+// Revert alpha values for border edge pixels to 255.
+// If the holes are not going to be filled the fully transparent texels are made opaque too
+static void RevertBorderAlpha(QImage &img, bool pullPush)
+{
+    assert(img.depth() == 32);
+    QRgb *texels = reinterpret_cast<QRgb *>(img.bits());
+    const int texelNum = img.width() * img.height();
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < texelNum; ++i)
+    {
+        QRgb px = texels[i];
+        if (qAlpha(px) < 255 && (!pullPush || qAlpha(px) > 0))
+            texels[i] = px | 0xff000000;
+    }
+}
+
+void FilterTexturePlugin::LogTexelRate(long long texelNum, int msec)
+{
+    Log("Rasterized %lld texels in %6.3f s (%.2f Mtexel/s)", texelNum, msec / 1000.0f,
+        msec > 0 ? double(texelNum) / (msec * 1000.0) : 0.0);
+}
+
 // This function define the needed parameters for each filter. Return true if the filter has some parameters
 // it is called every time, so you can set the default value of parameters according to the mesh
 // For each parmeter you need to define,
@@ -753,9 +777,10 @@ bool FilterTexturePlugin::applyFilter(QAction *filter, MeshDocument &md, RichPar
 		tri::UpdateFlags<CMeshO>::FaceBorderFromFF(m.cm);
 
 		// Rasterizing triangles
+		QTime rt; rt.start();
 		RasterSampler rs(trgImgs);
-		rs.InitCallback(cb, m.cm.fn, 0, 80);
-		tri::SurfaceSampling<CMeshO,RasterSampler>::Texture(m.cm,rs,textW,textH,true);
+		long long texelNum = TileRasterizer<RasterSampler>::Texture(m.cm, rs, textW, textH, true, cb, 0, 80);
+		LogTexelRate(texelNum, rt.elapsed());
 
 		// Undo topology changes
 		tri::UpdateTopology<CMeshO>::FaceFace(m.cm);
@@ -765,13 +790,7 @@ bool FilterTexturePlugin::applyFilter(QAction *filter, MeshDocument &md, RichPar
 		{
 			// Revert alpha values for border edge pixels to 255
 			cb(81, "Cleaning up texture ...");
-			for (int y = 0; y<textH; ++y)
-			for (int x = 0; x<textW; ++x)
-			{
-				QRgb px = trgImgs[texInd].pixel(x, y);
-				if (qAlpha(px) < 255 && (!pp || qAlpha(px) > 0))
-				trgImgs[texInd].setPixel(x, y, px | 0xff000000);
-			}
+			RevertBorderAlpha(trgImgs[texInd], pp);
 
 			// PullPush
 			if (pp)
@@ -922,18 +941,19 @@ bool FilterTexturePlugin::applyFilter(QAction *filter, MeshDocument &md, RichPar
 		// Rasterizing faces
 		srcMesh->updateDataMask(MeshModel::MM_FACEMARK);
 		tri::UpdateNormal<CMeshO>::PerFaceNormalized(srcMesh->cm);
+		QTime rt; rt.start();
+		long long texelNum;
 		if (vertexSampling)
 		{
 			TransferColorSampler sampler(srcMesh->cm, trgImgs, upperbound, vertexMode); // color sampling
-			sampler.InitCallback(cb, trgMesh->cm.fn, 0, 80);
-			tri::SurfaceSampling<CMeshO, TransferColorSampler>::Texture(trgMesh->cm, sampler, textW, textH, false);
+			texelNum = TileRasterizer<TransferColorSampler>::Texture(trgMesh->cm, sampler, textW, textH, false, cb, 0, 80);
 		} 
 		else 
 		{ 
 			TransferColorSampler sampler(srcMesh->cm, trgImgs, &srcImgs, upperbound); // texture sampling
-			sampler.InitCallback(cb, trgMesh->cm.fn, 0, 80);
-			tri::SurfaceSampling<CMeshO, TransferColorSampler>::Texture(trgMesh->cm, sampler, textW, textH, false);
+			texelNum = TileRasterizer<TransferColorSampler>::Texture(trgMesh->cm, sampler, textW, textH, false, cb, 0, 80);
 		}
+		LogTexelRate(texelNum, rt.elapsed());
 
 		// the meshes have to return to their original position
 		// only if source different from target (if single mesh, it does not matter)
@@ -953,13 +973,7 @@ bool FilterTexturePlugin::applyFilter(QAction *filter, MeshDocument &md, RichPar
 		{
 			// Revert alpha values for border edge pixels to 255
 			cb(81, "Cleaning up texture ...");
-			for (int y = 0; y<textH; ++y)
-			for (int x = 0; x<textW; ++x)
-			{
-				QRgb px = trgImgs[trgTexInd].pixel(x, y);
-				if (qAlpha(px) < 255 && (!pp || qAlpha(px) > 0))
-					trgImgs[trgTexInd].setPixel(x, y, px | 0xff000000);
-			}
+			RevertBorderAlpha(trgImgs[trgTexInd], pp);
 
 			// PullPush
 			if (pp)
@@ -64,6 +64,9 @@ public:
     virtual int postCondition( QAction* ) const;
     FilterClass getClass(QAction *a);
     FILTER_ARITY filterArity(QAction * filter) const;
+
+private:
+    void LogTexelRate(long long texelNum, int msec);
 };
 
 #endif
@@ -1,4 +1,5 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += filter_texture.h \
 		pushpull.h \
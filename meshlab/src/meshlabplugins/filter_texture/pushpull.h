@@ -50,60 +50,88 @@ namespace vcg
     }
 
     // Genera una mipmap pesata
+    // Works directly on the 32 bit image buffers, each mip row is computed independently
     void PullPushMip( QImage & p, QImage & mip, QRgb  bkcolor )
     {
         assert(p.width()/2==mip.width());
         assert(p.height()/2==mip.height());
-        byte w1,w2,w3,w4;
-        int x,y;
-        for(y=0;y<mip.height();++y)
-            for(x=0;x<mip.width();++x)
+        assert(p.depth()==32 && mip.depth()==32);
+        const int pw=p.width();
+        const int mw=mip.width();
+        const int mh=mip.height();
+        const QRgb *src=reinterpret_cast<const QRgb *>(p.constBits());
+        QRgb *dst=reinterpret_cast<QRgb *>(mip.bits());
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for(int y=0;y<mh;++y)
+        {
+            const QRgb *r0=src+(y*2)*pw;
+            const QRgb *r1=r0+pw;
+            QRgb *d=dst+y*mw;
+            for(int x=0;x<mw;++x)
             {
-                if(p.pixel(x*2  ,y*2  )==bkcolor) w1=0; else w1=255;
-                if(p.pixel(x*2+1,y*2  )==bkcolor) w2=0; else w2=255;
-                if(p.pixel(x*2  ,y*2+1)==bkcolor) w3=0; else w3=255;
-                if(p.pixel(x*2+1,y*2+1)==bkcolor) w4=0; else w4=255;
+                byte w1,w2,w3,w4;
+                if(r0[x*2  ]==bkcolor) w1=0; else w1=255;
+                if(r0[x*2+1]==bkcolor) w2=0; else w2=255;
+                if(r1[x*2  ]==bkcolor) w3=0; else w3=255;
+                if(r1[x*2+1]==bkcolor) w4=0; else w4=255;
                 if(w1+w2+w3+w4>0        )
-                    mip.setPixel(x, y, mean4Pixelw(
-                                                   p.pixel(x*2  ,y*2  ),w1,
-                                                   p.pixel(x*2+1,y*2  ),w2,
-                                                   p.pixel(x*2  ,y*2+1),w3,
-                                                   p.pixel(x*2+1,y*2+1),w4 ));
+                    d[x] = mean4Pixelw(r0[x*2  ],w1,
+                                       r0[x*2+1],w2,
+                                       r1[x*2  ],w3,
+                                       r1[x*2+1],w4 );
             }
+        }
     }
 
     // interpola a partire da una mipmap
+    // Each mip texel fills its own 2x2 block of p, so rows are filled concurrently
     void PullPushFill( QImage & p, QImage & mip, QRgb  bkg )
     {
         assert(p.width()/2==mip.width());
         assert(p.height()/2==mip.height());
-        //      byte w1,w2,w3,w4;
-        int x,y;
-        for(y=0;y<mip.height();++y)
-            for(x=0;x<mip.width();++x)
+        assert(p.depth()==32 && mip.depth()==32);
+        const int pw=p.width();
+        const int mw=mip.width();
+        const int mh=mip.height();
+        QRgb *dst=reinterpret_cast<QRgb *>(p.bits());
+        const QRgb *src=reinterpret_cast<const QRgb *>(mip.constBits());
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for(int y=0;y<mh;++y)
+        {
+            const QRgb *mu=(y>0    ? src+(y-1)*mw : 0); // mip row above
+            const QRgb *mc=src+y*mw;                     // mip row
+            const QRgb *md=(y<mh-1 ? src+(y+1)*mw : 0); // mip row below
+            QRgb *p0=dst+(y*2)*pw;
+            QRgb *p1=p0+pw;
+            for(int x=0;x<mw;++x)
             {
-                if(p.pixel(x*2 ,y*2)==bkg)
-                    p.setPixel(x*2 ,y*2 ,mean4Pixelw( mip.pixel(x  ,y  ) ,  byte(144),
-                                                     (x>0 ? mip.pixel(x-1,y  ) : bkg),  (x>0 ? byte( 48) : 0),
-                                                     (y>0 ? mip.pixel(x  ,y-1) : bkg),  (y>0 ? byte( 48) : 0),
-                                                     ((x>0 && y>0 )? mip.pixel(x-1,y-1) : bkg), ((x>0 && y>0 )? byte( 16) : 0)));
-                if(p.pixel(x*2+1,y*2  )==bkg)
-                    p.setPixel(x*2+1,y*2  ,mean4Pixelw(mip.pixel(x  ,y  ) ,byte(144),
-                                                       (x<mip.width()-1 ? mip.pixel(x+1,y) : bkg),  (x<mip.width()-1 ? byte( 48) : 0),
-                                                       (y>0  ? mip.pixel(x  ,y-1) : bkg),  (y>0  ? byte( 48) : 0),
-                                                       ((x<mip.width()-1 && y>0) ? mip.pixel(x+1,y-1) : bkg), ((x<mip.width()-1 && y>0) ? byte( 16) : 0)));
-                if(p.pixel(x*2  ,y*2+1)==bkg)
-                    p.setPixel(x*2  ,y*2+1, mean4Pixelw( mip.pixel(x  ,y  ), byte(144),
-                                                        (x>0 ? mip.pixel(x-1,y  ) : bkg),  (x>0 ? byte( 48) : 0),
-                                                        (y<mip.height()-1  ? mip.pixel(x  ,y+1) : bkg),  (y<mip.height()-1  ? byte( 48) : 0),
-                                                        ((x>0 && y<mip.height()-1) ? mip.pixel(x-1,y+1) : bkg), ((x>0 && y<mip.height()-1 )? byte( 16) : 0)));
-                if(p.pixel(x*2+1,y*2+1)==bkg)
-                    p.setPixel(x*2+1,y*2+1, mean4Pixelw(mip.pixel(x  ,y  ), byte(144),
-                                                        (x<mip.width()-1 ? mip.pixel(x+1,y  ) : bkg), (x<mip.width()-1 ? byte( 48) : 0),
-                                                        (y<mip.height()-1  ? mip.pixel(x  ,y+1) : bkg), ( y<mip.height()-1  ? byte( 48) : 0),
-                                                        ((x<mip.width()-1  && y<mip.height()-1) ? mip.pixel(x+1,y+1) : bkg), ((x<mip.width()-1  && y<mip.height()-1) ? byte( 16) : 0)));
-
+                const bool l=x>0, r=x<mw-1;
+                if(p0[x*2]==bkg)
+                    p0[x*2] = mean4Pixelw( mc[x] ,  byte(144),
+                                          (l ? mc[x-1] : bkg),  (l ? byte( 48) : 0),
+                                          (mu ? mu[x] : bkg),  (mu ? byte( 48) : 0),
+                                          ((l && mu)? mu[x-1] : bkg), ((l && mu)? byte( 16) : 0));
+                if(p0[x*2+1]==bkg)
+                    p0[x*2+1] = mean4Pixelw(mc[x] ,byte(144),
+                                            (r ? mc[x+1] : bkg),  (r ? byte( 48) : 0),
+                                            (mu ? mu[x] : bkg),  (mu ? byte( 48) : 0),
+                                            ((r && mu) ? mu[x+1] : bkg), ((r && mu) ? byte( 16) : 0));
+                if(p1[x*2]==bkg)
+                    p1[x*2] = mean4Pixelw( mc[x], byte(144),
+                                          (l ? mc[x-1] : bkg),  (l ? byte( 48) : 0),
+                                          (md ? md[x] : bkg),  (md ? byte( 48) : 0),
+                                          ((l && md) ? md[x-1] : bkg), ((l && md)? byte( 16) : 0));
+                if(p1[x*2+1]==bkg)
+                    p1[x*2+1] = mean4Pixelw(mc[x], byte(144),
+                                            (r ? mc[x+1] : bkg), (r ? byte( 48) : 0),
+                                            (md ? md[x] : bkg), (md ? byte( 48) : 0),
+                                            ((r && md) ? md[x+1] : bkg), ((r && md) ? byte( 16) : 0));
             }
+        }
     }
 
 
@@ -27,6 +27,38 @@
 #include <common/interfaces.h>
 #include <vcg/complex/algorithms/point_sampling.h>
 #include <vcg/space/triangle2.h>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+// Direct access to the texels of a set of 32 bit images.
+// QImage::pixel()/setPixel() are slow and setPixel() can detach the image, so
+// they cannot be used concurrently; the buffers are grabbed once here
+// and texels are then addressed directly (y axis pointing up as in uv space).
+class TexelBuffers
+{
+    std::vector<QRgb *> bits;
+    std::vector<int> w, h;
+
+public:
+    TexelBuffers(vector <QImage> &imgs)
+    {
+        for (size_t i = 0; i < imgs.size(); ++i)
+        {
+            assert(imgs[i].depth() == 32);
+            bits.push_back(reinterpret_cast<QRgb *>(imgs[i].bits()));
+            w.push_back(imgs[i].width());
+            h.push_back(imgs[i].height());
+        }
+    }
+
+    // Returns NULL for texels falling outside the image
+    inline QRgb *Texel(int n, int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= w[n] || y >= h[n]) return 0;
+        return bits[n] + (h[n] - 1 - y) * w[n] + x;
+    }
+};
 
 class VertexSampler
 {
@@ -95,27 +127,10 @@ public:
 class RasterSampler
 {
     vector<QImage> &trgImgs;
-
-    // Callback stuff
-    vcg::CallBackPos *cb;
-    const CMeshO::FaceType *currFace;
-    int faceNo, faceCnt, start, offset;
+    TexelBuffers trgTexels;
 
 public:
-	RasterSampler(vector<QImage> &_imgs) : trgImgs(_imgs) {}
-
-    void InitCallback(vcg::CallBackPos *_cb, int _faceNo, int _start=0, int _offset=100)
-    {
-        assert(_faceNo > 0);
-        assert(_start>=0);
-        assert(_offset>=0 && _offset <= 100-_start);
-        cb = _cb;
-        faceNo = _faceNo;
-        faceCnt = 0;
-        start = _start;
-        offset = _offset;
-        currFace = NULL;
-    }
+	RasterSampler(vector<QImage> &_imgs) : trgImgs(_imgs), trgTexels(_imgs) {}
 
         // expects points outside face (affecting face color) with edge distance > 0
     void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist= 0.0)
@@ -130,15 +145,12 @@ public:
         if (edgeDist != 0.0)
             alpha=254-edgeDist*128;
 
-		if (alpha == 255 || qAlpha(trgImgs[f.cWT(0).N()].pixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y())) < alpha)
+        QRgb *texel = trgTexels.Texel(f.cWT(0).N(), tp.X(), tp.Y());
+        if (texel == 0) return;
+        if (alpha == 255 || qAlpha(*texel) < alpha)
         {
             c.lerp(f.cV(0)->cC(), f.cV(1)->cC(), f.cV(2)->cC(), p);
-			trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(c[0], c[1], c[2], alpha));
-        }
-        if (cb)
-        {
-            if (&f != currFace) {currFace = &f; ++faceCnt;}
-            cb(start + faceCnt*offset/faceNo, "Rasterizing faces ...");
+            *texel = qRgba(c[0], c[1], c[2], alpha);
         }
     }
 };
@@ -149,6 +161,7 @@ class TransferColorSampler
     typedef vcg::GridStaticPtr<CMeshO::VertexType, CMeshO::ScalarType > VertexMeshGrid;
 
     vector <QImage> &trgImgs;
+    TexelBuffers trgTexels;
 	vector <QImage> *srcImgs;
     float dist_upper_bound;
     bool fromTexture;
@@ -156,15 +169,12 @@ class TransferColorSampler
     VertexMeshGrid   unifGridVert;
     bool usePointCloudSampling;
 
-    // Callback stuff
-    vcg::CallBackPos *cb;
-    const CMeshO::FaceType *currFace;
     CMeshO *srcMesh;
-    int faceNo, faceCnt, start, offset;
     int vertexMode;
     float minQ,maxQ;
-    typedef vcg::tri::FaceTmark<CMeshO> MarkerFace;
-    MarkerFace markerFunctor;
+    // Grid queries do not mark the visited faces, so that AddTextureSample
+    // can be safely called by many threads at once (see TileRasterizer)
+    typedef vcg::tri::EmptyTMark<CMeshO> MarkerFace;
 
     /*QRgb GetBilinearPixelColor(float _u, float _v, int alpha)
     {
@@ -198,13 +208,12 @@ class TransferColorSampler
 
 public:
     TransferColorSampler(CMeshO &_srcMesh, vector <QImage> &_trgImgs, float upperBound, int _vertexMode)
-    : trgImgs(_trgImgs), dist_upper_bound(upperBound)
+    : trgImgs(_trgImgs), trgTexels(_trgImgs), dist_upper_bound(upperBound)
     {
         srcMesh=&_srcMesh;
         usePointCloudSampling = _srcMesh.face.empty();
         if(usePointCloudSampling) unifGridVert.Set(_srcMesh.vert.begin(),_srcMesh.vert.end());
                         else  unifGridFace.Set(_srcMesh.face.begin(),_srcMesh.face.end());
-        markerFunctor.SetMesh(&_srcMesh);
         fromTexture = false;
         vertexMode=_vertexMode;
         if(vertexMode==2)
@@ -216,26 +225,14 @@ public:
     }
 
 	TransferColorSampler(CMeshO &_srcMesh, vector <QImage> &_trgImgs, vector <QImage> *_srcImgs, float upperBound)
-		: trgImgs(_trgImgs), srcImgs(_srcImgs), dist_upper_bound(upperBound)
+		: trgImgs(_trgImgs), trgTexels(_trgImgs), srcImgs(_srcImgs), dist_upper_bound(upperBound)
     {
+        srcMesh=&_srcMesh;
         unifGridFace.Set(_srcMesh.face.begin(),_srcMesh.face.end());
-        markerFunctor.SetMesh(&_srcMesh);
         fromTexture = true;
         usePointCloudSampling=false;
         vertexMode=-1;
     }
-    void InitCallback(vcg::CallBackPos *_cb, int _faceNo, int _start=0, int _offset=100)
-    {
-        assert(_faceNo > 0);
-        assert(_start>=0);
-        assert(_offset>=0 && _offset <= 100-_start);
-        cb = _cb;
-        faceNo = _faceNo;
-        faceCnt = 0;
-        start = _start;
-        offset = _offset;
-        currFace = NULL;
-    }
 
     void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist=0.0)
     {
@@ -252,6 +249,10 @@ public:
         if (edgeDist != 0.0)
             alpha=254-edgeDist*128;
 
+        // Texels outside the image would be discarded anyway, skip the closest point search
+        QRgb *texel = trgTexels.Texel(f.cWT(0).N(), tp.X(), tp.Y());
+        if (texel == 0) return;
+
         // Get point on face
         CMeshO::CoordType startPt;
         startPt[0] = bary[0]*f.cV(0)->cP().X()+bary[1]*f.cV(1)->cP().X()+bary[2]*f.cV(2)->cP().X();
@@ -264,7 +265,10 @@ public:
         {
             CMeshO::VertexType   *nearestV=0;
             CMeshO::ScalarType dist=dist_upper_bound;
-            nearestV =  vcg::tri::GetClosestVertex<CMeshO,VertexMeshGrid>(*srcMesh,unifGridVert,startPt,dist_upper_bound,dist); //(PDistFunct,markerFunctor,startPt,dist_upper_bound,dist,closestPt);
+            CMeshO::CoordType closestPt;
+            vcg::vertex::PointDistanceFunctor<CMeshO::ScalarType> VDistFunct;
+            MarkerFace markerFunctor;
+            nearestV =  unifGridVert.GetClosest(VDistFunct, markerFunctor, startPt, dist_upper_bound, dist, closestPt);
         //if(cb) cb(sampleCnt++*100/sampleNum,"Resampling Vertex attributes");
             //if(storeDistanceAsQualityFlag)  p.Q() = dist;
             if(dist == dist_upper_bound) return ;
@@ -289,12 +293,13 @@ public:
                     rr = gg = bb = q;
                 } break;
             }
-			trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(rr, gg, bb, 255));
+            *texel = qRgba(rr, gg, bb, 255);
         }
         else // sampling from a mesh
         {
             CMeshO::CoordType closestPt;
             vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
+            MarkerFace markerFunctor;
             CMeshO::ScalarType dist=dist_upper_bound;
             CMeshO::FaceType *nearestF;
             nearestF =  unifGridFace.GetClosest(PDistFunct, markerFunctor, startPt, dist_upper_bound, dist, closestPt);
@@ -321,7 +326,7 @@ public:
               interp[2]=1.0-interp[1]-interp[0];
             }
 
-		if (alpha == 255 || qAlpha(trgImgs[f.cWT(0).N()].pixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y())) < alpha)
+		if (alpha == 255 || qAlpha(*texel) < alpha)
         {
             if (fromTexture)
             {
@@ -333,7 +338,7 @@ public:
                 x = (x%w + w)%w;
                 y = (y%h + h)%h;
 				QRgb px = (*srcImgs)[nearestF->cWT(0).N()].pixel(x, y);
-				trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(qRed(px), qGreen(px), qBlue(px), alpha));
+				*texel = qRgba(qRed(px), qGreen(px), qBlue(px), alpha);
             }
             else
             {
@@ -360,15 +365,122 @@ public:
                 } break;
                 default: assert(0);
                 }
-				trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(c[0], c[1], c[2], alpha));
+				*texel = qRgba(c[0], c[1], c[2], alpha);
             }
         }
-            if (cb)
+        }
+    }
+};
+
+// Forwards to the wrapped sampler only the samples falling inside a given
+// rectangle [x0,x1) x [y0,y1) of texture space, counting them.
+template <class SamplerType>
+class TileClipSampler
+{
+    SamplerType &ps;
+    int x0, y0, x1, y1;
+
+public:
+    long long sampleCnt;
+
+    TileClipSampler(SamplerType &_ps, int _x0, int _y0, int _x1, int _y1)
+        : ps(_ps), x0(_x0), y0(_y0), x1(_x1), y1(_y1), sampleCnt(0) {}
+
+    void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist=0.0)
+    {
+        if (tp.X() < x0 || tp.X() >= x1 || tp.Y() < y0 || tp.Y() >= y1) return;
+        ++sampleCnt;
+        ps.AddTextureSample(f, p, tp, edgeDist);
+    }
+};
+
+// Tile parallel replacement of tri::SurfaceSampling::Texture().
+// Texture space is split into square tiles and each face is binned into all the
+// tiles touched by its (enlarged) uv bounding box. Tiles are then rasterized
+// concurrently, every tile clipping the samples of its faces to its own rectangle:
+// each texel is owned by exactly one tile and receives its samples in the same face
+// order of the serial version, so no locking is needed and the result is identical.
+// The sampler AddTextureSample() must be safe to call concurrently on different texels.
+// Returns the number of generated texel samples.
+template <class SamplerType>
+class TileRasterizer
+{
+public:
+    static long long Texture(CMeshO &m, SamplerType &ps, int textureWidth, int textureHeight, bool correctSafePointsBaryCoords=true,
+                             vcg::CallBackPos *cb=0, int start=0, int offset=100, int tileSide=256)
+    {
+        typedef TileClipSampler<SamplerType> ClipSampler;
+        const int tileW = (textureWidth  + tileSide - 1) / tileSide;
+        const int tileH = (textureHeight + tileSide - 1) / tileSide;
+        const int tileNum = tileW * tileH;
+        if (tileNum == 0) return 0;
+
+        // Bin the faces. SingleFaceRaster visits the bbox enlarged by one texel on each side
+        std::vector< std::vector<int> > tileFaces(tileNum);
+        for (size_t i = 0; i < m.face.size(); ++i)
+        {
+            const CMeshO::FaceType &f = m.face[i];
+            if (f.IsD()) continue;
+            vcg::Box2<CMeshO::ScalarType> bb;
+            for (int j = 0; j < 3; ++j)
+                bb.Add(TexelPos(f, j, textureWidth, textureHeight));
+            int bx0 = std::max<int>(int(floor(bb.min[0])) - 1, 0);
+            int by0 = std::max<int>(int(floor(bb.min[1])) - 1, 0);
+            int bx1 = std::min<int>(int(ceil(bb.max[0])) + 1, textureWidth - 1);
+            int by1 = std::min<int>(int(ceil(bb.max[1])) + 1, textureHeight - 1);
+            if (bx0 > bx1 || by0 > by1) continue;
+            for (int ty = by0 / tileSide; ty <= by1 / tileSide; ++ty)
+                for (int tx = bx0 / tileSide; tx <= bx1 / tileSide; ++tx)
+                    tileFaces[ty * tileW + tx].push_back(int(i));
+        }
+
+        long long sampleCnt = 0;
+        int doneTiles = 0;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic) reduction(+: sampleCnt)
+#endif
+        for (int t = 0; t < tileNum; ++t)
+        {
+            int x0 = (t % tileW) * tileSide;
+            int y0 = (t / tileW) * tileSide;
+            ClipSampler clip(ps, x0, y0, std::min(x0 + tileSide, textureWidth), std::min(y0 + tileSide, textureHeight));
+            for (size_t i = 0; i < tileFaces[t].size(); ++i)
             {
-                if (&f != currFace) {currFace = &f; ++faceCnt;}
-                cb(start + faceCnt*offset/faceNo, "Rasterizing faces ...");
+                CMeshO::FaceType &f = m.face[tileFaces[t][i]];
+                vcg::tri::SurfaceSampling<CMeshO, ClipSampler>::SingleFaceRaster(f, clip,
+                        TexelPos(f, 0, textureWidth, textureHeight),
+                        TexelPos(f, 1, textureWidth, textureHeight),
+                        TexelPos(f, 2, textureWidth, textureHeight),
+                        correctSafePointsBaryCoords);
             }
+            sampleCnt += clip.sampleCnt;
+
+            int done;
+#ifdef _USE_OMP
+            #pragma omp critical (tileRasterProgress)
+#endif
+            done = ++doneTiles;
+            if (cb && IsMasterThread())
+                cb(start + done * offset / tileNum, "Rasterizing faces ...");
         }
+        return sampleCnt;
+    }
+
+private:
+    // -0.5 offsets are the same used by SurfaceSampling::Texture to get a correct texture mapping
+    static inline Point2m TexelPos(const CMeshO::FaceType &f, int i, int textureWidth, int textureHeight)
+    {
+        return Point2m(f.cWT(i).U() * textureWidth - 0.5, f.cWT(i).V() * textureHeight - 0.5);
+    }
+
+    // Only the calling thread is allowed to report progress
+    static inline bool IsMasterThread()
+    {
+#ifdef _USE_OMP
+        return omp_get_thread_num() == 0;
+#else
+        return true;
+#endif
     }
 };
 
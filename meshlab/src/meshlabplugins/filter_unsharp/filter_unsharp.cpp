@@ -21,7 +21,9 @@
 *                                                                           *
 ****************************************************************************/
 #include <Qt>
+#include <QElapsedTimer>
 #include "filter_unsharp.h"
+#include "laplacian_csr.h"
 
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/smooth.h>
@@ -31,6 +33,13 @@
 using namespace vcg;
 using namespace std;
 
+// millions of vertex updates per second, for the logs of the laplacian smoothers
+static double vertexIterRate(int vertNum, int iterNum, const QElapsedTimer &t)
+{
+  const qint64 ns = std::max<qint64>(t.nsecsElapsed(), 1);
+  return double(vertNum) * double(iterNum) * 1000.0 / double(ns);
+}
+
 FilterUnsharp::FilterUnsharp()
 {
   typeList <<
@@ -399,8 +408,11 @@ bool FilterUnsharp::applyFilter(QAction *filter, MeshDocument &md, RichParameter
       bool cotangentWeight = par.getBool("cotangentWeight");
       if(!boundarySmooth) tri::UpdateFlags<CMeshO>::FaceClearB(m.cm);
 
-      tri::Smooth<CMeshO>::VertexCoordLaplacian(m.cm,stepSmoothNum,Selected,cotangentWeight,cb);
+      QElapsedTimer t; t.start();
+      LaplacianCSR<CMeshO> lap(m.cm,Selected,cotangentWeight);
+      lap.Laplacian(stepSmoothNum,cotangentWeight,cb);
       Log( "Smoothed %d vertices", Selected>0 ? m.cm.svn : m.cm.vn);
+      Log( "%d iterations in %i ms (%.1f M vertex iterations/s)", stepSmoothNum, int(t.elapsed()), vertexIterRate(m.cm.vn,stepSmoothNum,t));
       m.UpdateBoxAndNormals();
       }
         break;
@@ -468,8 +480,11 @@ bool FilterUnsharp::applyFilter(QAction *filter, MeshDocument &md, RichParameter
             // Small hack
             tri::UpdateFlags<CMeshO>::FaceClearB(m.cm);
             float delta = par.getAbsPerc("delta");
-            tri::Smooth<CMeshO>::VertexCoordScaleDependentLaplacian_Fujiwara(m.cm,stepSmoothNum,delta);
+            QElapsedTimer t; t.start();
+            LaplacianCSR<CMeshO> lap(m.cm,cnt>0);
+            lap.ScaleDependent(stepSmoothNum,delta,cb);
             Log( "Smoothed %d vertices", cnt>0 ? cnt : m.cm.vn);
+            Log( "%d iterations in %i ms (%.1f M vertex iterations/s)", stepSmoothNum, int(t.elapsed()), vertexIterRate(m.cm.vn,stepSmoothNum,t));
             m.UpdateBoxAndNormals();
       }
         break;
@@ -477,7 +492,10 @@ bool FilterUnsharp::applyFilter(QAction *filter, MeshDocument &md, RichParameter
       {
       tri::UpdateFlags<CMeshO>::FaceBorderFromNone(m.cm);
             size_t cnt=tri::UpdateSelection<CMeshO>::VertexFromFaceStrict(m.cm);
-      tri::Smooth<CMeshO>::VertexCoordLaplacianHC(m.cm,1,cnt>0);
+      QElapsedTimer t; t.start();
+      LaplacianCSR<CMeshO> lap(m.cm,cnt>0);
+      lap.HC();
+      Log( "Smoothed %d vertices in %i ms (%.1f M vertex iterations/s)", cnt>0 ? int(cnt) : m.cm.vn, int(t.elapsed()), vertexIterRate(m.cm.vn,1,t));
       m.UpdateBoxAndNormals();
       }
         break;
@@ -510,8 +528,11 @@ bool FilterUnsharp::applyFilter(QAction *filter, MeshDocument &md, RichParameter
             float mu=par.getFloat("mu");
 
             size_t cnt=tri::UpdateSelection<CMeshO>::VertexFromFaceStrict(m.cm);
-      tri::Smooth<CMeshO>::VertexCoordTaubin(m.cm,stepSmoothNum,lambda,mu,cnt>0,cb);
+            QElapsedTimer t; t.start();
+            LaplacianCSR<CMeshO> lap(m.cm,cnt>0);
+            lap.Taubin(stepSmoothNum,lambda,mu,cb);
             Log( "Smoothed %d vertices", cnt>0 ? cnt : m.cm.vn);
+            Log( "%d iterations in %i ms (%.1f M vertex iterations/s)", 2*stepSmoothNum, int(t.elapsed()), vertexIterRate(m.cm.vn,2*stepSmoothNum,t));
             m.UpdateBoxAndNormals();
       }
             break;
@@ -1,6 +1,8 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += filter_unsharp.h \
+    laplacian_csr.h \
     $$VCGDIR/vcg/complex/algorithms/crease_cut.h
 				
 SOURCES       += filter_unsharp.cpp 
@@ -0,0 +1,408 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef LAPLACIAN_CSR_H
+#define LAPLACIAN_CSR_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <vcg/complex/complex.h>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+/*
+Parallel versions of the laplacian smoothers of tri::Smooth (VertexCoordLaplacian,
+VertexCoordTaubin, VertexCoordLaplacianHC and
+VertexCoordScaleDependentLaplacian_Fujiwara), with the same weights and border rules.
+
+The face loops of tri::Smooth scatter into per vertex temporary data and cannot be
+split among threads. Here the vertex adjacency is built once, in compressed rows: for
+every vertex the list of its neighbors, each one with the number of faces in which
+the edge is an inner edge and a border edge. Every iteration then gathers, for each
+vertex, the positions of its neighbors from the previous iteration (Jacobi style),
+so the vertices are processed independently. The positions are kept as three
+separate coordinate arrays while iterating and written back at the end.
+
+As in tri::Smooth, a vertex on a border edge is averaged only with its border
+neighbors (and itself), and the face border flags must be up to date. With the
+cotangent weights the adjacency also stores, for each inner edge, the vertices
+opposite to it; the weights follow the moving vertices at every iteration.
+*/
+template <class MeshType>
+class LaplacianCSR
+{
+public:
+    typedef typename MeshType::ScalarType ScalarType;
+    typedef typename MeshType::CoordType CoordType;
+    typedef typename MeshType::FaceType FaceType;
+
+    // selectedOnly: only the selected vertices move (they still average with all
+    // their neighbors); cotangentWeight: keep what is needed by Laplacian(...,true)
+    LaplacianCSR(MeshType &m, bool selectedOnly = false, bool cotangentWeight = false)
+        : m(m)
+    {
+        vertNum = int(m.vert.size());
+        movable.resize(vertNum);
+        for (int i = 0; i < vertNum; ++i)
+            movable[i] = !m.vert[i].IsD() && (!selectedOnly || m.vert[i].IsS());
+        Build(cotangentWeight);
+    }
+
+    int VertexNum() const { return vertNum; }
+
+    // tri::Smooth::VertexCoordLaplacian
+    void Laplacian(int step, bool cotangentWeight = false, vcg::CallBackPos *cb = 0)
+    {
+        Load();
+        for (int it = 0; it < step; ++it)
+        {
+            if (cb) cb(100 * it / step, "Classic Laplacian Smoothing");
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic, 4096)
+#endif
+            for (int i = 0; i < vertNum; ++i)
+            {
+                ScalarType s[3], cnt;
+                UmbrellaSum(i, cotangentWeight, s, cnt);
+                if (movable[i] && cnt > 0)
+                {
+                    nx[i] = (px[i] + s[0]) / (cnt + 1);
+                    ny[i] = (py[i] + s[1]) / (cnt + 1);
+                    nz[i] = (pz[i] + s[2]) / (cnt + 1);
+                }
+                else
+                {
+                    nx[i] = px[i]; ny[i] = py[i]; nz[i] = pz[i];
+                }
+            }
+            px.swap(nx); py.swap(ny); pz.swap(nz);
+        }
+        Store();
+    }
+
+    // tri::Smooth::VertexCoordTaubin, umbrella weights
+    void Taubin(int step, ScalarType lambda, ScalarType mu, vcg::CallBackPos *cb = 0)
+    {
+        Load();
+        for (int it = 0; it < 2 * step; ++it)
+        {
+            if (cb && (it % 2) == 0) cb(100 * it / (2 * step), "Taubin Smoothing");
+            const ScalarType k = (it % 2 == 0) ? lambda : mu;
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic, 4096)
+#endif
+            for (int i = 0; i < vertNum; ++i)
+            {
+                ScalarType s[3], cnt;
+                UmbrellaSum(i, false, s, cnt);
+                if (movable[i] && cnt > 0)
+                {
+                    nx[i] = px[i] + (s[0] / cnt - px[i]) * k;
+                    ny[i] = py[i] + (s[1] / cnt - py[i]) * k;
+                    nz[i] = pz[i] + (s[2] / cnt - pz[i]) * k;
+                }
+                else
+                {
+                    nx[i] = px[i]; ny[i] = py[i]; nz[i] = pz[i];
+                }
+            }
+            px.swap(nx); py.swap(ny); pz.swap(nz);
+        }
+        Store();
+    }
+
+    // tri::Smooth::VertexCoordLaplacianHC (one step, beta 0.5): border edges count twice
+    void HC()
+    {
+        const ScalarType beta = 0.5;
+        Load();
+        std::vector<ScalarType> cnt(vertNum);
+        // nx,ny,nz hold the plain laplacian average
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic, 4096)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            ScalarType s[3] = {0, 0, 0}, c = 0;
+            for (int e = first[i]; e < first[i + 1]; ++e)
+            {
+                const ScalarType w = ScalarType(adj[e].inner + 2 * adj[e].border);
+                const int j = adj[e].v;
+                s[0] += px[j] * w; s[1] += py[j] * w; s[2] += pz[j] * w;
+                c += w;
+            }
+            cnt[i] = c;
+            if (c > 0) { nx[i] = s[0] / c; ny[i] = s[1] / c; nz[i] = s[2] / c; }
+            else       { nx[i] = px[i];    ny[i] = py[i];    nz[i] = pz[i]; }
+        }
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic, 4096)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            if (!movable[i] || cnt[i] <= 0)
+                continue;
+            ScalarType d[3] = {0, 0, 0};
+            for (int e = first[i]; e < first[i + 1]; ++e)
+            {
+                const ScalarType w = ScalarType(adj[e].inner + 2 * adj[e].border);
+                const int j = adj[e].v;
+                d[0] += (nx[j] - px[j]) * w; d[1] += (ny[j] - py[j]) * w; d[2] += (nz[j] - pz[j]) * w;
+            }
+            const CoordType b(nx[i], ny[i], nz[i]);
+            const CoordType p = b - (b - m.vert[i].cP()) * beta + CoordType(d[0], d[1], d[2]) * ((1 - beta) / cnt[i]);
+            m.vert[i].P() = p;
+        }
+    }
+
+    // tri::Smooth::VertexCoordScaleDependentLaplacian_Fujiwara
+    void ScaleDependent(int step, ScalarType delta, vcg::CallBackPos *cb = 0)
+    {
+        Load();
+        for (int it = 0; it < step; ++it)
+        {
+            if (cb) cb(100 * it / step, "Scale Dependent Laplacian Smoothing");
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic, 4096)
+#endif
+            for (int i = 0; i < vertNum; ++i)
+            {
+                ScalarType s[3] = {0, 0, 0}, lenSum = 0;
+                for (int e = first[i]; e < first[i + 1]; ++e)
+                {
+                    const ScalarType c = ScalarType(onBorder[i] ? adj[e].border : adj[e].inner);
+                    if (c == 0) continue;
+                    const int j = adj[e].v;
+                    const ScalarType d[3] = {px[j] - px[i], py[j] - py[i], pz[j] - pz[i]};
+                    const ScalarType len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                    if (len == 0) continue;
+                    s[0] += d[0] * (c / len); s[1] += d[1] * (c / len); s[2] += d[2] * (c / len);
+                    lenSum += c * len;
+                }
+                if (movable[i] && lenSum > 0)
+                {
+                    nx[i] = px[i] + s[0] / lenSum * delta;
+                    ny[i] = py[i] + s[1] / lenSum * delta;
+                    nz[i] = pz[i] + s[2] / lenSum * delta;
+                }
+                else
+                {
+                    nx[i] = px[i]; ny[i] = py[i]; nz[i] = pz[i];
+                }
+            }
+            px.swap(nx); py.swap(ny); pz.swap(nz);
+        }
+        Store();
+    }
+
+private:
+    // A neighbor of a vertex: in how many faces the edge is inner or border, and where
+    // the vertices opposite to the edge start in opp (border ones first, encoded as -1-v)
+    struct Entry
+    {
+        int v;
+        int inner;
+        int border;
+        int oppBegin;
+    };
+
+    struct HalfEdge
+    {
+        int v;
+        int opp;
+        bool operator<(const HalfEdge &h) const { return v < h.v || (v == h.v && opp < h.opp); }
+    };
+
+    void Build(bool keepOpposite)
+    {
+        // bucket the two directions of every face edge by their first vertex
+        std::vector<int> hfirst(vertNum + 1, 0);
+        const int faceNum = int(m.face.size());
+        for (int f = 0; f < faceNum; ++f)
+            if (!m.face[f].IsD())
+                for (int j = 0; j < 3; ++j)
+                {
+                    ++hfirst[Index(m.face[f].cV0(j)) + 1];
+                    ++hfirst[Index(m.face[f].cV1(j)) + 1];
+                }
+        for (int i = 0; i < vertNum; ++i)
+            hfirst[i + 1] += hfirst[i];
+        std::vector<HalfEdge> he(hfirst[vertNum]);
+        {
+            std::vector<int> pos(hfirst.begin(), hfirst.end() - 1);
+            for (int f = 0; f < faceNum; ++f)
+                if (!m.face[f].IsD())
+                {
+                    const FaceType &face = m.face[f];
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        const int a = Index(face.cV0(j)), b = Index(face.cV1(j));
+                        const int o = Index(face.cV2(j));
+                        const int opp = face.IsB(j) ? -1 - o : o;
+                        HalfEdge h;
+                        h.opp = opp;
+                        h.v = b; he[pos[a]++] = h;
+                        h.v = a; he[pos[b]++] = h;
+                    }
+                }
+        }
+
+        // sort every bucket by neighbor and count the distinct ones
+        first.assign(vertNum + 1, 0);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic, 4096)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            std::sort(he.begin() + hfirst[i], he.begin() + hfirst[i + 1]);
+            int n = 0;
+            for (int k = hfirst[i]; k < hfirst[i + 1]; ++k)
+                if (k == hfirst[i] || he[k].v != he[k - 1].v)
+                    ++n;
+            first[i + 1] = n;
+        }
+        for (int i = 0; i < vertNum; ++i)
+            first[i + 1] += first[i];
+
+        adj.resize(first[vertNum]);
+        onBorder.assign(vertNum, 0);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic, 4096)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            int e = first[i] - 1;
+            for (int k = hfirst[i]; k < hfirst[i + 1]; ++k)
+            {
+                if (k == hfirst[i] || he[k].v != he[k - 1].v)
+                {
+                    ++e;
+                    adj[e].v = he[k].v;
+                    adj[e].inner = 0;
+                    adj[e].border = 0;
+                    adj[e].oppBegin = k;
+                }
+                if (he[k].opp < 0)
+                {
+                    ++adj[e].border;
+                    onBorder[i] = 1;
+                }
+                else
+                    ++adj[e].inner;
+            }
+        }
+
+        if (keepOpposite)
+        {
+            opp.resize(he.size());
+            for (size_t k = 0; k < he.size(); ++k)
+                opp[k] = he[k].opp;
+        }
+    }
+
+    int Index(const typename MeshType::VertexType *v) const { return int(v - &m.vert[0]); }
+
+    // Sum of the weighted neighbors and of the weights of tri::Smooth::AccumulateLaplacianInfo:
+    // a border vertex counts itself once and its border edges, the others their inner edges
+    void UmbrellaSum(int i, bool cotangentWeight, ScalarType s[3], ScalarType &cnt) const
+    {
+        if (onBorder[i])
+        {
+            s[0] = px[i]; s[1] = py[i]; s[2] = pz[i];
+            cnt = 1;
+            for (int e = first[i]; e < first[i + 1]; ++e)
+                if (adj[e].border > 0)
+                {
+                    const ScalarType w = ScalarType(adj[e].border);
+                    const int j = adj[e].v;
+                    s[0] += px[j] * w; s[1] += py[j] * w; s[2] += pz[j] * w;
+                    cnt += w;
+                }
+            return;
+        }
+        s[0] = s[1] = s[2] = cnt = 0;
+        for (int e = first[i]; e < first[i + 1]; ++e)
+        {
+            const int j = adj[e].v;
+            ScalarType w;
+            if (cotangentWeight)
+            {
+                // the border opposite vertices (negative) sort before the inner ones
+                w = 0;
+                const int k0 = adj[e].oppBegin + adj[e].border;
+                for (int k = k0; k < k0 + adj[e].inner; ++k)
+                    w += Cotangent(i, j, opp[k]);
+            }
+            else
+                w = ScalarType(adj[e].inner);
+            s[0] += px[j] * w; s[1] += py[j] * w; s[2] += pz[j] * w;
+            cnt += w;
+        }
+    }
+
+    // cotangent of the angle in o of the triangle (i,j,o); zero if degenerate
+    ScalarType Cotangent(int i, int j, int o) const
+    {
+        const CoordType a(px[i] - px[o], py[i] - py[o], pz[i] - pz[o]);
+        const CoordType b(px[j] - px[o], py[j] - py[o], pz[j] - pz[o]);
+        const ScalarType sinLen = (a ^ b).Norm();
+        return (sinLen > 0) ? (a * b) / sinLen : ScalarType(0);
+    }
+
+    void Load()
+    {
+        px.resize(vertNum); py.resize(vertNum); pz.resize(vertNum);
+        nx.resize(vertNum); ny.resize(vertNum); nz.resize(vertNum);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+        {
+            const CoordType &p = m.vert[i].cP();
+            px[i] = p[0]; py[i] = p[1]; pz[i] = p[2];
+        }
+    }
+
+    void Store()
+    {
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < vertNum; ++i)
+            if (movable[i])
+                m.vert[i].P() = CoordType(px[i], py[i], pz[i]);
+    }
+
+    MeshType &m;
+    int vertNum;
+    std::vector<int> first;         // compressed rows of adj
+    std::vector<Entry> adj;
+    std::vector<int> opp;           // only for the cotangent weights
+    std::vector<char> onBorder;
+    std::vector<char> movable;
+    std::vector<ScalarType> px, py, pz, nx, ny, nz;
+};
+
+#endif // LAPLACIAN_CSR_H
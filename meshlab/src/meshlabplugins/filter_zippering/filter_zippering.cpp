@@ -202,7 +202,7 @@ bool FilterZippering::checkRedundancy(  CMeshO::FacePointer face,
 
     for ( unsigned int j = 0; j < edge_samples.size(); j ++ ) {
         CMeshO::FacePointer nearestF = 0;
-        tri::FaceTmark<CMeshO> markerFunctor; markerFunctor.SetMesh(&m->cm); tri::UnMarkAll(m->cm);
+        tri::EmptyTMark<CMeshO> markerFunctor;
         face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
         MeshFaceGrid::ScalarType  dist = max_dist;  MeshFaceGrid::CoordType closest;
         //Search closest point on A
@@ -216,7 +216,7 @@ bool FilterZippering::checkRedundancy(  CMeshO::FacePointer face,
 
     //check if V2(i) has a closest point on border of m
     CMeshO::FacePointer nearestF = 0;
-    tri::FaceTmark<CMeshO> markerFunctor; markerFunctor.SetMesh(&m->cm);
+    tri::EmptyTMark<CMeshO> markerFunctor;
     face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
     MeshFaceGrid::ScalarType  dist = max_dist;  MeshFaceGrid::CoordType closest;
     nearestF =  grid.GetClosest(PDistFunct, markerFunctor, face->P2(i), max_dist, dist, closest);
@@ -233,7 +233,7 @@ bool FilterZippering::checkRedundancy(  CMeshO::FacePointer face,
         // samples on A
         for ( size_t k = 0; k < edge_samples.size(); k ++ ) {
             CMeshO::FacePointer nearestF = 0;
-            tri::FaceTmark<CMeshO> markerFunctor; markerFunctor.SetMesh(&m->cm); tri::UnMarkAll(m->cm);
+            tri::EmptyTMark<CMeshO> markerFunctor;
             face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
             MeshFaceGrid::ScalarType  dist = max_dist;  MeshFaceGrid::CoordType closest;
             //Search closest point on A
@@ -248,6 +248,51 @@ bool FilterZippering::checkRedundancy(  CMeshO::FacePointer face,
     return true;
 }
 
+/**
+ * Test the redundancy of a run of faces coming from the same mesh, in parallel.
+ * checkRedundancy only reads the grid and the flags of m, and the selection of the
+ * neighbours of the face to pick the border edge; none of them changes while the run is
+ * tested, as the selection is updated only after the whole run. The selection of the
+ * neighbours seen by each test is returned, so that the caller can repeat the test of the
+ * faces whose neighbours are selected earlier in the same run.
+ * @param run   Faces to be tested (all from the same mesh)
+ * @param m     The other mesh
+ * @param grid  A face-grid created using the faces of mesh m (shared, read-only)
+ * @param max_dist Max Distance allowed between m and the faces
+ * @param redundant Output, redundant[i] != 0 if run[i] is redundant
+ * @param neighbours Output, selectedNeighbours(run[i]) at the time of the test
+ */
+void FilterZippering::checkRedundancyRun( const vector< std::pair<CMeshO::FacePointer,char> >& run,
+                                          MeshModel *m,
+                                          MeshFaceGrid &grid,
+                                          CMeshO::ScalarType max_dist,
+                                          vector<char>& redundant,
+                                          vector<char>& neighbours )
+{
+	int n = int(run.size());
+	redundant.assign( n, 0 );
+	neighbours.assign( n, 0 );
+	//not worth to wake up the threads for the few faces of the last steps of the erosion
+#ifdef _USE_OMP
+	#pragma omp parallel for schedule(dynamic, 8) if (n > 32)
+#endif
+	for ( int i = 0; i < n; i ++ ) {
+		neighbours[i] = selectedNeighbours( run[i].first );
+		redundant[i] = checkRedundancy( run[i].first, m, grid, max_dist );
+	}
+}
+
+/**
+ * Bit j is set if the face adjacent to f along the edge j is selected
+ */
+char FilterZippering::selectedNeighbours( CMeshO::FacePointer f )
+{
+	char mask = 0;
+	for ( int j = 0; j < 3; j ++ )
+		if ( f->FFp(j)->IsS() ) mask |= (1 << j);
+	return mask;
+}
+
 /*
  * Perform a simple test on a face in order to check redundancy (F.Ganovelli improvement of redundancy test)
  * CheckRedundancy procedure uses a number of sampled points; instead, this function performs redundancy test
@@ -273,7 +318,7 @@ bool FilterZippering::simpleCheckRedundancy(   CMeshO::FacePointer f,   //face
 	Scalarm dist = max_dist; 
     CMeshO::FacePointer nearestF = 0; 
     Point3m closest;
-	tri::FaceTmark<CMeshO> markerFunctor; markerFunctor.SetMesh(&m->cm); UnMarkAll(m->cm);
+	tri::EmptyTMark<CMeshO> markerFunctor;
 	face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
 	nearestF =  grid.GetClosest(PDistFunct, markerFunctor, qp, max_dist, dist, closest);
 	if (nearestF == 0) return false;	//too far away
@@ -769,8 +814,8 @@ bool FilterZippering::Init_pq( std::priority_queue< std::pair<CMeshO::FacePointe
 int FilterZippering::preProcess (vector< std::pair<CMeshO::FacePointer,char> >& queue,	//queue
 								 MeshModel* a,
 								 MeshModel* b,
-								 MeshFaceGrid grid_a,									//grid on A
-								 MeshFaceGrid grid_b,									//grid on A
+								 MeshFaceGrid &grid_a,									//grid on A
+								 MeshFaceGrid &grid_b,									//grid on B
 								 float max_dist ) {										//max dist search
 
 	//face count
@@ -793,16 +838,19 @@ int FilterZippering::preProcess (vector< std::pair<CMeshO::FacePointer,char> >&
 	b->updateDataMask(-MeshModel::MM_VERTFACETOPO); //is that correct?
 	vcg::tri::UpdateTopology<CMeshO>::FaceFace(b->cm);
 	//perform simpleCheckRedundancy on faces of the queue
-	for ( int i = 0; i < queue.size(); i ++ ) {
-		if ( queue[i].second == 'B' ) {
-			if ( simpleCheckRedundancy( queue[i].first, a, grid_a, max_dist, true ) ) {
-				queue[i].first->SetS(); fc++;
-			}
-		}
-		if ( queue[i].second == 'A' ) {
-			if ( simpleCheckRedundancy( queue[i].first, b, grid_b, max_dist, true ) ) {
-				queue[i].first->SetS(); fc++;
-			}
+	//(the test does not depend on the selection, so all the faces can be tested at once)
+	int qn = int(queue.size());
+	vector<char> redundant( qn, 0 );
+#ifdef _USE_OMP
+	#pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for ( int i = 0; i < qn; i ++ ) {
+		if ( queue[i].second == 'B' ) redundant[i] = simpleCheckRedundancy( queue[i].first, a, grid_a, max_dist, true );
+		if ( queue[i].second == 'A' ) redundant[i] = simpleCheckRedundancy( queue[i].first, b, grid_b, max_dist, true );
+	}
+	for ( int i = 0; i < qn; i ++ ) {
+		if ( redundant[i] ) {
+			queue[i].first->SetS(); fc++;
 		}
 	}
 	return fc;
@@ -811,8 +859,8 @@ int FilterZippering::preProcess (vector< std::pair<CMeshO::FacePointer,char> >&
 int FilterZippering::preProcess_pq ( std::priority_queue< std::pair<CMeshO::FacePointer,char>, std::vector< std::pair<CMeshO::FacePointer,char> >, compareFaceQuality >& queue,	//the queue
 									MeshModel* a,
 									MeshModel* b,
-									MeshFaceGrid grid_a,									//grid on A
-									MeshFaceGrid grid_b,									//grid on A
+									MeshFaceGrid &grid_a,									//grid on A
+									MeshFaceGrid &grid_b,									//grid on B
 									float max_dist ) {										//max dist search
 
 	//face count
@@ -844,20 +892,21 @@ int FilterZippering::preProcess_pq ( std::priority_queue< std::pair<CMeshO::Face
 		queue.pop();
 	}
 	//perform simpleCheckRedundancy on faces of the vector
-	for ( int i = 0; i < tmp_queue.size(); i ++ ) {
-		if ( tmp_queue[i].second == 'B' ) {
-			if ( simpleCheckRedundancy( tmp_queue[i].first, a, grid_a, max_dist, true ) ) {
-				tmp_queue[i].first->SetS(); fc++;
-			}
-			//store non-redundant faces for future check
-			else queue.push( tmp_queue[i] );
-		}
-		if ( tmp_queue[i].second == 'A' ) {
-			if ( simpleCheckRedundancy( tmp_queue[i].first, b, grid_b, max_dist, true ) ) {
-				tmp_queue[i].first->SetS(); fc++;
-			}
-			else queue.push( tmp_queue[i] );
+	int qn = int(tmp_queue.size());
+	vector<char> redundant( qn, 0 );
+#ifdef _USE_OMP
+	#pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for ( int i = 0; i < qn; i ++ ) {
+		if ( tmp_queue[i].second == 'B' ) redundant[i] = simpleCheckRedundancy( tmp_queue[i].first, a, grid_a, max_dist, true );
+		if ( tmp_queue[i].second == 'A' ) redundant[i] = simpleCheckRedundancy( tmp_queue[i].first, b, grid_b, max_dist, true );
+	}
+	for ( int i = 0; i < qn; i ++ ) {
+		if ( redundant[i] ) {
+			tmp_queue[i].first->SetS(); fc++;
 		}
+		//store non-redundant faces for future check
+		else if ( tmp_queue[i].second == 'A' || tmp_queue[i].second == 'B' ) queue.push( tmp_queue[i] );
 	}
 
 	return fc;
@@ -885,34 +934,34 @@ int FilterZippering::selectRedundant( std::vector< std::pair<CMeshO::FacePointer
 	//fast pre processing
 	sf = preProcess( queue, a, b, grid_a, grid_b, epsilon );
 
-	//process face once at the time until queue is not empty
+	//process the queue a run at the time until queue is not empty
+	vector< std::pair<CMeshO::FacePointer,char> > run;
+	vector<char> redundant, neighbours;
 	while ( !queue.empty() ) {
-		//extract face from the queue
-		CMeshO::FacePointer currentF = queue.back().first;  char choose = queue.back().second; queue.pop_back();
-		if ( currentF->IsD() || currentF->IsS() ) continue;	//no op if face is deleted or selected (already tested)
-		//face from mesh A, test redundancy with respect to B
-		if (choose == 'A') {
-			if ( checkRedundancy( currentF, b, grid_b, epsilon ) ) {
-				//if face is redundant, remove it from A and put new border faces at the top of the queue
-				//in order to guarantee that A and B will be tested alternatively
-				currentF->SetS(); sf++;
-				//insert adjacent faces at the beginning of the queue
-				queue.push_back( make_pair(currentF->FFp(0),'A') );
-				queue.push_back( make_pair(currentF->FFp(1),'A') );
-				queue.push_back( make_pair(currentF->FFp(2),'A') );
-			}
+		//extract the faces at the back of the queue coming from the same mesh
+		char choose = queue.back().second; run.clear();
+		while ( !queue.empty() && queue.back().second == choose ) {
+			CMeshO::FacePointer currentF = queue.back().first; queue.pop_back();
+			if ( currentF->IsD() || currentF->IsS() ) continue;	//no op if face is deleted or selected (already tested)
+			run.push_back( make_pair(currentF, choose) );
 		}
-		//face is from mesh B, test redundancy with respect to A
-		else {
-			if ( checkRedundancy( currentF, a, grid_a, epsilon ) ) {
-				//if face is redundant, remove it from B and put new border faces at the top of the queue
-				//in order to guarantee that A and B will be tested alternatively
-				currentF->SetS(); sf++;
-				//insert adjacent faces at the beginning of the queue
-				queue.push_back( make_pair(currentF->FFp(0),'B') );
-				queue.push_back( make_pair(currentF->FFp(1),'B') );
-				queue.push_back( make_pair(currentF->FFp(2),'B') );
-			}
+		//face from mesh A, test redundancy with respect to B (and viceversa)
+		if (choose == 'A') checkRedundancyRun( run, b, grid_b, epsilon, redundant, neighbours );
+		else               checkRedundancyRun( run, a, grid_a, epsilon, redundant, neighbours );
+		for ( size_t i = 0; i < run.size(); i ++ ) {
+			CMeshO::FacePointer currentF = run[i].first;
+			if ( currentF->IsS() ) continue;	//face appearing twice in the run
+			//a neighbour selected earlier in this run changes the test: repeat it, as a serial pass would see it
+			if ( selectedNeighbours( currentF ) != neighbours[i] )
+				redundant[i] = checkRedundancy( currentF, (choose == 'A') ? b : a, (choose == 'A') ? grid_b : grid_a, epsilon );
+			if ( !redundant[i] ) continue;
+			//if face is redundant, remove it and put new border faces at the top of the queue
+			//in order to guarantee that A and B will be tested alternatively
+			currentF->SetS(); sf++;
+			//insert adjacent faces at the beginning of the queue
+			queue.push_back( make_pair(currentF->FFp(0),choose) );
+			queue.push_back( make_pair(currentF->FFp(1),choose) );
+			queue.push_back( make_pair(currentF->FFp(2),choose) );
 		}
 	}
 	//return number of selected faces
@@ -942,33 +991,32 @@ int FilterZippering::selectRedundant_pq( std::priority_queue< std::pair<CMeshO::
 	//fast pre processing
 	sf = preProcess_pq( queue, a, b, grid_a, grid_b, epsilon );
 
-	//process face once at the time until queue is not empty
+	//process the queue a run at the time until queue is not empty
+	vector< std::pair<CMeshO::FacePointer,char> > run;
+	vector<char> redundant, neighbours;
 	while ( !queue.empty() ) {
-		//extract face from the queue
-		CMeshO::FacePointer currentF = queue.top().first;  char choose = queue.top().second; queue.pop();
-		if ( currentF->IsD() || currentF->IsS() ) continue;	//no op if face is deleted or selected (already tested)
-		//face from mesh A, test redundancy with respect to B
-		if (choose == 'A') {
-			if ( checkRedundancy( currentF, b, grid_b, epsilon ) ) {
-				//if face is redundant, set is as Selectedand put new border faces in of the queue
-				currentF->SetS(); sf++;
-				//insert adjacent faces at the beginning of the queue
-				queue.push( make_pair(currentF->FFp(0),'A') );
-				queue.push( make_pair(currentF->FFp(1),'A') );
-				queue.push( make_pair(currentF->FFp(2),'A') );
-			}
+		//extract the faces with highest priority coming from the same mesh
+		char choose = queue.top().second; run.clear();
+		while ( !queue.empty() && queue.top().second == choose ) {
+			CMeshO::FacePointer currentF = queue.top().first; queue.pop();
+			if ( currentF->IsD() || currentF->IsS() ) continue;	//no op if face is deleted or selected (already tested)
+			run.push_back( make_pair(currentF, choose) );
 		}
-		//face is from mesh B, test redundancy with respect to A
-		else {
-			if ( checkRedundancy( currentF, a, grid_a, epsilon ) ) {
-				//if face is redundant, remove it from B and put new border faces at the top of the queue
-				//in order to guarantee that A and B will be tested alternatively
-				currentF->SetS(); sf++;
-				//insert adjacent faces at the beginning of the queue
-				queue.push( make_pair(currentF->FFp(0),'B') );
-				queue.push( make_pair(currentF->FFp(1),'B') );
-				queue.push( make_pair(currentF->FFp(2),'B') );
-			}
+		//face from mesh A, test redundancy with respect to B (and viceversa)
+		if (choose == 'A') checkRedundancyRun( run, b, grid_b, epsilon, redundant, neighbours );
+		else               checkRedundancyRun( run, a, grid_a, epsilon, redundant, neighbours );
+		for ( size_t i = 0; i < run.size(); i ++ ) {
+			CMeshO::FacePointer currentF = run[i].first;
+			if ( currentF->IsS() ) continue;	//face appearing twice in the run
+			//a neighbour selected earlier in this run changes the test: repeat it, as a serial pass would see it
+			if ( selectedNeighbours( currentF ) != neighbours[i] )
+				redundant[i] = checkRedundancy( currentF, (choose == 'A') ? b : a, (choose == 'A') ? grid_b : grid_a, epsilon );
+			if ( !redundant[i] ) continue;
+			//if face is redundant, set is as Selected and put new border faces in the queue
+			currentF->SetS(); sf++;
+			queue.push( make_pair(currentF->FFp(0),choose) );
+			queue.push( make_pair(currentF->FFp(1),choose) );
+			queue.push( make_pair(currentF->FFp(2),choose) );
 		}
 	}
 	//return number of selected faces
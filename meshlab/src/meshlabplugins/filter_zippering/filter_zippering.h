@@ -319,6 +319,13 @@ private:
         MeshFaceGrid &grid,      //grid A
         CMeshO::ScalarType max_dist,//Max search distance
         bool test );   
+    void checkRedundancyRun( const std::vector< std::pair<CMeshO::FacePointer,char> >& run,	//faces from the same mesh
+        MeshModel *m,            //the other mesh
+        MeshFaceGrid &grid,      //grid on the other mesh
+        CMeshO::ScalarType max_dist,//Max search distance
+        std::vector<char>& redundant,	//output, one flag per face of the run
+        std::vector<char>& neighbours );	//output, selectedNeighbours() of each face when tested
+    static char selectedNeighbours( CMeshO::FacePointer f );
     bool isBorderVert( CMeshO::FacePointer f, int i);
     bool isOnBorder( CMeshO::CoordType point, CMeshO::FacePointer f );
     bool isOnEdge( CMeshO::CoordType point, CMeshO::FacePointer f );
@@ -451,15 +458,15 @@ private:
     int preProcess ( std::vector< std::pair<CMeshO::FacePointer,char> >& queue,	//queue
         MeshModel* a,
         MeshModel* b, 
-        MeshFaceGrid grid_a,									//grid on A
-        MeshFaceGrid grid_b,									//grid on A
+        MeshFaceGrid &grid_a,									//grid on A
+        MeshFaceGrid &grid_b,									//grid on B
         float max_dist );										//max dist search
 
     int preProcess_pq ( std::priority_queue< std::pair<CMeshO::FacePointer,char>, std::vector< std::pair<CMeshO::FacePointer,char> >, compareFaceQuality >& queue,	//the queue
         MeshModel* a,
         MeshModel* b, 
-        MeshFaceGrid grid_a,									//grid on A
-        MeshFaceGrid grid_b,									//grid on A
+        MeshFaceGrid &grid_a,									//grid on A
+        MeshFaceGrid &grid_b,									//grid on B
         float max_dist );										//max dist search
 
 
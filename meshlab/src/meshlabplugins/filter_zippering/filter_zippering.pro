@@ -1,4 +1,5 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 HEADERS += filter_zippering.h
 SOURCES += filter_zippering.cpp
     
@@ -22,6 +22,7 @@
 ****************************************************************************/
 
 #include "baseio.h"
+#include "binary_export.h"
 
 #include <wrap/io_trimesh/import_ply.h>
 #include <wrap/io_trimesh/import_stl.h>
@@ -38,6 +39,8 @@
 #include <wrap/io_trimesh/export_vmi.h>
 #include <wrap/io_trimesh/export.h>
 
+#include <QMutexLocker>
+
 using namespace std;
 using namespace vcg;
 
@@ -257,11 +260,20 @@ bool BaseMeshIOPlugin::save(const QString &formatName,const QString &fileName, M
 
     if(formatName.toUpper() == tr("PLY"))
     {
+        if(binaryFlag)
+        {
+            BinaryExport::Result res = BinaryExport::SavePLY(m.cm,filename.c_str(),mask,cb);
+            if(res == BinaryExport::Done)
+                return true;
+            if(res != BinaryExport::Unsupported)
+            {
+                return saveFailed(fileName, errorMsgFormat.arg(fileName, BinaryExport::ErrorMsg(res)));
+            }
+        }
         int result = tri::io::ExporterPLY<CMeshO>::Save(m.cm,filename.c_str(),mask,binaryFlag,cb);
         if(result!=0)
         {
-            errorMessage = errorMsgFormat.arg(fileName, tri::io::ExporterPLY<CMeshO>::ErrorMsg(result));
-            return false;
+            return saveFailed(fileName, errorMsgFormat.arg(fileName, tri::io::ExporterPLY<CMeshO>::ErrorMsg(result)));
         }
         return true;
     }
@@ -269,11 +281,21 @@ bool BaseMeshIOPlugin::save(const QString &formatName,const QString &fileName, M
     {
       bool magicsFlag =  par.getBool("ColorMode");
 
+        if(binaryFlag)
+        {
+            BinaryExport::Result res = BinaryExport::SaveSTL(m.cm,filename.c_str(),mask,"STL generated by MeshLab",magicsFlag,cb);
+            if(res == BinaryExport::Done)
+                return true;
+            if(res != BinaryExport::Unsupported)
+            {
+                return saveFailed(fileName, errorMsgFormat.arg(fileName, BinaryExport::ErrorMsg(res)));
+            }
+        }
+
         int result = tri::io::ExporterSTL<CMeshO>::Save(m.cm,filename.c_str(),binaryFlag,mask,"STL generated by MeshLab",magicsFlag);
         if(result!=0)
         {
-            errorMessage = errorMsgFormat.arg(fileName, tri::io::ExporterSTL<CMeshO>::ErrorMsg(result));
-            return false;
+            return saveFailed(fileName, errorMsgFormat.arg(fileName, tri::io::ExporterSTL<CMeshO>::ErrorMsg(result)));
         }
         return true;
     }
@@ -282,8 +304,7 @@ bool BaseMeshIOPlugin::save(const QString &formatName,const QString &fileName, M
         int result = tri::io::ExporterWRL<CMeshO>::Save(m.cm,filename.c_str(),mask,cb);
         if(result!=0)
         {
-            errorMessage = errorMsgFormat.arg(fileName, tri::io::ExporterWRL<CMeshO>::ErrorMsg(result));
-            return false;
+            return saveFailed(fileName, errorMsgFormat.arg(fileName, tri::io::ExporterWRL<CMeshO>::ErrorMsg(result)));
         }
         return true;
     }
@@ -294,8 +315,7 @@ bool BaseMeshIOPlugin::save(const QString &formatName,const QString &fileName, M
       int result = tri::io::Exporter<CMeshO>::Save(m.cm,filename.c_str(),mask,cb);
       if(result!=0)
       {
-        errorMessage = errorMsgFormat.arg(fileName, tri::io::Exporter<CMeshO>::ErrorMsg(result));
-        return false;
+        return saveFailed(fileName, errorMsgFormat.arg(fileName, tri::io::Exporter<CMeshO>::ErrorMsg(result)));
       }
       return true;
     }
@@ -315,8 +335,7 @@ bool BaseMeshIOPlugin::save(const QString &formatName,const QString &fileName, M
       result = tri::io::ExporterOBJ<CMeshO>::Save(m.cm,filename.c_str(),mask,cb);
       if(result!=0)
       {
-        errorMessage = errorMsgFormat.arg(fileName, tri::io::Exporter<CMeshO>::ErrorMsg(result));
-        return false;
+        return saveFailed(fileName, errorMsgFormat.arg(fileName, tri::io::Exporter<CMeshO>::ErrorMsg(result)));
       }
       return true;
     }
@@ -326,8 +345,7 @@ bool BaseMeshIOPlugin::save(const QString &formatName,const QString &fileName, M
         int result = tri::io::Exporter<CMeshO>::Save(m.cm,filename.c_str(),mask,cb);
     if(result!=0)
       {
-            errorMessage = errorMsgFormat.arg(fileName, tri::io::Exporter<CMeshO>::ErrorMsg(result));
-          return false;
+            return saveFailed(fileName, errorMsgFormat.arg(fileName, tri::io::Exporter<CMeshO>::ErrorMsg(result)));
       }
     return true;
   }
@@ -336,6 +354,27 @@ bool BaseMeshIOPlugin::save(const QString &formatName,const QString &fileName, M
     return false;
 }
 
+// several layers can fail at the same time when a project is saved: the message of each
+// file is kept apart, errorMessage is the last one
+bool BaseMeshIOPlugin::saveFailed(const QString &fileName, const QString &msg)
+{
+    QMutexLocker lock(&errorMutex);
+    errorMessage = msg;
+    saveErrors[fileName] = msg;
+    return false;
+}
+
+QString BaseMeshIOPlugin::saveError(const QString &fileName)
+{
+    QMutexLocker lock(&errorMutex);
+    return saveErrors.value(fileName,errorMessage);
+}
+
+bool BaseMeshIOPlugin::supportsConcurrentSave(const QString &format) const
+{
+    return (format.toUpper() == "PLY") || (format.toUpper() == "STL") || (format.toUpper() == "OFF") || (format.toUpper() == "OBJ");
+}
+
 /*
     returns the list of the file's type which can be imported
 */
@@ -24,6 +24,8 @@
 #define BASEIOPLUGIN_H
 
 #include <common/interfaces.h>
+#include <QMutex>
+#include <QMap>
 
 class BaseMeshIOPlugin : public QObject, public MeshIOInterface
 {
@@ -47,6 +49,13 @@ public:
   void applyOpenParameter(const QString &format, MeshModel &m, const RichParameterSet &par);
   void initPreOpenParameter(const QString &formatName, const QString &filename, RichParameterSet &parlst);
   void initSaveParameter(const QString &format, MeshModel &/*m*/, RichParameterSet & par);
+  bool supportsConcurrentSave(const QString &format) const;
+  QString saveError(const QString &fileName);
+
+private:
+  bool saveFailed(const QString &fileName, const QString &msg);
+  QMutex errorMutex;
+  QMap<QString,QString> saveErrors;
 };
 
 #endif
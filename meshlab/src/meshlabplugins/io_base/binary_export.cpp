@@ -0,0 +1,559 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "binary_export.h"
+
+#include <wrap/io_trimesh/export_ply.h>
+#include <wrap/io_trimesh/export_stl.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+using namespace vcg;
+
+namespace {
+
+// elements serialized at once and chunks of a window (a few per core)
+const int windowSize = 1 << 18;
+const int chunkNum = 64;
+
+enum PlyType { PlyChar, PlyUChar, PlyShort, PlyUShort, PlyInt, PlyUInt, PlyFloat, PlyDouble, PlyNone };
+
+PlyType plyType(const std::string &name)
+{
+    static const char *names[8][2] = {
+        {"char", "int8"}, {"uchar", "uint8"}, {"short", "int16"}, {"ushort", "uint16"},
+        {"int", "int32"}, {"uint", "uint32"}, {"float", "float32"}, {"double", "float64"}};
+    for (int i = 0; i < 8; ++i)
+        if (name == names[i][0] || name == names[i][1])
+            return PlyType(i);
+    return PlyNone;
+}
+
+int plySize(PlyType t)
+{
+    static const int sizes[9] = {1, 1, 2, 2, 4, 4, 4, 8, 0};
+    return sizes[t];
+}
+
+template <class T>
+inline void put(char *&p, const T &v)
+{
+    memcpy(p, &v, sizeof(T));
+    p += sizeof(T);
+}
+
+// writes v converted to the type of the property, as fwrite of a variable of that type does
+template <class T>
+inline void putAs(char *&p, PlyType t, T v)
+{
+    switch (t)
+    {
+    case PlyChar:   put(p, (signed char)(v)); break;
+    case PlyUChar:  put(p, (unsigned char)(v)); break;
+    case PlyShort:  put(p, short(v)); break;
+    case PlyUShort: put(p, (unsigned short)(v)); break;
+    case PlyInt:    put(p, int(v)); break;
+    case PlyUInt:   put(p, (unsigned int)(v)); break;
+    case PlyFloat:  put(p, float(v)); break;
+    case PlyDouble: put(p, double(v)); break;
+    default: break;
+    }
+}
+
+// The properties written by tri::io::ExporterPLY for vertices and faces
+enum Source
+{
+    VertX, VertY, VertZ, VertNX, VertNY, VertNZ, VertFlags, VertRed, VertGreen, VertBlue, VertAlpha,
+    VertQuality, VertRadius, VertTexU, VertTexV,
+    FaceIndices, FaceFlags, FaceTexCoord, FaceTexNumber, FaceRed, FaceGreen, FaceBlue, FaceAlpha, FaceQuality
+};
+
+struct Field
+{
+    Source src;
+    PlyType type;
+    PlyType countType;   // PlyNone if not a list
+    int listSize;
+};
+
+struct Element
+{
+    std::string name;
+    int count;
+    std::vector<std::string> properties;   // the property lines, without "property"
+};
+
+bool fieldOf(const std::string &element, const std::string &property, const CMeshO &m, Field &f)
+{
+    std::istringstream in(property);
+    std::string type, name;
+    in >> type;
+    f.countType = PlyNone;
+    f.listSize = 0;
+    if (type == "list")
+    {
+        std::string countType;
+        in >> countType >> type;
+        f.countType = plyType(countType);
+        if (f.countType == PlyNone)
+            return false;
+    }
+    in >> name;
+    f.type = plyType(type);
+    if (f.type == PlyNone || name.empty())
+        return false;
+
+    const bool list = (f.countType != PlyNone);
+    if (element == "vertex")
+    {
+        static const char *names[] = {"x", "y", "z", "nx", "ny", "nz", "flags", "red", "green", "blue", "alpha",
+                                      "quality", "radius", "texture_u", "texture_v"};
+        for (int i = 0; i <= VertTexV; ++i)
+            if (name == names[i])
+            {
+                f.src = Source(i);
+                if (f.src == VertRadius && !tri::HasPerVertexRadius(m)) return false;
+                if ((f.src == VertTexU || f.src == VertTexV) && !tri::HasPerVertexTexCoord(m)) return false;
+                return !list;
+            }
+        return false;
+    }
+
+    if (name == "vertex_indices")      { f.src = FaceIndices;   f.listSize = 3; return list; }
+    if (name == "texcoord")            { f.src = FaceTexCoord;  f.listSize = 6;
+                                         return list && (tri::HasPerWedgeTexCoord(m) || tri::HasPerVertexTexCoord(m)); }
+    if (list)
+        return false;
+    if (name == "flags")               { f.src = FaceFlags; return true; }
+    if (name == "texnumber")           { f.src = FaceTexNumber; return tri::HasPerWedgeTexCoord(m); }
+    if (name == "quality")             { f.src = FaceQuality; return tri::HasPerFaceQuality(m); }
+    static const char *colors[] = {"red", "green", "blue", "alpha"};
+    for (int i = 0; i < 4; ++i)
+        if (name == colors[i])
+        {
+            f.src = Source(FaceRed + i);
+            return tri::HasPerFaceColor(m);
+        }
+    return false;
+}
+
+int recordSize(const std::vector<Field> &fields)
+{
+    int size = 0;
+    for (size_t i = 0; i < fields.size(); ++i)
+    {
+        if (fields[i].countType != PlyNone)
+            size += plySize(fields[i].countType) + fields[i].listSize * plySize(fields[i].type);
+        else
+            size += plySize(fields[i].type);
+    }
+    return size;
+}
+
+struct VertexWriter
+{
+    CMeshO &m;
+    const std::vector<Field> &fields;
+
+    VertexWriter(CMeshO &_m, const std::vector<Field> &_fields) : m(_m), fields(_fields) {}
+
+    void operator()(int i, char *&p) const
+    {
+        CVertexO &v = m.vert[i];
+        for (size_t j = 0; j < fields.size(); ++j)
+        {
+            const Field &f = fields[j];
+            switch (f.src)
+            {
+            case VertX:       putAs(p, f.type, v.P()[0]); break;
+            case VertY:       putAs(p, f.type, v.P()[1]); break;
+            case VertZ:       putAs(p, f.type, v.P()[2]); break;
+            case VertNX:      putAs(p, f.type, v.N()[0]); break;
+            case VertNY:      putAs(p, f.type, v.N()[1]); break;
+            case VertNZ:      putAs(p, f.type, v.N()[2]); break;
+            case VertFlags:   putAs(p, f.type, v.Flags()); break;
+            case VertRed:     putAs(p, f.type, v.C()[0]); break;
+            case VertGreen:   putAs(p, f.type, v.C()[1]); break;
+            case VertBlue:    putAs(p, f.type, v.C()[2]); break;
+            case VertAlpha:   putAs(p, f.type, v.C()[3]); break;
+            case VertQuality: putAs(p, f.type, v.Q()); break;
+            case VertRadius:  putAs(p, f.type, v.R()); break;
+            case VertTexU:    putAs(p, f.type, v.T().u()); break;
+            case VertTexV:    putAs(p, f.type, v.T().v()); break;
+            default: break;
+            }
+        }
+    }
+};
+
+struct FaceWriter
+{
+    CMeshO &m;
+    const std::vector<Field> &fields;
+    const int *remap;   // compacted vertex indexes, null if no vertex is deleted
+    const bool wedgeTex;
+
+    FaceWriter(CMeshO &_m, const std::vector<Field> &_fields, const int *_remap)
+        : m(_m), fields(_fields), remap(_remap), wedgeTex(tri::HasPerWedgeTexCoord(_m)) {}
+
+    void operator()(int i, char *&p) const
+    {
+        CFaceO &fc = m.face[i];
+        for (size_t j = 0; j < fields.size(); ++j)
+        {
+            const Field &f = fields[j];
+            switch (f.src)
+            {
+            case FaceIndices:
+                putAs(p, f.countType, 3);
+                for (int k = 0; k < 3; ++k)
+                {
+                    const int vi = int(fc.V(k) - &m.vert[0]);
+                    putAs(p, f.type, remap ? remap[vi] : vi);
+                }
+                break;
+            case FaceTexCoord:
+                putAs(p, f.countType, 6);
+                for (int k = 0; k < 3; ++k)
+                {
+                    const TexCoord2f &t = wedgeTex ? fc.WT(k) : fc.V(k)->T();
+                    putAs(p, f.type, t.u());
+                    putAs(p, f.type, t.v());
+                }
+                break;
+            case FaceFlags:     putAs(p, f.type, fc.Flags()); break;
+            case FaceTexNumber: putAs(p, f.type, fc.WT(0).n()); break;
+            case FaceRed:       putAs(p, f.type, fc.C()[0]); break;
+            case FaceGreen:     putAs(p, f.type, fc.C()[1]); break;
+            case FaceBlue:      putAs(p, f.type, fc.C()[2]); break;
+            case FaceAlpha:     putAs(p, f.type, fc.C()[3]); break;
+            case FaceQuality:   putAs(p, f.type, fc.Q()); break;
+            default: break;
+            }
+        }
+    }
+};
+
+// First index of chunk k of the range [r0, r1)
+inline int chunkBegin(int r0, int r1, int k)
+{
+    return r0 + int((long long)(r1 - r0) * k / chunkNum);
+}
+
+// Serializes the live elements of the container in windows and writes them in order
+template <class Container, class Writer>
+bool writeElements(FILE *fp, Container &c, int recSize, const Writer &write,
+                   vcg::CallBackPos *cb, int progressBegin, int progressEnd, const char *msg)
+{
+    const int n = int(c.size());
+    if (n == 0)
+        return true;
+    std::vector<char> buf(size_t(std::min(n, windowSize)) * recSize);
+    std::vector<int> offset(chunkNum + 1, 0);
+    for (int w0 = 0; w0 < n; w0 += windowSize)
+    {
+        const int w1 = std::min(n, w0 + windowSize);
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int k = 0; k < chunkNum; ++k)
+        {
+            int live = 0;
+            for (int i = chunkBegin(w0, w1, k); i < chunkBegin(w0, w1, k + 1); ++i)
+                if (!c[i].IsD())
+                    ++live;
+            offset[k + 1] = live;
+        }
+        for (int k = 0; k < chunkNum; ++k)
+            offset[k + 1] += offset[k];
+
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (int k = 0; k < chunkNum; ++k)
+        {
+            char *p = buf.data() + size_t(offset[k]) * recSize;
+            for (int i = chunkBegin(w0, w1, k); i < chunkBegin(w0, w1, k + 1); ++i)
+                if (!c[i].IsD())
+                    write(i, p);
+        }
+
+        const size_t live = size_t(offset[chunkNum]);
+        if (live > 0 && fwrite(buf.data(), recSize, live, fp) != live)
+            return false;
+        if (cb)
+            (*cb)(progressBegin + int((long long)(progressEnd - progressBegin) * w1 / n), msg);
+    }
+    return true;
+}
+
+// Compacted index of every vertex, skipping the deleted ones
+void compactVertexIndexes(CMeshO &m, std::vector<int> &remap)
+{
+    const int n = int(m.vert.size());
+    remap.resize(n);
+    std::vector<int> offset(chunkNum + 1, 0);
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int k = 0; k < chunkNum; ++k)
+    {
+        int live = 0;
+        for (int i = chunkBegin(0, n, k); i < chunkBegin(0, n, k + 1); ++i)
+            if (!m.vert[i].IsD())
+                ++live;
+        offset[k + 1] = live;
+    }
+    for (int k = 0; k < chunkNum; ++k)
+        offset[k + 1] += offset[k];
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int k = 0; k < chunkNum; ++k)
+    {
+        int index = offset[k];
+        for (int i = chunkBegin(0, n, k); i < chunkBegin(0, n, k + 1); ++i)
+        {
+            remap[i] = index;
+            if (!m.vert[i].IsD())
+                ++index;
+        }
+    }
+}
+
+// An empty mesh with the same optional components, textures and camera of m
+void emptyCopy(CMeshO &m, CMeshO &proxy)
+{
+    if (m.vert.IsTexCoordEnabled()) proxy.vert.EnableTexCoord();
+    if (m.vert.IsRadiusEnabled())   proxy.vert.EnableRadius();
+    if (m.face.IsQualityEnabled())  proxy.face.EnableQuality();
+    if (m.face.IsColorEnabled())    proxy.face.EnableColor();
+    if (m.face.IsWedgeTexCoordEnabled()) proxy.face.EnableWedgeTexCoord();
+    proxy.textures = m.textures;
+    proxy.normalmaps = m.normalmaps;
+    proxy.shot = m.shot;
+}
+
+bool readFile(const char *filename, std::string &data)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return false;
+    char buf[4096];
+    size_t read;
+    while ((read = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.append(buf, read);
+    fclose(fp);
+    return true;
+}
+
+// Splits the header of a binary ply file in its elements; the data that follows is in tail
+bool parsePlyHeader(const std::string &data, std::string &header, std::string &tail, std::vector<Element> &elements)
+{
+    const std::string endHeader = "end_header\n";
+    const size_t end = data.find(endHeader);
+    if (end == std::string::npos)
+        return false;
+    header = data.substr(0, end + endHeader.size());
+    tail = data.substr(end + endHeader.size());
+
+    std::istringstream lines(header);
+    std::string line;
+    bool binary = false;
+    while (std::getline(lines, line))
+    {
+        std::istringstream in(line);
+        std::string key;
+        in >> key;
+        if (key == "format")
+        {
+            std::string format;
+            in >> format;
+            binary = (format == "binary_little_endian" || format == "binary_big_endian");
+        }
+        else if (key == "element")
+        {
+            Element e;
+            if (!(in >> e.name >> e.count))
+                return false;
+            elements.push_back(e);
+        }
+        else if (key == "property")
+        {
+            if (elements.empty())
+                return false;
+            std::string rest;
+            std::getline(in, rest);
+            elements.back().properties.push_back(rest);
+        }
+    }
+    return binary;
+}
+
+// Replaces the count in the "element <name> 0" line of the header
+bool patchCount(std::string &header, const std::string &name, int count)
+{
+    const std::string line = "\nelement " + name + " 0\n";
+    const size_t pos = header.find(line);
+    if (pos == std::string::npos)
+        return false;
+    std::ostringstream patched;
+    patched << "\nelement " << name << " " << count << "\n";
+    header.replace(pos, line.size(), patched.str());
+    return true;
+}
+
+} // namespace
+
+BinaryExport::Result BinaryExport::SavePLY(CMeshO &m, const char *filename, int mask, vcg::CallBackPos *cb)
+{
+    if (m.en > 0 || (mask & tri::io::Mask::IOM_BITPOLYGONAL))
+        return Unsupported;
+
+    // header and camera as written by VCG for the same mesh without elements
+    CMeshO proxy;
+    emptyCopy(m, proxy);
+    if (tri::io::ExporterPLY<CMeshO>::Save(proxy, filename, mask, true) != 0)
+        return Unsupported;
+    std::string data, header, tail;
+    std::vector<Element> elements;
+    if (!readFile(filename, data) || !parsePlyHeader(data, header, tail, elements))
+        return Unsupported;
+
+    // the elements before the vertices (the camera) are already in the tail, the
+    // vertices and the faces must be followed only by empty elements
+    std::vector<Field> vertFields, faceFields;
+    int vertElem = -1, faceElem = -1;
+    for (int i = 0; i < int(elements.size()); ++i)
+    {
+        const Element &e = elements[i];
+        if (e.name == "vertex" && vertElem < 0)
+            vertElem = i;
+        else if (e.name == "face" && vertElem >= 0 && faceElem < 0)
+            faceElem = i;
+        else if (vertElem >= 0 && e.count != 0)
+            return Unsupported;
+        else
+            continue;
+        std::vector<Field> &fields = (e.name == "vertex") ? vertFields : faceFields;
+        for (size_t j = 0; j < e.properties.size(); ++j)
+        {
+            Field f;
+            if (!fieldOf(e.name, e.properties[j], m, f))
+                return Unsupported;
+            fields.push_back(f);
+        }
+    }
+    if (vertElem < 0 || !patchCount(header, "vertex", m.vn))
+        return Unsupported;
+    if (faceElem >= 0 && !patchCount(header, "face", m.fn))
+        return Unsupported;
+    if (faceElem < 0 && m.fn > 0)
+        return Unsupported;
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+        return CantOpen;
+    bool ok = fwrite(header.data(), 1, header.size(), fp) == header.size();
+    ok = ok && (tail.empty() || fwrite(tail.data(), 1, tail.size(), fp) == tail.size());
+
+    std::vector<int> remap;
+    if (ok && faceElem >= 0 && m.vn != int(m.vert.size()))
+        compactVertexIndexes(m, remap);
+    ok = ok && writeElements(fp, m.vert, recordSize(vertFields), VertexWriter(m, vertFields), cb, 0, 50, "Saving Vertices");
+    if (faceElem >= 0)
+        ok = ok && writeElements(fp, m.face, recordSize(faceFields), FaceWriter(m, faceFields, remap.empty() ? 0 : remap.data()),
+                                 cb, 50, 100, "Saving Faces");
+    if (fclose(fp) != 0)
+        ok = false;
+    return ok ? Done : WriteError;
+}
+
+namespace {
+
+struct StlFacetWriter
+{
+    CMeshO &m;
+
+    StlFacetWriter(CMeshO &_m) : m(_m) {}
+
+    void operator()(int i, char *&p) const
+    {
+        CFaceO &f = m.face[i];
+        Point3f q;
+        q.Import(NormalizedTriangleNormal(f));
+        put(p, q);
+        for (int k = 0; k < 3; ++k)
+        {
+            q.Import(f.V(k)->P());
+            put(p, q);
+        }
+        put(p, (unsigned short)(0));
+    }
+};
+
+} // namespace
+
+BinaryExport::Result BinaryExport::SaveSTL(CMeshO &m, const char *filename, int mask, const char *objectName, bool magicsMode, vcg::CallBackPos *cb)
+{
+    if ((mask & tri::io::Mask::IOM_FACECOLOR) && tri::HasPerFaceColor(m))
+        return Unsupported;
+
+    // 80 bytes of header and the number of facets
+    CMeshO proxy;
+    std::string header;
+    if (tri::io::ExporterSTL<CMeshO>::Save(proxy, filename, true, mask, objectName, magicsMode) != 0
+            || !readFile(filename, header) || header.size() != 84)
+        return Unsupported;
+    const int facetNum = m.fn;
+    memcpy(&header[80], &facetNum, sizeof(int));
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+        return CantOpen;
+    bool ok = fwrite(header.data(), 1, header.size(), fp) == header.size();
+    ok = ok && writeElements(fp, m.face, 50, StlFacetWriter(m), cb, 0, 100, "Saving Facets");
+    if (fclose(fp) != 0)
+        ok = false;
+    return ok ? Done : WriteError;
+}
+
+const char *BinaryExport::ErrorMsg(Result r)
+{
+    switch (r)
+    {
+    case Done:        return "No errors";
+    case Unsupported: return "Unsupported layout";
+    case CantOpen:    return "Can't open file";
+    case WriteError:  return "Error writing the file";
+    }
+    return "Unknown error";
+}
@@ -0,0 +1,55 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef BINARY_EXPORT_H
+#define BINARY_EXPORT_H
+
+#include <common/ml_mesh_type.h>
+#include <wrap/callback.h>
+
+/*
+  Parallel writers for the binary PLY and STL formats.
+
+  The header is produced by the VCG exporters themselves, saving an empty mesh with
+  the same components, textures and camera; the element counts are then patched in.
+  The elements are serialized in windows of a few hundred thousand: every window is
+  split in chunks, the live elements of each chunk are counted and written into one
+  buffer concurrently, with deleted vertices remapped through a prefix count, and the
+  buffer is written with a single fwrite. The output is byte-identical to the one of
+  tri::io::ExporterPLY and tri::io::ExporterSTL.
+
+  Only the layouts known to the writer are handled (the standard vertex and face
+  properties, no edges, no polygonal faces, no STL face colors); in the other cases
+  Unsupported is returned and the file must be saved again with the VCG exporter.
+*/
+class BinaryExport
+{
+public:
+    enum Result { Done = 0, Unsupported, CantOpen, WriteError };
+
+    static Result SavePLY(CMeshO &m, const char *filename, int mask, vcg::CallBackPos *cb = 0);
+    static Result SaveSTL(CMeshO &m, const char *filename, int mask, const char *objectName, bool magicsMode, vcg::CallBackPos *cb = 0);
+    static const char *ErrorMsg(Result r);
+};
+
+#endif // BINARY_EXPORT_H
@@ -1,6 +1,8 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += baseio.h \
+		binary_export.h \
 		$$VCGDIR/wrap/io_trimesh/import_obj.h \
 		$$VCGDIR/wrap/io_trimesh/import_off.h \
 		$$VCGDIR/wrap/io_trimesh/import_ptx.h \
@@ -12,6 +14,7 @@ HEADERS       += baseio.h \
 		$$VCGDIR/wrap/io_trimesh/io_material.h
 
 SOURCES       += baseio.cpp \
+		binary_export.cpp \
 		$$VCGDIR//wrap/ply/plylib.cpp\
 
 
@@ -0,0 +1,1018 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "import_dae_stream.h"
+
+#include <common/ml_ascii_reader.h>
+
+#include <QFile>
+#include <QXmlStreamReader>
+
+#include <map>
+#include <string>
+#include <vector>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+using namespace vcg;
+
+namespace {
+
+inline bool isBlank(QChar c)
+{
+    const ushort u = c.unicode();
+    return u == ' ' || u == '\n' || u == '\r' || u == '\t';
+}
+
+// "#id" -> "id"
+inline QString localId(const QStringRef &url)
+{
+    return url.startsWith(QLatin1Char('#')) ? url.mid(1).toString() : url.toString();
+}
+
+/*
+  Parses the blank separated numbers of the content of an element, which the XML
+  reader can report in more than one chunk. A number cut at the end of a chunk is
+  completed with the beginning of the next one.
+*/
+template <class T>
+class NumberParser
+{
+public:
+    NumberParser(std::vector<T> &out) : _out(out), _ok(true) {}
+
+    void add(const QStringRef &text)
+    {
+        const QChar *s = text.unicode();
+        const int n = text.size();
+        int begin = 0;
+        if (!_carry.empty())
+        {
+            while (begin < n && !isBlank(s[begin]))
+                _carry += latin1(s[begin++]);
+            if (begin == n)
+                return;
+            flushCarry();
+        }
+        int end = n;
+        while (end > begin && !isBlank(s[end - 1]))
+            --end;
+        for (int i = end; i < n; ++i)
+            _carry += latin1(s[i]);
+        parse(s + begin, end - begin);
+    }
+
+    bool finish()
+    {
+        flushCarry();
+        return _ok;
+    }
+
+private:
+    static const int blockSize = 1 << 16;
+
+    static inline char latin1(QChar c)
+    {
+        return c.unicode() < 128 ? char(c.unicode()) : '?';
+    }
+
+    void flushCarry()
+    {
+        if (_carry.empty())
+            return;
+        _ok = parseBlock(_carry.data(), _carry.data() + _carry.size(), _out) && _ok;
+        _carry.clear();
+    }
+
+    static bool parseBlock(const char *p, const char *end, std::vector<T> &out)
+    {
+        for (;;)
+        {
+            while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+                ++p;
+            if (p == end)
+                return true;
+            double v;
+            if (!MLAsciiReader::parseNumber(p, end, v))
+                return false;
+            out.push_back(T(v));
+        }
+    }
+
+    // Parses text made of whole numbers; big texts are split at blanks and parsed concurrently
+    void parse(const QChar *s, int n)
+    {
+        int pieceNum = 1;
+#ifdef _USE_OMP
+        if (n > 16 * blockSize)
+            pieceNum = 4 * omp_get_max_threads();
+#endif
+        std::vector<int> bounds(pieceNum + 1, n);
+        bounds[0] = 0;
+        for (int k = 1; k < pieceNum; ++k)
+        {
+            int b = std::max(bounds[k - 1], int((long long)n * k / pieceNum));
+            while (b < n && !isBlank(s[b]))
+                ++b;
+            bounds[k] = b;
+        }
+        std::vector<std::vector<T> > parts(pieceNum);
+        int failed = 0;
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic, 1) reduction(+: failed)
+#endif
+        for (int k = 0; k < pieceNum; ++k)
+        {
+            std::vector<T> &out = (pieceNum == 1) ? _out : parts[k];
+            std::string block;
+            for (int b0 = bounds[k]; b0 < bounds[k + 1]; )
+            {
+                int b1 = std::min(bounds[k + 1], b0 + blockSize);
+                while (b1 < bounds[k + 1] && !isBlank(s[b1]))
+                    ++b1;
+                block.resize(b1 - b0);
+                for (int i = b0; i < b1; ++i)
+                    block[i - b0] = latin1(s[i]);
+                if (!parseBlock(block.data(), block.data() + block.size(), out))
+                {
+                    ++failed;
+                    break;
+                }
+                b0 = b1;
+            }
+        }
+        if (pieceNum > 1)
+        {
+            size_t total = _out.size();
+            for (int k = 0; k < pieceNum; ++k)
+                total += parts[k].size();
+            _out.reserve(total);
+            for (int k = 0; k < pieceNum; ++k)
+                _out.insert(_out.end(), parts[k].begin(), parts[k].end());
+        }
+        if (failed > 0)
+            _ok = false;
+    }
+
+    std::vector<T> &_out;
+    std::string _carry;
+    bool _ok;
+};
+
+// A float array seen through its accessor
+struct Source
+{
+    std::vector<float> data;
+    int count;
+    int stride;
+    int offset;
+
+    Source() : count(0), stride(1), offset(0) {}
+    bool valid(int dim) const
+    {
+        return stride >= dim && offset >= 0 && count >= 0 &&
+               (count == 0 || size_t(offset) + size_t(count - 1) * stride + dim <= data.size());
+    }
+    const float *at(int k) const { return &data[size_t(offset) + size_t(k) * stride]; }
+};
+
+struct Input
+{
+    QString semantic;
+    QString source;
+    int offset;
+    int set;
+};
+
+// triangles, polylist or polygons; vcount is empty for triangles
+struct Primitive
+{
+    QString material;
+    std::vector<Input> inputs;
+    std::vector<int> vcount;
+    std::vector<int> p;
+    int tupleSize;
+};
+
+struct Geometry
+{
+    std::map<QString, Source> sources;
+    QString verticesId;
+    std::vector<Input> vertexInputs;
+    std::vector<Primitive> primitives;
+};
+
+struct Effect
+{
+    std::map<QString, QString> surfaces;   // newparam sid -> image
+    std::map<QString, QString> samplers;   // newparam sid -> surface sid
+    QString texture;                       // the first texture used by the effect
+};
+
+struct Instance
+{
+    QString geometry;
+    Matrix44m mat;
+    std::map<QString, QString> bind;       // material symbol -> material
+};
+
+class DaeReader
+{
+public:
+    DaeReader() : unsupported(false), badNumbers(false) {}
+
+    std::map<QString, Geometry> geometries;
+    std::vector<QString> geometryOrder;
+    std::vector<QString> imageIds;
+    std::vector<QString> imageFiles;
+    std::map<QString, QString> materialEffect;
+    std::map<QString, Effect> effects;
+    std::map<QString, std::vector<Instance> > scenes;
+    std::vector<QString> sceneOrder;
+    QString sceneUrl;
+    bool unsupported;
+    bool badNumbers;
+
+    DaeStreamImporter::Result read(QFile &file, vcg::CallBackPos *cb)
+    {
+        xml.setDevice(&file);
+        const qint64 size = std::max<qint64>(1, file.size());
+        int tokens = 0;
+        while (!xml.atEnd() && !unsupported)
+        {
+            xml.readNext();
+            if (cb && (++tokens & 0xfff) == 0)
+                (*cb)(int(70 * file.pos() / size), "Reading Collada");
+            if (!xml.isStartElement())
+                continue;
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("image"))
+                readImage();
+            else if (name == QLatin1String("material"))
+                readMaterial();
+            else if (name == QLatin1String("effect"))
+                readEffect();
+            else if (name == QLatin1String("geometry"))
+                readGeometry();
+            else if (name == QLatin1String("visual_scene"))
+                readVisualScene();
+            else if (name == QLatin1String("instance_visual_scene"))
+                sceneUrl = localId(xml.attributes().value("url"));
+        }
+        if (unsupported)
+            return DaeStreamImporter::Unsupported;
+        if (xml.hasError())
+            return DaeStreamImporter::InvalidXml;
+        return badNumbers ? DaeStreamImporter::Unsupported : DaeStreamImporter::Done;
+    }
+
+private:
+    QXmlStreamReader xml;
+
+    int intAttribute(const char *name, int def)
+    {
+        bool ok;
+        const int v = xml.attributes().value(name).toString().toInt(&ok);
+        return ok ? v : def;
+    }
+
+    // Parses the numbers of the current element, up to its end
+    template <class T>
+    void readNumbers(std::vector<T> &out)
+    {
+        NumberParser<T> parser(out);
+        while (!xml.atEnd())
+        {
+            xml.readNext();
+            if (xml.isCharacters())
+                parser.add(xml.text());
+            else if (xml.isEndElement())
+                break;
+            else if (xml.isStartElement())
+                xml.skipCurrentElement();
+        }
+        if (!parser.finish())
+            badNumbers = true;
+    }
+
+    QString readText()
+    {
+        return xml.readElementText(QXmlStreamReader::IncludeChildElements).trimmed();
+    }
+
+    void readImage()
+    {
+        const QString id = xml.attributes().value("id").toString();
+        QString file;
+        while (xml.readNextStartElement())
+        {
+            if (xml.name() == QLatin1String("init_from"))
+                file = readText();
+            else
+                xml.skipCurrentElement();
+        }
+        if (file.startsWith("file://"))
+            file = file.mid(7);
+        imageIds.push_back(id);
+        imageFiles.push_back(file);
+    }
+
+    void readMaterial()
+    {
+        const QString id = xml.attributes().value("id").toString();
+        while (xml.readNextStartElement())
+        {
+            if (xml.name() == QLatin1String("instance_effect"))
+                materialEffect[id] = localId(xml.attributes().value("url"));
+            xml.skipCurrentElement();
+        }
+    }
+
+    void readEffect()
+    {
+        Effect &e = effects[xml.attributes().value("id").toString()];
+        readEffectContent(e);
+    }
+
+    void readEffectContent(Effect &e)
+    {
+        while (xml.readNextStartElement())
+        {
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("newparam"))
+                readNewParam(e, xml.attributes().value("sid").toString());
+            else if (name == QLatin1String("texture"))
+            {
+                if (e.texture.isEmpty())
+                    e.texture = xml.attributes().value("texture").toString();
+                xml.skipCurrentElement();
+            }
+            else if (name == QLatin1String("image"))
+                readImage();
+            else
+                readEffectContent(e);
+        }
+    }
+
+    void readNewParam(Effect &e, const QString &sid)
+    {
+        while (xml.readNextStartElement())
+        {
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("surface") || name == QLatin1String("sampler2D"))
+            {
+                const bool surface = (name == QLatin1String("surface"));
+                while (xml.readNextStartElement())
+                {
+                    if (surface && xml.name() == QLatin1String("init_from"))
+                        e.surfaces[sid] = readText();
+                    else if (!surface && xml.name() == QLatin1String("source"))
+                        e.samplers[sid] = readText();
+                    else if (!surface && xml.name() == QLatin1String("instance_image"))
+                    {
+                        e.surfaces[sid] = localId(xml.attributes().value("url"));
+                        e.samplers[sid] = sid;
+                        xml.skipCurrentElement();
+                    }
+                    else
+                        xml.skipCurrentElement();
+                }
+            }
+            else
+                xml.skipCurrentElement();
+        }
+    }
+
+    void readGeometry()
+    {
+        const QString id = xml.attributes().value("id").toString();
+        if (geometries.count(id))
+        {
+            unsupported = true;
+            return;
+        }
+        Geometry &g = geometries[id];
+        geometryOrder.push_back(id);
+        while (xml.readNextStartElement() && !unsupported)
+        {
+            if (xml.name() == QLatin1String("mesh"))
+                readMesh(g);
+            else
+                xml.skipCurrentElement();
+        }
+    }
+
+    void readInput(std::vector<Input> &inputs)
+    {
+        Input in;
+        in.semantic = xml.attributes().value("semantic").toString();
+        in.source = localId(xml.attributes().value("source"));
+        in.offset = intAttribute("offset", 0);
+        in.set = intAttribute("set", 0);
+        inputs.push_back(in);
+        xml.skipCurrentElement();
+    }
+
+    void readMesh(Geometry &g)
+    {
+        while (xml.readNextStartElement() && !unsupported)
+        {
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("source"))
+                readSource(g.sources[xml.attributes().value("id").toString()]);
+            else if (name == QLatin1String("vertices"))
+            {
+                g.verticesId = xml.attributes().value("id").toString();
+                while (xml.readNextStartElement())
+                {
+                    if (xml.name() == QLatin1String("input"))
+                        readInput(g.vertexInputs);
+                    else
+                        xml.skipCurrentElement();
+                }
+            }
+            else if (name == QLatin1String("triangles") || name == QLatin1String("polylist") || name == QLatin1String("polygons"))
+            {
+                g.primitives.push_back(Primitive());
+                readPrimitive(g.primitives.back(), name.toString());
+            }
+            else if (name == QLatin1String("lines") || name == QLatin1String("linestrips") ||
+                     name == QLatin1String("trifans") || name == QLatin1String("tristrips"))
+                unsupported = true;
+            else
+                xml.skipCurrentElement();
+        }
+    }
+
+    void readSource(Source &s)
+    {
+        while (xml.readNextStartElement())
+        {
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("float_array"))
+                readNumbers(s.data);
+            else if (name == QLatin1String("technique_common"))
+            {
+                while (xml.readNextStartElement())
+                {
+                    if (xml.name() == QLatin1String("accessor"))
+                    {
+                        s.count = intAttribute("count", 0);
+                        s.stride = intAttribute("stride", 1);
+                        s.offset = intAttribute("offset", 0);
+                    }
+                    xml.skipCurrentElement();
+                }
+            }
+            else
+                xml.skipCurrentElement();
+        }
+    }
+
+    void readPrimitive(Primitive &pr, const QString &kind)
+    {
+        pr.material = xml.attributes().value("material").toString();
+        pr.tupleSize = 1;
+        const bool polygons = (kind == "polygons");
+        while (xml.readNextStartElement() && !unsupported)
+        {
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("input"))
+            {
+                readInput(pr.inputs);
+                pr.tupleSize = std::max(pr.tupleSize, pr.inputs.back().offset + 1);
+            }
+            else if (name == QLatin1String("vcount"))
+                readNumbers(pr.vcount);
+            else if (name == QLatin1String("p"))
+            {
+                const size_t first = pr.p.size();
+                readNumbers(pr.p);
+                if (polygons)
+                    pr.vcount.push_back(int((pr.p.size() - first) / pr.tupleSize));
+            }
+            else if (name == QLatin1String("ph"))
+                unsupported = true;
+            else
+                xml.skipCurrentElement();
+        }
+
+        // every polygon must have all its indices
+        size_t corners = 0;
+        for (size_t i = 0; i < pr.vcount.size(); ++i)
+        {
+            if (pr.vcount[i] < 0)
+                unsupported = true;
+            corners += std::max(pr.vcount[i], 0);
+        }
+        if (kind == "triangles")
+            unsupported = unsupported || !pr.vcount.empty() || pr.p.size() % (3 * pr.tupleSize) != 0;
+        else
+            unsupported = unsupported || corners * pr.tupleSize != pr.p.size();
+    }
+
+    void readVisualScene()
+    {
+        const QString id = xml.attributes().value("id").toString();
+        sceneOrder.push_back(id);
+        std::vector<Instance> &instances = scenes[id];
+        Matrix44m identity;
+        identity.SetIdentity();
+        while (xml.readNextStartElement() && !unsupported)
+        {
+            if (xml.name() == QLatin1String("node"))
+                readNode(identity, instances);
+            else
+                xml.skipCurrentElement();
+        }
+    }
+
+    // reads exactly n numbers
+    bool readValues(std::vector<float> &v, size_t n)
+    {
+        v.clear();
+        readNumbers(v);
+        return v.size() == n;
+    }
+
+    void readNode(const Matrix44m &parent, std::vector<Instance> &instances)
+    {
+        Matrix44m mat = parent;
+        std::vector<float> v;
+        while (xml.readNextStartElement() && !unsupported)
+        {
+            const QStringRef name = xml.name();
+            Matrix44m t;
+            if (name == QLatin1String("matrix"))
+            {
+                if (!readValues(v, 16)) { unsupported = true; return; }
+                for (int i = 0; i < 16; ++i)
+                    t[i / 4][i % 4] = v[i];
+                mat = mat * t;
+            }
+            else if (name == QLatin1String("translate"))
+            {
+                if (!readValues(v, 3)) { unsupported = true; return; }
+                t.SetTranslate(v[0], v[1], v[2]);
+                mat = mat * t;
+            }
+            else if (name == QLatin1String("rotate"))
+            {
+                if (!readValues(v, 4)) { unsupported = true; return; }
+                t.SetRotateDeg(v[3], Point3m(v[0], v[1], v[2]));
+                mat = mat * t;
+            }
+            else if (name == QLatin1String("scale"))
+            {
+                if (!readValues(v, 3)) { unsupported = true; return; }
+                t.SetScale(v[0], v[1], v[2]);
+                mat = mat * t;
+            }
+            else if (name == QLatin1String("node"))
+                readNode(mat, instances);
+            else if (name == QLatin1String("instance_geometry"))
+            {
+                Instance in;
+                in.geometry = localId(xml.attributes().value("url"));
+                in.mat = mat;
+                readBindings(in.bind);
+                instances.push_back(in);
+            }
+            else if (name == QLatin1String("instance_node") || name == QLatin1String("instance_controller") ||
+                     name == QLatin1String("lookat") || name == QLatin1String("skew"))
+                unsupported = true;
+            else
+                xml.skipCurrentElement();
+        }
+    }
+
+    void readBindings(std::map<QString, QString> &bind)
+    {
+        while (xml.readNextStartElement())
+        {
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("instance_material"))
+            {
+                bind[xml.attributes().value("symbol").toString()] = localId(xml.attributes().value("target"));
+                xml.skipCurrentElement();
+            }
+            else if (name == QLatin1String("bind_material") || name == QLatin1String("technique_common"))
+                readBindings(bind);
+            else
+                xml.skipCurrentElement();
+        }
+    }
+};
+
+// Where a per corner attribute comes from: a source and the offset of its index in the
+// tuples, or the index of the vertex when the attribute is an input of <vertices>
+struct Attribute
+{
+    const Source *src;
+    int offset;
+
+    Attribute() : src(0), offset(-1) {}
+};
+
+// A primitive of an instance, ready to be copied into the mesh
+struct Part
+{
+    const Primitive *pr;
+    const Source *pos;
+    int vertexOffset;
+    Attribute normal, color, tex;
+    int texIndex;
+    int vertBase;                   // first vertex of the instance
+    int faceBase;                   // first face of the primitive
+    std::vector<int> polyStart;     // first tuple and first face of every polygon (not for triangles)
+    std::vector<int> faceStart;
+
+    int polygonNum() const { return pr->vcount.empty() ? int(pr->p.size() / (3 * pr->tupleSize)) : int(pr->vcount.size()); }
+    int corners(int i) const { return pr->vcount.empty() ? 3 : pr->vcount[i]; }
+    int firstTuple(int i) const { return pr->vcount.empty() ? 3 * i : polyStart[i]; }
+    int firstFace(int i) const { return pr->vcount.empty() ? i : faceStart[i]; }
+    int index(int tuple, int offset) const { return pr->p[size_t(tuple) * pr->tupleSize + offset]; }
+};
+
+struct PlacedInstance
+{
+    const Geometry *g;
+    const Source *pos;
+    Attribute normal, color, tex;   // inputs of <vertices>
+    Matrix44m mat;
+    int vertBase;
+    int firstPart, lastPart;
+};
+
+inline Point3m transformNormal(const Matrix44m &mat, const float *n)
+{
+    Point3m r;
+    for (int i = 0; i < 3; ++i)
+        r[i] = mat[i][0] * n[0] + mat[i][1] * n[1] + mat[i][2] * n[2];
+    return r.Normalize();
+}
+
+inline Color4b toColor(const Source *src, const float *c)
+{
+    Color4b col(255, 255, 255, 255);
+    const int dim = std::min(src->stride, 4);
+    for (int i = 0; i < dim; ++i)
+        col[i] = (unsigned char)(math::Clamp(c[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    return col;
+}
+
+const Source *findSource(const Geometry &g, const QString &id, int dim)
+{
+    std::map<QString, Source>::const_iterator it = g.sources.find(id);
+    if (it == g.sources.end() || !it->second.valid(dim))
+        return 0;
+    return &it->second;
+}
+
+// Resolves the inputs of a list: VERTEX goes to vertexOffset, the others to the attributes
+bool resolveInputs(const Geometry &g, const std::vector<Input> &inputs, int &vertexOffset,
+                   Attribute &normal, Attribute &color, Attribute &tex)
+{
+    int texSet = -1;
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        const Input &in = inputs[i];
+        Attribute *a = 0;
+        int dim = 0;
+        if (in.semantic == "VERTEX")
+        {
+            if (in.source != g.verticesId)
+                return false;
+            vertexOffset = in.offset;
+            continue;
+        }
+        else if (in.semantic == "NORMAL")   { a = &normal; dim = 3; }
+        else if (in.semantic == "COLOR")    { a = &color;  dim = 3; }
+        else if (in.semantic == "TEXCOORD")
+        {
+            // the set with the lowest number
+            if (texSet >= 0 && in.set >= texSet)
+                continue;
+            texSet = in.set;
+            a = &tex;
+            dim = 2;
+        }
+        else
+            continue;
+        a->src = findSource(g, in.source, dim);
+        a->offset = in.offset;
+        if (a->src == 0)
+            return false;
+    }
+    return true;
+}
+
+int textureIndex(const DaeReader &r, const Instance &inst, const QString &symbol)
+{
+    std::map<QString, QString>::const_iterator b = inst.bind.find(symbol);
+    const QString material = (b != inst.bind.end()) ? b->second : symbol;
+    std::map<QString, QString>::const_iterator me = r.materialEffect.find(material);
+    if (me == r.materialEffect.end())
+        return -1;
+    std::map<QString, Effect>::const_iterator e = r.effects.find(me->second);
+    if (e == r.effects.end() || e->second.texture.isEmpty())
+        return -1;
+    QString image = e->second.texture;
+    std::map<QString, QString>::const_iterator s = e->second.samplers.find(image);
+    if (s != e->second.samplers.end())
+    {
+        std::map<QString, QString>::const_iterator f = e->second.surfaces.find(s->second);
+        image = (f != e->second.surfaces.end()) ? f->second : s->second;
+    }
+    for (size_t i = 0; i < r.imageIds.size(); ++i)
+        if (r.imageIds[i] == image)
+            return int(i);
+    return -1;
+}
+
+// Number of indices out of range in the tuples of a part
+int badIndices(const Part &pt, int vertNum)
+{
+    const int tupleNum = int(pt.pr->p.size() / pt.pr->tupleSize);
+    const Attribute *attr[3] = {&pt.normal, &pt.color, &pt.tex};
+    int bad = 0;
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static) reduction(+: bad)
+#endif
+    for (int t = 0; t < tupleNum; ++t)
+    {
+        const int vi = pt.index(t, pt.vertexOffset);
+        if (vi < 0 || vi >= vertNum)
+            ++bad;
+        for (int a = 0; a < 3; ++a)
+            if (attr[a]->src && attr[a]->offset >= 0)
+            {
+                const int ai = pt.index(t, attr[a]->offset);
+                if (ai < 0 || ai >= attr[a]->src->count)
+                    ++bad;
+            }
+    }
+    return bad;
+}
+
+} // namespace
+
+DaeStreamImporter::Result DaeStreamImporter::Open(MeshModel &m, const QString &fileName, int &mask, vcg::CallBackPos *cb)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return CantOpen;
+    DaeReader r;
+    Result res = r.read(file, cb);
+    file.close();
+    if (res != Done)
+        return res;
+
+    // the instances of the scene, or every geometry once
+    std::vector<Instance> instances;
+    if (!r.sceneOrder.empty())
+    {
+        const QString scene = r.scenes.count(r.sceneUrl) ? r.sceneUrl : r.sceneOrder.front();
+        instances = r.scenes[scene];
+    }
+    else
+        for (size_t i = 0; i < r.geometryOrder.size(); ++i)
+        {
+            Instance in;
+            in.geometry = r.geometryOrder[i];
+            in.mat.SetIdentity();
+            instances.push_back(in);
+        }
+
+    // vertex and face ranges of every instance and primitive
+    std::vector<PlacedInstance> placed(instances.size());
+    std::vector<Part> parts;
+    int vertNum = 0, faceNum = 0;
+    mask = tri::io::Mask::IOM_VERTCOORD | tri::io::Mask::IOM_FACEINDEX;
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        std::map<QString, Geometry>::const_iterator git = r.geometries.find(instances[i].geometry);
+        if (git == r.geometries.end())
+            return Unsupported;
+        const Geometry &g = git->second;
+        PlacedInstance &pi = placed[i];
+        pi.g = &g;
+        pi.mat = instances[i].mat;
+        pi.vertBase = vertNum;
+        pi.pos = 0;
+        for (size_t k = 0; k < g.vertexInputs.size(); ++k)
+            if (g.vertexInputs[k].semantic == "POSITION")
+                pi.pos = findSource(g, g.vertexInputs[k].source, 3);
+        int unusedOffset = -1;
+        if (pi.pos == 0 || !resolveInputs(g, g.vertexInputs, unusedOffset, pi.normal, pi.color, pi.tex))
+            return Unsupported;
+        // the inputs of <vertices> are indexed by the vertex
+        pi.normal.offset = pi.color.offset = pi.tex.offset = -1;
+        const Attribute *vertAttr[3] = {&pi.normal, &pi.color, &pi.tex};
+        for (int a = 0; a < 3; ++a)
+            if (vertAttr[a]->src && vertAttr[a]->src->count < pi.pos->count)
+                return Unsupported;
+        vertNum += pi.pos->count;
+
+        pi.firstPart = int(parts.size());
+        for (size_t k = 0; k < g.primitives.size(); ++k)
+        {
+            parts.push_back(Part());
+            Part &pt = parts.back();
+            pt.pr = &g.primitives[k];
+            pt.pos = pi.pos;
+            pt.vertexOffset = -1;
+            pt.normal = pi.normal;
+            pt.color = pi.color;
+            pt.tex = pi.tex;
+            if (!resolveInputs(g, pt.pr->inputs, pt.vertexOffset, pt.normal, pt.color, pt.tex) || pt.vertexOffset < 0)
+                return Unsupported;
+            pt.texIndex = textureIndex(r, instances[i], pt.pr->material);
+            pt.vertBase = pi.vertBase;
+            pt.faceBase = faceNum;
+            if (pt.pr->vcount.empty())
+                faceNum += pt.polygonNum();
+            else
+            {
+                const int polyNum = pt.polygonNum();
+                pt.polyStart.resize(polyNum);
+                pt.faceStart.resize(polyNum);
+                int tuple = 0, face = 0;
+                for (int j = 0; j < polyNum; ++j)
+                {
+                    pt.polyStart[j] = tuple;
+                    pt.faceStart[j] = face;
+                    tuple += pt.pr->vcount[j];
+                    face += std::max(pt.pr->vcount[j] - 2, 0);
+                }
+                faceNum += face;
+            }
+            if (badIndices(pt, pi.pos->count) > 0)
+                return InvalidIndex;
+            if (pt.tex.src)    mask |= tri::io::Mask::IOM_WEDGTEXCOORD;
+            if (pt.normal.src) mask |= tri::io::Mask::IOM_VERTNORMAL;
+            if (pt.color.src)  mask |= tri::io::Mask::IOM_VERTCOLOR;
+        }
+        pi.lastPart = int(parts.size());
+    }
+
+    m.Enable(mask);
+    CMeshO &cm = m.cm;
+    for (size_t i = 0; i < r.imageFiles.size(); ++i)
+        cm.textures.push_back(r.imageFiles[i].toStdString());
+    const int vertStart = int(cm.vert.size());
+    const int faceStart = int(cm.face.size());
+    tri::Allocator<CMeshO>::AddVertices(cm, vertNum);
+    tri::Allocator<CMeshO>::AddFaces(cm, faceNum);
+    if (cb) (*cb)(75, "Building mesh");
+
+    // vertices, in chunks of every instance
+    const int chunk = 1 << 16;
+    std::vector<std::pair<int, int> > vertTasks;
+    for (int i = 0; i < int(placed.size()); ++i)
+        for (int k = 0; k < placed[i].pos->count; k += chunk)
+            vertTasks.push_back(std::make_pair(i, k));
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int t = 0; t < int(vertTasks.size()); ++t)
+    {
+        const PlacedInstance &pi = placed[vertTasks[t].first];
+        const int k1 = std::min(pi.pos->count, vertTasks[t].second + chunk);
+        for (int k = vertTasks[t].second; k < k1; ++k)
+        {
+            CVertexO &v = cm.vert[vertStart + pi.vertBase + k];
+            const float *p = pi.pos->at(k);
+            v.P() = pi.mat * Point3m(p[0], p[1], p[2]);
+            if (pi.normal.src)
+                v.N() = transformNormal(pi.mat, pi.normal.src->at(k));
+            if (pi.color.src)
+                v.C() = toColor(pi.color.src, pi.color.src->at(k));
+        }
+    }
+
+    // faces, in chunks of polygons of every part
+    const bool wedgeTex = (mask & tri::io::Mask::IOM_WEDGTEXCOORD) != 0;
+    std::vector<std::pair<int, int> > faceTasks;
+    for (int i = 0; i < int(parts.size()); ++i)
+        for (int k = 0; k < parts[i].polygonNum(); k += chunk)
+            faceTasks.push_back(std::make_pair(i, k));
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int t = 0; t < int(faceTasks.size()); ++t)
+    {
+        const Part &pt = parts[faceTasks[t].first];
+        const int k1 = std::min(pt.polygonNum(), faceTasks[t].second + chunk);
+        CVertexO *vb = &cm.vert[vertStart + pt.vertBase];
+        for (int k = faceTasks[t].second; k < k1; ++k)
+        {
+            const int tuple0 = pt.firstTuple(k);
+            int fi = faceStart + pt.faceBase + pt.firstFace(k);
+            // fan triangulation
+            for (int c = 1; c + 1 < pt.corners(k); ++c, ++fi)
+            {
+                CFaceO &f = cm.face[fi];
+                const int tuples[3] = {tuple0, tuple0 + c, tuple0 + c + 1};
+                for (int j = 0; j < 3; ++j)
+                {
+                    const int vi = pt.index(tuples[j], pt.vertexOffset);
+                    f.V(j) = vb + vi;
+                    if (!wedgeTex)
+                        continue;
+                    if (pt.tex.src)
+                    {
+                        const float *uv = pt.tex.src->at(pt.tex.offset >= 0 ? pt.index(tuples[j], pt.tex.offset) : vi);
+                        f.WT(j).U() = uv[0];
+                        f.WT(j).V() = uv[1];
+                    }
+                    else
+                        f.WT(j).U() = f.WT(j).V() = 0;
+                    f.WT(j).N() = short(pt.texIndex);
+                }
+            }
+        }
+    }
+
+    // normals and colors indexed by the corners go to their vertices, the last corner wins
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int i = 0; i < int(placed.size()); ++i)
+    {
+        CVertexO *vb = &cm.vert[vertStart + placed[i].vertBase];
+        for (int k = placed[i].firstPart; k < placed[i].lastPart; ++k)
+        {
+            const Part &pt = parts[k];
+            const bool normal = pt.normal.src && pt.normal.offset >= 0;
+            const bool color = pt.color.src && pt.color.offset >= 0;
+            if (!normal && !color)
+                continue;
+            const int tupleNum = int(pt.pr->p.size() / pt.pr->tupleSize);
+            for (int t = 0; t < tupleNum; ++t)
+            {
+                CVertexO &v = vb[pt.index(t, pt.vertexOffset)];
+                if (normal)
+                    v.N() = transformNormal(placed[i].mat, pt.normal.src->at(pt.index(t, pt.normal.offset)));
+                if (color)
+                    v.C() = toColor(pt.color.src, pt.color.src->at(pt.index(t, pt.color.offset)));
+            }
+        }
+    }
+
+    if (cb) (*cb)(95, "Building mesh");
+    return Done;
+}
+
+QStringList DaeStreamImporter::GeometryIds(const QString &fileName)
+{
+    QStringList ids;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return ids;
+    QXmlStreamReader xml(&file);
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+        if (xml.isStartElement() && xml.name() == QLatin1String("geometry"))
+        {
+            ids.push_back(xml.attributes().value("id").toString());
+            xml.skipCurrentElement();
+        }
+    }
+    return ids;
+}
+
+const char *DaeStreamImporter::ErrorMsg(Result r)
+{
+    switch (r)
+    {
+    case Done:         return "No errors";
+    case Unsupported:  return "Unsupported Collada features";
+    case CantOpen:     return "Can't open file";
+    case InvalidXml:   return "Invalid XML";
+    case InvalidIndex: return "Index out of range";
+    }
+    return "Unknown error";
+}
@@ -0,0 +1,64 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2016                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef IMPORT_DAE_STREAM_H
+#define IMPORT_DAE_STREAM_H
+
+#include <QString>
+#include <QStringList>
+#include <common/meshmodel.h>
+
+/*
+  Streaming importer for Collada files.
+
+  The file is read once with a QXmlStreamReader, without building a DOM: the float
+  arrays of the sources and the index arrays of the primitives are parsed as they are
+  read into compact vectors (big arrays are split at blanks and parsed by all the
+  cores), together with the images, materials, effects and visual scenes needed to
+  place the geometries and bind their textures. The memory used is proportional to
+  the mesh, not to the document.
+
+  The geometry instances of the scene (or all the geometries, if there is no visual
+  scene) are then copied into the mesh concurrently: every instance has its own range
+  of vertices and faces, and the polygons of the big primitives are split in chunks.
+  One vertex is created for every position, as tri::io::ImporterDAE does; polygons are
+  triangulated as fans, texture coordinates go to the wedges and normals and colors
+  to the vertices.
+
+  Documents using features the importer does not know (controllers, instanced nodes,
+  holes, lines and strips...) are reported as Unsupported and must be loaded with
+  tri::io::ImporterDAE.
+*/
+class DaeStreamImporter
+{
+public:
+    enum Result { Done = 0, Unsupported, CantOpen, InvalidXml, InvalidIndex };
+
+    // Loads the file into m, enabling the components listed in mask
+    static Result Open(MeshModel &m, const QString &fileName, int &mask, vcg::CallBackPos *cb = 0);
+    // The ids of the geometry nodes of the file
+    static QStringList GeometryIds(const QString &fileName);
+    static const char *ErrorMsg(Result r);
+};
+
+#endif // IMPORT_DAE_STREAM_H
@@ -90,6 +90,7 @@
 #include <Qt>
 
 #include "io_collada.h"
+#include "import_dae_stream.h"
 
 #include <vcg/complex/algorithms/update/texture.h>
 #include <wrap/io_trimesh/export.h>
@@ -116,6 +117,24 @@ bool ColladaIOPlugin::open(const QString &formatName, const QString &fileName, M
 
 	if(formatName.toUpper() == tr("DAE"))
 	{
+		// the streaming importer handles the common files, the others go through the DOM of ImporterDAE
+		DaeStreamImporter::Result res = DaeStreamImporter::Open(m, fileName, mask, cb);
+		if (res == DaeStreamImporter::Done)
+		{
+			_mp.push_back(&m);
+			vcg::tri::UpdateBounding<CMeshO>::Box(m.cm);
+			if (!(mask & vcg::tri::io::Mask::IOM_VERTNORMAL))
+				vcg::tri::UpdateNormal<CMeshO>::PerVertex(m.cm);
+			if (cb != NULL)	(*cb)(99, "Done");
+			return true;
+		}
+		if (res != DaeStreamImporter::Unsupported)
+		{
+			qDebug() << "DAE Opening Error" << DaeStreamImporter::ErrorMsg(res) << endl;
+			return false;
+		}
+		mask = 0;
+
 		//m.addinfo = NULL;
         tri::io::InfoDAE  info;
 		if (!tri::io::ImporterDAE<CMeshO>::LoadMask(filename.c_str(), info))
@@ -154,23 +173,12 @@ void ColladaIOPlugin::initPreOpenParameter(const QString &/*format*/, const QStr
 	QTime t;
 	t.start();
 	
-	QDomDocument* doc = new QDomDocument(filename);
-	QFile file(filename);
-	if (!file.open(QIODevice::ReadOnly))
-				return;
-	if (!doc->setContent(&file)) 
-	{
-				file.close();
-				return;
-	}
-	file.close();
-	
-	QDomNodeList geomList = doc->elementsByTagName("geometry");
+	QStringList geomList = DaeStreamImporter::GeometryIds(filename);
 	QStringList idList;
 	idList.push_back("Full Scene");
 	for(int i=0;i<geomList.size();++i)
 	{
-		QString idVal = geomList.at(i).toElement().attribute("id");
+		QString idVal = geomList.at(i);
 		idList.push_back(idVal);
 		qDebug("Node %i geom id = '%s'",i,qPrintable(idVal));
 	}
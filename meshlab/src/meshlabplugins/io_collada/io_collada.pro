@@ -1,6 +1,8 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += io_collada.h \
+		import_dae_stream.h \
 		$$VCGDIR/wrap/io_trimesh/export_dae.h \
 		$$VCGDIR/wrap/io_trimesh/import_dae.h \
 		$$VCGDIR/wrap/dae/util_dae.h \
@@ -9,6 +11,7 @@ HEADERS       += io_collada.h \
 
 
 SOURCES       += io_collada.cpp \
+		import_dae_stream.cpp \
         $$VCGDIR/wrap/dae/xmldocumentmanaging.cpp
 
 TARGET        = io_collada
@@ -36,6 +36,7 @@
 #include <vcg/space/color4.h>
 #include <wrap/callback.h>
 #include <wrap/io_trimesh/io_mask.h>
+#include <common/ml_ascii_reader.h>
 
 namespace vcg
 {
@@ -267,96 +268,137 @@ class ImporterExpePTS
 			if(header[2]=="Binary")
 				return appendBinaryData(mesh, nofPoints, fileProperties, pointSize, device);
 			else if(header[2]=="Ascii")
-				return appendAsciiData(mesh, nofPoints, fileProperties, device);
+			{
+				device.close();
+				return appendAsciiData(mesh, nofPoints, fileProperties, filename, streamPos, cb);
+			}
 
 			return 0;
 		} // end Open
 
-		template<typename VectorType>
-		static bool parse_vector(const QString& str, VectorType& v)
+		struct AsciiPoint
 		{
-			bool ok = true;
-			QRegExp xtrimming("^.*([-\\d].*\\d).*$");
-			xtrimming.indexIn(str);
-			QString trimmed = xtrimming.cap(1);
-			QList<QString> elements = trimmed.split(QRegExp("[ \t]+|[ \t]*,[ \t]*"));
-			int expectedSize = v.size();
-			if (elements.size() != expectedSize)
+			CoordType p;
+			CoordType n;
+			ScalarType r;
+			vcg::Color4f c;
+			bool valid;
+		};
+
+		// Reads n numbers, ignoring what precedes the first one and follows the last one
+		static bool parseVector(const char *b, const char *e, double *v, int n)
+		{
+			while (b < e && !((*b >= '0' && *b <= '9') || *b == '-' || *b == '.'))
+				++b;
+			if (MLAsciiReader::parseNumbers(b, e, ",", v, n) != n)
 				return false;
-			for (uint k=0 ; k<expectedSize && ok ; ++k)
-				v[k] = elements[k].toDouble(&ok);
-			return ok;
+			double extra;
+			b = MLAsciiReader::skip(b, e, ",");
+			return !MLAsciiReader::parseNumber(b, e, extra);
 		}
 
-		static int appendAsciiData(MESH_TYPE& mesh, uint nofPoints, const FileProperties& fileProperties, QIODevice& device)
+		// A line has one field per property, separated by ';'
+		struct AsciiLineParser
 		{
-			QTextStream stream(&device);
-			std::vector<double> v(3);
-			std::vector<double> c(4);
-			QStringList line;
-			uint i=0;
-			VertexIterator v_iter = Allocator<MESH_TYPE>::AddVertices(mesh, nofPoints);
-			while(i<nofPoints && !stream.atEnd())
+			const FileProperties &props;
+			AsciiLineParser(const FileProperties &fileProperties) : props(fileProperties) {}
+
+			bool operator()(const char *line, const char *lineEnd, AsciiPoint &point) const
 			{
-				line = stream.readLine(1024).split(";");
-				if (line.size()==int(fileProperties.size()))
+				int fieldNum = 1;
+				for (const char *c = line; c < lineEnd; ++c)
+					if (*c == ';')
+						++fieldNum;
+				if (fieldNum != int(props.size()))
+					return false;
+
+				double v[4];
+				point.valid = true;
+				const char *field = line;
+				for (size_t k=0 ; k<props.size() ; ++k)
 				{
-					for(uint k=0 ; k<fileProperties.size() ; ++k)
+					const char *fieldEnd = field;
+					while (fieldEnd < lineEnd && *fieldEnd != ';')
+						++fieldEnd;
+					if (props[k].hasProperty)
 					{
-						if (fileProperties[k].hasProperty)
+						if (props[k].name=="position")
+						{
+							point.valid &= parseVector(field, fieldEnd, v, 3);
+							for (int j=0; j<3; ++j)
+								point.p[j] = ScalarType(v[j]);
+						}
+						else if (props[k].name=="normal")
+						{
+							point.valid &= parseVector(field, fieldEnd, v, 3);
+							for (int j=0; j<3; ++j)
+								point.n[j] = ScalarType(v[j]);
+						}
+						else if (props[k].name=="radius")
 						{
-							if (fileProperties[k].name=="position")
-							{
-								if (!parse_vector(line[k], v))
-								{
-									std::cerr << "Error parsing position " << line[k].toLocal8Bit().data() << "\n";
-									return InvalidFile;
-								}
-								for (int j=0; j<3; ++j)
-									v_iter->P()[j] = v[j];
-							}
-							else if(fileProperties[k].name=="normal")
-							{
-								if (!parse_vector(line[k], v))
-								{
-									std::cerr << "Error parsing normal " << line[k].toLocal8Bit().data() << "\n";
-									return InvalidFile;
-								}
-								for (int j=0; j<3; ++j)
-									v_iter->N()[j] = v[j];
-							}
-							else if(fileProperties[k].name=="radius")
-							{
-								bool ok = true;
-								v_iter->R() = line[k].toFloat(&ok);
-								if (!ok)
-								{
-									std::cerr << "Error parsing radius " << line[k].toLocal8Bit().data() << "\n";
-									return InvalidFile;
-								}
-							}
-							else if(fileProperties[k].name=="color")
-							{
-								if (!parse_vector(line[k], c))
-								{
-									std::cerr << "Error parsing color " << line[k].toLocal8Bit().data() << "\n";
-									return InvalidFile;
-								}
-								vcg::Color4f color(c[0],c[1],c[2],c[3]);
-								(*v_iter).C().Import(color);
-							}
-							else
-							{
-								std::cerr << "unsupported property " << fileProperties[k].name.data() << "\n";
-							}
+							point.valid &= parseVector(field, fieldEnd, v, 1);
+							point.r = ScalarType(v[0]);
+						}
+						else if (props[k].name=="color")
+						{
+							point.valid &= parseVector(field, fieldEnd, v, 4);
+							point.c = vcg::Color4f(v[0],v[1],v[2],v[3]);
 						}
 					}
-					++v_iter;
+					field = fieldEnd + 1;
 				}
-				else if(line.size()!=0)
+				return true;
+			}
+		};
+
+		static int appendAsciiData(MESH_TYPE& mesh, int nofPoints, const FileProperties& fileProperties,
+																const char *filename, qint64 dataPos, CallBackPos *cb)
+		{
+			MLAsciiReader reader;
+			if (!reader.open(QString::fromLocal8Bit(filename)))
+				return CantOpen;
+
+			// the points start on the line following the data command
+			const char *from = MLAsciiReader::nextLine(reader.begin() + std::min(dataPos, reader.size()), reader.end());
+			std::vector<AsciiPoint> points;
+			int skipped = reader.parseLines(from, AsciiLineParser(fileProperties), points, cb, "Loading APTS");
+			if (skipped > 0)
+				std::cerr << "\tskipped " << skipped << " invalid lines\n";
+			reader.close();
+
+			if (nofPoints >= 0 && int(points.size()) > nofPoints)
+				points.resize(nofPoints);
+			const int pointNum = int(points.size());
+			for (int i=0; i<pointNum; ++i)
+				if (!points[i].valid)
+				{
+					std::cerr << "Error parsing point " << i << "\n";
+					return InvalidFile;
+				}
+
+			bool hasProperty[4] = {false, false, false, false};
+			for (size_t k=0 ; k<fileProperties.size() ; ++k)
+				if (fileProperties[k].hasProperty)
 				{
-					std::cerr << "\tInvalid line : " << line[0].toLocal8Bit().data() << "... (skip)\n";
+					if (fileProperties[k].name=="position") hasProperty[0] = true;
+					else if (fileProperties[k].name=="normal") hasProperty[1] = true;
+					else if (fileProperties[k].name=="radius") hasProperty[2] = true;
+					else if (fileProperties[k].name=="color") hasProperty[3] = true;
+					else std::cerr << "unsupported property " << fileProperties[k].name.data() << "\n";
 				}
+
+			const int first = int(mesh.vert.size());
+			Allocator<MESH_TYPE>::AddVertices(mesh, pointNum);
+#ifdef _USE_OMP
+			#pragma omp parallel for schedule(static)
+#endif
+			for (int i=0; i<pointNum; ++i)
+			{
+				VertexType &v = mesh.vert[first+i];
+				if (hasProperty[0]) v.P() = points[i].p;
+				if (hasProperty[1]) v.N() = points[i].n;
+				if (hasProperty[2]) v.R() = points[i].r;
+				if (hasProperty[3]) v.C().Import(points[i].c);
 			}
 			return 0;
 		}
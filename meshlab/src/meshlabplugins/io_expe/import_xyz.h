@@ -36,6 +36,7 @@
 #include <vcg/space/color4.h>
 #include <wrap/callback.h>
 #include <wrap/io_trimesh/io_mask.h>
+#include <common/ml_ascii_reader.h>
 
 namespace vcg
 {
@@ -140,89 +141,83 @@ class ImporterXYZ
 		static int Open(MESH_TYPE &mesh, const char *filename, int &loadmask,
 			const Options& options, CallBackPos *cb=0)
 		{
-			QFile device(filename);
-			if ( (!device.open(QFile::ReadOnly)) )
+			MLAsciiReader reader;
+			if (!reader.open(QString::fromLocal8Bit(filename)))
 				return CantOpen;
 
-			QTextStream stream(&device);
-
 			loadmask = 0;
 
-      QString buf;
-      QStringList line;
-
 			if (options.onlyMaskFlag)
-      {
-        // check the first line
-        buf = stream.readLine(0);
-        buf = buf.trimmed();
-        line = buf.split(QRegExp("[ |\t]"));
-
-        if (line.size()==6)
-        {
-          loadmask |= Mask::IOM_VERTCOORD;
-          loadmask |= Mask::IOM_VERTNORMAL;
-        }
-        else if (line.size()==3)
-        {
-          loadmask |= Mask::IOM_VERTCOORD;
-        }
+			{
+				// check the first line
+				XYZPoint point;
+				const char *first = reader.begin();
+				if (LineParser()(first, MLAsciiReader::lineEnd(first, reader.end()), point))
+				{
+					loadmask |= Mask::IOM_VERTCOORD;
+					if (point.hasNormal)
+						loadmask |= Mask::IOM_VERTNORMAL;
+				}
 				return 0;
-      }
-
-      std::vector<CoordType> pos,normals;
-      CoordType p,n;
-      while(!stream.atEnd())
-      {
-        buf = stream.readLine(0);
-        buf = buf.trimmed();
-        line = buf.split(QRegExp("[ |\t]"));
-
-        if (line.size()==6)
-        {
-          loadmask |= Mask::IOM_VERTCOORD;
-          loadmask |= Mask::IOM_VERTNORMAL;
-          for (int k=0; k<3; ++k)
-          {
-            p[k] = line[k].toDouble();
-            n[k] = line[3+k].toDouble();
-          }
-          pos.push_back(p);
-          normals.push_back(n);
-        }
-        else if (line.size()==3)
-        {
-          loadmask |= Mask::IOM_VERTCOORD;
-          // there is no normal information
-          for (int k=0; k<3; ++k)
-          {
-            p[k] = line[k].toDouble();
-            n[k] = 0;
-          }
-          pos.push_back(p);
-          normals.push_back(n);
-        }
-        else
-        {
-          std::cerr << "error: skip line " << buf.toUtf8().data() << "\n";
-          for (int i=0; i<line.size(); ++i)
-            std::cerr << line[i].toUtf8().data() << " $ ";
-          std::cerr << "\n";
-        }
-      }
-      VertexIterator v_iter = Allocator<MESH_TYPE>::AddVertices(mesh,pos.size());
-      for (int i=0; i<pos.size(); ++i)
-      {
-        v_iter->P() = pos[i];
-        v_iter->N() = normals[i];
-        ++v_iter;
-      }
+			}
+
+			// the lines are parsed in parallel, see MLAsciiReader
+			std::vector<XYZPoint> points;
+			int skipped = reader.parseLines(reader.begin(), LineParser(), points, cb, "Loading XYZ");
+			if (skipped > 0)
+				std::cerr << "error: skipped " << skipped << " lines that are not 3 or 6 numbers\n";
+			reader.close();
+
+			if (!points.empty())
+				loadmask |= Mask::IOM_VERTCOORD;
+			const int pointNum = int(points.size());
+			for (int i=0; i<pointNum; ++i)
+				if (points[i].hasNormal)
+				{
+					loadmask |= Mask::IOM_VERTNORMAL;
+					break;
+				}
+
+			const int first = int(mesh.vert.size());
+			Allocator<MESH_TYPE>::AddVertices(mesh,pointNum);
+#ifdef _USE_OMP
+			#pragma omp parallel for schedule(static)
+#endif
+			for (int i=0; i<pointNum; ++i)
+			{
+				mesh.vert[first+i].P() = points[i].p;
+				mesh.vert[first+i].N() = points[i].n;
+			}
 
 			return 0;
 		} // end Open
 
 	protected:
+		struct XYZPoint
+		{
+			CoordType p;
+			CoordType n;		// zero when there is no normal information
+			bool hasNormal;
+		};
 
+		// a line is x y z or x y z nx ny nz, separated by blanks, '|' or ','
+		struct LineParser
+		{
+			bool operator()(const char *line, const char *lineEnd, XYZPoint &point) const
+			{
+				double v[7];
+				const int n = MLAsciiReader::parseNumbers(line, lineEnd, "|,", v, 7);
+				if ((n != 3 && n != 6) || MLAsciiReader::skip(line, lineEnd, "|,") != lineEnd)
+					return false;
+				point.hasNormal = (n == 6);
+				for (int k=0; k<3; ++k)
+				{
+					point.p[k] = ScalarType(v[k]);
+					point.n[k] = point.hasNormal ? ScalarType(v[3+k]) : ScalarType(0);
+				}
+				return true;
+			}
+		};
 };
 // /*! @} */
 
@@ -1,4 +1,5 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += io_expe.h \
                  import_expe.h \
@@ -28,8 +28,10 @@
 
 #include "io_tri.h"
 
-#include <wrap/io_trimesh/import_asc.h>
 #include <wrap/io_trimesh/export.h>
+#include <vcg/complex/algorithms/clean.h>
+#include <vcg/complex/algorithms/create/platonic.h>
+#include <common/ml_ascii_reader.h>
 
 #include <QMessageBox>
 #include <QFileDialog>
@@ -37,6 +39,7 @@
 using namespace vcg;
 
 bool parseTRI(const std::string &filename, CMeshO &m);
+bool parseASC(const QString &fileName, CMeshO &m, CallBackPos *cb, bool triangulate, int rowToSkip);
 
 void TriIOPlugin::initPreOpenParameter(const QString &format, const QString &/*fileName*/, RichParameterSet & parlst)
 {
@@ -61,8 +64,7 @@ bool TriIOPlugin::open(const QString &formatName, const QString &fileName, MeshM
 			m.Enable(mask);			
 			bool triangulate = parlst.getBool("triangulate");
 			int rowToSkip = parlst.getInt("rowToSkip");
-			int result = tri::io::ImporterASC<CMeshO>::Open(m.cm, qPrintable(fileName),cb,triangulate,rowToSkip);
-			if (result != 0) // all the importers return 0 on success
+			if (!parseASC(fileName, m.cm, cb, triangulate, rowToSkip))
 			{
 				errorMessage = QString("Failed to open:")+fileName;
 				return false;
@@ -331,4 +333,71 @@ bool parseTRI(const std::string &filename, CMeshO &m) {
 
  
  
+namespace {
+struct ASCPoint
+{
+	Point3m p;
+	Scalarm q;
+};
+
+// x y z [quality], separated by blanks or commas; lines starting with '#' are comments
+struct ASCLineParser
+{
+	bool operator()(const char *line, const char *lineEnd, ASCPoint &point) const
+	{
+		line = MLAsciiReader::skip(line, lineEnd, "");
+		if (line < lineEnd && *line == '#')
+			return false;
+		double v[4];
+		const int n = MLAsciiReader::parseNumbers(line, lineEnd, ",", v, 4);
+		if (n < 3)
+			return false;
+		point.p = Point3m(Scalarm(v[0]), Scalarm(v[1]), Scalarm(v[2]));
+		point.q = (n == 4) ? Scalarm(v[3]) : Scalarm(0);
+		return true;
+	}
+};
+}
+
+// The lines are parsed in parallel by MLAsciiReader
+bool parseASC(const QString &fileName, CMeshO &m, CallBackPos *cb, bool triangulate, int rowToSkip)
+{
+	MLAsciiReader reader;
+	if (!reader.open(fileName))
+		return false;
+	const char *from = reader.begin();
+	for (int i = 0; i < rowToSkip; ++i)
+		from = MLAsciiReader::nextLine(from, reader.end());
+
+	std::vector<ASCPoint> points;
+	reader.parseLines(from, ASCLineParser(), points, cb, "ASC Mesh Loading");
+	reader.close();
+	if (points.empty())
+		return false;
+
+	m.Clear();
+	const int pointNum = int(points.size());
+	tri::Allocator<CMeshO>::AddVertices(m, pointNum);
+#ifdef _USE_OMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < pointNum; ++i)
+	{
+		m.vert[i].P() = points[i].p;
+		m.vert[i].Q() = points[i].q;
+	}
+	std::vector<ASCPoint>().swap(points);
+
+	if (!triangulate)
+		return true;
+	// a complete xy grid, row after row: the first change of y gives the row length
+	const Scalarm baseY = m.vert[0].P().Y();
+	int rowLen = 1;
+	while (rowLen < m.vn && m.vert[rowLen].P().Y() == baseY)
+		++rowLen;
+	tri::FaceGrid(m, rowLen, m.vn / rowLen);
+	tri::Clean<CMeshO>::FlipMesh(m);
+	return true;
+}
+
 MESHLAB_PLUGIN_NAME_EXPORTER(TriIOPlugin)
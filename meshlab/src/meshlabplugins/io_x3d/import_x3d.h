@@ -88,6 +88,9 @@
 #include "vrml/Parser.h"
 
 #include <set>
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
 
 namespace vcg {
 namespace tri {
@@ -167,10 +170,98 @@ namespace io {
 
 		
 		
+		//X3D documents linked by the Inline nodes, parsed before they are needed
+		struct ParsedInline
+		{
+			std::map<QString, QDomDocument*> docs;
+			std::map<QString, bool> valid;
+
+			~ParsedInline()
+			{
+				for (std::map<QString, QDomDocument*>::iterator it = docs.begin(); it != docs.end(); ++it)
+					delete it->second;
+			}
+
+			//return the document of the file (NULL if it cannot be opened), parsing it if it was not
+			QDomDocument* take(const QString& path, bool& isValid)
+			{
+				std::map<QString, QDomDocument*>::iterator it = docs.find(path);
+				if (it == docs.end())
+				{
+					QDomDocument* doc = NULL;
+					isValid = parseFile(path, doc);
+					return doc;
+				}
+				QDomDocument* doc = it->second;
+				isValid = valid[path];
+				docs.erase(it);
+				return doc;
+			}
+
+			static bool parseFile(const QString& path, QDomDocument*& doc)
+			{
+				QFile file(path);
+				if (!file.open(QIODevice::ReadOnly))
+					return false;
+				doc = new QDomDocument(path);
+				bool res = doc->setContent(&file);
+				file.close();
+				return res;
+			}
+		};
+
+
+		//parse concurrently the x3d files that the Inline nodes of doc will load
+		static void ParseInlineFiles(const QDomNodeList& inlineNodes, AdditionalInfoX3D* info, ParsedInline& parsed)
+		{
+			QStringList paths;
+			QFileInfo docFi(info->filename);
+			for(int in = 0; in < inlineNodes.size(); in++)
+			{
+				QDomElement inl = inlineNodes.at(in).toElement();
+				if(inl.attribute("load", "true") != "true")
+					continue;
+				QStringList urls = inl.attribute("url").split(" ", QString::SkipEmptyParts);
+				for (int i = 0; i < urls.size(); i++)
+				{
+					QString path = urls.at(i).trimmed().remove(QChar('"'));
+					QFileInfo fi(path);
+					if (!fi.exists())
+						continue;
+					bool load = (fi.fileName() != docFi.fileName());
+					std::map<QString, QDomNode*>::const_iterator iter;
+					for (iter = info->inlineNodeMap.begin(); iter != info->inlineNodeMap.end() && load; iter++)
+						load = (QFileInfo(iter->first).fileName() != fi.fileName());
+					if (load && fi.suffix().toLower() == "x3d")
+					{
+						if (!paths.contains(path))
+							paths.push_back(path);
+						break;
+					}
+				}
+			}
+			std::vector<QDomDocument*> docs(paths.size(), (QDomDocument*)NULL);
+			std::vector<char> valid(paths.size(), 0);
+#ifdef _USE_OMP
+			#pragma omp parallel for schedule(dynamic, 1)
+#endif
+			for (int i = 0; i < paths.size(); i++)
+				valid[i] = ParsedInline::parseFile(paths.at(i), docs[i]);
+			for (int i = 0; i < paths.size(); i++)
+				if (docs[i] != NULL)
+				{
+					parsed.docs[paths.at(i)] = docs[i];
+					parsed.valid[paths.at(i)] = (valid[i] != 0);
+				}
+		}
+
+
 		//search all Inline nodes and try to open the linked files
 		static int ManageInlineNode(QDomDocument* doc, AdditionalInfoX3D*& info)
 		{
 			QDomNodeList inlineNodes = doc->elementsByTagName("Inline");
+			ParsedInline parsed;
+			ParseInlineFiles(inlineNodes, info, parsed);
 			for(int in = 0; in < inlineNodes.size(); in++)
 			{
 				QDomElement inl = inlineNodes.at(in).toElement();
@@ -206,16 +297,18 @@ namespace io {
 							}
 							if(load && fi.suffix().toLower()=="x3d")
 							{
-								QDomDocument* docChild = new QDomDocument(path);
-								QFile file(path);
-								if (file.open(QIODevice::ReadOnly))
+								bool valid = false;
+								QDomDocument* docChild = parsed.take(path, valid);
+								if (docChild != NULL)
 								{
 									//load components mesh info from file .x3d linked in Inline node
 									info->filenameStack.push_back(path);
-									if (!docChild->setContent(&file)) 
+									if (!valid)
+									{
+										delete docChild;
 										return E_INVALIDXML;
+									}
 									info->inlineNodeMap[path] = docChild;
-									file.close();
 									int result = LoadMaskByDom(docChild, info, fi.fileName());
 									if (result != E_NOERROR) return result;
 									info->filenameStack.pop_back();
@@ -493,9 +586,22 @@ namespace io {
 				list = QStringList();
 				return;
 			}
+			//values are separated by blanks and commas
 			QString value = elem.attribute(attribute, defValue);
-			value.replace(",", " ");
-			list = value.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+			list = QStringList();
+			const QChar* s = value.constData();
+			const int n = value.size();
+			int i = 0;
+			while (i < n)
+			{
+				while (i < n && (s[i].isSpace() || s[i] == QChar(',')))
+					i++;
+				int begin = i;
+				while (i < n && !s[i].isSpace() && s[i] != QChar(','))
+					i++;
+				if (i > begin)
+					list.push_back(value.mid(begin, i - begin));
+			}
 		}
 
 		
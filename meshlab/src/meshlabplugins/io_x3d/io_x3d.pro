@@ -1,4 +1,5 @@
 include (../../shared.pri)
+include (../../openmp.pri)
 
 HEADERS       += io_x3d.h import_x3d.h\
 		export_x3d.h util_x3d.h \
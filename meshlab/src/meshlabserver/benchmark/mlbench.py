@@ -0,0 +1,322 @@
+#!/usr/bin/env python3
+#****************************************************************************
+# MeshLab                                                           o o     *
+# A versatile mesh processing toolbox                             o     o   *
+#                                                                _   O  _   *
+# Copyright(C) 2005                                                \/)\/    *
+# Visual Computing Lab                                            /\/|      *
+# ISTI - Italian National Research Council                           |      *
+#                                                                    \      *
+# All rights reserved.                                                      *
+#                                                                           *
+# This program is free software; you can redistribute it and/or modify      *
+# it under the terms of the GNU General Public License as published by      *
+# the Free Software Foundation; either version 2 of the License, or         *
+# (at your option) any later version.                                       *
+#                                                                           *
+# This program is distributed in the hope that it will be useful,           *
+# but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+# GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+# for more details.                                                         *
+#                                                                           *
+#****************************************************************************
+
+"""MeshLab filter benchmark.
+
+Generates deterministic synthetic inputs with meshlabserver (the scripts in
+generators/), runs every script of the catalog (scripts/) and a save/load round
+trip for each IO format on them, and writes a JSON report with wall time, time
+spent in the filters and in the IO plugins, throughput, peak memory and the
+checksums of the outputs. Two reports can be compared with the 'compare' command.
+
+See README.txt for the details.
+"""
+
+import argparse
+import datetime
+import hashlib
+import json
+import os
+import platform
+import re
+import shutil
+import string
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+REPORT_FORMAT = 1
+
+# scale name -> (sphere subdivision level, number of samples of the point clouds)
+# the meshes have 20 * 4^(subdiv+1) faces after the loop subdivision step
+SCALES = {
+    "small":  (4, 50000),
+    "medium": (5, 200000),
+    "large":  (6, 800000),
+    "huge":   (7, 3200000),
+}
+DEFAULT_SCALES = ["small", "medium", "large"]
+DEFAULT_FORMATS = ["ply", "obj", "off", "stl"]
+
+LOADED_RE = re.compile(r"Mesh .* loaded has (\d+) vn (\d+) fn")
+SAVED_RE = re.compile(r"Mesh .* saved as .* \((\d+) vn (\d+) fn\)")
+
+
+def default_server():
+    exe = "meshlabserver.exe" if os.name == "nt" else "meshlabserver"
+    for candidate in (os.path.join(HERE, "..", "..", "distrib", exe),
+                      os.path.join(HERE, "..", "..", "distrib", "meshlab.app", "Contents", "MacOS", exe)):
+        if os.path.isfile(candidate):
+            return os.path.abspath(candidate)
+    return shutil.which(exe) or exe
+
+
+def file_checksum(path):
+    h = hashlib.sha1()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(1 << 20), b""):
+            h.update(chunk)
+    return h.hexdigest()
+
+
+def read_trace(path):
+    """Sums the trace spans written by meshlabserver -t per category."""
+    res = {"filter_ms": 0.0, "open_ms": 0.0, "save_ms": 0.0, "peak_rss_mb": None}
+    if not os.path.isfile(path):
+        return res
+    with open(path) as f:
+        events = json.load(f).get("traceEvents", [])
+    for ev in events:
+        dur = ev.get("dur", 0) / 1000.0
+        if ev.get("cat") == "filter":
+            res["filter_ms"] += dur
+        elif ev.get("cat") == "io":
+            res["open_ms" if ev.get("name", "").startswith("Open") else "save_ms"] += dur
+        rss = ev.get("args", {}).get("processPeakRSS_MB")
+        if rss is not None:
+            res["peak_rss_mb"] = max(res["peak_rss_mb"] or 0.0, rss)
+    return res
+
+
+class Runner:
+    def __init__(self, server, workdir, verbose):
+        self.server = server
+        self.workdir = workdir
+        self.verbose = verbose
+
+    def run(self, args, tag):
+        """Runs meshlabserver with tracing enabled; returns (ok, wall_ms, trace, stdout)."""
+        trace = os.path.join(self.workdir, tag + ".trace.json")
+        if os.path.exists(trace):
+            os.remove(trace)
+        cmd = [self.server] + args + ["-t", trace]
+        if self.verbose:
+            print("  " + " ".join(cmd))
+        start = time.perf_counter()
+        proc = subprocess.run(cmd, cwd=self.workdir, stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT, universal_newlines=True)
+        wall_ms = (time.perf_counter() - start) * 1000.0
+        if self.verbose:
+            print(proc.stdout)
+        return proc.returncode == 0, wall_ms, read_trace(trace), proc.stdout
+
+
+def generate_inputs(runner, scales, regenerate):
+    inputs = {}
+    for kind in ("mesh", "cloud"):
+        with open(os.path.join(HERE, "generators", kind + ".mlx.in")) as f:
+            template = string.Template(f.read())
+        for scale in scales:
+            subdiv, samples = SCALES[scale]
+            name = "%s_%s" % (kind, scale)
+            path = os.path.join(runner.workdir, name + ".ply")
+            if regenerate or not os.path.isfile(path):
+                # the clouds are sampled from a finer mesh than the one used for the mesh inputs
+                script = os.path.join(runner.workdir, name + ".mlx")
+                with open(script, "w") as f:
+                    f.write(template.substitute(subdiv=subdiv + (1 if kind == "cloud" else 0), samples=samples))
+                print("Generating %s" % name)
+                ok, _, _, out = runner.run(["-s", script, "-o", path, "-m", "vn"], name + ".gen")
+                if not ok or not os.path.isfile(path):
+                    sys.exit("Failed generating %s:\n%s" % (name, out))
+            inputs[(kind, scale)] = path
+    return inputs
+
+
+def measure(runner, name, scale, inputpath, args, outpath, repeat):
+    """Runs the same command 'repeat' times and keeps the fastest run."""
+    best = None
+    checksums = set()
+    for it in range(repeat):
+        if outpath and os.path.exists(outpath):
+            os.remove(outpath)
+        ok, wall_ms, trace, out = runner.run(["-i", inputpath] + args, "%s_%s" % (name, scale))
+        if not ok or (outpath and not os.path.isfile(outpath)):
+            return {"name": name, "scale": scale, "status": "failed", "log": out[-2000:]}
+        if outpath:
+            checksums.add(file_checksum(outpath))
+        if best is None or wall_ms < best[0]:
+            best = (wall_ms, trace, out)
+
+    wall_ms, trace, out = best
+    res = {"name": name, "scale": scale, "status": "ok", "input": os.path.basename(inputpath),
+           "wall_ms": round(wall_ms, 1)}
+    loaded = LOADED_RE.search(out)
+    if loaded:
+        res["input_vn"], res["input_fn"] = int(loaded.group(1)), int(loaded.group(2))
+    saved = SAVED_RE.search(out)
+    if saved:
+        res["output_vn"], res["output_fn"] = int(saved.group(1)), int(saved.group(2))
+    for key in ("filter_ms", "open_ms", "save_ms"):
+        res[key] = round(trace[key], 1)
+    res["peak_rss_mb"] = trace["peak_rss_mb"]
+    if trace["filter_ms"] > 0:
+        sec = trace["filter_ms"] / 1000.0
+        res["faces_per_sec"] = round(res.get("input_fn", 0) / sec)
+        res["verts_per_sec"] = round(res.get("input_vn", 0) / sec)
+    if checksums:
+        res["checksum"] = sorted(checksums)[0]
+        res["deterministic"] = len(checksums) == 1
+    return res
+
+
+def command_run(opt):
+    scales = opt.scales.split(",")
+    for s in scales:
+        if s not in SCALES:
+            sys.exit("Unknown scale '%s' (available: %s)" % (s, ", ".join(SCALES)))
+    workdir = os.path.abspath(opt.workdir or tempfile.mkdtemp(prefix="mlbench_"))
+    if not os.path.isdir(workdir):
+        os.makedirs(workdir)
+    runner = Runner(opt.server, workdir, opt.verbose)
+    inputs = generate_inputs(runner, scales, opt.regenerate)
+
+    filt = re.compile(opt.filter) if opt.filter else None
+    results = []
+    for (kind, scale), path in sorted(inputs.items()):
+        results.append({"name": "input_" + kind, "scale": scale, "status": "ok",
+                        "input": os.path.basename(path), "checksum": file_checksum(path)})
+
+    scripts = sorted(f for f in os.listdir(os.path.join(HERE, "scripts")) if f.endswith(".mlx"))
+    for script in scripts:
+        name = os.path.splitext(script)[0]
+        kind = name.split("_")[0]
+        if (kind, scales[0]) not in inputs or (filt and not filt.search(name)):
+            continue
+        for scale in scales:
+            print("Running %s (%s)" % (name, scale))
+            outpath = os.path.join(workdir, "%s_%s.out.ply" % (name, scale))
+            results.append(measure(runner, name, scale, inputs[(kind, scale)],
+                                   ["-s", os.path.join(HERE, "scripts", script), "-o", outpath, "-m", "vn"],
+                                   outpath, opt.repeat))
+
+    for ext in (opt.formats.split(",") if opt.formats else []):
+        name = "io_" + ext
+        if filt and not filt.search(name):
+            continue
+        for scale in scales:
+            print("Running %s (%s)" % (name, scale))
+            outpath = os.path.join(workdir, "%s_%s.%s" % (name, scale, ext))
+            res = measure(runner, name, scale, inputs[("mesh", scale)], ["-o", outpath], outpath, opt.repeat)
+            if res["status"] == "ok":
+                # load back what has just been saved
+                back = measure(runner, name + "_load", scale, outpath, [], None, opt.repeat)
+                res["load_ms"] = back.get("open_ms")
+                mb = os.path.getsize(outpath) / (1024.0 * 1024.0)
+                res["file_mb"] = round(mb, 2)
+                if res["save_ms"] > 0:
+                    res["save_mb_per_sec"] = round(mb / (res["save_ms"] / 1000.0), 1)
+                if res["load_ms"]:
+                    res["load_mb_per_sec"] = round(mb / (res["load_ms"] / 1000.0), 1)
+            results.append(res)
+
+    report = {
+        "format": REPORT_FORMAT,
+        "created": datetime.datetime.now().isoformat(timespec="seconds"),
+        "host": platform.node(),
+        "platform": platform.platform(),
+        "server": os.path.abspath(opt.server),
+        "label": opt.label,
+        "repeat": opt.repeat,
+        "results": results,
+    }
+    with open(opt.output, "w") as f:
+        json.dump(report, f, indent=1)
+    failed = [r for r in results if r["status"] != "ok"]
+    print("Report saved in %s (%i runs, %i failed)" % (opt.output, len(results), len(failed)))
+    if not opt.keep and not opt.workdir:
+        shutil.rmtree(workdir, ignore_errors=True)
+    return 1 if failed else 0
+
+
+def command_compare(opt):
+    with open(opt.base) as f:
+        base = json.load(f)
+    with open(opt.new) as f:
+        new = json.load(f)
+    basemap = dict(((r["name"], r["scale"]), r) for r in base["results"])
+    key = opt.metric
+    regressions = 0
+    print("%-36s %-7s %12s %12s %7s  %s" % ("name", "scale", "base " + key, "new " + key, "ratio", "output"))
+    for r in new["results"]:
+        b = basemap.get((r["name"], r["scale"]))
+        if b is None:
+            continue
+        note = ""
+        if r["status"] != "ok" or b["status"] != "ok":
+            note = "FAILED" if r["status"] != "ok" else "fixed"
+            regressions += r["status"] != "ok"
+        elif "checksum" in r and "checksum" in b and r["checksum"] != b["checksum"]:
+            note = "changed"
+            regressions += opt.strict
+        bv, nv = b.get(key), r.get(key)
+        ratio = ""
+        if bv and nv is not None:
+            ratio = "%7.2f" % (nv / bv)
+            if nv / bv > 1.0 + opt.tolerance and nv - bv > opt.min_delta:
+                note = (note + " SLOWER").strip()
+                regressions += 1
+        print("%-36s %-7s %12s %12s %7s  %s" % (r["name"], r["scale"], "-" if bv is None else bv,
+                                                "-" if nv is None else nv, ratio, note))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="MeshLab filter benchmark")
+    sub = parser.add_subparsers(dest="command")
+
+    run = sub.add_parser("run", help="run the benchmark and write a report")
+    run.add_argument("-o", "--output", default="mlbench.json", help="report file (default: %(default)s)")
+    run.add_argument("--server", default=default_server(), help="meshlabserver executable")
+    run.add_argument("--scales", default=",".join(DEFAULT_SCALES), help="comma separated list of " + ", ".join(SCALES))
+    run.add_argument("--formats", default=",".join(DEFAULT_FORMATS), help="IO formats to benchmark (empty to skip)")
+    run.add_argument("--filter", help="regular expression selecting the benchmarks by name")
+    run.add_argument("--repeat", type=int, default=3, help="runs of each benchmark, the fastest is kept")
+    run.add_argument("--label", default="", help="free text stored in the report (e.g. the commit)")
+    run.add_argument("--workdir", help="directory for inputs and outputs (kept, inputs are reused)")
+    run.add_argument("--regenerate", action="store_true", help="regenerate the inputs found in the workdir")
+    run.add_argument("--keep", action="store_true", help="do not delete the temporary workdir")
+    run.add_argument("-v", "--verbose", action="store_true")
+
+    cmp = sub.add_parser("compare", help="compare two reports")
+    cmp.add_argument("base")
+    cmp.add_argument("new")
+    cmp.add_argument("--metric", default="filter_ms", help="value to compare (default: %(default)s)")
+    cmp.add_argument("--tolerance", type=float, default=0.10, help="allowed slowdown ratio (default: %(default)s)")
+    cmp.add_argument("--min-delta", type=float, default=5.0, help="ignore slowdowns smaller than this (default: %(default)s)")
+    cmp.add_argument("--strict", action="store_true", help="also fail when an output checksum changes")
+
+    opt = parser.parse_args()
+    if opt.command == "run":
+        return command_run(opt)
+    if opt.command == "compare":
+        return command_compare(opt)
+    parser.print_help()
+    return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+#****************************************************************************
+# MeshLab                                                           o o     *
+# A versatile mesh processing toolbox                             o     o   *
+#                                                                _   O  _   *
+# Copyright(C) 2005                                                \/)\/    *
+# Visual Computing Lab                                            /\/|      *
+# ISTI - Italian National Research Council                           |      *
+#                                                                    \      *
+# All rights reserved.                                                      *
+#                                                                           *
+# This program is free software; you can redistribute it and/or modify      *
+# it under the terms of the GNU General Public License as published by      *
+# the Free Software Foundation; either version 2 of the License, or         *
+# (at your option) any later version.                                       *
+#                                                                           *
+# This program is distributed in the hope that it will be useful,           *
+# but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+# GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+# for more details.                                                         *
+#                                                                           *
+#****************************************************************************
+
+"""Client of the resident mode of meshlabserver (-r option).
+
+Sends the requests given on the command line, or read from the standard input,
+to a meshlabserver listening on a local socket and prints the responses:
+
+    meshlabserver -r mlserver &
+    python3 mldaemon.py mlserver "load doc=a file=scan.ply" "measure doc=a"
+
+On Windows the server listens on a named pipe, use the standard input mode there
+(meshlabserver -r -).
+"""
+
+import os
+import socket
+import sys
+import tempfile
+
+
+class Daemon(object):
+    def __init__(self, name):
+        # QLocalServer puts relative names in the temporary directory
+        path = name if os.path.isabs(name) else os.path.join(tempfile.gettempdir(), name)
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+        self.stream = self.sock.makefile('rw', encoding='utf-8', newline='\n')
+
+    def request(self, line):
+        """Sends a request, returns (ok, fields) where fields maps the keys of the
+        response to their values (ms is always there)."""
+        self.stream.write(line.strip() + '\n')
+        self.stream.flush()
+        response = self.stream.readline()
+        if not response:
+            raise ConnectionError('meshlabserver closed the connection')
+        words = split_words(response)
+        fields = {}
+        for w in words[1:]:
+            key, _, value = w.partition('=')
+            fields[key] = value
+        return words[0] == 'ok', fields
+
+    def close(self):
+        self.stream.close()
+        self.sock.close()
+
+
+def split_words(line):
+    words, word, inword, quoted, ii = [], '', False, False, 0
+    while ii < len(line):
+        c = line[ii]
+        if quoted and c == '\\' and ii + 1 < len(line):
+            ii += 1
+            word += line[ii]
+        elif c == '"':
+            quoted, inword = not quoted, True
+        elif c.isspace() and not quoted:
+            if inword:
+                words.append(word)
+            word, inword = '', False
+        else:
+            word, inword = word + c, True
+        ii += 1
+    if inword:
+        words.append(word)
+    return words
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 2
+    daemon = Daemon(sys.argv[1])
+    requests = sys.argv[2:] if len(sys.argv) > 2 else sys.stdin
+    failed = False
+    for line in requests:
+        if not line.strip():
+            continue
+        ok, fields = daemon.request(line)
+        print(('ok ' if ok else 'error ') + ' '.join(
+            '%s="%s"' % kv if ' ' in kv[1] else '%s=%s' % kv for kv in fields.items()))
+        failed = failed or not ok
+    daemon.close()
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
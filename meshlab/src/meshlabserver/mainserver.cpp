@@ -27,8 +27,26 @@
 #include <common/pluginmanager.h>
 #include <common/filterscript.h>
 #include <common/meshlabdocumentxml.h>
+#include <common/mltrace.h>
+#include <common/ml_filter_cache.h>
+#include <common/ml_layer_runner.h>
+#include <common/ml_layer_saver.h>
+
+#include <vcg/complex/algorithms/stat.h>
 
 #include <QFileInfo>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTextStream>
+#include <QCryptographicHash>
+#include <QScopedPointer>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 class FilterData
 {
@@ -43,7 +61,7 @@ public:
 class MeshLabServer
 {
 public:
-    MeshLabServer() {}
+    MeshLabServer() :allLayers(false) {}
 
     ~MeshLabServer() {}
 
@@ -147,6 +165,7 @@ public:
         RichParameterSet prePar;
         pCurrentIOPlugin->initPreOpenParameter(extension, fileName,prePar);
 
+        MLTraceSpan span("Open " + fi.fileName(),"io");
         if (!pCurrentIOPlugin->open(extension, fileName, mm ,mask,prePar))
         {
             fprintf(fp,"MeshLabServer: Failed loading of %s from dir %s\n",qPrintable(fileName),qPrintable(QDir::currentPath()));
@@ -181,6 +200,7 @@ public:
         }
         else
             mm.updateDataMask(MeshModel::MM_VERTNORMAL);
+        span.setCounts(mm.cm.vn,mm.cm.fn);
         //vcg::tri::UpdateBounding<CMeshO>::Box(mm.cm);
         QDir::setCurrent(curDir.absolutePath());
         return true;
@@ -206,12 +226,22 @@ public:
             return false;
         }
 
+        // compact point clouds are saved from a temporary copy, the layer stays compact
+        QScopedPointer<MeshModel> expanded;
+        if (mm->isCompact())
+        {
+            expanded.reset(new MeshModel(mm->parent,mm->fullName(),mm->label()));
+            mm->expandTo(*expanded);
+            mm = expanded.data();
+        }
+
         // optional saving parameters (like ascii/binary encoding)
         RichParameterSet savePar;
         pCurrentIOPlugin->initSaveParameter(extension, *mm, savePar);
         int formatmask = 0;
         int defbits = 0;
         pCurrentIOPlugin->GetExportMaskCapability(extension,formatmask,defbits);
+        MLTraceSpan span("Save " + fi.fileName(),"io",mm->cm.vn,mm->cm.fn);
         if (!pCurrentIOPlugin->save(extension, fileName, *mm ,mask & formatmask, savePar))
         {
             fprintf(fp,"Failed saving\n");
@@ -265,6 +295,8 @@ public:
 
         QDir curDir = QDir::current();
         QDir::setCurrent(outprojinfo.absolutePath());
+        // the layers are written first (the unchanged ones are skipped), the project file only if all of them succeeded
+        MLLayerSaver saver;
         foreach(MeshModel* m,md.meshList)
         {
             if (m != NULL)
@@ -275,12 +307,36 @@ public:
                     outfilename = outdir + "/" + m->label().remove(" ") + outfilemeshmiddlename + ".ply";
                 else
                     outfilename =  fi.absolutePath() + "/" + fi.completeBaseName() + outfilemeshmiddlename + "." + fi.completeSuffix();
+                const bool needed = MLLayerSaver::needsSave(*m,outfilename);
                 m->setFileName(outfilename);
                 QFileInfo of(outfilename);
                 m->setLabel(of.fileName());
-                exportMesh(m,m->dataMask(),outfilename);
+                if (!needed)
+                    continue;
+
+                QString extension = of.suffix();
+                MeshIOInterface* pCurrentIOPlugin = PM.allKnowOutputFormats[extension.toLower()];
+                if (pCurrentIOPlugin == 0)
+                {
+                    fprintf(stdout,"Unknown file extension for layer %s\n",qPrintable(m->label()));
+                    QDir::setCurrent(curDir.absolutePath());
+                    return false;
+                }
+                RichParameterSet savePar;
+                pCurrentIOPlugin->initSaveParameter(extension, *m, savePar);
+                int formatmask = 0;
+                int defbits = 0;
+                pCurrentIOPlugin->GetExportMaskCapability(extension,formatmask,defbits);
+                saver.add(m,pCurrentIOPlugin,extension,outfilename,m->dataMask() & formatmask,savePar);
             }
         }
+        if (!saver.run(filterCallBack))
+        {
+            foreach(QString err, saver.errors())
+                fprintf(stdout,"Failed saving %s\n",qPrintable(err));
+            QDir::setCurrent(curDir.absolutePath());
+            return false;
+        }
 
         QDir::setCurrent(curDir.absolutePath());
         return MeshDocumentToXMLFile(md,filename,false);
@@ -305,10 +361,26 @@ public:
             return false;
         }
         fprintf(fp,"Starting Script of %i actions",scriptPtr.filtparlist.size());
+        // the keys are computed before the mesh parameters of the script get bound to the document
+        QList<QByteArray> cacheKeys = filterCache.scriptKeys(meshDocument,scriptPtr);
+        // the same script gives a different result when applied to all the layers
+        if (allLayers)
+            for(int kk = 0;kk < cacheKeys.size();++kk)
+                cacheKeys[kk] = QCryptographicHash::hash(cacheKeys[kk] + " all layers",QCryptographicHash::Sha1).toHex();
+        int firstStep = filterCache.resume(meshDocument,cacheKeys);
+        if (firstStep < 0)
+        {
+            fprintf(fp,"Failed to read the filter cache in %s\n",qPrintable(filterCache.directory()));
+            return false;
+        }
+        if (firstStep > 0)
+            fprintf(fp,"Filter cache: the result of the first %i actions has been restored\n",firstStep);
         GLLogStream log;
-        for(FilterScript::iterator ii = scriptPtr.filtparlist.begin();ii!= scriptPtr.filtparlist.end();++ii)
+        for(FilterScript::iterator ii = scriptPtr.filtparlist.begin() + firstStep;ii!= scriptPtr.filtparlist.end();++ii)
         {
             bool ret = false;
+            // filters creating new layers (e.g. the ones of filter_create) change the current mesh
+            mm = meshDocument.mm();
             //RichParameterSet &par = (*ii).second;
             QString fname = (*ii)->filterName();
             fprintf(fp,"filter: %s\n",qPrintable(fname));
@@ -323,8 +395,16 @@ public:
 
                 MeshFilterInterface *iFilter = qobject_cast<MeshFilterInterface *>(action->parent());
                 iFilter->setLog(&log);
+                QList<MeshModel*> layers;
+                if (allLayers && MLLayerRunner::canRun(iFilter,action))
+                    layers = MLLayerRunner::visibleLayers(meshDocument);
+                const bool onLayers = (layers.size() > 1);
+                QList<MeshModel*> expanded;
+                if (!iFilter->acceptsCompactMeshes(action))
+                    expanded = meshDocument.expandCompactMeshes(!onLayers && (iFilter->filterArity(action) == MeshFilterInterface::SINGLE_MESH));
                 int req = iFilter->getRequirements(action);
-                mm->updateDataMask(req);
+                if (mm != NULL)
+                    mm->updateDataMask(req,true);
                 //make sure the PARMESH parameters are initialized
 
                 //A filter in the script file couldn't have all the required parameter not defined (a script file not generated by MeshLab).
@@ -350,7 +430,10 @@ public:
                         required.paramList[i]->accept(v);
                         parameterSet.addParam(v.lastCreated);
                     }
-                    assert(parameterSet.paramList.size() == required.paramList.size());
+                }
+                assert(parameterSet.paramList.size() == required.paramList.size());
+                for(int i = 0; i < parameterSet.paramList.size(); i++)
+                {
                     RichParameter* parameter = parameterSet.paramList[i];
                     //if this is a mesh paramter and the index is valid
                     if(parameter->val->isMesh())
@@ -379,7 +462,39 @@ public:
                     return false;
                 }
                 meshDocument.setBusy(true);
-                ret = iFilter->applyFilter( action, meshDocument, pairold->pair.second, filterCallBack);
+                {
+                    MLTraceSpan span(fname,"filter");
+                    if (onLayers)
+                    {
+                        fprintf(fp,"applied to %i layers\n",layers.size());
+                        QStringList failed;
+                        ret = MLLayerRunner::apply(iFilter,action,meshDocument,layers,pairold->pair.second,filterCallBack,&failed);
+                        foreach(QString layer, failed)
+                            fprintf(fp,"failed on layer %s\n",qPrintable(layer));
+                    }
+                    else
+                        ret = iFilter->applyFilter( action, meshDocument, pairold->pair.second, filterCallBack);
+                    if (!onLayers && (meshDocument.mm() != NULL))
+                        span.setCounts(meshDocument.mm()->cm.vn,meshDocument.mm()->cm.fn);
+                }
+                int changedMask = ret ? iFilter->postCondition(action) : int(MeshModel::MM_UNKNOWN);
+                for(MeshModel* m = meshDocument.nextMesh();m != NULL;m = meshDocument.nextMesh(m))
+                    m->invalidateTopology(changedMask);
+                // the layers expanded for the filter go back to their compact form
+                meshDocument.recompactMeshes(expanded);
+                // the layers touched by the filter are written again by saveProject
+                if (onLayers)
+                {
+                    foreach(MeshModel* m, layers)
+                        m->meshModified() = true;
+                }
+                else if ((iFilter->filterArity(action) == MeshFilterInterface::SINGLE_MESH) && (meshDocument.mm() != NULL))
+                    meshDocument.mm()->meshModified() = true;
+                else
+                {
+                    for(MeshModel* m = meshDocument.nextMesh();m != NULL;m = meshDocument.nextMesh(m))
+                        m->meshModified() = true;
+                }
                 meshDocument.setBusy(false);
                 delete iFilter->glContext;
             }
@@ -396,6 +511,7 @@ public:
                         cppfilt->setLog(&log);
 
                         Env env;
+                        QList<MeshModel*> expanded = meshDocument.expandCompactMeshes();
                         env.loadMLScriptEnv(meshDocument,PM);
                         XMLFilterNameParameterValuesPair* xmlfilt = reinterpret_cast<XMLFilterNameParameterValuesPair*>(*ii);
                         QMap<QString,QString>& parmap = xmlfilt->pair.second;
@@ -434,7 +550,23 @@ public:
                         //WARNING!!!!!!!!!!!!
                         /* IT SHOULD INVOKE executeFilter function. Unfortunately this function create a different thread for each invoked filter, and the MeshLab synchronization mechanisms are quite naive. Better to invoke the filters list in the same thread*/
                         meshDocument.setBusy(true);
-                        ret = cppfilt->applyFilter( fname, meshDocument, envwrap, filterCallBack );
+                        {
+                            MLTraceSpan span(fname,"filter");
+                            ret = cppfilt->applyFilter( fname, meshDocument, envwrap, filterCallBack );
+                            if (meshDocument.mm() != NULL)
+                                span.setCounts(meshDocument.mm()->cm.vn,meshDocument.mm()->cm.fn);
+                        }
+                        // xml filters without a declared post condition can have changed anything
+                        QString postCond = info->filterAttribute(fname,MLXMLElNames::filterPostCond);
+                        int changedMask = MeshLabFilterInterface::convertStringListToMeshElementEnum(postCond.split(QRegExp("\\W+"), QString::SkipEmptyParts));
+                        if (!ret || (changedMask == MeshModel::MM_NONE))
+                            changedMask = MeshModel::MM_UNKNOWN;
+                        for(MeshModel* m = meshDocument.nextMesh();m != NULL;m = meshDocument.nextMesh(m))
+                        {
+                            m->invalidateTopology(changedMask);
+                            m->meshModified() = true;
+                        }
+                        meshDocument.recompactMeshes(expanded);
                         meshDocument.setBusy(false);
                         ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
                         delete cppfilt->glContext;
@@ -456,16 +588,331 @@ public:
                 fprintf(fp,"Problem with filter: %s\n",qPrintable(fname));
                 return false;
             }
+            const int step = int(ii - scriptPtr.filtparlist.begin());
+            if (step < cacheKeys.size())
+                filterCache.store(cacheKeys[step],meshDocument);
         }
         return true;
     }
 
+    MLFilterCache &cache() {return filterCache;}
+    // the filters that support it are applied to all the visible layers
+    void setAllLayers(bool on) {allLayers = on;}
+
 private:
     PluginManager PM;
     RichParameterSet defaultGlobal;
+    MLFilterCache filterCache;
+    bool allLayers;
 
 };
 
+/*
+  Resident mode: the plugins are loaded once and the documents stay in memory between
+  the commands read from a local socket (QLocalServer) or from the standard input.
+
+  The protocol is line based. A request is a command followed by key=value arguments,
+  values with blanks are enclosed in double quotes:
+      load doc=scan file="/data/big scan.ply"
+  every request gets exactly one line of response, starting with ok or error and
+  followed by the time spent on the command and its results:
+      ok ms=5310.2 mesh=0 vn=12000000 fn=24000000
+      error ms=0.1 message="unknown document scan2"
+  See meshlabserver.txt for the list of the commands.
+*/
+class MeshLabDaemon
+{
+public:
+    MeshLabDaemon(MeshLabServer &server,MeshDocument &initialDoc,FILE *logfp)
+        :_server(server),_initialDoc(&initialDoc),_logfp(logfp)
+    {
+        _docs["default"] = &initialDoc;
+    }
+
+    ~MeshLabDaemon()
+    {
+        foreach(MeshDocument *md,_docs)
+            if (md != _initialDoc)
+                delete md;
+    }
+
+    // Serves the clients of the local socket name, one at a time, until a quit command
+    bool serveSocket(const QString &name)
+    {
+        QLocalServer::removeServer(name);
+        QLocalServer localServer;
+        if (!localServer.listen(name))
+        {
+            fprintf(_logfp,"Cannot listen on %s: %s\n",qPrintable(name),qPrintable(localServer.errorString()));
+            return false;
+        }
+        fprintf(_logfp,"MeshLabServer listening on %s\n",qPrintable(localServer.fullServerName()));
+        fflush(_logfp);
+        bool quit = false;
+        while (!quit && localServer.waitForNewConnection(-1))
+        {
+            QLocalSocket *client = localServer.nextPendingConnection();
+            while (!quit && client->state() == QLocalSocket::ConnectedState)
+            {
+                if (!client->canReadLine())
+                {
+                    client->waitForReadyRead(-1);
+                    continue;
+                }
+                QString request = QString::fromUtf8(client->readLine()).trimmed();
+                if (request.isEmpty())
+                    continue;
+                client->write((handle(request,quit) + "\n").toUtf8());
+                client->flush();
+                while (client->bytesToWrite() > 0 && client->waitForBytesWritten(-1)) {}
+            }
+            client->disconnectFromServer();
+            delete client;
+        }
+        return true;
+    }
+
+    // Returns a stream on the original standard output and moves everything else printed
+    // there (messages of the server, of the filters and of the plugins) to the standard error,
+    // so that nothing but the responses reaches the client
+    static FILE *detachStdout()
+    {
+        fflush(stdout);
+#if defined(Q_OS_WIN)
+        FILE *out = _fdopen(_dup(_fileno(stdout)),"w");
+        _dup2(_fileno(stderr),_fileno(stdout));
+#else
+        FILE *out = fdopen(dup(fileno(stdout)),"w");
+        dup2(fileno(stderr),fileno(stdout));
+#endif
+        return out;
+    }
+
+    // Serves the requests of the standard input, the responses are written on out
+    bool serveStdin(FILE *out)
+    {
+        if (out == NULL)
+            return false;
+        QTextStream in(stdin);
+        bool quit = false;
+        while (!quit)
+        {
+            QString request = in.readLine();
+            if (request.isNull())
+                break;
+            request = request.trimmed();
+            if (request.isEmpty())
+                continue;
+            fprintf(out,"%s\n",handle(request,quit).toUtf8().constData());
+            fflush(out);
+        }
+        fclose(out);
+        return true;
+    }
+
+    // Executes a request and returns the response line
+    QString handle(const QString &request,bool &quit)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QStringList words = splitWords(request);
+        QString cmd = words.isEmpty() ? QString() : words.takeFirst();
+        QMap<QString,QString> args;
+        foreach(const QString &w,words)
+        {
+            int eq = w.indexOf('=');
+            if (eq <= 0)
+                return response(false,timer,"message=" + quoted("invalid argument " + w));
+            args[w.left(eq)] = w.mid(eq + 1);
+        }
+
+        QString result;
+        bool ok;
+        {
+            MLTraceSpan span("Daemon " + cmd,"daemon");
+            ok = execute(cmd,args,result,quit);
+        }
+        fflush(_logfp);
+        return response(ok,timer,ok ? result : "message=" + quoted(result));
+    }
+
+private:
+    bool execute(const QString &cmd,const QMap<QString,QString> &args,QString &result,bool &quit)
+    {
+        const QString docName = args.value("doc","default");
+        if (cmd == "load")
+        {
+            if (!args.contains("file"))
+                return fail(result,"missing file");
+            MeshDocument *md = _docs.value(docName,NULL);
+            if (md == NULL)
+                md = _docs[docName] = new MeshDocument();
+            QString fileName = QFileInfo(args["file"]).absoluteFilePath();
+            MeshModel *mm = md->addNewMesh(fileName,"");
+            if ((mm == NULL) || !_server.importMesh(*mm,fileName,_logfp))
+            {
+                if (mm != NULL)
+                    md->delMesh(mm);
+                return fail(result,"cannot load " + fileName);
+            }
+            result = QString("mesh=%1 vn=%2 fn=%3").arg(mm->id()).arg(mm->cm.vn).arg(mm->cm.fn);
+            return true;
+        }
+        if (cmd == "list")
+        {
+            QStringList docs;
+            for(QMap<QString,MeshDocument*>::const_iterator it = _docs.constBegin();it != _docs.constEnd();++it)
+                docs << QString("%1:%2").arg(it.key()).arg(it.value()->size());
+            result = "docs=" + quoted(docs.join(" "));
+            return true;
+        }
+        if (cmd == "quit")
+        {
+            quit = true;
+            return true;
+        }
+
+        MeshDocument *md = _docs.value(docName,NULL);
+        if (md == NULL)
+            return fail(result,"unknown document " + docName);
+        if (cmd == "unload")
+        {
+            _docs.remove(docName);
+            if (md != _initialDoc)
+                delete md;
+            else
+                while (!md->meshList.isEmpty())
+                    md->delMesh(md->meshList.front());
+            return true;
+        }
+        if (cmd == "run")
+        {
+            if (!args.contains("script"))
+                return fail(result,"missing script");
+            QString scriptName = QFileInfo(args["script"]).absoluteFilePath();
+            if (!_server.script(*md,scriptName,_logfp))
+                return fail(result,"failed script " + scriptName);
+            if (md->mm() != NULL)
+                result = QString("mesh=%1 vn=%2 fn=%3").arg(md->mm()->id()).arg(md->mm()->cm.vn).arg(md->mm()->cm.fn);
+            return true;
+        }
+
+        MeshModel *mm = args.contains("mesh") ? md->getMesh(args["mesh"].toInt()) : md->mm();
+        if (mm == NULL)
+            return fail(result,"no mesh");
+        if (cmd == "save")
+        {
+            if (!args.contains("file"))
+                return fail(result,"missing file");
+            int mask = 0;
+            if (!saveMask(args.value("mask"),*mm,mask))
+                return fail(result,"invalid mask " + args.value("mask"));
+            QString fileName = QFileInfo(args["file"]).absoluteFilePath();
+            if (!_server.exportMesh(mm,mask,fileName,_logfp))
+                return fail(result,"cannot save " + fileName);
+            result = QString("vn=%1 fn=%2").arg(mm->cm.vn).arg(mm->cm.fn);
+            return true;
+        }
+        if (cmd == "measure")
+        {
+            vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);
+            const Box3m &bb = mm->cm.bbox;
+            result = QString("mesh=%1 vn=%2 fn=%3 bbox=%4 diag=%5 area=%6")
+                .arg(mm->id()).arg(mm->cm.vn).arg(mm->cm.fn)
+                .arg(quoted(QString("%1 %2 %3 %4 %5 %6").arg(bb.min[0]).arg(bb.min[1]).arg(bb.min[2]).arg(bb.max[0]).arg(bb.max[1]).arg(bb.max[2])))
+                .arg(bb.Diag()).arg(vcg::tri::Stat<CMeshO>::ComputeMeshArea(mm->cm));
+            return true;
+        }
+        return fail(result,"unknown command " + cmd);
+    }
+
+    static bool fail(QString &result,const QString &message)
+    {
+        result = message;
+        return false;
+    }
+
+    // the attributes codes of the -m option, separated by commas; "all" saves what the mesh has
+    static bool saveMask(const QString &codes,MeshModel &mm,int &mask)
+    {
+        using namespace vcg::tri::io;
+        static const char *names[] = {"vc","vf","vn","vq","vt","fc","ff","fn","fq","wc","wn","wt"};
+        static const int bits[] = {Mask::IOM_VERTCOLOR,Mask::IOM_VERTFLAGS,Mask::IOM_VERTNORMAL,Mask::IOM_VERTQUALITY,Mask::IOM_VERTTEXCOORD,
+                                   Mask::IOM_FACECOLOR,Mask::IOM_FACEFLAGS,Mask::IOM_FACENORMAL,Mask::IOM_FACEQUALITY,
+                                   Mask::IOM_WEDGCOLOR,Mask::IOM_WEDGNORMAL,Mask::IOM_WEDGTEXCOORD};
+        mask = 0;
+        if (codes == "all")
+        {
+            // the mask is made of IOM bits, the ones of the attributes the mesh has
+            for(int ii = 0;ii < 12;++ii)
+                if (mm.hasDataMask(MeshModel::io2mm(bits[ii])))
+                    mask |= bits[ii];
+            return true;
+        }
+        foreach(const QString &code,codes.split(',',QString::SkipEmptyParts))
+        {
+            int ii = 0;
+            while ((ii < 12) && (code != names[ii]))
+                ++ii;
+            if (ii == 12)
+                return false;
+            mask |= bits[ii];
+        }
+        return true;
+    }
+
+    static QString response(bool ok,const QElapsedTimer &timer,const QString &result)
+    {
+        QString res = QString("%1 ms=%2").arg(ok ? "ok" : "error").arg(double(timer.nsecsElapsed()) / 1e6,0,'f',1);
+        return result.isEmpty() ? res : res + " " + result;
+    }
+
+    static QString quoted(QString s)
+    {
+        s.replace('\\',"\\\\").replace('"',"\\\"").replace('\n',' ');
+        return "\"" + s + "\"";
+    }
+
+    // splits at blanks, keeping together what is enclosed in double quotes (\" and \\ are escapes)
+    static QStringList splitWords(const QString &line)
+    {
+        QStringList words;
+        QString word;
+        bool inWord = false,inQuotes = false;
+        for(int ii = 0;ii < line.size();++ii)
+        {
+            QChar c = line[ii];
+            if (inQuotes && (c == '\\') && (ii + 1 < line.size()))
+                word += line[++ii];
+            else if (c == '"')
+            {
+                inQuotes = !inQuotes;
+                inWord = true;
+            }
+            else if (c.isSpace() && !inQuotes)
+            {
+                if (inWord)
+                    words << word;
+                word.clear();
+                inWord = false;
+            }
+            else
+            {
+                word += c;
+                inWord = true;
+            }
+        }
+        if (inWord)
+            words << word;
+        return words;
+    }
+
+    MeshLabServer &_server;
+    MeshDocument *_initialDoc;
+    FILE *_logfp;
+    QMap<QString,MeshDocument*> _docs;
+};
+
 namespace commandline
 {
     const char inproject('p');
@@ -485,6 +932,10 @@ namespace commandline
     const char log('l');
     const char dump('d');
     const char script('s');
+    const char trace('t');
+    const char resident('r');
+    const char cache('c');
+    const char alllayers('a');
 
     void usage()
     {
@@ -513,7 +964,7 @@ namespace commandline
     {
         QString logstring("(" + optionValueExpression(log) + "\\s+" +  optionValueExpression(dump) + "|" + optionValueExpression(dump) + "\\s+" +  optionValueExpression(log) + "|" +  optionValueExpression(dump) + "|" + optionValueExpression(log) + ")");
         //QString remainstring("(" + optionValueExpression(inproject) + "|" + optionValueExpression(inputmeshes,true) + ")" + "(\\s+" + optionValueExpression(inproject) + "|\\s+" + optionValueExpression(inputmeshes,true) + ")*(\\s+" + optionValueExpression(outproject) + "|\\s+" + optionValueExpression(script) + "|\\s+" + outputmeshExpression() + ")*");
-        QString arg("(" + optionValueExpression(inproject) + "|" + optionValueExpression(inputmeshes) + "|" + optionValueExpression(outproject) + "(\\s+-v)?" + "|" + optionValueExpression(script) + "|" + outputmeshExpression() + ")");
+        QString arg("(" + optionValueExpression(inproject) + "|" + optionValueExpression(inputmeshes) + "|" + optionValueExpression(outproject) + "(\\s+-v)?" + "|" + optionValueExpression(script) + "|" + optionValueExpression(trace) + "|" + optionValueExpression(resident) + "|" + optionValueExpression(cache) + "|-" + QString(alllayers) + "|" + outputmeshExpression() + ")");
         QString args("(" + arg + ")(\\s+" + arg + ")*");
         QString completecommandline("(" + logstring + "|" + logstring + "\\s+" + args + "|" + args + ")");
         QRegExp completecommandlineexp(completecommandline);
@@ -551,8 +1002,11 @@ int main(int argc, char *argv[])
         exit(-1);
     }
     QStringList scriptfiles;
+    QString tracefile = MLTracer::environmentFileName();
     QList<OutFileMesh> outmeshlist;
     QList<OutProject> outprojectfiles;
+    QString residentname;
+    FILE* protocolfp = NULL;
 
 
     QString cmdline;
@@ -566,9 +1020,23 @@ int main(int argc, char *argv[])
         exit(-1);
     }
 
+    // with the requests coming from the standard input the standard output is reserved to the responses
+    for(int ii = 1;ii + 1 < argc;++ii)
+        if (QString(argv[ii]) == QString("-") + commandline::resident)
+            residentname = argv[ii+1];
+    if (residentname == "-")
+        protocolfp = MeshLabDaemon::detachStdout();
+
     printf("Loading Plugins:\n");
     server.loadPlugins();
 
+    // tracing has to start before the meshes are loaded, whatever the position of the option
+    for(int ii = 1;ii + 1 < argc;++ii)
+        if (QString(argv[ii]) == QString("-") + commandline::trace)
+            tracefile = QFileInfo(argv[ii+1]).absoluteFilePath();
+    if (!tracefile.isEmpty())
+        MLTracer::setEnabled(true);
+
     MeshDocument meshDocument;
     int i = 1;
     while(i < argc)
@@ -726,6 +1194,27 @@ int main(int argc, char *argv[])
                 i += 2;
                 break;
             }
+        case commandline::trace :
+        case commandline::resident :
+            {
+                // already handled before parsing the other options
+                i += 2;
+                break;
+            }
+        case commandline::cache :
+            {
+                server.cache().setDirectory(QFileInfo(argv[i+1]).absoluteFilePath());
+                fprintf(logfp,"Filter cache in %s\n",qPrintable(server.cache().directory()));
+                i += 2;
+                break;
+            }
+        case commandline::alllayers :
+            {
+                server.setAllLayers(true);
+                fprintf(logfp,"The filters that support it are applied to all the visible layers\n");
+                ++i;
+                break;
+            }
         case commandline::log :
             {
                 //freopen redirect both std::cout and printf. Now I'm quite sure i will get everything the plugins will print in the standard output (i hope no one used std::cerr...)
@@ -804,6 +1293,23 @@ int main(int argc, char *argv[])
             fprintf(logfp,"Invalid current mesh. Output mesh %s will not be saved\n",qPrintable(outmeshlist[ii].filename));
     }
 
+    if (!residentname.isEmpty())
+    {
+        // the document built by the other options is available as "default"
+        MeshLabDaemon daemon(server,meshDocument,logfp);
+        bool served = (residentname == "-") ? daemon.serveStdin(protocolfp) : daemon.serveSocket(residentname);
+        if (!served)
+            fprintf(logfp,"MeshLabServer resident mode could not be started\n");
+    }
+
+    if (!tracefile.isEmpty())
+    {
+        if (MLTracer::instance().saveChromeTrace(tracefile))
+            fprintf(logfp,"Trace of %i events saved in %s\n",MLTracer::instance().eventCount(),qPrintable(tracefile));
+        else
+            fprintf(logfp,"Error occurred saving the trace file %s\n",qPrintable(tracefile));
+    }
+
     if((logfp != NULL) && (logfp != stdout))
         fclose(logfp);
     return 0;
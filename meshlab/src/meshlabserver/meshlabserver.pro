@@ -13,6 +13,7 @@ RC_FILE = ../meshlab/meshlab.rc
 QT           += xml opengl
 QT += xmlpatterns
 QT += script
+QT += network
 #QT -= gui # Only the core module is used.
 DESTDIR = ../distrib
 macx:DESTDIR = ../distrib/meshlab.app/Contents/MacOS/
@@ -54,3 +55,8 @@ CONFIG += console
 
 # Mac specific Config required to avoid to make application bundles
 CONFIG -= app_bundle
+
+# "make benchmark" runs the filter benchmark suite (see benchmark/README.txt)
+benchmark.commands = python3 $$PWD/benchmark/mlbench.py run --server $$DESTDIR/$$TARGET -o mlbench.json
+benchmark.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += benchmark
@@ -0,0 +1,28 @@
+# Include this file in the .pro of any module that wants to use OpenMP.
+# The code must guard both the pragmas and the omp.h inclusion with
+#   #ifdef _USE_OMP
+# so that it still compiles (and runs serially) where OpenMP is not available.
+
+win32-msvc2005:QMAKE_CXXFLAGS += /openmp -D_USE_OMP
+win32-msvc2008:QMAKE_CXXFLAGS += /openmp -D_USE_OMP
+win32-msvc2010:QMAKE_CXXFLAGS += /openmp -D_USE_OMP
+win32-msvc2012:QMAKE_CXXFLAGS += /openmp -D_USE_OMP
+win32-msvc2013:QMAKE_CXXFLAGS += /openmp -D_USE_OMP
+win32-msvc2015:QMAKE_CXXFLAGS += /openmp -D_USE_OMP
+
+win32-g++:QMAKE_CXXFLAGS += -fopenmp -D_USE_OMP
+win32-g++:QMAKE_LFLAGS   += -fopenmp
+linux-g++:QMAKE_CXXFLAGS += -fopenmp -D_USE_OMP
+linux-g++:QMAKE_LFLAGS   += -fopenmp
+linux-g++-32:QMAKE_CXXFLAGS += -fopenmp -D_USE_OMP
+linux-g++-32:QMAKE_LFLAGS   += -fopenmp
+linux-g++-64:QMAKE_CXXFLAGS += -fopenmp -D_USE_OMP
+linux-g++-64:QMAKE_LFLAGS   += -fopenmp
+
+# Apple clang does not ship OpenMP, only macports gcc does.
+macx: {
+  contains(QMAKE_CXX,g++-mp-4.8) {
+    QMAKE_CXXFLAGS += -fopenmp -D_USE_OMP
+    QMAKE_LFLAGS += -fopenmp
+  }
+}
@@ -25,6 +25,10 @@
 #include <windows.h>
 #endif
 
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
 #include "Src/MarchingCubes.h"
 #include "Src/Octree.h"
 #include "Src/SparseMatrix.h"
@@ -95,6 +99,7 @@ bool NonManifoldFlag;
   int CGDepthVal;
   int ItersVal;
   Real CSSolverAccuracyVal;
+  int ThreadsVal;
 
   PoissonParam()
   {
@@ -117,6 +122,11 @@ bool NonManifoldFlag;
     CGDepthVal=0;
     ItersVal=8;
     CSSolverAccuracyVal=1e-3f;
+#ifdef _USE_OMP
+    ThreadsVal=omp_get_num_procs();
+#else
+    ThreadsVal=1;
+#endif
   }
 };
 
@@ -207,6 +217,141 @@ public:
   }
 };
 
+/*
+  Streams the oriented points of a binary PLY file directly from the disk, so that
+  point clouds too large to be loaded in a MeshDocument can still be reconstructed.
+  The vertex element must be the first one of the file and must have x,y,z,nx,ny,nz
+  stored as float or double; the other (fixed size) vertex properties are skipped.
+*/
+template< class Real >
+class BinaryPlyPointStream : public PointStream< Real >
+{
+  FILE *_fp;
+  long _dataStart;
+  size_t _vertNum, _curPos;
+  size_t _stride;          // size of a vertex in bytes
+  int _offset[6];          // offsets of x y z nx ny nz inside a vertex
+  int _size[6];            // 4 (float) or 8 (double)
+  bool _swap;              // file endianness differs from the host one
+  std::vector<char> _buf;
+  size_t _bufNum, _bufPos; // vertices in the buffer and next one to be returned
+  QString _error;
+
+  static int typeSize(const QByteArray &t)
+  {
+    if(t=="char" || t=="uchar" || t=="int8" || t=="uint8") return 1;
+    if(t=="short" || t=="ushort" || t=="int16" || t=="uint16") return 2;
+    if(t=="int" || t=="uint" || t=="float" || t=="int32" || t=="uint32" || t=="float32") return 4;
+    if(t=="double" || t=="float64") return 8;
+    return 0;
+  }
+
+  bool parseHeader()
+  {
+    static const char *names[6] = {"x","y","z","nx","ny","nz"};
+    char line[1024];
+    bool inVertex=false, littleEndian=true;
+    if(!fgets(line,sizeof(line),_fp) || QByteArray(line).trimmed()!="ply") { _error="Not a PLY file"; return false; }
+    for(int i=0;i<6;++i) _offset[i]=-1;
+    while(fgets(line,sizeof(line),_fp))
+    {
+      QList<QByteArray> tok = QByteArray(line).simplified().split(' ');
+      if(tok[0]=="end_header")
+      {
+        _dataStart = ftell(_fp);
+        for(int i=0;i<6;++i)
+          if(_offset[i]<0) { _error=QString("Missing vertex property '%1'").arg(names[i]); return false; }
+        unsigned short one=1;
+        bool hostLittle = (*((unsigned char *)&one)==1);
+        _swap = (hostLittle!=littleEndian);
+        return true;
+      }
+      if(tok[0]=="format")
+      {
+        if(tok.size()<2 || tok[1]=="ascii") { _error="Only binary PLY files can be streamed"; return false; }
+        littleEndian = (tok[1]=="binary_little_endian");
+      }
+      else if(tok[0]=="element" && tok.size()>=3)
+      {
+        if(tok[1]=="vertex")
+        {
+          if(_vertNum>0 || _stride>0) { _error="Vertex element is not the first one"; return false; }
+          _vertNum = tok[2].toULongLong();
+          inVertex = true;
+        }
+        else
+        {
+          if(!inVertex) { _error="Vertex element is not the first one"; return false; }
+          inVertex = false;
+        }
+      }
+      else if(tok[0]=="property" && inVertex)
+      {
+        if(tok.size()<3 || tok[1]=="list") { _error="List properties are not supported in the vertex element"; return false; }
+        int sz = typeSize(tok[1]);
+        if(sz==0) { _error=QString("Unknown property type '%1'").arg(QString(tok[1])); return false; }
+        for(int i=0;i<6;++i)
+          if(tok[2]==names[i])
+          {
+            if(tok[1]!="float" && tok[1]!="float32" && tok[1]!="double" && tok[1]!="float64")
+            { _error=QString("Property '%1' must be float or double").arg(names[i]); return false; }
+            _offset[i]=int(_stride); _size[i]=sz;
+          }
+        _stride+=sz;
+      }
+    }
+    _error="Unexpected end of the PLY header";
+    return false;
+  }
+
+  Real readValue(const char *p, int size) const
+  {
+    char tmp[8];
+    memcpy(tmp,p,size);
+    if(_swap) std::reverse(tmp,tmp+size);
+    if(size==4) { float f; memcpy(&f,tmp,4); return Real(f); }
+    double d; memcpy(&d,tmp,8); return Real(d);
+  }
+
+public:
+  BinaryPlyPointStream(const QString &fileName):_fp(0),_dataStart(0),_vertNum(0),_curPos(0),_stride(0),_swap(false),_bufNum(0),_bufPos(0)
+  {
+    _fp = fopen(qPrintable(fileName),"rb");
+    if(!_fp) { _error=QString("Unable to open '%1'").arg(fileName); return; }
+    if(!parseHeader()) { fclose(_fp); _fp=0; return; }
+    _buf.resize(_stride*(1<<16));
+  }
+  ~BinaryPlyPointStream( void ) { if(_fp) fclose(_fp); }
+  bool isValid() const { return _fp!=0; }
+  const QString &errorString() const { return _error; }
+  size_t size() const { return _vertNum; }
+  void reset( void )
+  {
+    if(_fp) fseek(_fp,_dataStart,SEEK_SET);
+    _curPos=0; _bufNum=0; _bufPos=0;
+  }
+  bool nextPoint( Point3D< Real >& p , Point3D< Real >& n )
+  {
+    if(!_fp || _curPos>=_vertNum) return false;
+    if(_bufPos>=_bufNum)
+    {
+      size_t toRead = std::min(_vertNum-_curPos, _buf.size()/_stride);
+      _bufNum = fread(&_buf[0],_stride,toRead,_fp);
+      _bufPos = 0;
+      if(_bufNum==0) { _curPos=_vertNum; return false; } // truncated file
+    }
+    const char *v = &_buf[_bufPos*_stride];
+    for(int i=0;i<3;++i)
+    {
+      p[i] = readValue(v+_offset[i],_size[i]);
+      n[i] = readValue(v+_offset[i+3],_size[i+3]);
+    }
+    ++_bufPos; ++_curPos;
+    return true;
+  }
+};
+
+
 
 template< class Real>
 bool Execute(PointStream< Real > *ps, CMeshO &pm, PoissonParam<Real> &pp, vcg::CallBackPos* cb)
@@ -221,7 +366,7 @@ bool Execute(PointStream< Real > *ps, CMeshO &pm, PoissonParam<Real> &pp, vcg::C
   Real isoValue = 0;
 
   Octree< Real > tree;
-  tree.threads = 1;
+  tree.threads = std::max(1, pp.ThreadsVal);
   if( pp.MaxSolveDepthVal<0 ) pp.MaxSolveDepthVal = pp.MaxDepthVal;
 
   //    OctNode< TreeNodeData >::SetAllocator( MEMORY_ALLOCATOR_BLOCK_SIZE );
@@ -359,9 +504,6 @@ bool FilterScreenedPoissonPlugin::applyFilter( const QString& filterName,MeshDoc
     pm->updateDataMask(MeshModel::MM_VERTQUALITY);
     PoissonParam<Scalarm> pp;
 
-    MeshModelPointStream<Scalarm> meshStream(mm->cm);
-    MeshDocumentPointStream<Scalarm> documentStream(md);
-
     pp.MaxDepthVal = env.evalInt("depth");
     pp.FullDepthVal = env.evalInt("fullDepth");
     pp.CGDepthVal= env.evalInt("cgDepth");
@@ -372,17 +514,34 @@ bool FilterScreenedPoissonPlugin::applyFilter( const QString& filterName,MeshDoc
     pp.ConfidenceFlag = env.evalBool("confidence");
     pp.NormalWeightsFlag = env.evalBool("nWeights");
     pp.DensityFlag = true;
-    if(env.evalBool("visibleLayer"))
+    if(env.evalInt("threads")>0) pp.ThreadsVal = env.evalInt("threads");
+
+    QString fileName = env.evalString("fileName");
+    if(!fileName.isEmpty())
+    {
+      BinaryPlyPointStream<Scalarm> fileStream(fileName);
+      if(!fileStream.isValid())
+      {
+        this->errorMessage = fileStream.errorString();
+        md.delMesh(pm);
+        return false;
+      }
+      Log("Streaming %i points from %s",int(fileStream.size()),qPrintable(fileName));
+      Execute<Scalarm>(&fileStream,pm->cm,pp,cb);
+    }
+    else if(env.evalBool("visibleLayer"))
     {
       MeshModel *m=0;
       while(m=md.nextVisibleMesh(m))
         PoissonClean(m->cm, (pp.ConfidenceFlag || pp.NormalWeightsFlag));
 
+      MeshDocumentPointStream<Scalarm> documentStream(md);
       Execute<Scalarm>(&documentStream,pm->cm,pp,cb);
     }
     else
     {
       PoissonClean(mm->cm, (pp.ConfidenceFlag || pp.NormalWeightsFlag));
+      MeshModelPointStream<Scalarm> meshStream(mm->cm);
       Execute<Scalarm>(&meshStream,pm->cm,pp,cb);
     }
     pm->UpdateBoxAndNormals();